@@ -0,0 +1,691 @@
+#include "c_emit.h"
+#include "../semantic/symtab.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! Growing string
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+} text_t;
+
+//! Declarations of a name inside the function being emitted
+typedef struct {
+  const char *name; // Interned
+  int count;
+} name_count_t;
+
+typedef struct {
+  FILE *output;
+  text_t body;  // Of the function, printed once its temporaries are known
+  int temps;    // Used by the function
+  int indent;
+  name_count_t *names;
+  int name_count;
+  int name_capacity;
+} emitter_t;
+
+static void *emit_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the C source.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void text_vprintf(text_t *text, const char *format, va_list args) {
+  va_list copy;
+  va_copy(copy, args);
+  int length = vsnprintf(NULL, 0, format, copy);
+  va_end(copy);
+
+  if (text->length + length + 1 > text->capacity) {
+    while (text->length + length + 1 > text->capacity)
+      text->capacity = text->capacity ? text->capacity * 2 : 256;
+    text->data = (char *)emit_realloc(text->data, text->capacity);
+  }
+  vsnprintf(text->data + text->length, length + 1, format, args);
+  text->length += length;
+}
+
+static void text_printf(text_t *text, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  text_vprintf(text, format, args);
+  va_end(args);
+}
+
+//! Formats into a new string
+static char *format(const char *format, ...) {
+  text_t text = {0};
+  va_list args;
+  va_start(args, format);
+  text_vprintf(&text, format, args);
+  va_end(args);
+  return text.data ? text.data : (char *)emit_realloc(NULL, 1);
+}
+
+//! Appends a line of the function body at the current indentation
+static void line(emitter_t *e, const char *format, ...) {
+  va_list args;
+
+  text_printf(&e->body, "%*s", 2 * e->indent, "");
+  va_start(args, format);
+  text_vprintf(&e->body, format, args);
+  va_end(args);
+  text_printf(&e->body, "\n");
+}
+
+// ----------------------- Names ----------------------
+
+//! Numbers a parameter or local among the ones of the same name
+static void declare(emitter_t *e, symbol_t *symbol) {
+  for (int n = 0; n < e->name_count; n++)
+    if (e->names[n].name == symbol->name) {
+      symbol->location = ++e->names[n].count;
+      return;
+    }
+
+  if (e->name_count == e->name_capacity) {
+    e->name_capacity = e->name_capacity ? e->name_capacity * 2 : 16;
+    e->names = (name_count_t *)emit_realloc(
+        e->names, e->name_capacity * sizeof(name_count_t));
+  }
+  e->names[e->name_count++] = (name_count_t){symbol->name, 1};
+  symbol->location = 1;
+}
+
+static char *name_of(const symbol_t *symbol) {
+  if (symbol->scope_depth == 0)
+    return format("cm_%s", symbol->name);
+  return format("%s_%d", symbol->name, symbol->location);
+}
+
+static char *temp(emitter_t *e, int index) {
+  if (index + 1 > e->temps)
+    e->temps = index + 1;
+  return format("t%d", index);
+}
+
+// ----------------------- Expressions ----------------------
+
+static char *expression(emitter_t *e, ast_node_t *node, int base, int top);
+
+//! The expression calls a function or assigns a variable
+static int has_effects(ast_node_t *node) {
+  if (!node)
+    return 0;
+
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+  case AST_ACTIVATION:
+    return 1;
+  case AST_SIMPLE_EXPRESSION:
+    return has_effects(node->data.simple_expression.left) ||
+           has_effects(node->data.simple_expression.right);
+  case AST_ADDITIVE_EXPRESSION:
+    return has_effects(node->data.additive_expression.left) ||
+           has_effects(node->data.additive_expression.right);
+  case AST_TERM:
+    return has_effects(node->data.term.left) ||
+           has_effects(node->data.term.right);
+  case AST_FACTOR:
+    return has_effects(node->data.factor.expression) ||
+           has_effects(node->data.factor.variable) ||
+           has_effects(node->data.factor.activation);
+  case AST_VARIABLE:
+    return has_effects(node->data.variable.index);
+  default:
+    return 0;
+  }
+}
+
+//! Skips the parentheses and the levels of the grammar without operator
+static ast_node_t *unwrap(ast_node_t *node) {
+  for (;;) {
+    if (node->type == AST_FACTOR && node->data.factor.expression)
+      node = node->data.factor.expression;
+    else if (node->type == AST_SIMPLE_EXPRESSION &&
+             !node->data.simple_expression.relational_op)
+      node = node->data.simple_expression.left;
+    else if (node->type == AST_ADDITIVE_EXPRESSION &&
+             !node->data.additive_expression.add_op)
+      node = node->data.additive_expression.left;
+    else if (node->type == AST_TERM && !node->data.term.mult_op)
+      node = node->data.term.left;
+    else
+      return node;
+  }
+}
+
+//! The value of the expression is the same whenever it is evaluated:
+//! numbers and arrays passed whole
+static int is_constant(ast_node_t *node) {
+  node = unwrap(node);
+  if (node->type != AST_FACTOR)
+    return 0;
+  if (node->data.factor.variable)
+    return !node->data.factor.variable->data.variable.index &&
+           node->data.factor.variable->symbol->kind == SYM_ARRAY;
+  return !node->data.factor.activation;
+}
+
+//! The expression is an assignment or a call, whose value may be dropped
+//! silently. Other values alone are cast to void
+static int is_statement(ast_node_t *node) {
+  node = unwrap(node);
+  return node->type == AST_ASSIGNMENT_EXPRESSION ||
+         (node->type == AST_FACTOR && node->data.factor.activation);
+}
+
+//! Emits the operands of an operator or a call into 'texts'. C leaves the
+//! order of their evaluation open, so when one has effects and another may
+//! see them, every operand but the last that is not a constant goes first
+//! into a temporary, in order. Returns the assignments to put before, with
+//! their commas, or NULL. Operands of a relation keep their parentheses
+static char *operands(emitter_t *e, ast_node_t **nodes, int count, int base,
+                      int top, char **texts) {
+  int effects = 0, variable = 0;
+
+  for (int i = 0; i < count; i++) {
+    effects |= has_effects(nodes[i]);
+    variable += !is_constant(nodes[i]);
+  }
+
+  if (!effects || variable < 2) {
+    for (int i = 0; i < count; i++)
+      texts[i] = expression(e, nodes[i], base, top);
+    return NULL;
+  }
+
+  text_t prefix = {0};
+  for (int i = 0; i < count; i++) {
+    if (i == count - 1 || is_constant(nodes[i])) {
+      texts[i] = expression(e, nodes[i], base, top);
+      continue;
+    }
+    char *value = expression(e, nodes[i], base + 1, 1);
+    texts[i] = temp(e, base++);
+    text_printf(&prefix, "%s = %s, ", texts[i], value);
+    free(value);
+  }
+  return prefix.data;
+}
+
+//! Puts the assignments of the operands before the expression
+static char *sequenced(char *prefix, char *result) {
+  if (!prefix)
+    return result;
+
+  char *sequence = format("(%s%s)", prefix, result);
+  free(prefix);
+  free(result);
+  return sequence;
+}
+
+static char *number(int value) {
+  if (value == -2147483647 - 1)
+    return format("(-2147483647 - 1)");
+  return value < 0 ? format("(%d)", value) : format("%d", value);
+}
+
+static char *call(emitter_t *e, ast_node_t *node, int base) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *nodes[symbol->param_count + 1];
+  char *texts[symbol->param_count + 1];
+  int count = 0;
+
+  for (ast_node_t *list = node->data.activation.args; list;
+       list = list->data.argument_list.arg_list)
+    nodes[count++] = list->data.argument_list.expression;
+
+  char *prefix = operands(e, nodes, count, base, 1, texts);
+  text_t result = {0};
+  if (symbol->is_builtin)
+    text_printf(&result, "cmrt_%s(", symbol->name);
+  else
+    text_printf(&result, "cm_%s(", symbol->name);
+  for (int i = 0; i < count; i++) {
+    text_printf(&result, "%s%s", i ? ", " : "", texts[i]);
+    free(texts[i]);
+  }
+  text_printf(&result, ")");
+  return sequenced(prefix, result.data);
+}
+
+static char *assign(emitter_t *e, ast_node_t *node, int base, int top) {
+  char *name = name_of(node->symbol);
+  ast_node_t *index = node->data.assignment_expression.var_index;
+  char *result;
+
+  if (!index) {
+    char *value =
+        expression(e, node->data.assignment_expression.expression, base, 1);
+    result = format(top ? "%s = %s" : "(%s = %s)", name, value);
+    free(value);
+    free(name);
+    return result;
+  }
+
+  ast_node_t *nodes[2] = {index, node->data.assignment_expression.expression};
+  char *texts[2];
+  char *prefix = operands(e, nodes, 2, base, 1, texts);
+  result = format(top && !prefix ? "%s[%s] = %s" : "(%s[%s] = %s)", name,
+                  texts[0], texts[1]);
+  free(texts[0]);
+  free(texts[1]);
+  free(name);
+  return sequenced(prefix, result);
+}
+
+static char *binary(emitter_t *e, int op, ast_node_t *left, ast_node_t *right,
+                    int base, int top) {
+  ast_node_t *nodes[2] = {left, right};
+  char *texts[2];
+  const char *function = NULL, *relation = NULL;
+  char *result;
+
+  switch (op) {
+  case '+':
+    function = "cmrt_add";
+    break;
+  case '-':
+    function = "cmrt_sub";
+    break;
+  case '*':
+    function = "cmrt_mul";
+    break;
+  case '/':
+    function = "cmrt_div";
+    break;
+  case TOKEN_LT:
+    relation = "<";
+    break;
+  case TOKEN_LE:
+    relation = "<=";
+    break;
+  case TOKEN_GT:
+    relation = ">";
+    break;
+  case TOKEN_GE:
+    relation = ">=";
+    break;
+  case TOKEN_EQ:
+    relation = "==";
+    break;
+  default:
+    relation = "!=";
+    break;
+  }
+
+  char *prefix = operands(e, nodes, 2, base, function != NULL, texts);
+  if (function)
+    result = format("%s(%s, %s)", function, texts[0], texts[1]);
+  else
+    result = format(top && !prefix ? "%s %s %s" : "(%s %s %s)", texts[0],
+                    relation, texts[1]);
+  free(texts[0]);
+  free(texts[1]);
+  return sequenced(prefix, result);
+}
+
+static char *variable(emitter_t *e, ast_node_t *node, int base) {
+  char *name = name_of(node->symbol);
+
+  if (!node->data.variable.index)
+    return name;
+
+  char *index = expression(e, node->data.variable.index, base, 1);
+  char *result = format("%s[%s]", name, index);
+  free(index);
+  free(name);
+  return result;
+}
+
+//! Temporaries from 'base' on are free. At the top of a statement or of a
+//! condition, the expression needs no parentheses
+static char *expression(emitter_t *e, ast_node_t *node, int base, int top) {
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    return assign(e, node, base, top);
+
+  case AST_SIMPLE_EXPRESSION:
+    if (!node->data.simple_expression.relational_op)
+      return expression(e, node->data.simple_expression.left, base, top);
+    return binary(e,
+                  node->data.simple_expression.relational_op->data
+                      .relational_operator.relop,
+                  node->data.simple_expression.left,
+                  node->data.simple_expression.right, base, top);
+
+  case AST_ADDITIVE_EXPRESSION:
+    if (!node->data.additive_expression.add_op)
+      return expression(e, node->data.additive_expression.left, base, top);
+    return binary(e,
+                  node->data.additive_expression.add_op->data
+                      .additive_operator.add_operator,
+                  node->data.additive_expression.left,
+                  node->data.additive_expression.right, base, top);
+
+  case AST_TERM:
+    if (!node->data.term.mult_op)
+      return expression(e, node->data.term.left, base, top);
+    return binary(e,
+                  node->data.term.mult_op->data.multiplicative_operator
+                      .mult_operator,
+                  node->data.term.left, node->data.term.right, base, top);
+
+  case AST_FACTOR:
+    if (node->data.factor.expression)
+      return expression(e, node->data.factor.expression, base, top);
+    if (node->data.factor.variable)
+      return variable(e, node->data.factor.variable, base);
+    if (node->data.factor.activation)
+      return call(e, node->data.factor.activation, base);
+    return number(node->data.factor.number);
+
+  default:
+    return format("0");
+  }
+}
+
+// ----------------------- Statements ----------------------
+
+static void statement(emitter_t *e, ast_node_t *node);
+
+//! Locals start at zero, like in the other engines
+static void compound(emitter_t *e, ast_node_t *node) {
+  for (ast_node_t *list = node->data.compound_decl.local_declarations;
+       list && list->data.local_declarations.var_declaration;
+       list = list->data.local_declarations.local_declarations) {
+    ast_node_t *local = list->data.local_declarations.var_declaration;
+    declare(e, local->symbol);
+    char *name = name_of(local->symbol);
+    if (local->data.var_declaration.dimension)
+      line(e, "CMRT_UNUSED int32_t %s[%d] = {0};", name, local->symbol->size);
+    else
+      line(e, "CMRT_UNUSED int32_t %s = 0;", name);
+    free(name);
+  }
+
+  for (ast_node_t *list = node->data.compound_decl.statement_list;
+       list && list->data.statement_list.statement;
+       list = list->data.statement_list.statement_list)
+    statement(e, list->data.statement_list.statement);
+}
+
+//! Body of an if, an else or a while, always in braces
+static void block(emitter_t *e, ast_node_t *node) {
+  e->indent++;
+  statement(e, node);
+  e->indent--;
+}
+
+static void statement(emitter_t *e, ast_node_t *node) {
+  char *text;
+
+  if (!node)
+    return;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    statement(e, node->data.statement.statement);
+    break;
+  case AST_COMPOUND_STATEMENT:
+    statement(e, node->data.compound_statement.compound_decl);
+    break;
+  case AST_COMPOUND_DECL:
+    line(e, "{");
+    e->indent++;
+    compound(e, node);
+    e->indent--;
+    line(e, "}");
+    break;
+  case AST_EXPRESSION_STATEMENT:
+    if (!node->data.expression_statement.expression)
+      break;
+    text = expression(e, node->data.expression_statement.expression, 0, 1);
+    line(e, is_statement(node->data.expression_statement.expression)
+                ? "%s;"
+                : "(void)%s;",
+         text);
+    free(text);
+    break;
+  case AST_SELECTION_STATEMENT:
+    text = expression(e, node->data.selection_statement.expression, 0, 1);
+    line(e, "if (%s) {", text);
+    free(text);
+    block(e, node->data.selection_statement.then_statement);
+    if (node->data.selection_statement.else_statement) {
+      line(e, "} else {");
+      block(e, node->data.selection_statement.else_statement);
+    }
+    line(e, "}");
+    break;
+  case AST_ITERATION_STATEMENT:
+    text = expression(e, node->data.iteration_statement.expression, 0, 1);
+    line(e, "while (%s) {", text);
+    free(text);
+    block(e, node->data.iteration_statement.body);
+    line(e, "}");
+    break;
+  case AST_RETURN_STATEMENT:
+    if (!node->data.return_statement.expression) {
+      line(e, "return;");
+      break;
+    }
+    text = expression(e, node->data.return_statement.expression, 0, 1);
+    line(e, "return %s;", text);
+    free(text);
+    break;
+  default:
+    break;
+  }
+}
+
+// ----------------------- Program ----------------------
+
+static void print_signature(FILE *output, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+  int first = 1;
+
+  fprintf(output, "static CMRT_UNUSED %s cm_%s(",
+          symbol->type == TOKEN_VOID ? "void" : "int32_t", symbol->name);
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->type == AST_PARAM_LIST && list->data.param_list.param;
+       list = list->data.param_list.param_list) {
+    ast_node_t *param = list->data.param_list.param;
+    char *name = name_of(param->symbol);
+    fprintf(output, "%sCMRT_UNUSED int32_t %s%s", first ? "" : ", ",
+            param->symbol->kind == SYM_ARRAY ? "*" : "", name);
+    free(name);
+    first = 0;
+  }
+  fprintf(output, "%s)", first ? "void" : "");
+}
+
+static void function(emitter_t *e, ast_node_t *node) {
+  e->name_count = 0;
+  e->temps = 0;
+  e->body.length = 0;
+
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->type == AST_PARAM_LIST && list->data.param_list.param;
+       list = list->data.param_list.param_list)
+    declare(e, list->data.param_list.param->symbol);
+
+  e->indent = 1;
+  compound(e, node->data.fun_declaration.compound_decl);
+  // Falling off the end gives 0, as in the other engines
+  if (node->symbol->type != TOKEN_VOID)
+    line(e, "return 0;");
+
+  fprintf(e->output, "\n");
+  print_signature(e->output, node);
+  fprintf(e->output, " {\n");
+  for (int t = 0; t < e->temps; t++)
+    fprintf(e->output, "%s%s%d", t ? ", " : "  int32_t ", "t", t);
+  if (e->temps)
+    fprintf(e->output, ";\n");
+  if (e->body.length)
+    fwrite(e->body.data, 1, e->body.length, e->output);
+  fprintf(e->output, "}\n");
+}
+
+//! Wrapping arithmetic without any implementation-defined conversion,
+//! which gcc and clang compile to the bare instructions. Any function or
+//! variable of the program may be unused, which is no mistake of the C
+static const char *RUNTIME =
+    "#define CMRT_BUFFER 4096\n"
+    "\n"
+    "#ifdef __GNUC__\n"
+    "#define CMRT_UNUSED __attribute__((unused))\n"
+    "#else\n"
+    "#define CMRT_UNUSED\n"
+    "#endif\n"
+    "\n"
+    "static char cmrt_out[CMRT_BUFFER];\n"
+    "static size_t cmrt_out_length;\n"
+    "\n"
+    "static void cmrt_flush(void) {\n"
+    "  fwrite(cmrt_out, 1, cmrt_out_length, stdout);\n"
+    "  fflush(stdout);\n"
+    "  cmrt_out_length = 0;\n"
+    "}\n"
+    "\n"
+    "static void cmrt_fail(const char *message) {\n"
+    "  cmrt_flush();\n"
+    "  fprintf(stderr, \"Error: %s\\n\", message);\n"
+    "  exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t cmrt_wrap(uint32_t value) {\n"
+    "  return value <= INT32_MAX ? (int32_t)value\n"
+    "                            : (int32_t)(value - 2147483648u) - "
+    "INT32_MAX - 1;\n"
+    "}\n"
+    "\n"
+    "static inline int32_t cmrt_add(int32_t a, int32_t b) {\n"
+    "  return cmrt_wrap((uint32_t)a + (uint32_t)b);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t cmrt_sub(int32_t a, int32_t b) {\n"
+    "  return cmrt_wrap((uint32_t)a - (uint32_t)b);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t cmrt_mul(int32_t a, int32_t b) {\n"
+    "  return cmrt_wrap((uint32_t)a * (uint32_t)b);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t cmrt_div(int32_t a, int32_t b) {\n"
+    "  if (b == 0)\n"
+    "    cmrt_fail(\"Division by zero.\");\n"
+    "  return b == -1 ? cmrt_wrap(0u - (uint32_t)a) : a / b;\n"
+    "}\n"
+    "\n"
+    "// Skips the blanks and reads an optionally negative decimal number,\n"
+    "// 0 when none follows. The output shows before the program waits\n"
+    "static inline int32_t cmrt_input(void) {\n"
+    "  uint32_t value = 0;\n"
+    "  int negative = 0, c;\n"
+    "\n"
+    "  cmrt_flush();\n"
+    "  while ((c = getchar()) != EOF && c <= ' ')\n"
+    "    ;\n"
+    "  if (c == '-') {\n"
+    "    negative = 1;\n"
+    "    c = getchar();\n"
+    "  }\n"
+    "  for (; c >= '0' && c <= '9'; c = getchar())\n"
+    "    value = value * 10 + (uint32_t)(c - '0');\n"
+    "  if (c != EOF)\n"
+    "    ungetc(c, stdin);\n"
+    "  return cmrt_wrap(negative ? 0u - value : value);\n"
+    "}\n"
+    "\n"
+    "static inline void cmrt_output(int32_t value) {\n"
+    "  char digits[12];\n"
+    "  int count = 0;\n"
+    "  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : "
+    "(uint32_t)value;\n"
+    "\n"
+    "  do {\n"
+    "    digits[count++] = (char)('0' + magnitude % 10);\n"
+    "    magnitude /= 10;\n"
+    "  } while (magnitude);\n"
+    "  if (value < 0)\n"
+    "    digits[count++] = '-';\n"
+    "\n"
+    "  if (cmrt_out_length + count + 1 > CMRT_BUFFER)\n"
+    "    cmrt_flush();\n"
+    "  while (count)\n"
+    "    cmrt_out[cmrt_out_length++] = digits[--count];\n"
+    "  cmrt_out[cmrt_out_length++] = '\\n';\n"
+    "}\n";
+
+void c_emit_program(ast_node_t *program, const char *source, FILE *output) {
+  emitter_t e = {.output = output};
+
+  fprintf(output, "// Translated from %s by cmc\n\n", source);
+  fprintf(output, "#include <stdint.h>\n#include <stdio.h>\n"
+                  "#include <stdlib.h>\n\n");
+  fputs(RUNTIME, output);
+
+  // Parameters get their names before the prototypes
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+
+    if (node->type == AST_VAR_DECLARATION) {
+      if (node->data.var_declaration.dimension)
+        fprintf(output, "%sstatic CMRT_UNUSED int32_t cm_%s[%d];\n",
+                list == program->data.program.decl_list ? "\n" : "",
+                node->symbol->name, node->symbol->size);
+      else
+        fprintf(output, "%sstatic CMRT_UNUSED int32_t cm_%s;\n",
+                list == program->data.program.decl_list ? "\n" : "",
+                node->symbol->name);
+      continue;
+    }
+
+    e.name_count = 0;
+    for (ast_node_t *params = node->data.fun_declaration.params;
+         params && params->type == AST_PARAM_LIST &&
+         params->data.param_list.param;
+         params = params->data.param_list.param_list)
+      declare(&e, params->data.param_list.param->symbol);
+  }
+
+  fprintf(output, "\n");
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    if (node->type == AST_FUN_DECLARATION) {
+      print_signature(output, node);
+      fprintf(output, ";\n");
+    }
+  }
+
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    if (node->type == AST_FUN_DECLARATION)
+      function(&e, node);
+  }
+
+  fprintf(output, "\nint main(void) {\n  cm_main();\n  cmrt_flush();\n"
+                  "  return 0;\n}\n");
+
+  free(e.body.data);
+  free(e.names);
+}
@@ -0,0 +1,18 @@
+#ifndef C_EMIT_H
+#define C_EMIT_H
+
+#include "../parser/parser.h"
+
+#include <stdio.h>
+
+//! Translates a checked program into strictly conforming C11, to be built
+//! by the host compiler. Values are int32_t and wrap around like in the
+//! other engines, arrays go by pointer, the operands run left to right and
+//! input() and output() go through a small buffered runtime. A division by
+//! zero stops the program with an error. Globals and functions are named
+//! 'cm_' followed by their C- name, the other variables get the number of
+//! their declaration among the ones of the same name in their function,
+//! which the symbols keep in 'location'
+void c_emit_program(ast_node_t *program, const char *source, FILE *output);
+
+#endif // !C_EMIT_H
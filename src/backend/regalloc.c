@@ -0,0 +1,553 @@
+#include "regalloc.h"
+#include "../ir/ir_dominance.h"
+#include "../ir/ir_loop.h"
+
+#include <stdlib.h>
+
+//! (temporary, block) pairs, grouped later by one or the other
+typedef struct {
+  int temp;
+  int block;
+} ra_pair_t;
+
+typedef struct {
+  ra_pair_t *pairs;
+  int count;
+  int capacity;
+} ra_pairs_t;
+
+typedef struct {
+  ir_function_t *function;
+  ra_allocation_t *allocation;
+  int block_capacity;
+
+  int *live_in;       // Temporaries live into each block, CSR by block
+  int *live_in_start; // block_count + 1 entries
+
+  char *block_head; // Whether each instruction starts a block
+  int *calls;       // Instructions holding a call, in order
+  int call_count;
+
+  int *active; // Temporaries holding a register, at most one per register
+  int active_count;
+  int move_capacity;
+} ra_t;
+
+static void *ra_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the register "
+                    "allocator.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *ra_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the register "
+                    "allocator.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void add_pair(ra_pairs_t *pairs, int temp, int block) {
+  if (pairs->count == pairs->capacity) {
+    pairs->capacity = pairs->capacity ? pairs->capacity * 2 : 256;
+    pairs->pairs = (ra_pair_t *)ra_realloc(
+        pairs->pairs, pairs->capacity * sizeof(ra_pair_t));
+  }
+  pairs->pairs[pairs->count++] = (ra_pair_t){temp, block};
+}
+
+//! Groups the pairs by temporary (or by block), returns the CSR offsets
+static int *group_pairs(ra_pairs_t *pairs, int groups, int by_block,
+                        int **members) {
+  int *start = (int *)ra_alloc(groups + 1, sizeof(int));
+  *members = (int *)ra_alloc(pairs->count, sizeof(int));
+
+  for (int p = 0; p < pairs->count; p++)
+    start[(by_block ? pairs->pairs[p].block : pairs->pairs[p].temp) + 1]++;
+  for (int g = 0; g < groups; g++)
+    start[g + 1] += start[g];
+
+  int *fill = (int *)ra_alloc(groups, sizeof(int));
+  for (int p = 0; p < pairs->count; p++) {
+    int group = by_block ? pairs->pairs[p].block : pairs->pairs[p].temp;
+    (*members)[start[group] + fill[group]++] =
+        by_block ? pairs->pairs[p].temp : pairs->pairs[p].block;
+  }
+  free(fill);
+  return start;
+}
+
+static void extend(ra_interval_t *interval, int position) {
+  if (interval->end < interval->start) {
+    interval->start = interval->end = position;
+    return;
+  }
+  if (position < interval->start)
+    interval->start = position;
+  if (position > interval->end)
+    interval->end = position;
+}
+
+static int block_start(const ra_t *ra, int block) {
+  return RA_USE_POSITION(ra->allocation->block_first[block]);
+}
+
+static int block_end(const ra_t *ra, int block) {
+  return RA_DEF_POSITION(ra->allocation->block_first[block] +
+                         ra->function->blocks[block].count - 1);
+}
+
+// ----------------------- Liveness ----------------------
+
+//! Builds the intervals: the positions where each temporary is used or
+//! defined, widened over the blocks it is live into or out of. The liveness
+//! is found per temporary, going back from its upward-exposed uses through
+//! the predecessors until the blocks defining it
+static void build_intervals(ra_t *ra, const ir_loops_t *loops) {
+  ir_function_t *function = ra->function;
+  ra_allocation_t *allocation = ra->allocation;
+  int temps = function->temp_count, blocks = function->block_count;
+  ra_pairs_t exposed = {0}, defined = {0}, live = {0};
+  int *def_stamp = (int *)ra_alloc(temps, sizeof(int));
+  int *use_stamp = (int *)ra_alloc(temps, sizeof(int));
+  int *block_def_stamp = (int *)ra_alloc(temps, sizeof(int));
+  double *cost = (double *)ra_alloc(temps, sizeof(double));
+
+  for (int t = 0; t < temps; t++) {
+    def_stamp[t] = use_stamp[t] = block_def_stamp[t] = -1;
+    allocation->intervals[t] = (ra_interval_t){
+        .start = 0, .end = -1, .reg = -1, .split = INT_MAX, .slot = -1};
+  }
+
+  for (int b = 0; b < blocks; b++) {
+    const ir_block_t *block = &function->blocks[b];
+    double weight = 1;
+    for (int d = ir_loop_depth(loops, b); d > 0 && weight < 1e6; d--)
+      weight *= 10;
+
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+      int index = allocation->block_first[b] + i;
+
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind != IR_OPD_TEMP)
+          continue;
+
+        int t = use->value;
+        extend(&allocation->intervals[t], RA_USE_POSITION(index));
+        cost[t] += weight;
+        if (def_stamp[t] != b && use_stamp[t] != b) {
+          use_stamp[t] = b;
+          add_pair(&exposed, t, b);
+        }
+      }
+
+      if (instr->dst.kind == IR_OPD_TEMP) {
+        int t = instr->dst.value;
+        extend(&allocation->intervals[t], RA_DEF_POSITION(index));
+        cost[t] += weight;
+        def_stamp[t] = b;
+        if (block_def_stamp[t] != b) {
+          block_def_stamp[t] = b;
+          add_pair(&defined, t, b);
+        }
+      }
+    }
+  }
+  free(def_stamp);
+  free(use_stamp);
+  free(block_def_stamp);
+
+  int *exposed_blocks, *defined_blocks;
+  int *exposed_start = group_pairs(&exposed, temps, 0, &exposed_blocks);
+  int *defined_start = group_pairs(&defined, temps, 0, &defined_blocks);
+  int *defines = (int *)ra_alloc(blocks, sizeof(int));
+  int *reached = (int *)ra_alloc(blocks, sizeof(int));
+  int *work = (int *)ra_alloc(blocks, sizeof(int));
+
+  for (int b = 0; b < blocks; b++)
+    defines[b] = reached[b] = -1;
+
+  for (int t = 0; t < temps; t++) {
+    ra_interval_t *interval = &allocation->intervals[t];
+    int top = 0;
+
+    for (int d = defined_start[t]; d < defined_start[t + 1]; d++)
+      defines[defined_blocks[d]] = t;
+    for (int e = exposed_start[t]; e < exposed_start[t + 1]; e++) {
+      reached[exposed_blocks[e]] = t;
+      work[top++] = exposed_blocks[e];
+    }
+
+    while (top) {
+      int b = work[--top];
+      const ir_block_t *block = &function->blocks[b];
+
+      add_pair(&live, t, b);
+      extend(interval, block_start(ra, b));
+
+      for (int p = 0; p < block->pred_count; p++) {
+        int pred = block->preds[p];
+        extend(interval, block_end(ra, pred));
+        if (reached[pred] != t && defines[pred] != t) {
+          reached[pred] = t;
+          work[top++] = pred;
+        }
+      }
+    }
+
+    if (interval->end >= interval->start) {
+      allocation->live_count++;
+      interval->weight = cost[t] / (interval->end - interval->start + 1);
+    }
+  }
+
+  ra->live_in_start = group_pairs(&live, blocks, 1, &ra->live_in);
+
+  free(exposed.pairs);
+  free(defined.pairs);
+  free(live.pairs);
+  free(exposed_start);
+  free(exposed_blocks);
+  free(defined_start);
+  free(defined_blocks);
+  free(defines);
+  free(reached);
+  free(work);
+  free(cost);
+}
+
+// ----------------------- Linear Scan ----------------------
+
+//! (start, temporary) pairs, the order the intervals are scanned in
+typedef struct {
+  int start;
+  int temp;
+} ra_order_t;
+
+static int compare_start(const void *a, const void *b) {
+  const ra_order_t *first = (const ra_order_t *)a;
+  const ra_order_t *second = (const ra_order_t *)b;
+  if (first->start != second->start)
+    return first->start - second->start;
+  return first->temp - second->temp;
+}
+
+static void add_move(ra_t *ra, int position, int temp, int to_memory) {
+  ra_allocation_t *allocation = ra->allocation;
+  if (allocation->move_count == ra->move_capacity) {
+    ra->move_capacity = ra->move_capacity ? ra->move_capacity * 2 : 64;
+    allocation->moves = (ra_move_t *)ra_realloc(
+        allocation->moves, ra->move_capacity * sizeof(ra_move_t));
+  }
+  allocation->moves[allocation->move_count++] =
+      (ra_move_t){position, temp, to_memory};
+}
+
+static void give_slot(ra_allocation_t *allocation, int temp) {
+  if (allocation->intervals[temp].slot < 0)
+    allocation->intervals[temp].slot = allocation->slot_count++;
+}
+
+//! Moves an active interval to memory from 'position' on. Splits at the
+//! first instruction of a block move to its start, so the stores are left
+//! to the edges into it
+static void split_active(ra_t *ra, int a, int position) {
+  ra_allocation_t *allocation = ra->allocation;
+  int temp = ra->active[a];
+
+  if (ra->block_head[position / 2])
+    position = RA_USE_POSITION(position / 2);
+
+  allocation->intervals[temp].split = position;
+  give_slot(allocation, temp);
+  allocation->splits++;
+  ra->active[a] = ra->active[--ra->active_count];
+}
+
+//! Whether a call happens while the interval is live and after its start
+static int crosses_call(const ra_t *ra, const ra_interval_t *interval) {
+  int low = 0, high = ra->call_count;
+
+  while (low < high) { // First call writing after the start
+    int middle = (low + high) / 2;
+    if (RA_DEF_POSITION(ra->calls[middle]) > interval->start)
+      high = middle;
+    else
+      low = middle + 1;
+  }
+  return low < ra->call_count &&
+         interval->end > RA_USE_POSITION(ra->calls[low]);
+}
+
+//! Calls before 'position' push the values living past them out of the
+//! caller-saved registers
+static void pass_calls(ra_t *ra, int *next_call, int position) {
+  const ra_interval_t *intervals = ra->allocation->intervals;
+
+  for (; *next_call < ra->call_count &&
+         RA_DEF_POSITION(ra->calls[*next_call]) <= position;
+       (*next_call)++) {
+    int call = ra->calls[*next_call];
+    for (int a = 0; a < ra->active_count;) {
+      const ra_interval_t *active = &intervals[ra->active[a]];
+      if (active->reg >= RA_CALLEE_SAVED &&
+          active->end > RA_USE_POSITION(call))
+        split_active(ra, a, RA_DEF_POSITION(call));
+      else
+        a++;
+    }
+  }
+}
+
+static void scan(ra_t *ra) {
+  ra_allocation_t *allocation = ra->allocation;
+  ra_interval_t *intervals = allocation->intervals;
+  int temps = ra->function->temp_count, count = 0, next_call = 0;
+  ra_order_t *order = (ra_order_t *)ra_alloc(temps, sizeof(ra_order_t));
+
+  for (int t = 0; t < temps; t++)
+    if (intervals[t].end >= intervals[t].start)
+      order[count++] = (ra_order_t){intervals[t].start, t};
+  if (count)
+    qsort(order, count, sizeof(ra_order_t), compare_start);
+
+  for (int o = 0; o < count; o++) {
+    int temp = order[o].temp;
+    ra_interval_t *current = &intervals[temp];
+    int position = current->start;
+
+    pass_calls(ra, &next_call, position);
+
+    unsigned int busy = 0;
+    for (int a = 0; a < ra->active_count;) {
+      if (intervals[ra->active[a]].end < position) {
+        ra->active[a] = ra->active[--ra->active_count];
+        continue;
+      }
+      busy |= 1u << intervals[ra->active[a]].reg;
+      a++;
+    }
+
+    // Registers surviving calls go first to the intervals crossing one
+    int first = crosses_call(ra, current) ? 0 : RA_CALLEE_SAVED;
+    for (int r = 0; r < RA_REGISTER_COUNT && current->reg < 0; r++) {
+      int reg = (first + r) % RA_REGISTER_COUNT;
+      if (!(busy & (1u << reg)))
+        current->reg = reg;
+    }
+
+    if (current->reg < 0) {
+      int victim = -1;
+      for (int a = 0; a < ra->active_count; a++)
+        if (victim < 0 ||
+            intervals[ra->active[a]].weight < intervals[ra->active[victim]].weight)
+          victim = a;
+
+      if (intervals[ra->active[victim]].weight >= current->weight) {
+        give_slot(allocation, temp);
+        allocation->spilled++;
+        continue;
+      }
+
+      current->reg = intervals[ra->active[victim]].reg;
+      split_active(ra, victim, position);
+    }
+
+    allocation->used_registers |= 1u << current->reg;
+    ra->active[ra->active_count++] = temp;
+  }
+  pass_calls(ra, &next_call, INT_MAX);
+
+  free(order);
+}
+
+// ----------------------- Resolution ----------------------
+
+int ra_register_at(const ra_allocation_t *allocation, int temp, int position) {
+  const ra_interval_t *interval = &allocation->intervals[temp];
+  return position < interval->split ? interval->reg : -1;
+}
+
+static int compare_moves(const void *a, const void *b) {
+  const ra_move_t *first = (const ra_move_t *)a;
+  const ra_move_t *second = (const ra_move_t *)b;
+  if (first->position != second->position)
+    return first->position - second->position;
+  return second->to_memory - first->to_memory;
+}
+
+static void set_block_first(ra_t *ra, int block, int first) {
+  ra_allocation_t *allocation = ra->allocation;
+  if (block >= ra->block_capacity) {
+    ra->block_capacity = 2 * block + 1;
+    allocation->block_first = (int *)ra_realloc(
+        allocation->block_first, ra->block_capacity * sizeof(int));
+  }
+  allocation->block_first[block] = first;
+}
+
+//! Moves an edge to a new block holding only a jump, numbered after the
+//! existing instructions
+static int split_edge(ra_t *ra, int from, int to) {
+  ir_function_t *function = ra->function;
+  int middle = ir_new_block(function);
+  ir_instr_t *branch = ir_terminator(&function->blocks[from]);
+
+  for (int t = 0; t < branch->arg_count; t++)
+    if (branch->args[t].value == to)
+      branch->args[t].value = middle;
+
+  ir_emit(function, middle, IR_JMP, ir_none(), ir_block(to), ir_none());
+  set_block_first(ra, middle, ra->allocation->instruction_count++);
+  return middle;
+}
+
+//! Adds the moves for the values whose location differs between the end of
+//! 'from' and the start of 'to'. The stores come before the loads: a
+//! register being loaded only ever holds a value dead on the edge or one
+//! being stored
+static void resolve_edge(ra_t *ra, int from, int to, int *split_edges) {
+  const ra_allocation_t *allocation = ra->allocation;
+  int needed = 0;
+
+  for (int l = ra->live_in_start[to]; l < ra->live_in_start[to + 1]; l++) {
+    int temp = ra->live_in[l];
+    needed |= ra_register_at(allocation, temp, block_end(ra, from)) !=
+              ra_register_at(allocation, temp, block_start(ra, to));
+  }
+  if (!needed)
+    return;
+
+  int position;
+  if (ra->function->blocks[to].pred_count == 1)
+    position = block_start(ra, to);
+  else if (ra->function->blocks[from].succ_count == 1)
+    position = RA_USE_POSITION(allocation->block_first[from] +
+                               ra->function->blocks[from].count - 1);
+  else {
+    int middle = split_edge(ra, from, to);
+    position = block_start(ra, middle);
+    (*split_edges)++;
+  }
+
+  for (int l = ra->live_in_start[to]; l < ra->live_in_start[to + 1]; l++) {
+    int temp = ra->live_in[l];
+    int at_end = ra_register_at(allocation, temp, block_end(ra, from));
+    int at_start = ra_register_at(allocation, temp, block_start(ra, to));
+    if (at_end != at_start)
+      add_move(ra, position, temp, at_start < 0);
+  }
+}
+
+static void resolve(ra_t *ra) {
+  ra_allocation_t *allocation = ra->allocation;
+  int blocks = ra->function->block_count, split_edges = 0;
+
+  // Stores where an interval leaves its register inside a block, splits at
+  // a block start are left to the edges
+  for (int t = 0; t < ra->function->temp_count; t++) {
+    const ra_interval_t *interval = &allocation->intervals[t];
+    if (interval->reg >= 0 && interval->split != INT_MAX &&
+        !ra->block_head[interval->split / 2])
+      add_move(ra, RA_USE_POSITION(interval->split / 2), t, 1);
+  }
+
+  for (int b = 0; b < blocks; b++) {
+    int pred_count = ra->function->blocks[b].pred_count;
+    int *preds = (int *)ra_alloc(pred_count, sizeof(int));
+    for (int p = 0; p < pred_count; p++)
+      preds[p] = ra->function->blocks[b].preds[p];
+    for (int p = 0; p < pred_count; p++)
+      resolve_edge(ra, preds[p], b, &split_edges);
+    free(preds);
+  }
+
+  if (split_edges)
+    ir_compute_cfg(ra->function);
+
+  if (allocation->move_count)
+    qsort(allocation->moves, allocation->move_count, sizeof(ra_move_t),
+          compare_moves);
+}
+
+// ----------------------- Allocation ----------------------
+
+ra_allocation_t *ra_allocate(ir_function_t *function) {
+  ra_allocation_t *allocation =
+      (ra_allocation_t *)ra_alloc(1, sizeof(ra_allocation_t));
+  ra_t ra = {.function = function, .allocation = allocation};
+  int active[RA_REGISTER_COUNT];
+
+  allocation->function = function;
+  allocation->intervals = (ra_interval_t *)ra_alloc(function->temp_count,
+                                                    sizeof(ra_interval_t));
+  ra.active = active;
+  ra.block_capacity = function->block_count;
+  allocation->block_first = (int *)ra_alloc(function->block_count,
+                                            sizeof(int));
+
+  for (int b = 0; b < function->block_count; b++) {
+    allocation->block_first[b] = allocation->instruction_count;
+    for (int i = 0; i < function->blocks[b].count; i++)
+      if (function->blocks[b].instrs[i].op == IR_CALL)
+        ra.call_count++;
+    allocation->instruction_count += function->blocks[b].count;
+  }
+
+  ra.calls = (int *)ra_alloc(ra.call_count, sizeof(int));
+  ra.block_head = (char *)ra_alloc(allocation->instruction_count, 1);
+  ra.call_count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      int index = allocation->block_first[b] + i;
+      ra.block_head[index] = i == 0;
+      if (function->blocks[b].instrs[i].op == IR_CALL)
+        ra.calls[ra.call_count++] = index;
+    }
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  ir_loops_t *loops = ir_loops_find(function, dominance);
+  build_intervals(&ra, loops);
+  ir_loops_destroy(loops);
+  ir_dominance_destroy(dominance);
+
+  scan(&ra);
+  resolve(&ra);
+
+  free(ra.calls);
+  free(ra.block_head);
+  free(ra.live_in);
+  free(ra.live_in_start);
+  return allocation;
+}
+
+void ra_destroy(ra_allocation_t *allocation) {
+  if (!allocation)
+    return;
+
+  free(allocation->intervals);
+  free(allocation->block_first);
+  free(allocation->moves);
+  free(allocation);
+}
+
+void ra_print_stats(const ra_allocation_t *allocation, FILE *output) {
+  int registers = 0;
+  for (int r = 0; r < RA_REGISTER_COUNT; r++)
+    registers += (allocation->used_registers >> r) & 1;
+
+  fprintf(output,
+          "%-20s %6d intervals %6d spilled %6d split %6d moves %3d "
+          "registers %5d slots\n",
+          allocation->function->name, allocation->live_count,
+          allocation->spilled, allocation->splits, allocation->move_count,
+          registers, allocation->slot_count);
+}
@@ -0,0 +1,75 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "../ir/ir.h"
+
+#include <limits.h>
+
+//! Registers handed out by the allocator. The first RA_CALLEE_SAVED survive
+//! calls, the others are clobbered by them. The backend maps them onto the
+//! machine registers it keeps free of its own scratch uses
+#define RA_REGISTER_COUNT 10
+#define RA_CALLEE_SAVED 5
+
+//! Instructions are numbered in block order; the instruction 'i' reads its
+//! operands at the position 2i and writes its result at 2i + 1
+#define RA_USE_POSITION(index) (2 * (index))
+#define RA_DEF_POSITION(index) (2 * (index) + 1)
+
+//! Live interval of a temporary: from its first to its last live position,
+//! holes included. It stays in 'reg' until 'split', and from there on in its
+//! spill slot
+typedef struct {
+  int start;
+  int end;       // Lower than start if the temporary is never live
+  int reg;       // -1 if it lives in memory from the start
+  int split;     // INT_MAX if it never leaves its register
+  int slot;      // Spill slot, -1 if it never goes to memory
+  double weight; // Uses and definitions weighted by loop depth, per position
+} ra_interval_t;
+
+//! Copy between a temporary's register and its spill slot, done before the
+//! instruction at 'position'. Moves at the same position come stores first
+typedef struct {
+  int position;
+  int temp;
+  int to_memory; // 1 stores the register, 0 loads it back
+} ra_move_t;
+
+typedef struct {
+  const ir_function_t *function;
+  ra_interval_t *intervals; // One per temporary
+  int *block_first;         // Number of the first instruction of each block
+  int instruction_count;
+
+  ra_move_t *moves; // Sorted by position
+  int move_count;
+  int slot_count;
+  unsigned int used_registers; // Bit per register that was handed out
+
+  int live_count; // Temporaries with an interval
+  int spilled;    // Intervals living in memory from the start
+  int splits;     // Intervals moved to memory at a call or for another one
+} ra_allocation_t;
+
+//! Linear-scan allocation (Poletto and Sarkar) of a function out of SSA form.
+//! Intervals come from the liveness of each temporary over the blocks in
+//! their order. When the registers run out, the active interval or the new
+//! one with the lowest spill weight, its uses and definitions weighted by
+//! 10^loop depth over its length, gives way: the new one is spilled whole,
+//! an active one is split, keeping its register until then. Intervals live
+//! across a call prefer the callee-saved registers and are split at the
+//! call otherwise. Moves on the CFG edges reconcile the locations where
+//! they differ; critical edges needing them are split, so the function may
+//! gain blocks
+ra_allocation_t *ra_allocate(ir_function_t *function);
+
+void ra_destroy(ra_allocation_t *allocation);
+
+//! Register holding a temporary at a position, -1 if it is in its slot
+int ra_register_at(const ra_allocation_t *allocation, int temp, int position);
+
+//! Prints the intervals, spills and moves of the allocation
+void ra_print_stats(const ra_allocation_t *allocation, FILE *output);
+
+#endif // !REGALLOC_H
@@ -0,0 +1,185 @@
+#include "x86.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void *x86_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the machine "
+                    "code.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+// ----------------------- Operands ----------------------
+
+x86_operand_t x86_none() { return (x86_operand_t){X86_OPD_NONE, -1, -1, 0}; }
+x86_operand_t x86_reg(int reg) {
+  return (x86_operand_t){X86_OPD_REG, reg, -1, 0};
+}
+x86_operand_t x86_xmm(int reg) {
+  return (x86_operand_t){X86_OPD_XMM, reg, -1, 0};
+}
+x86_operand_t x86_imm(int value) {
+  return (x86_operand_t){X86_OPD_IMM, -1, -1, value};
+}
+x86_operand_t x86_mem(int base, int displacement) {
+  return (x86_operand_t){X86_OPD_MEM, base, -1, displacement};
+}
+x86_operand_t x86_rip(int symbol, int displacement) {
+  return (x86_operand_t){X86_OPD_MEM, -1, symbol, displacement};
+}
+x86_operand_t x86_label(int label) {
+  return (x86_operand_t){X86_OPD_LABEL, -1, -1, label};
+}
+x86_operand_t x86_symbol(int symbol) {
+  return (x86_operand_t){X86_OPD_SYMBOL, -1, symbol, 0};
+}
+
+int x86_same_operand(x86_operand_t a, x86_operand_t b) {
+  return a.kind == b.kind && a.reg == b.reg && a.symbol == b.symbol &&
+         a.value == b.value;
+}
+
+// ----------------------- Module ----------------------
+
+x86_module_t *x86_module_create() {
+  x86_module_t *module = (x86_module_t *)calloc(1, sizeof(x86_module_t));
+  if (!module) {
+    fprintf(stderr, "Error: Memory allocation failed for the machine "
+                    "code.\n");
+    exit(EXIT_FAILURE);
+  }
+  return module;
+}
+
+void x86_module_destroy(x86_module_t *module) {
+  if (!module)
+    return;
+
+  for (int s = 0; s < module->symbol_count; s++)
+    free(module->symbols[s].name);
+  free(module->symbols);
+
+  for (int f = 0; f < module->function_count; f++)
+    free(module->functions[f].instrs);
+  free(module->functions);
+  free(module);
+}
+
+int x86_add_symbol(x86_module_t *module, const char *name,
+                   x86_section_t section, int size, int align) {
+  module->symbols = (x86_symbol_t *)x86_realloc(
+      module->symbols, (module->symbol_count + 1) * sizeof(x86_symbol_t));
+
+  x86_symbol_t *symbol = &module->symbols[module->symbol_count];
+  *symbol = (x86_symbol_t){.section = section, .size = size, .align = align};
+  symbol->name = (char *)x86_realloc(NULL, strlen(name) + 1);
+  strcpy(symbol->name, name);
+
+  return module->symbol_count++;
+}
+
+int x86_find_symbol(const x86_module_t *module, const char *name) {
+  for (int s = 0; s < module->symbol_count; s++)
+    if (!strcmp(module->symbols[s].name, name))
+      return s;
+  return -1;
+}
+
+x86_function_t *x86_add_function(x86_module_t *module, int symbol) {
+  module->functions = (x86_function_t *)x86_realloc(
+      module->functions,
+      (module->function_count + 1) * sizeof(x86_function_t));
+
+  x86_function_t *function = &module->functions[module->function_count++];
+  *function = (x86_function_t){.symbol = symbol};
+  return function;
+}
+
+int x86_new_label(x86_function_t *function) { return function->label_count++; }
+
+x86_instr_t *x86_emit(x86_function_t *function, x86_opcode_t op, int size,
+                      x86_operand_t src, x86_operand_t dst) {
+  if (function->count == function->capacity) {
+    function->capacity = function->capacity ? function->capacity * 2 : 64;
+    function->instrs = (x86_instr_t *)x86_realloc(
+        function->instrs, function->capacity * sizeof(x86_instr_t));
+  }
+
+  x86_instr_t *instr = &function->instrs[function->count++];
+  *instr = (x86_instr_t){op, size, 0, src, dst};
+  return instr;
+}
+
+x86_instr_t *x86_emit_condition(x86_function_t *function, x86_opcode_t op,
+                                x86_condition_t condition, x86_operand_t src,
+                                x86_operand_t dst) {
+  x86_instr_t *instr = x86_emit(function, op, 1, src, dst);
+  instr->condition = condition;
+  return instr;
+}
+
+// ----------------------- Names ----------------------
+
+const char *x86_register_name(int reg, int size) {
+  static const char *names[][X86_REGISTER_COUNT] = {
+      {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil", "r8b", "r9b",
+       "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+      {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d",
+       "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+      {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9",
+       "r10", "r11", "r12", "r13", "r14", "r15"},
+  };
+  return names[size == 1 ? 0 : size == 4 ? 1 : 2][reg];
+}
+
+const char *x86_opcode_name(x86_opcode_t op) {
+  static const char *names[X86_OPCODE_COUNT] = {
+      [X86_LABEL] = "label",     [X86_MOV] = "mov",   [X86_MOVSX] = "movsx",
+      [X86_MOVZX] = "movzx",     [X86_LEA] = "lea",   [X86_ADD] = "add",
+      [X86_SUB] = "sub",         [X86_IMUL] = "imul", [X86_AND] = "and",
+      [X86_XOR] = "xor",         [X86_NEG] = "neg",   [X86_SHL] = "shl",
+      [X86_SHR] = "shr",         [X86_SAR] = "sar",   [X86_CDQ] = "cdq",
+      [X86_IDIV] = "idiv",       [X86_DIV] = "div",   [X86_CMP] = "cmp",
+      [X86_TEST] = "test",       [X86_SETCC] = "set", [X86_JMP] = "jmp",
+      [X86_JCC] = "j",           [X86_CALL] = "call", [X86_RET] = "ret",
+      [X86_PUSH] = "push",       [X86_POP] = "pop",   [X86_SYSCALL] = "syscall",
+      [X86_MOVD] = "movd",       [X86_MOVDQU] = "movdqu",
+      [X86_PSHUFD] = "pshufd",   [X86_PADDD] = "paddd",
+      [X86_PSUBD] = "psubd",
+  };
+  return op < X86_OPCODE_COUNT ? names[op] : "?";
+}
+
+const char *x86_condition_name(x86_condition_t condition) {
+  switch (condition) {
+  case X86_CC_B:
+    return "b";
+  case X86_CC_AE:
+    return "ae";
+  case X86_CC_E:
+    return "e";
+  case X86_CC_NE:
+    return "ne";
+  case X86_CC_BE:
+    return "be";
+  case X86_CC_A:
+    return "a";
+  case X86_CC_S:
+    return "s";
+  case X86_CC_NS:
+    return "ns";
+  case X86_CC_L:
+    return "l";
+  case X86_CC_GE:
+    return "ge";
+  case X86_CC_LE:
+    return "le";
+  case X86_CC_G:
+    return "g";
+  }
+  return "?";
+}
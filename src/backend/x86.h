@@ -0,0 +1,186 @@
+#ifndef X86_H
+#define X86_H
+
+#include <stdio.h>
+
+// ----------------------- Operands ----------------------
+
+//! Registers, numbered as in the instruction encoding
+typedef enum {
+  X86_RAX,
+  X86_RCX,
+  X86_RDX,
+  X86_RBX,
+  X86_RSP,
+  X86_RBP,
+  X86_RSI,
+  X86_RDI,
+  X86_R8,
+  X86_R9,
+  X86_R10,
+  X86_R11,
+  X86_R12,
+  X86_R13,
+  X86_R14,
+  X86_R15,
+  X86_REGISTER_COUNT,
+} x86_register_t;
+
+typedef enum {
+  X86_OPD_NONE,
+  X86_OPD_REG,
+  X86_OPD_XMM,    // SSE register, numbered like the others
+  X86_OPD_IMM,    // 32 bits, sign-extended for the 8 bytes instructions
+  X86_OPD_MEM,    // disp(base), or disp + symbol relative to rip
+  X86_OPD_LABEL,  // Label of the function
+  X86_OPD_SYMBOL, // Function or data symbol of the module
+} x86_operand_kind_t;
+
+typedef struct {
+  x86_operand_kind_t kind;
+  int reg;    // REG, base of MEM, -1 for the rip-relative ones
+  int symbol; // SYMBOL or rip-relative MEM, -1 otherwise
+  int value;  // IMM, displacement of MEM or number of LABEL
+} x86_operand_t;
+
+// ----------------------- Instructions ----------------------
+
+//! Condition codes, numbered as in the encoding of jcc and setcc
+typedef enum {
+  X86_CC_B = 2,
+  X86_CC_AE = 3,
+  X86_CC_E = 4,
+  X86_CC_NE = 5,
+  X86_CC_BE = 6,
+  X86_CC_A = 7,
+  X86_CC_S = 8,
+  X86_CC_NS = 9,
+  X86_CC_L = 12,
+  X86_CC_GE = 13,
+  X86_CC_LE = 14,
+  X86_CC_G = 15,
+} x86_condition_t;
+
+//! Two operands opcodes in AT&T order: 'op src, dst' computes dst op= src
+typedef enum {
+  X86_LABEL,   // Defines the label src
+  X86_MOV,
+  X86_MOVSX,   // Sign-extends the 4 bytes src into the 8 bytes dst
+  X86_MOVZX,   // Zero-extends the byte src into the 4 bytes dst
+  X86_LEA,
+  X86_ADD,
+  X86_SUB,
+  X86_IMUL,    // dst is a register
+  X86_AND,
+  X86_XOR,
+  X86_NEG,     // dst = -dst
+  X86_SHL,     // Shifts dst by the immediate src or by cl
+  X86_SHR,
+  X86_SAR,
+  X86_CDQ,     // edx:eax = sign-extended eax
+  X86_IDIV,    // eax, edx = edx:eax / src, edx:eax % src
+  X86_DIV,     // Unsigned
+  X86_CMP,     // Flags of dst - src
+  X86_TEST,    // Flags of dst & src
+  X86_SETCC,   // Byte dst = condition
+  X86_JMP,     // Goes to the label src, or to the symbol src (tail call)
+  X86_JCC,     // Goes to the label src if the condition holds
+  X86_CALL,    // Calls the symbol src, or the address in the memory src
+  X86_RET,
+  X86_PUSH,    // 8 bytes src
+  X86_POP,     // 8 bytes dst
+  X86_SYSCALL,
+  X86_MOVD,    // Lowest int of the xmm dst = 4 bytes src, the others zeroed
+  X86_MOVDQU,  // 16 bytes between an xmm register and memory, unaligned
+  X86_PSHUFD,  // Four ints of the xmm dst = the lowest int of the xmm src
+  X86_PADDD,   // Four ints of the xmm dst += those of the xmm src
+  X86_PSUBD,
+  X86_OPCODE_COUNT,
+} x86_opcode_t;
+
+typedef struct {
+  x86_opcode_t op;
+  int size;      // Bytes of the operation: 1, 4, 8 or 16 (SSE)
+  int condition; // JCC and SETCC
+  x86_operand_t src;
+  x86_operand_t dst;
+} x86_instr_t;
+
+// ----------------------- Functions and Modules ----------------------
+
+typedef enum {
+  X86_SECTION_TEXT, // Functions
+  X86_SECTION_BSS,  // Zero-initialized data
+} x86_section_t;
+
+typedef struct {
+  char *name;
+  x86_section_t section;
+  int is_global; // Visible to the linker
+  int size;      // Bytes of the data symbols
+  int align;
+} x86_symbol_t;
+
+typedef struct {
+  int symbol;
+  x86_instr_t *instrs;
+  int count;
+  int capacity;
+  int label_count;
+} x86_function_t;
+
+typedef struct {
+  x86_symbol_t *symbols;
+  int symbol_count;
+  x86_function_t *functions;
+  int function_count;
+} x86_module_t;
+
+// ----------------------- Construction ----------------------
+
+//! Operand constructors
+x86_operand_t x86_none();
+x86_operand_t x86_reg(int reg);
+x86_operand_t x86_xmm(int reg);
+x86_operand_t x86_imm(int value);
+x86_operand_t x86_mem(int base, int displacement);
+x86_operand_t x86_rip(int symbol, int displacement);
+x86_operand_t x86_label(int label);
+x86_operand_t x86_symbol(int symbol);
+
+int x86_same_operand(x86_operand_t a, x86_operand_t b);
+
+x86_module_t *x86_module_create();
+
+void x86_module_destroy(x86_module_t *module);
+
+//! Adds a symbol, returns its index
+int x86_add_symbol(x86_module_t *module, const char *name,
+                   x86_section_t section, int size, int align);
+
+//! Index of a symbol by name, -1 if absent
+int x86_find_symbol(const x86_module_t *module, const char *name);
+
+//! Adds an empty function defining the text symbol 'symbol'
+x86_function_t *x86_add_function(x86_module_t *module, int symbol);
+
+//! Reserves a label of the function, returns its number
+int x86_new_label(x86_function_t *function);
+
+//! Appends an instruction
+x86_instr_t *x86_emit(x86_function_t *function, x86_opcode_t op, int size,
+                      x86_operand_t src, x86_operand_t dst);
+
+//! Appends a jcc or setcc
+x86_instr_t *x86_emit_condition(x86_function_t *function, x86_opcode_t op,
+                                x86_condition_t condition, x86_operand_t src,
+                                x86_operand_t dst);
+
+//! Name of the register for an access of 'size' bytes
+const char *x86_register_name(int reg, int size);
+
+const char *x86_opcode_name(x86_opcode_t op);
+
+const char *x86_condition_name(x86_condition_t condition);
+
+#endif // !X86_H
@@ -0,0 +1,133 @@
+#include "x86_asm.h"
+
+static char suffix(int size) {
+  return size == 1 ? 'b' : size == 4 ? 'l' : 'q';
+}
+
+static void print_operand(x86_operand_t operand, int size, int function,
+                          const x86_module_t *module, FILE *output) {
+  switch (operand.kind) {
+  case X86_OPD_NONE:
+    break;
+  case X86_OPD_REG:
+    fprintf(output, "%%%s", x86_register_name(operand.reg, size));
+    break;
+  case X86_OPD_XMM:
+    fprintf(output, "%%xmm%d", operand.reg);
+    break;
+  case X86_OPD_IMM:
+    fprintf(output, "$%d", operand.value);
+    break;
+  case X86_OPD_MEM:
+    if (operand.symbol >= 0) {
+      fprintf(output, "%s", module->symbols[operand.symbol].name);
+      if (operand.value)
+        fprintf(output, "%+d", operand.value);
+      fprintf(output, "(%%rip)");
+    } else if (operand.value)
+      fprintf(output, "%d(%%%s)", operand.value,
+              x86_register_name(operand.reg, 8));
+    else
+      fprintf(output, "(%%%s)", x86_register_name(operand.reg, 8));
+    break;
+  case X86_OPD_LABEL:
+    fprintf(output, ".L%d_%d", function, operand.value);
+    break;
+  case X86_OPD_SYMBOL:
+    fprintf(output, "%s", module->symbols[operand.symbol].name);
+    break;
+  }
+}
+
+void x86_print_instr(const x86_instr_t *instr, int function,
+                     const x86_module_t *module, FILE *output) {
+  int src_size = instr->size, dst_size = instr->size;
+
+  switch (instr->op) {
+  case X86_LABEL:
+    print_operand(instr->src, 0, function, module, output);
+    fprintf(output, ":");
+    return;
+  case X86_MOVSX:
+    fprintf(output, "\tmovslq\t");
+    src_size = 4;
+    break;
+  case X86_MOVZX:
+    fprintf(output, "\tmovzbl\t");
+    src_size = 1;
+    break;
+  case X86_CDQ:
+    fprintf(output, "\tcltd");
+    return;
+  case X86_SETCC:
+    fprintf(output, "\tset%s\t", x86_condition_name(instr->condition));
+    break;
+  case X86_JCC:
+    fprintf(output, "\tj%s\t", x86_condition_name(instr->condition));
+    break;
+  case X86_RET:
+  case X86_SYSCALL:
+    fprintf(output, "\t%s", x86_opcode_name(instr->op));
+    return;
+  case X86_JMP:
+  case X86_CALL:
+    fprintf(output, "\t%s\t", x86_opcode_name(instr->op));
+    if (instr->src.kind == X86_OPD_MEM)
+      fputc('*', output);
+    break;
+  case X86_PSHUFD:
+    fprintf(output, "\tpshufd\t$0, ");
+    break;
+  case X86_MOVD: // From a 4 bytes operand, with no suffix like the others
+  case X86_MOVDQU:
+  case X86_PADDD:
+  case X86_PSUBD:
+    fprintf(output, "\t%s\t", x86_opcode_name(instr->op));
+    break;
+  case X86_SHL:
+  case X86_SHR:
+  case X86_SAR:
+    if (instr->src.kind == X86_OPD_REG)
+      src_size = 1; // cl
+    // fall through
+  default:
+    fprintf(output, "\t%s%c\t", x86_opcode_name(instr->op),
+            suffix(instr->size));
+    break;
+  }
+
+  print_operand(instr->src, src_size, function, module, output);
+  if (instr->src.kind != X86_OPD_NONE && instr->dst.kind != X86_OPD_NONE)
+    fprintf(output, ", ");
+  print_operand(instr->dst, dst_size, function, module, output);
+}
+
+void x86_print_module(const x86_module_t *module, FILE *output) {
+  fprintf(output, "\t.text\n");
+  for (int f = 0; f < module->function_count; f++) {
+    const x86_function_t *function = &module->functions[f];
+    const x86_symbol_t *symbol = &module->symbols[function->symbol];
+
+    fprintf(output, "\n");
+    if (symbol->is_global)
+      fprintf(output, "\t.globl\t%s\n", symbol->name);
+    fprintf(output, "\t.p2align\t4\n%s:\n", symbol->name);
+
+    for (int i = 0; i < function->count; i++) {
+      x86_print_instr(&function->instrs[i], f, module, output);
+      fprintf(output, "\n");
+    }
+  }
+
+  fprintf(output, "\n\t.bss\n");
+  for (int s = 0; s < module->symbol_count; s++) {
+    const x86_symbol_t *symbol = &module->symbols[s];
+    if (symbol->section != X86_SECTION_BSS)
+      continue;
+
+    fprintf(output, "\t.balign\t%d\n%s:\n\t.zero\t%d\n", symbol->align,
+            symbol->name, symbol->size);
+  }
+
+  fprintf(output, "\n\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
@@ -0,0 +1,14 @@
+#ifndef X86_ASM_H
+#define X86_ASM_H
+
+#include "x86.h"
+
+//! Prints the module as GNU assembler source, in AT&T syntax
+void x86_print_module(const x86_module_t *module, FILE *output);
+
+//! Prints a single instruction of the function numbered 'function', whose
+//! number makes its labels unique
+void x86_print_instr(const x86_instr_t *instr, int function,
+                     const x86_module_t *module, FILE *output);
+
+#endif // !X86_ASM_H
@@ -0,0 +1,299 @@
+#include "x86_elf.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EXECUTABLE_BASE 0x400000UL
+#define PAGE_SIZE 0x1000UL
+
+//! Growing file image
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+} buffer_t;
+
+static size_t put(buffer_t *buffer, const void *data, size_t size) {
+  size_t offset = buffer->size;
+
+  if (buffer->size + size > buffer->capacity) {
+    while (buffer->size + size > buffer->capacity)
+      buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    buffer->data = (unsigned char *)realloc(buffer->data, buffer->capacity);
+    if (!buffer->data) {
+      fprintf(stderr, "Error: Memory allocation failed for the ELF file.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (size)
+    memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+  return offset;
+}
+
+static void pad(buffer_t *buffer, size_t alignment) {
+  static const unsigned char zero[16] = {0};
+  while (buffer->size % alignment)
+    put(buffer, zero, 1);
+}
+
+static size_t put_string(buffer_t *table, const char *string) {
+  return put(table, string, strlen(string) + 1);
+}
+
+//! Writes the image, with execute permissions for the executables
+static int write_file(const buffer_t *buffer, const char *path,
+                      int executable) {
+  int descriptor =
+      open(path, O_WRONLY | O_CREAT | O_TRUNC, executable ? 0777 : 0666);
+  if (descriptor < 0) {
+    fprintf(stderr, "Error while opening file: %s\n", path);
+    return 0;
+  }
+
+  size_t written = 0;
+  while (written < buffer->size) {
+    ssize_t count =
+        write(descriptor, buffer->data + written, buffer->size - written);
+    if (count <= 0) {
+      fprintf(stderr, "Error while writing file: %s\n", path);
+      close(descriptor);
+      return 0;
+    }
+    written += count;
+  }
+
+  close(descriptor);
+  return 1;
+}
+
+static void fill_identification(Elf64_Ehdr *header, int type) {
+  memcpy(header->e_ident, ELFMAG, SELFMAG);
+  header->e_ident[EI_CLASS] = ELFCLASS64;
+  header->e_ident[EI_DATA] = ELFDATA2LSB;
+  header->e_ident[EI_VERSION] = EV_CURRENT;
+  header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+  header->e_type = type;
+  header->e_machine = EM_X86_64;
+  header->e_version = EV_CURRENT;
+  header->e_ehsize = sizeof(Elf64_Ehdr);
+}
+
+// ----------------------- Object ----------------------
+
+//! Section numbers of the object
+enum {
+  SECTION_TEXT = 1,
+  SECTION_BSS,
+  SECTION_RELA,
+  SECTION_SYMTAB,
+  SECTION_STRTAB,
+  SECTION_NOTE,
+  SECTION_SHSTRTAB,
+  SECTION_COUNT,
+};
+
+static Elf64_Sym symbol_entry(const x86_module_t *module,
+                              const x86_code_t *code, int s, buffer_t *names) {
+  const x86_symbol_t *symbol = &module->symbols[s];
+  int text = symbol->section == X86_SECTION_TEXT;
+  Elf64_Sym entry = {0};
+
+  entry.st_name = put_string(names, symbol->name);
+  entry.st_info = ELF64_ST_INFO(symbol->is_global ? STB_GLOBAL : STB_LOCAL,
+                                text ? STT_FUNC : STT_OBJECT);
+  entry.st_shndx = text ? SECTION_TEXT : SECTION_BSS;
+  entry.st_value = code->symbol_offsets[s];
+  entry.st_size = code->symbol_sizes[s];
+  return entry;
+}
+
+int x86_write_object(const x86_module_t *module, const x86_code_t *code,
+                     const char *path) {
+  buffer_t file = {0}, names = {0}, section_names = {0};
+  Elf64_Shdr sections[SECTION_COUNT] = {{0}};
+  int *elf_symbols = (int *)calloc(module->symbol_count + 1, sizeof(int));
+  if (!elf_symbols) {
+    fprintf(stderr, "Error: Memory allocation failed for the ELF file.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  Elf64_Ehdr header = {0};
+  put(&file, &header, sizeof(header));
+  put_string(&names, "");
+  put_string(&section_names, "");
+
+  sections[SECTION_TEXT] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".text"),
+      .sh_type = SHT_PROGBITS,
+      .sh_flags = SHF_ALLOC | SHF_EXECINSTR,
+      .sh_offset = put(&file, code->text, code->text_size),
+      .sh_size = code->text_size,
+      .sh_addralign = 16,
+  };
+  sections[SECTION_BSS] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".bss"),
+      .sh_type = SHT_NOBITS,
+      .sh_flags = SHF_ALLOC | SHF_WRITE,
+      .sh_offset = file.size,
+      .sh_size = code->bss_size,
+      .sh_addralign = 16,
+  };
+
+  // The null symbol and the sections, the locals and then the globals
+  pad(&file, 8);
+  size_t symbols_offset = file.size;
+  Elf64_Sym entry = {0};
+  put(&file, &entry, sizeof(entry));
+  for (int section = SECTION_TEXT; section <= SECTION_BSS; section++) {
+    entry.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    entry.st_shndx = section;
+    put(&file, &entry, sizeof(entry));
+  }
+
+  int count = 3, first_global = 3;
+  for (int global = 0; global < 2; global++) {
+    if (global)
+      first_global = count;
+    for (int s = 0; s < module->symbol_count; s++)
+      if (module->symbols[s].is_global == global) {
+        entry = symbol_entry(module, code, s, &names);
+        put(&file, &entry, sizeof(entry));
+        elf_symbols[s] = count++;
+      }
+  }
+
+  sections[SECTION_SYMTAB] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".symtab"),
+      .sh_type = SHT_SYMTAB,
+      .sh_offset = symbols_offset,
+      .sh_size = count * sizeof(Elf64_Sym),
+      .sh_link = SECTION_STRTAB,
+      .sh_info = first_global,
+      .sh_addralign = 8,
+      .sh_entsize = sizeof(Elf64_Sym),
+  };
+
+  size_t relocations_offset = file.size;
+  for (int r = 0; r < code->relocation_count; r++) {
+    const x86_relocation_t *relocation = &code->relocations[r];
+    Elf64_Rela rela = {
+        .r_offset = relocation->offset,
+        .r_info = ELF64_R_INFO(elf_symbols[relocation->symbol],
+                               R_X86_64_PC32),
+        .r_addend = relocation->addend,
+    };
+    put(&file, &rela, sizeof(rela));
+  }
+
+  sections[SECTION_RELA] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".rela.text"),
+      .sh_type = SHT_RELA,
+      .sh_flags = SHF_INFO_LINK,
+      .sh_offset = relocations_offset,
+      .sh_size = code->relocation_count * sizeof(Elf64_Rela),
+      .sh_link = SECTION_SYMTAB,
+      .sh_info = SECTION_TEXT,
+      .sh_addralign = 8,
+      .sh_entsize = sizeof(Elf64_Rela),
+  };
+  sections[SECTION_STRTAB] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".strtab"),
+      .sh_type = SHT_STRTAB,
+      .sh_offset = put(&file, names.data, names.size),
+      .sh_size = names.size,
+      .sh_addralign = 1,
+  };
+  // An empty note keeps the stack of the program non-executable
+  sections[SECTION_NOTE] = (Elf64_Shdr){
+      .sh_name = put_string(&section_names, ".note.GNU-stack"),
+      .sh_type = SHT_PROGBITS,
+      .sh_offset = file.size,
+      .sh_addralign = 1,
+  };
+  sections[SECTION_SHSTRTAB].sh_name =
+      put_string(&section_names, ".shstrtab");
+  sections[SECTION_SHSTRTAB].sh_type = SHT_STRTAB;
+  sections[SECTION_SHSTRTAB].sh_offset =
+      put(&file, section_names.data, section_names.size);
+  sections[SECTION_SHSTRTAB].sh_size = section_names.size;
+  sections[SECTION_SHSTRTAB].sh_addralign = 1;
+
+  pad(&file, 8);
+  fill_identification(&header, ET_REL);
+  header.e_shoff = put(&file, sections, sizeof(sections));
+  header.e_shentsize = sizeof(Elf64_Shdr);
+  header.e_shnum = SECTION_COUNT;
+  header.e_shstrndx = SECTION_SHSTRTAB;
+  memcpy(file.data, &header, sizeof(header));
+
+  int written = write_file(&file, path, 0);
+
+  free(file.data);
+  free(names.data);
+  free(section_names.data);
+  free(elf_symbols);
+  return written;
+}
+
+// ----------------------- Executable ----------------------
+
+int x86_write_executable(const x86_module_t *module, x86_code_t *code,
+                         const char *path) {
+  size_t headers = sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr);
+  unsigned long text_address = EXECUTABLE_BASE + headers;
+  unsigned long text_end = text_address + code->text_size;
+  unsigned long bss_address = (text_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+  int entry = x86_find_symbol(module, "_start");
+
+  if (entry < 0) {
+    fprintf(stderr, "Error: The program has no entry point.\n");
+    return 0;
+  }
+  if (!x86_code_link(code, module, text_address, bss_address)) {
+    fprintf(stderr, "Error: The program is too large to be linked.\n");
+    return 0;
+  }
+
+  Elf64_Ehdr header = {0};
+  fill_identification(&header, ET_EXEC);
+  header.e_entry = text_address + code->symbol_offsets[entry];
+  header.e_phoff = sizeof(Elf64_Ehdr);
+  header.e_phentsize = sizeof(Elf64_Phdr);
+  header.e_phnum = 2;
+
+  Elf64_Phdr segments[2] = {
+      {
+          .p_type = PT_LOAD,
+          .p_flags = PF_R | PF_X,
+          .p_offset = 0,
+          .p_vaddr = EXECUTABLE_BASE,
+          .p_paddr = EXECUTABLE_BASE,
+          .p_filesz = headers + code->text_size,
+          .p_memsz = headers + code->text_size,
+          .p_align = PAGE_SIZE,
+      },
+      {
+          .p_type = PT_LOAD,
+          .p_flags = PF_R | PF_W,
+          .p_offset = bss_address - EXECUTABLE_BASE,
+          .p_vaddr = bss_address,
+          .p_paddr = bss_address,
+          .p_filesz = 0,
+          .p_memsz = code->bss_size,
+          .p_align = PAGE_SIZE,
+      },
+  };
+
+  buffer_t file = {0};
+  put(&file, &header, sizeof(header));
+  put(&file, segments, sizeof(segments));
+  put(&file, code->text, code->text_size);
+
+  int written = write_file(&file, path, 1);
+  free(file.data);
+  return written;
+}
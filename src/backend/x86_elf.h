@@ -0,0 +1,20 @@
+#ifndef X86_ELF_H
+#define X86_ELF_H
+
+#include "x86.h"
+#include "x86_encode.h"
+
+//! Writes a relocatable ELF64 object with the text, the bss and the symbols
+//! of the module, the entry symbol being the only global one. Returns 0 if
+//! the file could not be written
+int x86_write_object(const x86_module_t *module, const x86_code_t *code,
+                     const char *path);
+
+//! Links the code at fixed addresses and writes a static ELF64 executable
+//! starting at '_start': a read and execute segment with the headers and
+//! the text, and a read and write one for the bss. Returns 0 if the file
+//! could not be written
+int x86_write_executable(const x86_module_t *module, x86_code_t *code,
+                         const char *path);
+
+#endif // !X86_ELF_H
@@ -0,0 +1,532 @@
+#include "x86_encode.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INSTRUCTION 16 // Bytes of the longest encoding
+
+//! Bytes of one instruction and the fields still to be filled
+typedef struct {
+  unsigned char bytes[MAX_INSTRUCTION];
+  int length;
+  int rip_field;    // Offset of the rip-relative displacement, -1 if none
+  int branch_field; // Offset of the rel8 or rel32 of a jump or call
+} encoding_t;
+
+//! Call to a symbol, resolved once every function has its offset
+typedef struct {
+  int offset; // Of the rel32 in the text
+  int symbol;
+} call_t;
+
+typedef struct {
+  x86_code_t *code;
+  const x86_module_t *module;
+  call_t *calls;
+  int call_count;
+  int call_capacity;
+} encoder_t;
+
+static void *encode_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the machine "
+                    "code.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *encode_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the machine "
+                    "code.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static int fits_byte(int value) { return value >= -128 && value <= 127; }
+
+// ----------------------- Instructions ----------------------
+
+static void put_byte(encoding_t *encoding, int value) {
+  encoding->bytes[encoding->length++] = (unsigned char)value;
+}
+
+static void put_int(encoding_t *encoding, int value) {
+  for (int b = 0; b < 4; b++)
+    put_byte(encoding, ((unsigned int)value >> (8 * b)) & 0xFF);
+}
+
+//! Byte registers 4 to 7 mean spl, bpl, sil and dil only with a REX prefix
+static int needs_rex(int size, int reg_is_register, int reg, x86_operand_t rm) {
+  if (size != 1)
+    return 0;
+  return (reg_is_register && reg >= 4 && reg < 8) ||
+         (rm.kind == X86_OPD_REG && rm.reg >= 4 && rm.reg < 8);
+}
+
+//! REX prefix, opcode (one or two bytes) and the ModRM, SIB and
+//! displacement addressing 'rm', with 'reg' in the middle field
+static void put_rex_rm(encoding_t *encoding, int w, int force_rex, int opcode,
+                       int reg, x86_operand_t rm) {
+  int r = reg >= 8;
+  int b = (rm.kind == X86_OPD_REG || rm.kind == X86_OPD_XMM ||
+           rm.kind == X86_OPD_MEM) &&
+          rm.reg >= 8;
+
+  if (w || r || b || force_rex)
+    put_byte(encoding, 0x40 | w << 3 | r << 2 | b);
+  if (opcode > 0xFF)
+    put_byte(encoding, opcode >> 8);
+  put_byte(encoding, opcode & 0xFF);
+
+  reg &= 7;
+  if (rm.kind == X86_OPD_REG || rm.kind == X86_OPD_XMM) {
+    put_byte(encoding, 0xC0 | reg << 3 | (rm.reg & 7));
+    return;
+  }
+
+  if (rm.reg < 0) { // disp32(%rip)
+    put_byte(encoding, reg << 3 | 5);
+    encoding->rip_field = encoding->length;
+    put_int(encoding, 0);
+    return;
+  }
+
+  int base = rm.reg & 7;
+  int mod = rm.value == 0 && base != X86_RBP ? 0 : fits_byte(rm.value) ? 1 : 2;
+  put_byte(encoding, mod << 6 | reg << 3 | base);
+  if (base == X86_RSP)
+    put_byte(encoding, 0x24); // SIB with no index
+  if (mod == 1)
+    put_byte(encoding, rm.value);
+  else if (mod == 2)
+    put_int(encoding, rm.value);
+}
+
+static void put_rm(encoding_t *encoding, int size, int opcode,
+                   int reg_is_register, int reg, x86_operand_t rm) {
+  put_rex_rm(encoding, size == 8, needs_rex(size, reg_is_register, reg, rm),
+             opcode, reg, rm);
+}
+
+//! Extension in the ModRM of the arithmetic group (0x80 to 0x83)
+static int arithmetic_extension(x86_opcode_t op) {
+  switch (op) {
+  case X86_ADD:
+    return 0;
+  case X86_AND:
+    return 4;
+  case X86_SUB:
+    return 5;
+  case X86_XOR:
+    return 6;
+  default:
+    return 7; // cmp
+  }
+}
+
+//! Mandatory prefix, then the REX and the two opcode bytes of an SSE
+//! instruction, with the xmm register 'reg' in the middle field
+static void put_sse(encoding_t *encoding, int prefix, int opcode, int reg,
+                    x86_operand_t rm) {
+  put_byte(encoding, prefix);
+  put_rex_rm(encoding, 0, 0, opcode, reg, rm);
+}
+
+static int shift_extension(x86_opcode_t op) {
+  return op == X86_SHL ? 4 : op == X86_SHR ? 5 : 7;
+}
+
+static void encode_mov(encoding_t *encoding, const x86_instr_t *instr) {
+  int size = instr->size;
+  x86_operand_t src = instr->src, dst = instr->dst;
+
+  if (src.kind == X86_OPD_IMM) {
+    if (dst.kind == X86_OPD_REG && size == 4) {
+      if (dst.reg >= 8)
+        put_byte(encoding, 0x41);
+      put_byte(encoding, 0xB8 + (dst.reg & 7));
+      put_int(encoding, src.value);
+    } else if (size == 1) {
+      put_rm(encoding, size, 0xC6, 0, 0, dst);
+      put_byte(encoding, src.value);
+    } else {
+      put_rm(encoding, size, 0xC7, 0, 0, dst);
+      put_int(encoding, src.value);
+    }
+  } else if (src.kind == X86_OPD_REG)
+    put_rm(encoding, size, size == 1 ? 0x88 : 0x89, 1, src.reg, dst);
+  else
+    put_rm(encoding, size, size == 1 ? 0x8A : 0x8B, 1, dst.reg, src);
+}
+
+static void encode_arithmetic(encoding_t *encoding, const x86_instr_t *instr) {
+  int size = instr->size, extension = arithmetic_extension(instr->op);
+  x86_operand_t src = instr->src, dst = instr->dst;
+
+  if (src.kind == X86_OPD_IMM) {
+    if (size == 1 || fits_byte(src.value)) {
+      put_rm(encoding, size, size == 1 ? 0x80 : 0x83, 0, extension, dst);
+      put_byte(encoding, src.value);
+    } else {
+      put_rm(encoding, size, 0x81, 0, extension, dst);
+      put_int(encoding, src.value);
+    }
+  } else if (src.kind == X86_OPD_REG)
+    put_rm(encoding, size, extension * 8 + (size == 1 ? 0 : 1), 1, src.reg,
+           dst);
+  else
+    put_rm(encoding, size, extension * 8 + (size == 1 ? 2 : 3), 1, dst.reg,
+           src);
+}
+
+//! Encodes an instruction, with a zero displacement for its label, symbol
+//! or rip-relative operand
+static void encode_instr(const x86_instr_t *instr, int long_jump,
+                         encoding_t *encoding) {
+  x86_operand_t src = instr->src, dst = instr->dst;
+  int size = instr->size;
+
+  encoding->length = 0;
+  encoding->rip_field = encoding->branch_field = -1;
+
+  switch (instr->op) {
+  case X86_LABEL:
+  case X86_OPCODE_COUNT:
+    break;
+  case X86_MOV:
+    encode_mov(encoding, instr);
+    break;
+  case X86_MOVSX:
+    put_rm(encoding, 8, 0x63, 1, dst.reg, src);
+    break;
+  case X86_MOVZX:
+    // The source is a byte register, even if the result is not
+    put_rex_rm(encoding, 0, needs_rex(1, 0, 0, src), 0x0FB6, dst.reg, src);
+    break;
+  case X86_LEA:
+    put_rm(encoding, 8, 0x8D, 1, dst.reg, src);
+    break;
+  case X86_ADD:
+  case X86_SUB:
+  case X86_AND:
+  case X86_XOR:
+  case X86_CMP:
+    encode_arithmetic(encoding, instr);
+    break;
+  case X86_TEST:
+    if (src.kind == X86_OPD_IMM) {
+      put_rm(encoding, size, size == 1 ? 0xF6 : 0xF7, 0, 0, dst);
+      if (size == 1)
+        put_byte(encoding, src.value);
+      else
+        put_int(encoding, src.value);
+    } else
+      put_rm(encoding, size, size == 1 ? 0x84 : 0x85, 1, src.reg, dst);
+    break;
+  case X86_IMUL:
+    if (src.kind != X86_OPD_IMM)
+      put_rm(encoding, size, 0x0FAF, 1, dst.reg, src);
+    else if (fits_byte(src.value)) {
+      put_rm(encoding, size, 0x6B, 1, dst.reg, dst);
+      put_byte(encoding, src.value);
+    } else {
+      put_rm(encoding, size, 0x69, 1, dst.reg, dst);
+      put_int(encoding, src.value);
+    }
+    break;
+  case X86_NEG:
+    put_rm(encoding, size, 0xF7, 0, 3, dst);
+    break;
+  case X86_SHL:
+  case X86_SHR:
+  case X86_SAR:
+    if (src.kind == X86_OPD_IMM && src.value == 1)
+      put_rm(encoding, size, 0xD1, 0, shift_extension(instr->op), dst);
+    else if (src.kind == X86_OPD_IMM) {
+      put_rm(encoding, size, 0xC1, 0, shift_extension(instr->op), dst);
+      put_byte(encoding, src.value);
+    } else
+      put_rm(encoding, size, 0xD3, 0, shift_extension(instr->op), dst);
+    break;
+  case X86_CDQ:
+    put_byte(encoding, 0x99);
+    break;
+  case X86_IDIV:
+  case X86_DIV:
+    put_rm(encoding, size, 0xF7, 0, instr->op == X86_IDIV ? 7 : 6, src);
+    break;
+  case X86_SETCC:
+    put_rm(encoding, 1, 0x0F90 + instr->condition, 0, 0, dst);
+    break;
+  case X86_JMP:
+    long_jump |= src.kind == X86_OPD_SYMBOL;
+    put_byte(encoding, long_jump ? 0xE9 : 0xEB);
+    encoding->branch_field = encoding->length;
+    if (long_jump)
+      put_int(encoding, 0);
+    else
+      put_byte(encoding, 0);
+    break;
+  case X86_JCC:
+    if (long_jump) {
+      put_byte(encoding, 0x0F);
+      put_byte(encoding, 0x80 + instr->condition);
+      encoding->branch_field = encoding->length;
+      put_int(encoding, 0);
+    } else {
+      put_byte(encoding, 0x70 + instr->condition);
+      encoding->branch_field = encoding->length;
+      put_byte(encoding, 0);
+    }
+    break;
+  case X86_CALL:
+    if (src.kind == X86_OPD_MEM) { // call *src
+      put_rex_rm(encoding, 0, 0, 0xFF, 2, src);
+      break;
+    }
+    put_byte(encoding, 0xE8);
+    encoding->branch_field = encoding->length;
+    put_int(encoding, 0);
+    break;
+  case X86_RET:
+    put_byte(encoding, 0xC3);
+    break;
+  case X86_PUSH:
+  case X86_POP: {
+    int reg = instr->op == X86_PUSH ? src.reg : dst.reg;
+    if (reg >= 8)
+      put_byte(encoding, 0x41);
+    put_byte(encoding, (instr->op == X86_PUSH ? 0x50 : 0x58) + (reg & 7));
+    break;
+  }
+  case X86_SYSCALL:
+    put_byte(encoding, 0x0F);
+    put_byte(encoding, 0x05);
+    break;
+  case X86_MOVD:
+    put_sse(encoding, 0x66, 0x0F6E, dst.reg, src);
+    break;
+  case X86_MOVDQU:
+    if (dst.kind == X86_OPD_XMM)
+      put_sse(encoding, 0xF3, 0x0F6F, dst.reg, src);
+    else
+      put_sse(encoding, 0xF3, 0x0F7F, src.reg, dst);
+    break;
+  case X86_PSHUFD:
+    put_sse(encoding, 0x66, 0x0F70, dst.reg, src);
+    put_byte(encoding, 0); // Every int from the lowest
+    break;
+  case X86_PADDD:
+  case X86_PSUBD:
+    put_sse(encoding, 0x66, instr->op == X86_PADDD ? 0x0FFE : 0x0FFA, dst.reg,
+            src);
+    break;
+  }
+}
+
+// ----------------------- Functions ----------------------
+
+static void append(x86_code_t *code, const unsigned char *bytes, int count) {
+  if (code->text_size + count > code->text_capacity) {
+    while (code->text_size + count > code->text_capacity)
+      code->text_capacity = code->text_capacity ? code->text_capacity * 2
+                                                : 4096;
+    code->text = (unsigned char *)encode_realloc(code->text,
+                                                 code->text_capacity);
+  }
+  memcpy(code->text + code->text_size, bytes, count);
+  code->text_size += count;
+}
+
+static void write_int(unsigned char *field, int value) {
+  for (int b = 0; b < 4; b++)
+    field[b] = ((unsigned int)value >> (8 * b)) & 0xFF;
+}
+
+static void add_relocation(x86_code_t *code, int offset, int symbol,
+                           int addend) {
+  if (code->relocation_count == code->relocation_capacity) {
+    code->relocation_capacity =
+        code->relocation_capacity ? code->relocation_capacity * 2 : 64;
+    code->relocations = (x86_relocation_t *)encode_realloc(
+        code->relocations, code->relocation_capacity * sizeof(x86_relocation_t));
+  }
+  code->relocations[code->relocation_count++] =
+      (x86_relocation_t){offset, symbol, addend};
+}
+
+static void add_call(encoder_t *encoder, int offset, int symbol) {
+  if (encoder->call_count == encoder->call_capacity) {
+    encoder->call_capacity =
+        encoder->call_capacity ? encoder->call_capacity * 2 : 64;
+    encoder->calls = (call_t *)encode_realloc(
+        encoder->calls, encoder->call_capacity * sizeof(call_t));
+  }
+  encoder->calls[encoder->call_count++] = (call_t){offset, symbol};
+}
+
+//! Jumps start short and the ones whose target ends up out of reach grow,
+//! until none does
+static void encode_function(encoder_t *encoder,
+                            const x86_function_t *function) {
+  x86_code_t *code = encoder->code;
+  int count = function->count;
+  char *long_jump = (char *)encode_alloc(count, 1);
+  int *offsets = (int *)encode_alloc(count + 1, sizeof(int));
+  int *labels = (int *)encode_alloc(function->label_count, sizeof(int));
+  encoding_t encoding;
+  int changed;
+
+  do {
+    int offset = 0;
+    for (int i = 0; i < count; i++) {
+      const x86_instr_t *instr = &function->instrs[i];
+      offsets[i] = offset;
+      if (instr->op == X86_LABEL)
+        labels[instr->src.value] = offset;
+      encode_instr(instr, long_jump[i], &encoding);
+      offset += encoding.length;
+    }
+    offsets[count] = offset;
+
+    changed = 0;
+    for (int i = 0; i < count; i++) {
+      const x86_instr_t *instr = &function->instrs[i];
+      if ((instr->op == X86_JMP || instr->op == X86_JCC) &&
+          instr->src.kind == X86_OPD_LABEL && !long_jump[i] &&
+          !fits_byte(labels[instr->src.value] - offsets[i + 1]))
+        long_jump[i] = changed = 1;
+    }
+  } while (changed);
+
+  int start = code->text_size;
+  for (int i = 0; i < count; i++) {
+    const x86_instr_t *instr = &function->instrs[i];
+    encode_instr(instr, long_jump[i], &encoding);
+    int end = offsets[i + 1];
+
+    if ((instr->op == X86_JMP || instr->op == X86_JCC) &&
+        instr->src.kind == X86_OPD_LABEL) {
+      int displacement = labels[instr->src.value] - end;
+      if (long_jump[i])
+        write_int(encoding.bytes + encoding.branch_field, displacement);
+      else
+        encoding.bytes[encoding.branch_field] = (unsigned char)displacement;
+    } else if ((instr->op == X86_CALL || instr->op == X86_JMP) &&
+               instr->src.kind == X86_OPD_SYMBOL)
+      add_call(encoder, start + offsets[i] + encoding.branch_field,
+               instr->src.symbol);
+
+    if (encoding.rip_field >= 0) {
+      x86_operand_t memory =
+          instr->src.kind == X86_OPD_MEM ? instr->src : instr->dst;
+      add_relocation(code, start + offsets[i] + encoding.rip_field,
+                     memory.symbol,
+                     memory.value - (encoding.length - encoding.rip_field));
+    }
+    append(code, encoding.bytes, encoding.length);
+  }
+
+  free(long_jump);
+  free(offsets);
+  free(labels);
+}
+
+// ----------------------- Module ----------------------
+
+x86_code_t *x86_encode_module(const x86_module_t *module) {
+  x86_code_t *code = (x86_code_t *)encode_alloc(1, sizeof(x86_code_t));
+  encoder_t encoder = {.code = code, .module = module};
+  char *defined = (char *)encode_alloc(module->symbol_count, 1);
+
+  code->symbol_offsets = (int *)encode_alloc(module->symbol_count, sizeof(int));
+  code->symbol_sizes = (int *)encode_alloc(module->symbol_count, sizeof(int));
+
+  for (int s = 0; s < module->symbol_count; s++) {
+    const x86_symbol_t *symbol = &module->symbols[s];
+    if (symbol->section != X86_SECTION_BSS)
+      continue;
+
+    code->bss_size =
+        (code->bss_size + symbol->align - 1) / symbol->align * symbol->align;
+    code->symbol_offsets[s] = code->bss_size;
+    code->symbol_sizes[s] = symbol->size;
+    code->bss_size += symbol->size;
+    defined[s] = 1;
+  }
+
+  static const unsigned char nop = 0x90;
+  for (int f = 0; f < module->function_count; f++) {
+    const x86_function_t *function = &module->functions[f];
+
+    while (code->text_size % 16)
+      append(code, &nop, 1);
+    code->symbol_offsets[function->symbol] = code->text_size;
+    encode_function(&encoder, function);
+    code->symbol_sizes[function->symbol] =
+        code->text_size - code->symbol_offsets[function->symbol];
+    defined[function->symbol] = 1;
+  }
+
+  for (int c = 0; c < encoder.call_count; c++) {
+    const call_t *call = &encoder.calls[c];
+    if (!defined[call->symbol]) {
+      fprintf(stderr, "Error: Call to the undefined symbol %s.\n",
+              module->symbols[call->symbol].name);
+      exit(EXIT_FAILURE);
+    }
+    write_int(code->text + call->offset,
+              code->symbol_offsets[call->symbol] - (call->offset + 4));
+  }
+
+  free(encoder.calls);
+  free(defined);
+  return code;
+}
+
+void x86_code_destroy(x86_code_t *code) {
+  if (!code)
+    return;
+
+  free(code->text);
+  free(code->symbol_offsets);
+  free(code->symbol_sizes);
+  free(code->relocations);
+  free(code);
+}
+
+int x86_code_link_at(x86_code_t *code, unsigned long text_address,
+                     const unsigned long *addresses) {
+  for (int r = 0; r < code->relocation_count; r++) {
+    const x86_relocation_t *relocation = &code->relocations[r];
+    long value = (long)(addresses[relocation->symbol] -
+                        (text_address + relocation->offset)) +
+                 relocation->addend;
+
+    if (value < -2147483648L || value > 2147483647L)
+      return 0;
+    write_int(code->text + relocation->offset, (int)value);
+  }
+  return 1;
+}
+
+int x86_code_link(x86_code_t *code, const x86_module_t *module,
+                  unsigned long text_address, unsigned long bss_address) {
+  unsigned long *addresses = (unsigned long *)encode_alloc(
+      module->symbol_count, sizeof(unsigned long));
+
+  for (int s = 0; s < module->symbol_count; s++)
+    addresses[s] = (module->symbols[s].section == X86_SECTION_BSS
+                        ? bss_address
+                        : text_address) +
+                   code->symbol_offsets[s];
+
+  int linked = x86_code_link_at(code, text_address, addresses);
+  free(addresses);
+  return linked;
+}
@@ -0,0 +1,47 @@
+#ifndef X86_ENCODE_H
+#define X86_ENCODE_H
+
+#include "x86.h"
+
+//! 32 bits field holding S + addend - P, where S is the address of the
+//! symbol and P the address of the field (ELF's R_X86_64_PC32)
+typedef struct {
+  int offset; // Of the field in the text
+  int symbol;
+  int addend;
+} x86_relocation_t;
+
+//! Machine code of a module: the text of every function, the layout of the
+//! zero-initialized data and the references to the data still unresolved
+typedef struct {
+  unsigned char *text;
+  int text_size;
+  int text_capacity;
+  int bss_size;
+  int *symbol_offsets; // In the text or in the bss, by symbol
+  int *symbol_sizes;   // Bytes of code of the functions, size of the data
+
+  x86_relocation_t *relocations;
+  int relocation_count;
+  int relocation_capacity;
+} x86_code_t;
+
+//! Encodes every function of the module, 16 bytes aligned. Jumps take the
+//! short form whenever their target is in reach, calls are resolved inside
+//! the text and rip-relative accesses are left as relocations
+x86_code_t *x86_encode_module(const x86_module_t *module);
+
+void x86_code_destroy(x86_code_t *code);
+
+//! Resolves the relocations for the text loaded at 'text_address' and the
+//! bss at 'bss_address'. Returns 0 if a reference is out of reach
+int x86_code_link(x86_code_t *code, const x86_module_t *module,
+                  unsigned long text_address, unsigned long bss_address);
+
+//! Resolves the relocations for the text loaded at 'text_address', every
+//! symbol being at its entry of 'addresses', wherever its section is.
+//! Returns 0 if a reference is out of reach
+int x86_code_link_at(x86_code_t *code, unsigned long text_address,
+                     const unsigned long *addresses);
+
+#endif // !X86_ENCODE_H
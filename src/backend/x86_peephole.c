@@ -0,0 +1,535 @@
+#include "x86_peephole.h"
+
+#include <stdlib.h>
+
+#define FLAGS X86_REGISTER_COUNT // Bit of the flags in the register sets
+#define BIT(reg) (1u << (reg))
+#define ALL_REGISTERS (BIT(X86_REGISTER_COUNT) - 1)
+#define CALLEE_SAVED                                                           \
+  (BIT(X86_RBX) | BIT(X86_RSP) | BIT(X86_RBP) | BIT(X86_R12) | BIT(X86_R13) | \
+   BIT(X86_R14) | BIT(X86_R15))
+#define ANY X86_OPCODE_COUNT // Opcode of a rule matching every instruction
+
+//! State of the rewriting of a function
+typedef struct {
+  x86_function_t *function;
+  int *labels;        // Instruction defining each label
+  unsigned *live_out; // Registers and flags read after each instruction
+  char *removed;      // By a rule, until the instructions are compacted
+} peephole_t;
+
+static void *peephole_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the peephole "
+                    "optimizer.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+// ----------------------- Liveness ----------------------
+
+static unsigned registers_of(x86_operand_t operand) {
+  if (operand.kind == X86_OPD_REG ||
+      (operand.kind == X86_OPD_MEM && operand.reg >= 0))
+    return BIT(operand.reg);
+  return 0;
+}
+
+//! Writes its register dst without reading it. The byte 'setcc' writes is
+//! always zero-extended right after
+static int defines_only(x86_opcode_t op) {
+  return op == X86_MOV || op == X86_MOVSX || op == X86_MOVZX ||
+         op == X86_LEA || op == X86_POP || op == X86_SETCC;
+}
+
+static int sets_flags(x86_opcode_t op) {
+  switch (op) {
+  case X86_ADD:
+  case X86_SUB:
+  case X86_IMUL:
+  case X86_AND:
+  case X86_XOR:
+  case X86_NEG:
+  case X86_SHL:
+  case X86_SHR:
+  case X86_SAR:
+  case X86_IDIV:
+  case X86_DIV:
+  case X86_CMP:
+  case X86_TEST:
+  case X86_CALL:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+//! Registers and flags an instruction reads and writes. The xmm registers
+//! never hold a value from one instruction sequence to the next. Calls and
+//! tail calls read every register, as the runtime passes some values
+//! outside of the calling convention, and what they write is left out,
+//! which only keeps more values alive. Returns give rax and the registers
+//! the caller keeps
+static void effects(const x86_instr_t *instr, unsigned *uses,
+                    unsigned *defs) {
+  x86_operand_t src = instr->src, dst = instr->dst;
+
+  *uses = registers_of(src);
+  *defs = sets_flags(instr->op) ? BIT(FLAGS) : 0;
+  if (dst.kind == X86_OPD_MEM)
+    *uses |= registers_of(dst);
+  else if (dst.kind == X86_OPD_REG) {
+    if (instr->op != X86_CMP && instr->op != X86_TEST)
+      *defs |= BIT(dst.reg);
+    if (instr->op == X86_XOR && x86_same_operand(src, dst))
+      *uses = 0; // Zeroes the register whatever it holds
+    else if (!defines_only(instr->op) ||
+             (instr->op == X86_MOV && instr->size == 1))
+      *uses |= BIT(dst.reg);
+  }
+
+  switch (instr->op) {
+  case X86_SHL:
+  case X86_SHR:
+  case X86_SAR:
+    if (src.kind == X86_OPD_REG)
+      *uses |= BIT(FLAGS); // Kept by a zero count
+    break;
+  case X86_SETCC:
+  case X86_JCC:
+    *uses |= BIT(FLAGS);
+    break;
+  case X86_CDQ:
+    *uses |= BIT(X86_RAX);
+    *defs |= BIT(X86_RDX);
+    break;
+  case X86_IDIV:
+  case X86_DIV:
+    *uses |= BIT(X86_RAX) | BIT(X86_RDX);
+    *defs |= BIT(X86_RAX) | BIT(X86_RDX);
+    break;
+  case X86_CALL:
+  case X86_SYSCALL:
+    *uses |= ALL_REGISTERS;
+    break;
+  case X86_RET:
+    *uses |= BIT(X86_RAX) | CALLEE_SAVED;
+    break;
+  case X86_JMP:
+    if (src.kind == X86_OPD_SYMBOL)
+      *uses |= ALL_REGISTERS;
+    break;
+  default:
+    break;
+  }
+}
+
+//! Instructions run after 'i', -1 for none
+static void successors(const peephole_t *peephole, int i, int next[2]) {
+  const x86_instr_t *instr = &peephole->function->instrs[i];
+
+  next[0] = next[1] = -1;
+  if (instr->op == X86_RET ||
+      (instr->op == X86_JMP && instr->src.kind != X86_OPD_LABEL))
+    return;
+  if (instr->op == X86_JMP || instr->op == X86_JCC)
+    next[0] = peephole->labels[instr->src.value];
+  if (instr->op != X86_JMP && i + 1 < peephole->function->count)
+    next[1] = i + 1;
+}
+
+//! Backward dataflow over the instructions until the sets stop changing
+static void compute_liveness(peephole_t *peephole) {
+  x86_function_t *function = peephole->function;
+  unsigned *live_in =
+      (unsigned *)peephole_alloc(function->count, sizeof(unsigned));
+  int changed = 1;
+
+  for (int l = 0; l < function->label_count; l++)
+    peephole->labels[l] = -1;
+  for (int i = 0; i < function->count; i++)
+    if (function->instrs[i].op == X86_LABEL)
+      peephole->labels[function->instrs[i].src.value] = i;
+
+  while (changed) {
+    changed = 0;
+    for (int i = function->count - 1; i >= 0; i--) {
+      unsigned out = 0, uses, defs;
+      int next[2];
+
+      successors(peephole, i, next);
+      for (int s = 0; s < 2; s++)
+        if (next[s] >= 0)
+          out |= live_in[next[s]];
+      peephole->live_out[i] = out;
+
+      effects(&function->instrs[i], &uses, &defs);
+      unsigned in = (out & ~defs) | uses;
+      if (in != live_in[i]) {
+        live_in[i] = in;
+        changed = 1;
+      }
+    }
+  }
+
+  free(live_in);
+}
+
+//! Nothing reads the register, or the flags, after the instruction. The
+//! stack and frame pointers are always needed
+static int dead_after(const peephole_t *peephole, int i, int reg) {
+  return reg != X86_RSP && reg != X86_RBP &&
+         !(peephole->live_out[i] & BIT(reg));
+}
+
+//! Next instruction not removed, -1 at the end of the function
+static int next_instr(const peephole_t *peephole, int i) {
+  for (i++; i < peephole->function->count; i++)
+    if (!peephole->removed[i])
+      return i;
+  return -1;
+}
+
+//! The labels starting at instruction 'i' include 'label'
+static int labels_at(const peephole_t *peephole, int i, int label) {
+  const x86_instr_t *instrs = peephole->function->instrs;
+
+  for (; i >= 0 && instrs[i].op == X86_LABEL; i = next_instr(peephole, i))
+    if (instrs[i].src.value == label)
+      return 1;
+  return 0;
+}
+
+// ----------------------- Rules ----------------------
+
+static int is_register_move(const x86_instr_t *instr) {
+  return instr->op == X86_MOV && instr->src.kind == X86_OPD_REG &&
+         instr->dst.kind == X86_OPD_REG;
+}
+
+//! 'mov %r, %r'. Ints are only ever read in their 4 low bytes, so a 4
+//! bytes move, which zeroes the high ones, is of no use either
+static int move_to_itself(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *move = &peephole->function->instrs[i];
+  (void)j;
+
+  if (!is_register_move(move) || move->src.reg != move->dst.reg)
+    return 0;
+  peephole->removed[i] = 1;
+  return 1;
+}
+
+//! 'mov %a, %b' then 'mov %b, %a'
+static int move_back(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *first = &peephole->function->instrs[i];
+  const x86_instr_t *second = &peephole->function->instrs[j];
+
+  if (!is_register_move(first) || !is_register_move(second) ||
+      first->size != second->size || first->src.reg != second->dst.reg ||
+      first->dst.reg != second->src.reg)
+    return 0;
+  peephole->removed[j] = 1;
+  return 1;
+}
+
+//! A spill then the reload of the same slot: the register still holds it
+static int load_after_store(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *store = &peephole->function->instrs[i];
+  x86_instr_t *load = &peephole->function->instrs[j];
+
+  if (store->src.kind != X86_OPD_REG || store->dst.kind != X86_OPD_MEM ||
+      load->dst.kind != X86_OPD_REG || store->size != load->size ||
+      !x86_same_operand(store->dst, load->src))
+    return 0;
+
+  if (load->dst.reg == store->src.reg)
+    peephole->removed[j] = 1;
+  else
+    load->src = store->src;
+  return 1;
+}
+
+//! A load then the store of the register back to the same place
+static int store_of_load(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *load = &peephole->function->instrs[i];
+  const x86_instr_t *store = &peephole->function->instrs[j];
+
+  if (load->src.kind != X86_OPD_MEM || load->dst.kind != X86_OPD_REG ||
+      load->src.reg == load->dst.reg || load->size != store->size ||
+      !x86_same_operand(load->dst, store->src) ||
+      !x86_same_operand(load->src, store->dst))
+    return 0;
+  peephole->removed[j] = 1;
+  return 1;
+}
+
+//! Makes an instruction read 'to' instead of 'from'. Fails when 'from' is
+//! also written in place, is the implicit count of a shift, or is read
+//! in 8 bytes when only 4 were copied
+static int substitute(x86_instr_t *instr, int from, int to, int size) {
+  x86_operand_t *src = &instr->src, *dst = &instr->dst;
+  int narrow = size != 8 && instr->size == 8 && instr->op != X86_MOVSX;
+
+  if (src->kind == X86_OPD_REG && src->reg == from) {
+    if (narrow || instr->op == X86_SHL || instr->op == X86_SHR ||
+        instr->op == X86_SAR)
+      return 0;
+    src->reg = to;
+  }
+  if (src->kind == X86_OPD_MEM && src->reg == from) {
+    if (size != 8)
+      return 0;
+    src->reg = to;
+  }
+
+  if (dst->kind == X86_OPD_MEM && dst->reg == from) {
+    if (size != 8)
+      return 0;
+    dst->reg = to;
+  } else if (dst->kind == X86_OPD_REG && dst->reg == from &&
+             !defines_only(instr->op)) {
+    if (narrow || (instr->op != X86_CMP && instr->op != X86_TEST))
+      return 0;
+    dst->reg = to;
+  }
+  return 1;
+}
+
+//! 'mov %a, %b' then an instruction reading b, which nothing reads after:
+//! the instruction reads a instead
+static int forward_copy(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *move = &peephole->function->instrs[i];
+  x86_instr_t rewritten = peephole->function->instrs[j];
+  unsigned uses, defs;
+
+  if (!is_register_move(move) || move->size == 1)
+    return 0;
+  int from = move->dst.reg, to = move->src.reg;
+  if (!substitute(&rewritten, from, to, move->size))
+    return 0;
+
+  // Neither read implicitly nor needed after, unless written again
+  effects(&rewritten, &uses, &defs);
+  if ((uses & BIT(from)) ||
+      (!(defs & BIT(from)) && !dead_after(peephole, j, from)))
+    return 0;
+
+  peephole->function->instrs[j] = rewritten;
+  peephole->removed[i] = 1;
+  return 1;
+}
+
+//! An instruction writing a register only copied to another one, which
+//! nothing reads after: the instruction writes the other one directly
+static int forward_result(peephole_t *peephole, int i, int j) {
+  x86_instr_t *first = &peephole->function->instrs[i];
+  const x86_instr_t *move = &peephole->function->instrs[j];
+  int size;
+
+  switch (first->op) {
+  case X86_MOV:
+    size = first->size;
+    break;
+  case X86_MOVZX:
+    size = 4;
+    break;
+  case X86_MOVSX:
+  case X86_LEA:
+    size = 8;
+    break;
+  default:
+    return 0;
+  }
+
+  if (!is_register_move(move) || move->size != size ||
+      first->dst.kind != X86_OPD_REG || first->dst.reg != move->src.reg ||
+      move->src.reg == move->dst.reg ||
+      !dead_after(peephole, j, move->src.reg))
+    return 0;
+  first->dst = move->dst;
+  peephole->removed[j] = 1;
+  return 1;
+}
+
+//! 'add $0' or 'sub $0' whose flags nothing reads
+static int add_zero(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *instr = &peephole->function->instrs[i];
+  (void)j;
+
+  if (instr->src.kind != X86_OPD_IMM || instr->src.value != 0 ||
+      !dead_after(peephole, i, FLAGS))
+    return 0;
+  peephole->removed[i] = 1;
+  return 1;
+}
+
+//! 'mov $0, %r' into the shorter 'xor %r, %r', when the flags are free
+static int zeroing_move(peephole_t *peephole, int i, int j) {
+  x86_instr_t *instr = &peephole->function->instrs[i];
+  (void)j;
+
+  if (instr->src.kind != X86_OPD_IMM || instr->src.value != 0 ||
+      instr->dst.kind != X86_OPD_REG || instr->size == 1 ||
+      !dead_after(peephole, i, FLAGS))
+    return 0;
+  instr->op = X86_XOR;
+  instr->size = 4; // Zeroes the high half too
+  instr->src = instr->dst;
+  return 1;
+}
+
+//! 'setcc', 'movzx' and 'test' of the result, then 'jne' or 'je' on it:
+//! the jump takes the condition of the compare before them
+static int compare_branch(peephole_t *peephole, int i, int j) {
+  x86_instr_t *instrs = peephole->function->instrs;
+  int k = next_instr(peephole, j);
+  int l = k >= 0 ? next_instr(peephole, k) : -1;
+
+  if (l < 0)
+    return 0;
+  x86_instr_t *set = &instrs[i], *extend = &instrs[j], *test = &instrs[k];
+  x86_instr_t *branch = &instrs[l];
+  if (set->dst.kind != X86_OPD_REG || extend->src.kind != X86_OPD_REG ||
+      extend->src.reg != set->dst.reg || extend->dst.kind != X86_OPD_REG)
+    return 0;
+
+  int result = extend->dst.reg;
+  if (test->op != X86_TEST || test->src.kind != X86_OPD_REG ||
+      test->src.reg != result || !x86_same_operand(test->src, test->dst) ||
+      branch->op != X86_JCC ||
+      (branch->condition != X86_CC_NE && branch->condition != X86_CC_E))
+    return 0;
+  if (!dead_after(peephole, l, set->dst.reg) ||
+      !dead_after(peephole, l, result) || !dead_after(peephole, l, FLAGS))
+    return 0;
+
+  // The conditions go by pairs, the second one of a pair negating the first
+  branch->condition = branch->condition == X86_CC_NE ? set->condition
+                                                     : set->condition ^ 1;
+  peephole->removed[i] = peephole->removed[j] = peephole->removed[k] = 1;
+  return 1;
+}
+
+//! 'jcc L1', 'jmp L2' then L1: a single jump on the negated condition
+static int branch_over_jump(peephole_t *peephole, int i, int j) {
+  x86_instr_t *branch = &peephole->function->instrs[i];
+  const x86_instr_t *jump = &peephole->function->instrs[j];
+
+  if (jump->src.kind != X86_OPD_LABEL ||
+      !labels_at(peephole, next_instr(peephole, j), branch->src.value))
+    return 0;
+  branch->condition ^= 1;
+  branch->src = jump->src;
+  peephole->removed[j] = 1;
+  return 1;
+}
+
+static int jump_to_next(peephole_t *peephole, int i, int j) {
+  const x86_instr_t *jump = &peephole->function->instrs[i];
+
+  if (jump->src.kind != X86_OPD_LABEL ||
+      !labels_at(peephole, j, jump->src.value))
+    return 0;
+  peephole->removed[i] = 1;
+  return 1;
+}
+
+typedef int (*peephole_rule_t)(peephole_t *peephole, int first, int second);
+
+//! Tried in order on each instruction, with the next one as the second,
+//! -1 at the end of the function. The moves and the compares come from the
+//! instruction sequences of the selection, which copy every result from
+//! rax to its register and branch on a compare through a byte register
+static const struct {
+  const char *name;
+  x86_opcode_t first;
+  x86_opcode_t second;
+  peephole_rule_t rewrite;
+} RULES[X86_PEEPHOLE_RULES] = {
+    {"moves to itself", X86_MOV, ANY, move_to_itself},
+    {"moves back", X86_MOV, X86_MOV, move_back},
+    {"loads after a store", X86_MOV, X86_MOV, load_after_store},
+    {"stores of a load", X86_MOV, X86_MOV, store_of_load},
+    {"copies forwarded", X86_MOV, ANY, forward_copy},
+    {"results forwarded", ANY, X86_MOV, forward_result},
+    {"adds of 0", X86_ADD, ANY, add_zero},
+    {"subs of 0", X86_SUB, ANY, add_zero},
+    {"zeroing moves", X86_MOV, ANY, zeroing_move},
+    {"compares branched on", X86_SETCC, X86_MOVZX, compare_branch},
+    {"branches over a jump", X86_JCC, X86_JMP, branch_over_jump},
+    {"jumps to the next label", X86_JMP, X86_LABEL, jump_to_next},
+};
+
+// ----------------------- Pass ----------------------
+
+//! One pass of the rules over the function. The liveness of the
+//! instructions after the one rewritten stays right: a rewrite never reads
+//! a register that was not live before it
+static int rewrite_function(peephole_t *peephole,
+                            x86_peephole_stats_t *stats) {
+  x86_function_t *function = peephole->function;
+  int changed = 0;
+
+  for (int i = 0; i < function->count; i++)
+    for (int r = 0; r < X86_PEEPHOLE_RULES && !peephole->removed[i]; r++) {
+      int j = next_instr(peephole, i);
+      x86_opcode_t first = function->instrs[i].op;
+      if ((RULES[r].first != ANY && RULES[r].first != first) ||
+          (RULES[r].second != ANY &&
+           (j < 0 || function->instrs[j].op != RULES[r].second)))
+        continue;
+      if (RULES[r].rewrite(peephole, i, j)) {
+        stats->hits[r]++;
+        changed = 1;
+      }
+    }
+  return changed;
+}
+
+static void compact(peephole_t *peephole) {
+  x86_function_t *function = peephole->function;
+  int count = 0;
+
+  for (int i = 0; i < function->count; i++)
+    if (!peephole->removed[i])
+      function->instrs[count++] = function->instrs[i];
+  for (int i = 0; i < function->count; i++)
+    peephole->removed[i] = 0;
+  function->count = count;
+}
+
+void x86_peephole_module(x86_module_t *module, x86_peephole_stats_t *stats) {
+  for (int f = 0; f < module->function_count; f++) {
+    x86_function_t *function = &module->functions[f];
+    peephole_t peephole = {.function = function};
+    int changed = 1;
+
+    peephole.labels =
+        (int *)peephole_alloc(function->label_count, sizeof(int));
+    peephole.live_out =
+        (unsigned *)peephole_alloc(function->count, sizeof(unsigned));
+    peephole.removed = (char *)peephole_alloc(function->count, 1);
+    stats->before += function->count;
+
+    while (changed) {
+      compute_liveness(&peephole);
+      changed = rewrite_function(&peephole, stats);
+      compact(&peephole);
+    }
+
+    stats->after += function->count;
+    free(peephole.labels);
+    free(peephole.live_out);
+    free(peephole.removed);
+  }
+}
+
+void x86_peephole_print_stats(const x86_peephole_stats_t *stats,
+                              FILE *output) {
+  fprintf(output, "peephole: %ld instructions down to %ld\n", stats->before,
+          stats->after);
+  for (int r = 0; r < X86_PEEPHOLE_RULES; r++)
+    fprintf(output, "  %-24s %ld\n", RULES[r].name, stats->hits[r]);
+}
@@ -0,0 +1,26 @@
+#ifndef X86_PEEPHOLE_H
+#define X86_PEEPHOLE_H
+
+#include "x86.h"
+
+#define X86_PEEPHOLE_RULES 12 // Entries of the rule table
+
+typedef struct {
+  long hits[X86_PEEPHOLE_RULES]; // Rewrites done by each rule of the table
+  long before;                   // Instructions
+  long after;
+} x86_peephole_stats_t;
+
+//! Rewrites the instructions of every function, after the selection and
+//! before the encoding or the assembly, from a table of rules each matching
+//! the opcodes of one instruction or of two adjacent ones. A liveness
+//! analysis of the registers and of the flags, over the jumps between the
+//! labels, tells the values a rewrite may stop computing. The rules run
+//! until none applies: removing a move often lets another one match
+void x86_peephole_module(x86_module_t *module, x86_peephole_stats_t *stats);
+
+//! The hits of each rule, then the instructions left
+void x86_peephole_print_stats(const x86_peephole_stats_t *stats,
+                              FILE *output);
+
+#endif // !X86_PEEPHOLE_H
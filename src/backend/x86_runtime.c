@@ -0,0 +1,350 @@
+#include "x86_runtime.h"
+
+#include <string.h>
+
+//! Symbols shared by the runtime functions
+typedef struct {
+  x86_module_t *module;
+  x86_function_t *function;
+  int out, out_length;
+  int in, in_position, in_length;
+  int flush, getc;
+} runtime_t;
+
+static void emit(runtime_t *runtime, x86_opcode_t op, int size,
+                 x86_operand_t src, x86_operand_t dst) {
+  x86_emit(runtime->function, op, size, src, dst);
+}
+
+static void jump(runtime_t *runtime, x86_condition_t condition, int label) {
+  x86_emit_condition(runtime->function, X86_JCC, condition, x86_label(label),
+                     x86_none());
+}
+
+static void place(runtime_t *runtime, int label) {
+  emit(runtime, X86_LABEL, 0, x86_label(label), x86_none());
+}
+
+static void call(runtime_t *runtime, int symbol) {
+  emit(runtime, X86_CALL, 8, x86_symbol(symbol), x86_none());
+}
+
+static void begin(runtime_t *runtime, int symbol) {
+  runtime->function = x86_add_function(runtime->module, symbol);
+}
+
+static int text_symbol(x86_module_t *module, const char *name) {
+  return x86_add_symbol(module, name, X86_SECTION_TEXT, 0, 16);
+}
+
+// ----------------------- Buffers ----------------------
+
+//! Writes the whole output buffer and empties it
+static void add_flush(runtime_t *runtime) {
+  begin(runtime, runtime->flush);
+  int loop = x86_new_label(runtime->function);
+  int done = x86_new_label(runtime->function);
+
+  emit(runtime, X86_MOVSX, 8, x86_rip(runtime->out_length, 0),
+       x86_reg(X86_RDX));
+  emit(runtime, X86_LEA, 8, x86_rip(runtime->out, 0), x86_reg(X86_RSI));
+  place(runtime, loop);
+  emit(runtime, X86_TEST, 8, x86_reg(X86_RDX), x86_reg(X86_RDX));
+  jump(runtime, X86_CC_LE, done);
+  emit(runtime, X86_MOV, 4, x86_imm(1), x86_reg(X86_RDI)); // stdout
+  emit(runtime, X86_MOV, 4, x86_imm(1), x86_reg(X86_RAX)); // write
+  emit(runtime, X86_SYSCALL, 0, x86_none(), x86_none());
+  emit(runtime, X86_TEST, 8, x86_reg(X86_RAX), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_LE, done);
+  emit(runtime, X86_ADD, 8, x86_reg(X86_RAX), x86_reg(X86_RSI));
+  emit(runtime, X86_SUB, 8, x86_reg(X86_RAX), x86_reg(X86_RDX));
+  emit(runtime, X86_JMP, 0, x86_label(loop), x86_none());
+  place(runtime, done);
+  emit(runtime, X86_MOV, 4, x86_imm(0), x86_rip(runtime->out_length, 0));
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+}
+
+//! Next byte of the input in eax, -1 at its end. Only rax, rcx, rdx, rsi,
+//! rdi and r11 change
+static void add_getc(runtime_t *runtime) {
+  begin(runtime, runtime->getc);
+  int filled = x86_new_label(runtime->function);
+  int next = x86_new_label(runtime->function);
+
+  emit(runtime, X86_MOV, 4, x86_rip(runtime->in_position, 0),
+       x86_reg(X86_RAX));
+  emit(runtime, X86_CMP, 4, x86_rip(runtime->in_length, 0),
+       x86_reg(X86_RAX));
+  jump(runtime, X86_CC_L, next);
+
+  emit(runtime, X86_XOR, 4, x86_reg(X86_RDI), x86_reg(X86_RDI)); // stdin
+  emit(runtime, X86_LEA, 8, x86_rip(runtime->in, 0), x86_reg(X86_RSI));
+  emit(runtime, X86_MOV, 4, x86_imm(X86_RUNTIME_BUFFER), x86_reg(X86_RDX));
+  emit(runtime, X86_XOR, 4, x86_reg(X86_RAX), x86_reg(X86_RAX)); // read
+  emit(runtime, X86_SYSCALL, 0, x86_none(), x86_none());
+  emit(runtime, X86_TEST, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_G, filled);
+  emit(runtime, X86_MOV, 4, x86_imm(-1), x86_reg(X86_RAX));
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+
+  place(runtime, filled);
+  emit(runtime, X86_MOV, 4, x86_reg(X86_RAX), x86_rip(runtime->in_length, 0));
+  emit(runtime, X86_XOR, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+
+  place(runtime, next);
+  emit(runtime, X86_LEA, 8, x86_rip(runtime->in, 0), x86_reg(X86_RDX));
+  emit(runtime, X86_ADD, 8, x86_reg(X86_RAX), x86_reg(X86_RDX));
+  emit(runtime, X86_ADD, 4, x86_imm(1), x86_reg(X86_RAX));
+  emit(runtime, X86_MOV, 4, x86_reg(X86_RAX),
+       x86_rip(runtime->in_position, 0));
+  emit(runtime, X86_MOVZX, 4, x86_mem(X86_RDX, 0), x86_reg(X86_RAX));
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+}
+
+// ----------------------- Builtins ----------------------
+
+//! Skips the blanks and reads an optionally negative decimal number. Gives
+//! 0, leaving the input as it was, when no number follows
+static void add_input(runtime_t *runtime, int symbol) {
+  begin(runtime, symbol);
+  int blanks = x86_new_label(runtime->function);
+  int digits = x86_new_label(runtime->function);
+  int other = x86_new_label(runtime->function);
+  int done = x86_new_label(runtime->function);
+  int positive = x86_new_label(runtime->function);
+
+  call(runtime, runtime->flush);
+  emit(runtime, X86_XOR, 4, x86_reg(X86_R8), x86_reg(X86_R8)); // Value
+  emit(runtime, X86_XOR, 4, x86_reg(X86_R9), x86_reg(X86_R9)); // Negative
+
+  place(runtime, blanks);
+  call(runtime, runtime->getc);
+  emit(runtime, X86_CMP, 4, x86_imm(-1), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_E, done);
+  emit(runtime, X86_CMP, 4, x86_imm(' '), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_LE, blanks);
+  emit(runtime, X86_CMP, 4, x86_imm('-'), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_NE, digits);
+  emit(runtime, X86_MOV, 4, x86_imm(1), x86_reg(X86_R9));
+  call(runtime, runtime->getc);
+
+  place(runtime, digits);
+  emit(runtime, X86_CMP, 4, x86_imm(-1), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_E, done);
+  emit(runtime, X86_SUB, 4, x86_imm('0'), x86_reg(X86_RAX));
+  emit(runtime, X86_CMP, 4, x86_imm(9), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_A, other);
+  emit(runtime, X86_IMUL, 4, x86_imm(10), x86_reg(X86_R8));
+  emit(runtime, X86_ADD, 4, x86_reg(X86_RAX), x86_reg(X86_R8));
+  call(runtime, runtime->getc);
+  emit(runtime, X86_JMP, 0, x86_label(digits), x86_none());
+
+  place(runtime, other); // Left for the next read
+  emit(runtime, X86_SUB, 4, x86_imm(1), x86_rip(runtime->in_position, 0));
+
+  place(runtime, done);
+  emit(runtime, X86_MOV, 4, x86_reg(X86_R8), x86_reg(X86_RAX));
+  emit(runtime, X86_TEST, 4, x86_reg(X86_R9), x86_reg(X86_R9));
+  jump(runtime, X86_CC_E, positive);
+  emit(runtime, X86_NEG, 4, x86_none(), x86_reg(X86_RAX));
+  place(runtime, positive);
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+}
+
+//! Writes edi in decimal and a line break. The digits are built backwards
+//! in the red zone, below the stack pointer
+static void add_output(runtime_t *runtime, int symbol) {
+  begin(runtime, symbol);
+  int room = x86_new_label(runtime->function);
+  int magnitude = x86_new_label(runtime->function);
+  int divide = x86_new_label(runtime->function);
+  int copy = x86_new_label(runtime->function);
+  int copy_loop = x86_new_label(runtime->function);
+
+  emit(runtime, X86_MOV, 4, x86_rip(runtime->out_length, 0),
+       x86_reg(X86_RAX));
+  emit(runtime, X86_CMP, 4, x86_imm(X86_RUNTIME_BUFFER - 12),
+       x86_reg(X86_RAX));
+  jump(runtime, X86_CC_LE, room);
+  emit(runtime, X86_PUSH, 8, x86_reg(X86_RDI), x86_none());
+  call(runtime, runtime->flush);
+  emit(runtime, X86_POP, 8, x86_none(), x86_reg(X86_RDI));
+
+  place(runtime, room);
+  emit(runtime, X86_LEA, 8, x86_mem(X86_RSP, -1), x86_reg(X86_RSI));
+  emit(runtime, X86_MOV, 1, x86_imm('\n'), x86_mem(X86_RSI, 0));
+  emit(runtime, X86_MOV, 4, x86_reg(X86_RDI), x86_reg(X86_RAX));
+  emit(runtime, X86_TEST, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_NS, magnitude);
+  emit(runtime, X86_NEG, 4, x86_none(), x86_reg(X86_RAX));
+
+  place(runtime, magnitude); // Unsigned, so INT_MIN works too
+  emit(runtime, X86_MOV, 4, x86_imm(10), x86_reg(X86_RCX));
+  place(runtime, divide);
+  emit(runtime, X86_XOR, 4, x86_reg(X86_RDX), x86_reg(X86_RDX));
+  emit(runtime, X86_DIV, 4, x86_reg(X86_RCX), x86_none());
+  emit(runtime, X86_ADD, 4, x86_imm('0'), x86_reg(X86_RDX));
+  emit(runtime, X86_SUB, 8, x86_imm(1), x86_reg(X86_RSI));
+  emit(runtime, X86_MOV, 1, x86_reg(X86_RDX), x86_mem(X86_RSI, 0));
+  emit(runtime, X86_TEST, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+  jump(runtime, X86_CC_NE, divide);
+
+  emit(runtime, X86_TEST, 4, x86_reg(X86_RDI), x86_reg(X86_RDI));
+  jump(runtime, X86_CC_NS, copy);
+  emit(runtime, X86_SUB, 8, x86_imm(1), x86_reg(X86_RSI));
+  emit(runtime, X86_MOV, 1, x86_imm('-'), x86_mem(X86_RSI, 0));
+
+  place(runtime, copy);
+  emit(runtime, X86_MOVSX, 8, x86_rip(runtime->out_length, 0),
+       x86_reg(X86_RAX));
+  emit(runtime, X86_LEA, 8, x86_rip(runtime->out, 0), x86_reg(X86_RDX));
+  emit(runtime, X86_ADD, 8, x86_reg(X86_RAX), x86_reg(X86_RDX));
+  place(runtime, copy_loop);
+  emit(runtime, X86_MOV, 1, x86_mem(X86_RSI, 0), x86_reg(X86_RCX));
+  emit(runtime, X86_MOV, 1, x86_reg(X86_RCX), x86_mem(X86_RDX, 0));
+  emit(runtime, X86_ADD, 8, x86_imm(1), x86_reg(X86_RSI));
+  emit(runtime, X86_ADD, 8, x86_imm(1), x86_reg(X86_RDX));
+  emit(runtime, X86_ADD, 4, x86_imm(1), x86_reg(X86_RAX));
+  emit(runtime, X86_CMP, 8, x86_reg(X86_RSP), x86_reg(X86_RSI));
+  jump(runtime, X86_CC_NE, copy_loop);
+  emit(runtime, X86_MOV, 4, x86_reg(X86_RAX),
+       x86_rip(runtime->out_length, 0));
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+}
+
+// ----------------------- Checks ----------------------
+
+#define BOUNDS_MESSAGE "Error: Array index out of bounds.\n"
+#define DIVISION_MESSAGE "Error: Division by zero.\n"
+
+//! Never returns. The message is stored in the red zone, 4 bytes at a time,
+//! since the module has no initialized data
+static void add_failure(runtime_t *runtime, int symbol, x86_entry_t entry,
+                        const char *message) {
+  int length = (int)strlen(message);
+  int start = -((length + 3) / 4 * 4);
+
+  begin(runtime, symbol);
+  if (entry != X86_ENTRY_HOST)
+    call(runtime, runtime->flush);
+
+  for (int i = 0; i < length; i += 4) {
+    unsigned word = 0;
+    for (int c = 0; c < 4 && i + c < length; c++)
+      word |= (unsigned)(unsigned char)message[i + c] << (8 * c);
+    emit(runtime, X86_MOV, 4, x86_imm((int)word),
+         x86_mem(X86_RSP, start + i));
+  }
+  emit(runtime, X86_LEA, 8, x86_mem(X86_RSP, start), x86_reg(X86_RSI));
+  emit(runtime, X86_MOV, 4, x86_imm(length), x86_reg(X86_RDX));
+  emit(runtime, X86_MOV, 4, x86_imm(2), x86_reg(X86_RDI)); // stderr
+  emit(runtime, X86_MOV, 4, x86_imm(1), x86_reg(X86_RAX)); // write
+  emit(runtime, X86_SYSCALL, 0, x86_none(), x86_none());
+  emit(runtime, X86_MOV, 4, x86_imm(1), x86_reg(X86_RDI));
+  emit(runtime, X86_MOV, 4, x86_imm(60), x86_reg(X86_RAX)); // exit
+  emit(runtime, X86_SYSCALL, 0, x86_none(), x86_none());
+}
+
+//! The host tells the faults of its code apart by their signal, so its
+//! division failure traps like an idiv by zero would
+static void add_division(runtime_t *runtime, int symbol, x86_entry_t entry) {
+  if (entry != X86_ENTRY_HOST) {
+    add_failure(runtime, symbol, entry, DIVISION_MESSAGE);
+    return;
+  }
+  begin(runtime, symbol);
+  emit(runtime, X86_XOR, 4, x86_reg(X86_RCX), x86_reg(X86_RCX));
+  emit(runtime, X86_IDIV, 4, x86_reg(X86_RCX), x86_none());
+}
+
+// ----------------------- Host ----------------------
+
+//! Builtin calling the hook whose address is at 'hook', the context going
+//! in the argument register after the ones of the builtin. The stack gets
+//! back the alignment the call took from it
+static void add_host_builtin(runtime_t *runtime, int symbol, int hook,
+                             int context, int context_register) {
+  begin(runtime, symbol);
+  emit(runtime, X86_SUB, 8, x86_imm(8), x86_reg(X86_RSP));
+  emit(runtime, X86_MOV, 8, x86_rip(context, 0), x86_reg(context_register));
+  emit(runtime, X86_CALL, 8, x86_rip(hook, 0), x86_none());
+  emit(runtime, X86_ADD, 8, x86_imm(8), x86_reg(X86_RSP));
+  emit(runtime, X86_RET, 0, x86_none(), x86_none());
+}
+
+static void add_host(x86_module_t *module, int input_symbol,
+                     int output_symbol) {
+  runtime_t runtime = {.module = module};
+  int context = x86_add_symbol(module, X86_HOST_CONTEXT, X86_SECTION_BSS, 8, 8);
+  int input = x86_add_symbol(module, X86_HOST_INPUT, X86_SECTION_BSS, 8, 8);
+  int output = x86_add_symbol(module, X86_HOST_OUTPUT, X86_SECTION_BSS, 8, 8);
+
+  add_host_builtin(&runtime, input_symbol, input, context, X86_RDI);
+  add_host_builtin(&runtime, output_symbol, output, context, X86_RSI);
+}
+
+// ----------------------- Entry ----------------------
+
+static void add_entry(runtime_t *runtime, int main_symbol, x86_entry_t entry) {
+  int symbol = text_symbol(runtime->module,
+                           entry == X86_ENTRY_MAIN ? "main" : "_start");
+  runtime->module->symbols[symbol].is_global = 1;
+  begin(runtime, symbol);
+
+  // The stack is aligned at _start, and off by the return address in main
+  if (entry == X86_ENTRY_MAIN)
+    emit(runtime, X86_PUSH, 8, x86_reg(X86_RBP), x86_none());
+  else
+    emit(runtime, X86_SUB, 8, x86_imm(8), x86_reg(X86_RSP));
+  call(runtime, main_symbol);
+  call(runtime, runtime->flush);
+
+  if (entry == X86_ENTRY_MAIN) {
+    emit(runtime, X86_XOR, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+    emit(runtime, X86_POP, 8, x86_none(), x86_reg(X86_RBP));
+    emit(runtime, X86_RET, 0, x86_none(), x86_none());
+  } else {
+    emit(runtime, X86_MOV, 4, x86_imm(60), x86_reg(X86_RAX)); // exit
+    emit(runtime, X86_XOR, 4, x86_reg(X86_RDI), x86_reg(X86_RDI));
+    emit(runtime, X86_SYSCALL, 0, x86_none(), x86_none());
+  }
+}
+
+void x86_add_runtime(x86_module_t *module, int input_symbol, int output_symbol,
+                     int main_symbol, x86_entry_t entry) {
+  runtime_t runtime = {.module = module};
+  int bounds = x86_find_symbol(module, X86_RUNTIME_BOUNDS);
+  int division = x86_find_symbol(module, X86_RUNTIME_DIVISION);
+
+  if (entry == X86_ENTRY_HOST) {
+    add_host(module, input_symbol, output_symbol);
+    if (bounds >= 0)
+      add_failure(&runtime, bounds, entry, BOUNDS_MESSAGE);
+    if (division >= 0)
+      add_division(&runtime, division, entry);
+    return;
+  }
+
+  runtime.out = x86_add_symbol(module, "cmrt_out", X86_SECTION_BSS,
+                               X86_RUNTIME_BUFFER, 16);
+  runtime.out_length =
+      x86_add_symbol(module, "cmrt_out_length", X86_SECTION_BSS, 4, 4);
+  runtime.in = x86_add_symbol(module, "cmrt_in", X86_SECTION_BSS,
+                              X86_RUNTIME_BUFFER, 16);
+  runtime.in_position =
+      x86_add_symbol(module, "cmrt_in_position", X86_SECTION_BSS, 4, 4);
+  runtime.in_length =
+      x86_add_symbol(module, "cmrt_in_length", X86_SECTION_BSS, 4, 4);
+  runtime.flush = text_symbol(module, "cmrt_flush");
+  runtime.getc = text_symbol(module, "cmrt_getc");
+
+  add_flush(&runtime);
+  add_getc(&runtime);
+  add_input(&runtime, input_symbol);
+  add_output(&runtime, output_symbol);
+  add_entry(&runtime, main_symbol, entry);
+  if (bounds >= 0)
+    add_failure(&runtime, bounds, entry, BOUNDS_MESSAGE);
+  if (division >= 0)
+    add_division(&runtime, division, entry);
+}
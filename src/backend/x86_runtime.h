@@ -0,0 +1,38 @@
+#ifndef X86_RUNTIME_H
+#define X86_RUNTIME_H
+
+#include "x86.h"
+
+//! Symbol the program starts from
+typedef enum {
+  X86_ENTRY_MAIN,  // 'main', called by the C library of the linker
+  X86_ENTRY_START, // '_start', for executables without any library
+  X86_ENTRY_HOST,  // None, the compiler loads the code and calls into it
+} x86_entry_t;
+
+#define X86_RUNTIME_BUFFER 4096 // Bytes of the input and output buffers
+
+//! Text symbol the array checks of the safe mode call when they fail. Its
+//! body is only added when the code calls it
+#define X86_RUNTIME_BOUNDS "cmrt_bounds"
+
+//! Text symbol a division by zero calls, added the same way
+#define X86_RUNTIME_DIVISION "cmrt_division"
+
+// Data symbols the host fills before running the code of X86_ENTRY_HOST
+#define X86_HOST_CONTEXT "cmrt_host"       // Passed to the hooks
+#define X86_HOST_INPUT "cmrt_host_input"   // int hook(void *context)
+#define X86_HOST_OUTPUT "cmrt_host_output" // void hook(int, void *context)
+
+//! Adds the bodies of the builtins, whose symbols must already exist, and
+//! the entry point. input() and output() go straight to the read and write
+//! system calls through buffers; the output is flushed before blocking on
+//! the input and when the program ends. The entry calls 'main_symbol' and
+//! exits with 0. A failed array check or a division by zero flushes the
+//! output, prints an error and exits with 1. With X86_ENTRY_HOST there are
+//! neither buffers nor entry, the builtins call the hooks of the host
+//! through their pointers, and a division by zero raises SIGFPE
+void x86_add_runtime(x86_module_t *module, int input_symbol, int output_symbol,
+                     int main_symbol, x86_entry_t entry);
+
+#endif // !X86_RUNTIME_H
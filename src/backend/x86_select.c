@@ -0,0 +1,724 @@
+#include "x86_select.h"
+#include "regalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARGUMENT_REGISTERS 6
+#define SLOT_SIZE 8 // Bytes of a spill slot or a saved parameter
+
+//! Machine registers of the allocator's, the callee-saved ones first
+static const int ALLOCATABLE[RA_REGISTER_COUNT] = {
+    X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15,
+    X86_RCX, X86_RSI, X86_RDI, X86_R8,  X86_R9,
+};
+
+static const int ARGUMENTS[ARGUMENT_REGISTERS] = {
+    X86_RDI, X86_RSI, X86_RDX, X86_RCX, X86_R8, X86_R9,
+};
+
+//! State of the translation of a function
+typedef struct {
+  const ir_module_t *module;
+  const ir_function_t *function;
+  const ra_allocation_t *allocation;
+  x86_module_t *machine;
+  x86_function_t *out;
+  const int *function_symbols;
+  const int *global_symbols;
+
+  int saved[RA_CALLEE_SAVED]; // Callee-saved registers pushed by the prologue
+  int saved_count;
+  int param_offset; // rbp offsets of the saved parameters, spill slots and
+  int slot_offset;  // local arrays
+  int *frame_offsets;
+  int next_move;
+  int bounds_label;   // Calls the runtime on a failed array check, -1 until
+  int division_label; // one, and on a division by zero
+} select_t;
+
+static void *select_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the instruction "
+                    "selection.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void emit(select_t *select, x86_opcode_t op, int size,
+                 x86_operand_t src, x86_operand_t dst) {
+  x86_emit(select->out, op, size, src, dst);
+}
+
+//! Copies between registers, memory and immediates, through r11 when both
+//! sides are in memory
+static void move(select_t *select, int size, x86_operand_t src,
+                 x86_operand_t dst) {
+  if (x86_same_operand(src, dst))
+    return;
+
+  if (src.kind == X86_OPD_MEM && dst.kind == X86_OPD_MEM) {
+    emit(select, X86_MOV, size, src, x86_reg(X86_R11));
+    src = x86_reg(X86_R11);
+  }
+  emit(select, X86_MOV, size, src, dst);
+}
+
+// ----------------------- Locations ----------------------
+
+static int temp_size(const select_t *select, int temp) {
+  return select->function->temp_types[temp] == IR_TYPE_PTR ? 8 : 4;
+}
+
+static x86_operand_t slot(const select_t *select, int slot) {
+  return x86_mem(X86_RBP, select->slot_offset - SLOT_SIZE * slot);
+}
+
+//! Register or spill slot of a temporary at a position
+static x86_operand_t location(const select_t *select, int temp, int position) {
+  int reg = ra_register_at(select->allocation, temp, position);
+  if (reg >= 0)
+    return x86_reg(ALLOCATABLE[reg]);
+  return slot(select, select->allocation->intervals[temp].slot);
+}
+
+//! Temporary or constant read at a position
+static x86_operand_t value(const select_t *select, ir_operand_t operand,
+                           int position) {
+  if (operand.kind == IR_OPD_CONST)
+    return x86_imm(operand.value);
+  return location(select, operand.value, position);
+}
+
+static int is_caller_saved(x86_operand_t operand) {
+  for (int r = RA_CALLEE_SAVED; r < RA_REGISTER_COUNT; r++)
+    if (operand.kind == X86_OPD_REG && operand.reg == ALLOCATABLE[r])
+      return 1;
+  return 0;
+}
+
+//! Loads and stores of the allocator placed before the position
+static void emit_moves(select_t *select, int position) {
+  const ra_allocation_t *allocation = select->allocation;
+
+  for (; select->next_move < allocation->move_count &&
+         allocation->moves[select->next_move].position <= position;
+       select->next_move++) {
+    const ra_move_t *ra_move = &allocation->moves[select->next_move];
+    const ra_interval_t *interval = &allocation->intervals[ra_move->temp];
+    x86_operand_t reg = x86_reg(ALLOCATABLE[interval->reg]);
+    x86_operand_t memory = slot(select, interval->slot);
+
+    if (ra_move->to_memory)
+      move(select, 8, reg, memory);
+    else
+      move(select, 8, memory, reg);
+  }
+}
+
+//! Drops the moves up to the position, placed in code that never runs
+static void skip_moves(select_t *select, int position) {
+  const ra_allocation_t *allocation = select->allocation;
+
+  while (select->next_move < allocation->move_count &&
+         allocation->moves[select->next_move].position <= position)
+    select->next_move++;
+}
+
+// ----------------------- Frame ----------------------
+
+static int align(int value, int alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+//! Bytes of the outgoing arguments of the largest call
+static int outgoing_size(const ir_function_t *function) {
+  int largest = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      const ir_instr_t *instr = &function->blocks[b].instrs[i];
+      if (instr->op == IR_CALL && instr->arg_count > largest)
+        largest = instr->arg_count;
+    }
+  return SLOT_SIZE * largest;
+}
+
+static void emit_prologue(select_t *select) {
+  const ir_function_t *function = select->function;
+  int register_params = function->param_count < ARGUMENT_REGISTERS
+                            ? function->param_count
+                            : ARGUMENT_REGISTERS;
+
+  for (int r = 0; r < RA_CALLEE_SAVED; r++)
+    if (select->allocation->used_registers & (1u << r))
+      select->saved[select->saved_count++] = ALLOCATABLE[r];
+
+  int offset = -SLOT_SIZE * select->saved_count;
+  select->param_offset = offset - SLOT_SIZE;
+  offset -= SLOT_SIZE * register_params;
+  select->slot_offset = offset - SLOT_SIZE;
+  offset -= SLOT_SIZE * select->allocation->slot_count;
+
+  select->frame_offsets =
+      (int *)select_alloc(function->frame_count, sizeof(int));
+  for (int f = 0; f < function->frame_count; f++) {
+    offset -= align(4 * function->frame[f].size, SLOT_SIZE);
+    select->frame_offsets[f] = offset;
+  }
+
+  // Pushed registers and locals keep the calls 16 bytes aligned
+  int locals = -offset - SLOT_SIZE * select->saved_count +
+               outgoing_size(function);
+  locals = align(locals + SLOT_SIZE * select->saved_count, 16) -
+           SLOT_SIZE * select->saved_count;
+
+  emit(select, X86_PUSH, 8, x86_reg(X86_RBP), x86_none());
+  emit(select, X86_MOV, 8, x86_reg(X86_RSP), x86_reg(X86_RBP));
+  for (int s = 0; s < select->saved_count; s++)
+    emit(select, X86_PUSH, 8, x86_reg(select->saved[s]), x86_none());
+  if (locals)
+    emit(select, X86_SUB, 8, x86_imm(locals), x86_reg(X86_RSP));
+
+  for (int p = 0; p < register_params; p++)
+    emit(select, X86_MOV, 8, x86_reg(ARGUMENTS[p]),
+         x86_mem(X86_RBP, select->param_offset - SLOT_SIZE * p));
+}
+
+//! Restores the saved registers and pops the frame, leaving rsp on the
+//! return address. The argument registers are untouched
+static void emit_frame_release(select_t *select) {
+  emit(select, X86_LEA, 8,
+       x86_mem(X86_RBP, -SLOT_SIZE * select->saved_count), x86_reg(X86_RSP));
+  for (int s = select->saved_count - 1; s >= 0; s--)
+    emit(select, X86_POP, 8, x86_none(), x86_reg(select->saved[s]));
+  emit(select, X86_POP, 8, x86_none(), x86_reg(X86_RBP));
+}
+
+static void emit_epilogue(select_t *select) {
+  emit_frame_release(select);
+  emit(select, X86_RET, 0, x86_none(), x86_none());
+}
+
+// ----------------------- Instructions ----------------------
+
+//! Text symbol of the runtime, added on the first call to it
+static int runtime_symbol(select_t *select, const char *name) {
+  int symbol = x86_find_symbol(select->machine, name);
+  if (symbol < 0)
+    symbol = x86_add_symbol(select->machine, name, X86_SECTION_TEXT, 0, 16);
+  return symbol;
+}
+
+//! dst = a op b for the two operands opcodes, in dst's register when b is
+//! not there
+static void emit_binary(select_t *select, x86_opcode_t op, x86_operand_t dst,
+                        x86_operand_t a, x86_operand_t b, int commutative) {
+  if (commutative && x86_same_operand(dst, b)) {
+    x86_operand_t swap = a;
+    a = b;
+    b = swap;
+  }
+
+  x86_operand_t result = dst.kind == X86_OPD_REG && !x86_same_operand(dst, b)
+                             ? dst
+                             : x86_reg(X86_RAX);
+  move(select, 4, a, result);
+  emit(select, op, 4, b, result);
+  move(select, 4, result, dst);
+}
+
+//! Shifts by a register go through cl, whose allocated value is kept in r11
+static void emit_shift(select_t *select, x86_opcode_t op, x86_operand_t dst,
+                       x86_operand_t a, x86_operand_t b) {
+  if (b.kind == X86_OPD_IMM) {
+    emit_binary(select, op, dst, a, b, 0);
+    return;
+  }
+
+  move(select, 4, a, x86_reg(X86_RAX));
+  emit(select, X86_MOV, 8, x86_reg(X86_RCX), x86_reg(X86_R11));
+  move(select, 4, b, x86_reg(X86_RCX));
+  emit(select, op, 4, x86_reg(X86_RCX), x86_reg(X86_RAX));
+  emit(select, X86_MOV, 8, x86_reg(X86_R11), x86_reg(X86_RCX));
+  move(select, 4, x86_reg(X86_RAX), dst);
+}
+
+//! idiv traps on a zero divisor, which calls the runtime like a failed
+//! array check, and on INT_MIN / -1, which wraps to INT_MIN as the negation
+//! does
+static void emit_division(select_t *select, x86_operand_t dst,
+                          x86_operand_t a, x86_operand_t b) {
+  move(select, 4, a, x86_reg(X86_RAX));
+  if (b.kind == X86_OPD_IMM && b.value == 0) {
+    emit(select, X86_CALL, 8,
+         x86_symbol(runtime_symbol(select, X86_RUNTIME_DIVISION)),
+         x86_none());
+    return;
+  }
+  if (b.kind == X86_OPD_IMM && b.value == -1) {
+    emit(select, X86_NEG, 4, x86_none(), x86_reg(X86_RAX));
+    move(select, 4, x86_reg(X86_RAX), dst);
+    return;
+  }
+
+  int divide = -1, done = -1;
+  if (b.kind == X86_OPD_IMM) {
+    move(select, 4, b, x86_reg(X86_R10));
+    b = x86_reg(X86_R10);
+  } else {
+    if (select->division_label < 0)
+      select->division_label = x86_new_label(select->out);
+    divide = x86_new_label(select->out);
+    done = x86_new_label(select->out);
+    emit(select, X86_CMP, 4, x86_imm(0), b);
+    x86_emit_condition(select->out, X86_JCC, X86_CC_E,
+                       x86_label(select->division_label), x86_none());
+    emit(select, X86_CMP, 4, x86_imm(-1), b);
+    x86_emit_condition(select->out, X86_JCC, X86_CC_NE, x86_label(divide),
+                       x86_none());
+    emit(select, X86_NEG, 4, x86_none(), x86_reg(X86_RAX));
+    emit(select, X86_JMP, 0, x86_label(done), x86_none());
+    emit(select, X86_LABEL, 0, x86_label(divide), x86_none());
+  }
+  emit(select, X86_CDQ, 4, x86_none(), x86_none());
+  emit(select, X86_IDIV, 4, b, x86_none());
+  if (done >= 0)
+    emit(select, X86_LABEL, 0, x86_label(done), x86_none());
+  move(select, 4, x86_reg(X86_RAX), dst);
+}
+
+//! Sign-extends a 32 bits value into a 64 bits register
+static void extend(select_t *select, x86_operand_t value, int reg) {
+  if (value.kind == X86_OPD_IMM)
+    emit(select, X86_MOV, 8, value, x86_reg(reg));
+  else
+    emit(select, X86_MOVSX, 8, value, x86_reg(reg));
+}
+
+static void emit_multiply_high(select_t *select, x86_operand_t dst,
+                               x86_operand_t a, x86_operand_t b) {
+  extend(select, a, X86_RAX);
+  extend(select, b, X86_R10);
+  emit(select, X86_IMUL, 8, x86_reg(X86_R10), x86_reg(X86_RAX));
+  emit(select, X86_SAR, 8, x86_imm(32), x86_reg(X86_RAX));
+  move(select, 4, x86_reg(X86_RAX), dst);
+}
+
+static x86_condition_t condition(ir_opcode_t op) {
+  switch (op) {
+  case IR_LT:
+    return X86_CC_L;
+  case IR_LE:
+    return X86_CC_LE;
+  case IR_GT:
+    return X86_CC_G;
+  case IR_GE:
+    return X86_CC_GE;
+  case IR_EQ:
+    return X86_CC_E;
+  default:
+    return X86_CC_NE;
+  }
+}
+
+static void emit_compare(select_t *select, ir_opcode_t op, x86_operand_t dst,
+                         x86_operand_t a, x86_operand_t b) {
+  if (a.kind == X86_OPD_IMM ||
+      (a.kind == X86_OPD_MEM && b.kind == X86_OPD_MEM)) {
+    move(select, 4, a, x86_reg(X86_RAX));
+    a = x86_reg(X86_RAX);
+  }
+
+  emit(select, X86_CMP, 4, b, a);
+  x86_emit_condition(select->out, X86_SETCC, condition(op), x86_none(),
+                     x86_reg(X86_RAX));
+  emit(select, X86_MOVZX, 4, x86_reg(X86_RAX), x86_reg(X86_RAX));
+  move(select, 4, x86_reg(X86_RAX), dst);
+}
+
+//! Register holding a pointer, loaded into rax from its slot if needed
+static x86_operand_t pointer(select_t *select, x86_operand_t address) {
+  if (address.kind == X86_OPD_REG)
+    return address;
+  move(select, 8, address, x86_reg(X86_RAX));
+  return x86_reg(X86_RAX);
+}
+
+static void emit_pointer_add(select_t *select, x86_operand_t dst,
+                             x86_operand_t a, x86_operand_t b) {
+  if (b.kind == X86_OPD_IMM) {
+    x86_operand_t result =
+        dst.kind == X86_OPD_REG ? dst : x86_reg(X86_RAX);
+    move(select, 8, a, result);
+    emit(select, X86_ADD, 8, b, result);
+    move(select, 8, result, dst);
+    return;
+  }
+
+  emit(select, X86_MOVSX, 8, b, x86_reg(X86_RAX));
+  emit(select, X86_ADD, 8, a, x86_reg(X86_RAX));
+  move(select, 8, x86_reg(X86_RAX), dst);
+}
+
+//! Arguments beyond the sixth go to the bottom of the stack. The values in
+//! caller-saved registers, which the argument registers may be holding,
+//! are staged in memory above them before the registers are loaded
+static void load_arguments(select_t *select, ir_instr_t *instr, int use) {
+  int count = instr->arg_count;
+  int stacked = count > ARGUMENT_REGISTERS ? count - ARGUMENT_REGISTERS : 0;
+  int staged[ARGUMENT_REGISTERS] = {0};
+
+  for (int i = ARGUMENT_REGISTERS; i < count; i++)
+    move(select, 8, value(select, instr->args[i], use),
+         x86_mem(X86_RSP, SLOT_SIZE * (i - ARGUMENT_REGISTERS)));
+
+  for (int i = 0; i < count && i < ARGUMENT_REGISTERS; i++) {
+    x86_operand_t argument = value(select, instr->args[i], use);
+    if (is_caller_saved(argument)) {
+      move(select, 8, argument, x86_mem(X86_RSP, SLOT_SIZE * (stacked + i)));
+      staged[i] = 1;
+    }
+  }
+
+  for (int i = 0; i < count && i < ARGUMENT_REGISTERS; i++) {
+    x86_operand_t argument =
+        staged[i] ? x86_mem(X86_RSP, SLOT_SIZE * (stacked + i))
+                  : value(select, instr->args[i], use);
+    move(select, 8, argument, x86_reg(ARGUMENTS[i]));
+  }
+}
+
+static void emit_call(select_t *select, ir_instr_t *instr, int use,
+                      int def) {
+  load_arguments(select, instr, use);
+  emit(select, X86_CALL, 8,
+       x86_symbol(select->function_symbols[instr->a.value]), x86_none());
+
+  if (instr->dst.kind == IR_OPD_TEMP)
+    move(select, temp_size(select, instr->dst.value), x86_reg(X86_RAX),
+         location(select, instr->dst.value, def));
+}
+
+//! Index of the return right after the call at 'i' when the function gives
+//! back what the call does, -1 otherwise. Such a call can reuse the frame
+//! when its arguments all go in registers: the stacked ones would have to
+//! take the place of the return address. A function with local arrays
+//! keeps its frame, which an argument may point into
+static int tail_return(const ir_function_t *function, const ir_block_t *block,
+                       int i) {
+  const ir_instr_t *call = &block->instrs[i];
+  int next = i + 1;
+
+  if (call->op != IR_CALL || call->arg_count > ARGUMENT_REGISTERS ||
+      function->frame_count > 0)
+    return -1;
+  while (next < block->count && block->instrs[next].op == IR_NOP)
+    next++;
+  if (next == block->count || block->instrs[next].op != IR_RET)
+    return -1;
+
+  const ir_instr_t *ret = &block->instrs[next];
+  if (ret->a.kind == IR_OPD_NONE ||
+      (ret->a.kind == IR_OPD_TEMP && call->dst.kind == IR_OPD_TEMP &&
+       ret->a.value == call->dst.value))
+    return next;
+  return -1;
+}
+
+//! Releases the frame before jumping to the callee, which then returns
+//! straight to the caller: tail recursion runs in constant stack
+static void emit_tail_call(select_t *select, ir_instr_t *instr, int use) {
+  load_arguments(select, instr, use);
+  emit_frame_release(select);
+  emit(select, X86_JMP, 0,
+       x86_symbol(select->function_symbols[instr->a.value]), x86_none());
+}
+
+static void emit_branch(select_t *select, ir_instr_t *instr, int use) {
+  x86_operand_t condition = value(select, instr->a, use);
+
+  if (condition.kind == X86_OPD_IMM) {
+    emit(select, X86_JMP, 0,
+         x86_label(instr->args[condition.value ? 0 : 1].value), x86_none());
+    return;
+  }
+
+  if (condition.kind == X86_OPD_REG)
+    emit(select, X86_TEST, 4, condition, condition);
+  else
+    emit(select, X86_CMP, 4, x86_imm(0), condition);
+  x86_emit_condition(select->out, X86_JCC, X86_CC_NE,
+                     x86_label(instr->args[0].value), x86_none());
+  emit(select, X86_JMP, 0, x86_label(instr->args[1].value), x86_none());
+}
+
+//! Four ints into an xmm register: those a pointer addresses, or an int
+//! copied into each of them
+static void load_vector(select_t *select, ir_operand_t operand, int use,
+                        int xmm) {
+  x86_operand_t source = value(select, operand, use);
+  if (operand.kind == IR_OPD_TEMP && temp_size(select, operand.value) == 8) {
+    x86_operand_t address = pointer(select, source);
+    emit(select, X86_MOVDQU, 16, x86_mem(address.reg, 0), x86_xmm(xmm));
+    return;
+  }
+
+  if (source.kind == X86_OPD_IMM) {
+    move(select, 4, source, x86_reg(X86_RAX));
+    source = x86_reg(X86_RAX);
+  }
+  emit(select, X86_MOVD, 4, source, x86_xmm(xmm));
+  emit(select, X86_PSHUFD, 16, x86_xmm(xmm), x86_xmm(xmm));
+}
+
+static void emit_vector(select_t *select, ir_instr_t *instr, int use) {
+  load_vector(select, instr->b, use, 0);
+  load_vector(select, instr->args[0], use, 1);
+  emit(select, instr->op == IR_VADD ? X86_PADDD : X86_PSUBD, 16, x86_xmm(1),
+       x86_xmm(0));
+  x86_operand_t address = pointer(select, value(select, instr->a, use));
+  emit(select, X86_MOVDQU, 16, x86_xmm(0), x86_mem(address.reg, 0));
+}
+
+//! One unsigned comparison covers both ends of the array. The failures of
+//! a function share a call at its end, out of the way of the code
+static void emit_check(select_t *select, x86_operand_t index, int size) {
+  if (index.kind == X86_OPD_IMM) {
+    if ((unsigned)index.value >= (unsigned)size)
+      emit(select, X86_CALL, 8,
+           x86_symbol(runtime_symbol(select, X86_RUNTIME_BOUNDS)),
+           x86_none());
+    return;
+  }
+
+  if (select->bounds_label < 0)
+    select->bounds_label = x86_new_label(select->out);
+  emit(select, X86_CMP, 4, x86_imm(size), index);
+  x86_emit_condition(select->out, X86_JCC, X86_CC_AE,
+                     x86_label(select->bounds_label), x86_none());
+}
+
+static void select_instr(select_t *select, ir_instr_t *instr, int index) {
+  int use = RA_USE_POSITION(index), def = RA_DEF_POSITION(index);
+  x86_operand_t dst = instr->dst.kind == IR_OPD_TEMP
+                          ? location(select, instr->dst.value, def)
+                          : x86_none();
+
+  switch (instr->op) {
+  case IR_NOP:
+  case IR_PHI:
+    break;
+  case IR_PARAM: {
+    int param = instr->a.value;
+    x86_operand_t source =
+        param < ARGUMENT_REGISTERS
+            ? x86_mem(X86_RBP, select->param_offset - SLOT_SIZE * param)
+            : x86_mem(X86_RBP, 16 + SLOT_SIZE * (param - ARGUMENT_REGISTERS));
+    move(select, temp_size(select, instr->dst.value), source, dst);
+    break;
+  }
+  case IR_MOV:
+    move(select, temp_size(select, instr->dst.value),
+         value(select, instr->a, use), dst);
+    break;
+  case IR_ADD:
+    emit_binary(select, X86_ADD, dst, value(select, instr->a, use),
+                value(select, instr->b, use), 1);
+    break;
+  case IR_SUB:
+    emit_binary(select, X86_SUB, dst, value(select, instr->a, use),
+                value(select, instr->b, use), 0);
+    break;
+  case IR_MUL:
+    emit_binary(select, X86_IMUL, dst, value(select, instr->a, use),
+                value(select, instr->b, use), 1);
+    break;
+  case IR_DIV:
+    emit_division(select, dst, value(select, instr->a, use),
+                  value(select, instr->b, use));
+    break;
+  case IR_SHL:
+  case IR_SHR:
+  case IR_SAR:
+    emit_shift(select,
+               instr->op == IR_SHL   ? X86_SHL
+               : instr->op == IR_SHR ? X86_SHR
+                                     : X86_SAR,
+               dst, value(select, instr->a, use),
+               value(select, instr->b, use));
+    break;
+  case IR_MULHI:
+    emit_multiply_high(select, dst, value(select, instr->a, use),
+                       value(select, instr->b, use));
+    break;
+  case IR_LT:
+  case IR_LE:
+  case IR_GT:
+  case IR_GE:
+  case IR_EQ:
+  case IR_NE:
+    emit_compare(select, instr->op, dst, value(select, instr->a, use),
+                 value(select, instr->b, use));
+    break;
+  case IR_ADDR: {
+    x86_operand_t result =
+        dst.kind == X86_OPD_REG ? dst : x86_reg(X86_RAX);
+    x86_operand_t address =
+        instr->a.kind == IR_OPD_GLOBAL
+            ? x86_rip(select->global_symbols[instr->a.value], 0)
+            : x86_mem(X86_RBP, select->frame_offsets[instr->a.value]);
+    emit(select, X86_LEA, 8, address, result);
+    move(select, 8, result, dst);
+    break;
+  }
+  case IR_PTRADD:
+    emit_pointer_add(select, dst, value(select, instr->a, use),
+                     value(select, instr->b, use));
+    break;
+  case IR_LOAD: {
+    x86_operand_t address = pointer(select, value(select, instr->a, use));
+    x86_operand_t result =
+        dst.kind == X86_OPD_REG ? dst : x86_reg(X86_RAX);
+    emit(select, X86_MOV, 4, x86_mem(address.reg, 0), result);
+    move(select, 4, result, dst);
+    break;
+  }
+  case IR_STORE: {
+    x86_operand_t address = pointer(select, value(select, instr->a, use));
+    x86_operand_t stored = value(select, instr->b, use);
+    if (stored.kind == X86_OPD_MEM) {
+      move(select, 4, stored, x86_reg(X86_R11));
+      stored = x86_reg(X86_R11);
+    }
+    emit(select, X86_MOV, 4, stored, x86_mem(address.reg, 0));
+    break;
+  }
+  case IR_CHECK:
+    emit_check(select, value(select, instr->a, use), instr->b.value);
+    break;
+  case IR_VADD:
+  case IR_VSUB:
+    emit_vector(select, instr, use);
+    break;
+  case IR_CALL:
+    emit_call(select, instr, use, def);
+    break;
+  case IR_JMP:
+    emit(select, X86_JMP, 0, x86_label(instr->a.value), x86_none());
+    break;
+  case IR_BR:
+    emit_branch(select, instr, use);
+    break;
+  case IR_RET:
+    if (instr->a.kind != IR_OPD_NONE)
+      move(select, 4, value(select, instr->a, use), x86_reg(X86_RAX));
+    emit_epilogue(select);
+    break;
+  default:
+    break;
+  }
+}
+
+// ----------------------- Module ----------------------
+
+static void select_function(select_t *select, ir_function_t *function,
+                            int symbol) {
+  ra_allocation_t *allocation = ra_allocate(function);
+
+  select->function = function;
+  select->allocation = allocation;
+  select->out = x86_add_function(select->machine, symbol);
+  select->out->label_count = function->block_count;
+  select->saved_count = 0;
+  select->next_move = 0;
+  select->bounds_label = -1;
+  select->division_label = -1;
+
+  emit_prologue(select);
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+
+    emit(select, X86_LABEL, 0, x86_label(b), x86_none());
+    for (int i = 0; i < block->count; i++) {
+      int index = allocation->block_first[b] + i;
+      int tail = tail_return(function, block, i);
+
+      emit_moves(select, RA_USE_POSITION(index));
+      if (tail < 0) {
+        select_instr(select, &block->instrs[i], index);
+        continue;
+      }
+
+      // Nothing after the call runs, not even the moves before the return
+      emit_tail_call(select, &block->instrs[i], RA_USE_POSITION(index));
+      skip_moves(select,
+                 RA_USE_POSITION(allocation->block_first[b] + tail));
+      i = tail;
+    }
+  }
+
+  if (select->bounds_label >= 0) {
+    emit(select, X86_LABEL, 0, x86_label(select->bounds_label), x86_none());
+    emit(select, X86_CALL, 8,
+         x86_symbol(runtime_symbol(select, X86_RUNTIME_BOUNDS)), x86_none());
+  }
+  if (select->division_label >= 0) {
+    emit(select, X86_LABEL, 0, x86_label(select->division_label),
+         x86_none());
+    emit(select, X86_CALL, 8,
+         x86_symbol(runtime_symbol(select, X86_RUNTIME_DIVISION)),
+         x86_none());
+  }
+
+  free(select->frame_offsets);
+  ra_destroy(allocation);
+}
+
+static char *symbol_name(const char *name) {
+  char *result = (char *)select_alloc(strlen(name) + 4, 1);
+  strcpy(result, "cm_");
+  strcat(result, name);
+  return result;
+}
+
+x86_module_t *x86_select_module(ir_module_t *module, x86_entry_t entry) {
+  x86_module_t *machine = x86_module_create();
+  int *function_symbols =
+      (int *)select_alloc(module->function_count, sizeof(int));
+  int *global_symbols = (int *)select_alloc(module->global_count, sizeof(int));
+  select_t select = {.module = module,
+                     .machine = machine,
+                     .function_symbols = function_symbols,
+                     .global_symbols = global_symbols};
+
+  for (int f = 0; f < module->function_count; f++) {
+    char *name = symbol_name(module->functions[f].name);
+    function_symbols[f] = x86_add_symbol(machine, name, X86_SECTION_TEXT, 0, 16);
+    free(name);
+  }
+
+  for (int g = 0; g < module->global_count; g++) {
+    const ir_global_t *global = &module->globals[g];
+    char *name = symbol_name(global->name);
+    global_symbols[g] =
+        global->size ? x86_add_symbol(machine, name, X86_SECTION_BSS,
+                                      4 * global->size, 16)
+                     : x86_add_symbol(machine, name, X86_SECTION_BSS, 4, 4);
+    free(name);
+  }
+
+  for (int f = 0; f < module->function_count; f++)
+    if (!module->functions[f].is_builtin)
+      select_function(&select, &module->functions[f], function_symbols[f]);
+
+  x86_add_runtime(machine, function_symbols[IR_FUNCTION_INPUT],
+                  function_symbols[IR_FUNCTION_OUTPUT],
+                  function_symbols[module->main_function], entry);
+
+  free(function_symbols);
+  free(global_symbols);
+  return machine;
+}
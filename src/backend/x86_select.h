@@ -0,0 +1,19 @@
+#ifndef X86_SELECT_H
+#define X86_SELECT_H
+
+#include "../ir/ir.h"
+#include "x86.h"
+#include "x86_runtime.h"
+
+//! Translates a module out of SSA form into x86-64 code following the
+//! System V calling convention, with the runtime and the given entry.
+//! Functions and globals are named 'cm_' followed by their C- name.
+//!
+//! The registers of each function come from the linear-scan allocator,
+//! which may split edges of its CFG. rax, rdx, r10 and r11 are left out of
+//! the allocation for the instruction sequences. The frame holds, below
+//! the saved registers, the incoming register parameters, the spill slots,
+//! the local arrays and the outgoing stack arguments
+x86_module_t *x86_select_module(ir_module_t *module, x86_entry_t entry);
+
+#endif // !X86_SELECT_H
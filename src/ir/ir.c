@@ -0,0 +1,593 @@
+#include "ir.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *ir_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the IR.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static char *ir_strdup(const char *string) {
+  if (!string)
+    return NULL;
+  char *copy = strdup(string);
+  if (!copy) {
+    fprintf(stderr, "Error: Memory allocation failed for the IR.\n");
+    exit(EXIT_FAILURE);
+  }
+  return copy;
+}
+
+// ----------------------- Operands ----------------------
+
+ir_operand_t ir_none() { return (ir_operand_t){IR_OPD_NONE, 0}; }
+ir_operand_t ir_temp(int temp) { return (ir_operand_t){IR_OPD_TEMP, temp}; }
+ir_operand_t ir_const(int value) { return (ir_operand_t){IR_OPD_CONST, value}; }
+ir_operand_t ir_global(int global) {
+  return (ir_operand_t){IR_OPD_GLOBAL, global};
+}
+ir_operand_t ir_frame(int slot) { return (ir_operand_t){IR_OPD_FRAME, slot}; }
+ir_operand_t ir_func(int function) {
+  return (ir_operand_t){IR_OPD_FUNC, function};
+}
+ir_operand_t ir_block(int block) { return (ir_operand_t){IR_OPD_BLOCK, block}; }
+
+// ----------------------- Module ----------------------
+
+ir_module_t *ir_module_create() {
+  ir_module_t *module = (ir_module_t *)calloc(1, sizeof(ir_module_t));
+  if (!module) {
+    fprintf(stderr, "Error: Memory allocation failed for the IR.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  module->main_function = -1;
+
+  int input = ir_add_function(module, "input", 1);
+  module->functions[input].is_builtin = 1;
+
+  int output = ir_add_function(module, "output", 0);
+  module->functions[output].is_builtin = 1;
+  module->functions[output].param_count = 1;
+  module->functions[output].param_is_array = (int *)calloc(1, sizeof(int));
+
+  return module;
+}
+
+static void ir_function_destroy(ir_function_t *function) {
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+    for (int i = 0; i < block->count; i++)
+      free(block->instrs[i].args);
+    free(block->instrs);
+    free(block->preds);
+  }
+  free(function->blocks);
+
+  for (int t = 0; t < function->temp_count; t++)
+    free(function->temp_names[t]);
+  free(function->temp_names);
+  free(function->temp_types);
+
+  for (int f = 0; f < function->frame_count; f++)
+    free(function->frame[f].name);
+  free(function->frame);
+
+  free(function->param_is_array);
+  free(function->name);
+}
+
+void ir_module_destroy(ir_module_t *module) {
+  if (!module)
+    return;
+
+  for (int f = 0; f < module->function_count; f++)
+    ir_function_destroy(&module->functions[f]);
+  free(module->functions);
+
+  for (int g = 0; g < module->global_count; g++)
+    free(module->globals[g].name);
+  free(module->globals);
+
+  free(module);
+}
+
+void ir_remove_functions(ir_module_t *module, const char *dead) {
+  int *remap = (int *)ir_realloc(NULL, module->function_count * sizeof(int));
+  int kept = 0;
+
+  for (int f = 0; f < module->function_count; f++)
+    remap[f] = dead[f] && !module->functions[f].is_builtin ? -1 : kept++;
+
+  for (int f = 0; f < module->function_count; f++) {
+    ir_function_t *function = &module->functions[f];
+
+    if (remap[f] < 0) {
+      ir_function_destroy(function);
+      continue;
+    }
+
+    for (int b = 0; b < function->block_count; b++)
+      for (int i = 0; i < function->blocks[b].count; i++) {
+        ir_instr_t *instr = &function->blocks[b].instrs[i];
+        if (instr->a.kind == IR_OPD_FUNC)
+          instr->a.value = remap[instr->a.value];
+      }
+
+    module->functions[remap[f]] = *function;
+  }
+
+  if (module->main_function >= 0)
+    module->main_function = remap[module->main_function];
+  module->function_count = kept;
+  free(remap);
+}
+
+int ir_add_global(ir_module_t *module, const char *name, int size) {
+  module->globals = (ir_global_t *)ir_realloc(
+      module->globals, (module->global_count + 1) * sizeof(ir_global_t));
+  module->globals[module->global_count] =
+      (ir_global_t){.name = ir_strdup(name), .size = size};
+  return module->global_count++;
+}
+
+int ir_add_function(ir_module_t *module, const char *name, int returns_value) {
+  module->functions = (ir_function_t *)ir_realloc(
+      module->functions, (module->function_count + 1) * sizeof(ir_function_t));
+
+  ir_function_t *function = &module->functions[module->function_count];
+  memset(function, 0, sizeof(*function));
+  function->name = ir_strdup(name);
+  function->returns_value = returns_value;
+
+  return module->function_count++;
+}
+
+// ----------------------- Function Construction ----------------------
+
+int ir_new_temp(ir_function_t *function, ir_type_t type, const char *name) {
+  if (function->temp_count == function->temp_capacity) {
+    function->temp_capacity =
+        function->temp_capacity ? function->temp_capacity * 2 : 32;
+    function->temp_types = (ir_type_t *)ir_realloc(
+        function->temp_types, function->temp_capacity * sizeof(ir_type_t));
+    function->temp_names = (char **)ir_realloc(
+        function->temp_names, function->temp_capacity * sizeof(char *));
+  }
+
+  function->temp_types[function->temp_count] = type;
+  function->temp_names[function->temp_count] = ir_strdup(name);
+
+  return function->temp_count++;
+}
+
+int ir_add_frame_slot(ir_function_t *function, const char *name, int size) {
+  function->frame = (ir_frame_slot_t *)ir_realloc(
+      function->frame, (function->frame_count + 1) * sizeof(ir_frame_slot_t));
+  function->frame[function->frame_count] =
+      (ir_frame_slot_t){.name = ir_strdup(name), .size = size};
+  return function->frame_count++;
+}
+
+int ir_new_block(ir_function_t *function) {
+  if (function->block_count == function->block_capacity) {
+    function->block_capacity =
+        function->block_capacity ? function->block_capacity * 2 : 16;
+    function->blocks = (ir_block_t *)ir_realloc(
+        function->blocks, function->block_capacity * sizeof(ir_block_t));
+  }
+
+  ir_block_t *block = &function->blocks[function->block_count];
+  memset(block, 0, sizeof(*block));
+  block->succs[0] = block->succs[1] = -1;
+
+  return function->block_count++;
+}
+
+ir_instr_t *ir_insert(ir_function_t *function, int block_index, int position,
+                      ir_opcode_t op, ir_operand_t dst, ir_operand_t a,
+                      ir_operand_t b) {
+  ir_block_t *block = &function->blocks[block_index];
+
+  if (block->count == block->capacity) {
+    block->capacity = block->capacity ? block->capacity * 2 : 8;
+    block->instrs = (ir_instr_t *)ir_realloc(
+        block->instrs, block->capacity * sizeof(ir_instr_t));
+  }
+
+  memmove(&block->instrs[position + 1], &block->instrs[position],
+          (block->count - position) * sizeof(ir_instr_t));
+  block->count++;
+
+  ir_instr_t *instr = &block->instrs[position];
+  *instr = (ir_instr_t){.op = op, .dst = dst, .a = a, .b = b};
+
+  return instr;
+}
+
+ir_instr_t *ir_emit(ir_function_t *function, int block, ir_opcode_t op,
+                    ir_operand_t dst, ir_operand_t a, ir_operand_t b) {
+  return ir_insert(function, block, function->blocks[block].count, op, dst, a,
+                   b);
+}
+
+void ir_set_args(ir_instr_t *instr, const ir_operand_t *args, int count) {
+  ir_operand_t *copy = NULL;
+
+  if (count) {
+    copy = (ir_operand_t *)ir_realloc(NULL, count * sizeof(ir_operand_t));
+    memcpy(copy, args, count * sizeof(ir_operand_t));
+  }
+
+  free(instr->args);
+  instr->args = copy;
+  instr->arg_count = count;
+}
+
+void ir_remove_instr(ir_instr_t *instr) {
+  free(instr->args);
+  *instr = (ir_instr_t){.op = IR_NOP};
+}
+
+// ----------------------- Control Flow Graph ----------------------
+
+ir_instr_t *ir_terminator(ir_block_t *block) {
+  for (int i = block->count - 1; i >= 0; i--) {
+    if (block->instrs[i].op == IR_NOP)
+      continue;
+    return IR_IS_TERMINATOR(block->instrs[i].op) ? &block->instrs[i] : NULL;
+  }
+  return NULL;
+}
+
+static void add_pred(ir_block_t *block, int pred) {
+  if (block->pred_count == block->pred_capacity) {
+    block->pred_capacity = block->pred_capacity ? block->pred_capacity * 2 : 4;
+    block->preds = (int *)ir_realloc(block->preds,
+                                     block->pred_capacity * sizeof(int));
+  }
+  block->preds[block->pred_count++] = pred;
+}
+
+void ir_compute_cfg(ir_function_t *function) {
+  for (int b = 0; b < function->block_count; b++)
+    function->blocks[b].pred_count = 0;
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+    ir_instr_t *terminator = ir_terminator(block);
+
+    block->succ_count = 0;
+    block->succs[0] = block->succs[1] = -1;
+    if (!terminator)
+      continue;
+
+    if (terminator->op == IR_JMP) {
+      block->succs[block->succ_count++] = terminator->a.value;
+    } else if (terminator->op == IR_BR) {
+      block->succs[block->succ_count++] = terminator->args[0].value;
+      // Both targets equal is a single edge
+      if (terminator->args[1].value != terminator->args[0].value)
+        block->succs[block->succ_count++] = terminator->args[1].value;
+    }
+  }
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int s = 0; s < function->blocks[b].succ_count; s++)
+      add_pred(&function->blocks[function->blocks[b].succs[s]], b);
+}
+
+int ir_pred_index(const ir_block_t *block, int pred) {
+  for (int p = 0; p < block->pred_count; p++)
+    if (block->preds[p] == pred)
+      return p;
+  return -1;
+}
+
+ir_operand_t *ir_phi_source(ir_instr_t *phi, int pred) {
+  for (int i = 0; i < phi->arg_count; i += 2)
+    if (phi->args[i].value == pred)
+      return &phi->args[i + 1];
+  return NULL;
+}
+
+void ir_phi_remove_source(ir_instr_t *phi, int pred) {
+  for (int i = 0; i < phi->arg_count; i += 2) {
+    if (phi->args[i].value != pred)
+      continue;
+    memmove(&phi->args[i], &phi->args[i + 2],
+            (phi->arg_count - i - 2) * sizeof(ir_operand_t));
+    phi->arg_count -= 2;
+    return;
+  }
+}
+
+static void renumber(ir_operand_t *operand, const int *remap) {
+  if (operand->kind == IR_OPD_BLOCK)
+    operand->value = remap[operand->value];
+}
+
+void ir_compact_function(ir_function_t *function, const char *dead) {
+  int *remap = (int *)ir_realloc(NULL, function->block_count * sizeof(int));
+  int kept = 0;
+
+  for (int b = 0; b < function->block_count; b++)
+    remap[b] = (dead && dead[b]) ? -1 : kept++;
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+
+    if (remap[b] < 0) {
+      for (int i = 0; i < block->count; i++)
+        free(block->instrs[i].args);
+      free(block->instrs);
+      free(block->preds);
+      continue;
+    }
+
+    int count = 0;
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+      if (instr->op == IR_NOP)
+        continue;
+
+      if (instr->op == IR_PHI) {
+        for (int p = 0; p < instr->arg_count;) {
+          if (remap[instr->args[p].value] < 0)
+            ir_phi_remove_source(instr, instr->args[p].value);
+          else
+            p += 2;
+        }
+      }
+
+      renumber(&instr->a, remap);
+      renumber(&instr->b, remap);
+      for (int a = 0; a < instr->arg_count; a++)
+        renumber(&instr->args[a], remap);
+
+      block->instrs[count++] = *instr;
+    }
+    block->count = count;
+
+    function->blocks[remap[b]] = *block;
+  }
+
+  function->block_count = kept;
+  free(remap);
+
+  ir_compute_cfg(function);
+}
+
+// ----------------------- Opcode Properties ----------------------
+
+const char *ir_opcode_name(ir_opcode_t op) {
+  static const char *names[IR_OPCODE_COUNT] = {
+      [IR_NOP] = "nop",       [IR_PARAM] = "param",   [IR_MOV] = "mov",
+      [IR_ADD] = "add",       [IR_SUB] = "sub",       [IR_MUL] = "mul",
+      [IR_DIV] = "div",       [IR_SHL] = "shl",       [IR_SHR] = "shr",
+      [IR_SAR] = "sar",       [IR_MULHI] = "mulhi",   [IR_LT] = "lt",
+      [IR_LE] = "le",
+      [IR_GT] = "gt",         [IR_GE] = "ge",         [IR_EQ] = "eq",
+      [IR_NE] = "ne",         [IR_ADDR] = "addr",     [IR_PTRADD] = "ptradd",
+      [IR_LOAD] = "load",     [IR_STORE] = "store",   [IR_CHECK] = "check",
+      [IR_VADD] = "vadd",     [IR_VSUB] = "vsub",     [IR_CALL] = "call",
+      [IR_PHI] = "phi",       [IR_JMP] = "jmp",       [IR_BR] = "br",
+      [IR_RET] = "ret",
+  };
+  return op < IR_OPCODE_COUNT && names[op] ? names[op] : "?";
+}
+
+int ir_has_side_effects(ir_opcode_t op) {
+  switch (op) {
+  case IR_STORE:
+  case IR_CHECK:
+  case IR_VADD:
+  case IR_VSUB:
+  case IR_CALL:
+  case IR_JMP:
+  case IR_BR:
+  case IR_RET:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+int ir_instr_has_side_effects(const ir_instr_t *instr) {
+  if (instr->op == IR_DIV)
+    return instr->b.kind != IR_OPD_CONST || instr->b.value == 0 ||
+           instr->b.value == -1;
+  return ir_has_side_effects(instr->op);
+}
+
+int ir_is_commutative(ir_opcode_t op) {
+  switch (op) {
+  case IR_ADD:
+  case IR_MUL:
+  case IR_EQ:
+  case IR_NE:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+//! Signed shift right that does not rely on the implementation-defined
+//! behavior of >> on negative values
+static long long shift_right(long long value, int amount) {
+  return value < 0 ? ~(~value >> amount) : value >> amount;
+}
+
+int ir_fold(ir_opcode_t op, int a, int b, int *result) {
+  unsigned int x = (unsigned int)a, y = (unsigned int)b;
+
+  switch (op) {
+  case IR_ADD:
+    *result = (int)(x + y);
+    return 1;
+  case IR_SUB:
+    *result = (int)(x - y);
+    return 1;
+  case IR_MUL:
+    *result = (int)(x * y);
+    return 1;
+  case IR_DIV:
+    if (b == 0 || (a == INT_MIN && b == -1))
+      return 0;
+    *result = a / b;
+    return 1;
+  case IR_SHL:
+  case IR_SHR:
+  case IR_SAR:
+    if (b < 0 || b > 31)
+      return 0;
+    *result = op == IR_SHL   ? (int)(x << b)
+              : op == IR_SHR ? (int)(x >> b)
+                             : (int)shift_right(a, b);
+    return 1;
+  case IR_MULHI:
+    *result = (int)shift_right((long long)a * b, 32);
+    return 1;
+  case IR_LT:
+    *result = a < b;
+    return 1;
+  case IR_LE:
+    *result = a <= b;
+    return 1;
+  case IR_GT:
+    *result = a > b;
+    return 1;
+  case IR_GE:
+    *result = a >= b;
+    return 1;
+  case IR_EQ:
+    *result = a == b;
+    return 1;
+  case IR_NE:
+    *result = a != b;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+int ir_use_count(const ir_instr_t *instr) {
+  if (instr->op == IR_CALL || instr->op == IR_PHI || IR_IS_VECTOR(instr->op))
+    return 2 + instr->arg_count;
+  return 2;
+}
+
+ir_operand_t *ir_use(ir_instr_t *instr, int index) {
+  if (index == 0)
+    return &instr->a;
+  if (index == 1)
+    return &instr->b;
+  return &instr->args[index - 2];
+}
+
+// ----------------------- Verifier ----------------------
+
+static int verify_error(const ir_function_t *function, int block,
+                        const char *message) {
+  fprintf(stderr, "IR invalido em %s, bloco b%d: %s\n", function->name, block,
+          message);
+  return 1;
+}
+
+static int verify_operand(const ir_function_t *function, int block,
+                          ir_operand_t operand) {
+  switch (operand.kind) {
+  case IR_OPD_TEMP:
+    if (operand.value < 0 || operand.value >= function->temp_count)
+      return verify_error(function, block, "temporario inexistente");
+    break;
+  case IR_OPD_FRAME:
+    if (operand.value < 0 || operand.value >= function->frame_count)
+      return verify_error(function, block, "slot de frame inexistente");
+    break;
+  case IR_OPD_BLOCK:
+    if (operand.value < 0 || operand.value >= function->block_count)
+      return verify_error(function, block, "bloco inexistente");
+    break;
+  default:
+    break;
+  }
+  return 0;
+}
+
+int ir_verify_function(const ir_function_t *function) {
+  int errors = 0;
+
+  if (function->is_builtin)
+    return 0;
+  if (function->block_count == 0)
+    return verify_error(function, 0, "funcao sem blocos");
+
+  for (int b = 0; b < function->block_count; b++) {
+    const ir_block_t *block = &function->blocks[b];
+    int seen_other = 0;
+
+    if (block->count == 0 || !IR_IS_TERMINATOR(block->instrs[block->count - 1].op)) {
+      errors += verify_error(function, b, "bloco sem terminador");
+      continue;
+    }
+
+    for (int i = 0; i < block->count; i++) {
+      const ir_instr_t *instr = &block->instrs[i];
+
+      if (IR_IS_TERMINATOR(instr->op) && i != block->count - 1)
+        errors += verify_error(function, b, "terminador no meio do bloco");
+
+      if (instr->op == IR_PHI) {
+        if (seen_other)
+          errors += verify_error(function, b, "phi depois de outra instrucao");
+        if (instr->arg_count != 2 * block->pred_count)
+          errors += verify_error(function, b,
+                                 "phi sem uma fonte por predecessor");
+        for (int p = 0; p < instr->arg_count; p += 2)
+          if (ir_pred_index(block, instr->args[p].value) < 0)
+            errors += verify_error(function, b,
+                                   "phi com fonte que nao e predecessor");
+      } else if (instr->op != IR_NOP) {
+        seen_other = 1;
+      }
+
+      if (instr->dst.kind != IR_OPD_NONE && instr->dst.kind != IR_OPD_TEMP)
+        errors += verify_error(function, b, "destino nao e temporario");
+
+      errors += verify_operand(function, b, instr->dst);
+      errors += verify_operand(function, b, instr->a);
+      errors += verify_operand(function, b, instr->b);
+      for (int a = 0; a < instr->arg_count; a++)
+        errors += verify_operand(function, b, instr->args[a]);
+    }
+
+    // The successors must match the terminator
+    const ir_instr_t *terminator = &block->instrs[block->count - 1];
+    int expected = terminator->op == IR_JMP  ? 1
+                   : terminator->op == IR_BR ? 1 + (terminator->args[0].value !=
+                                                    terminator->args[1].value)
+                                             : 0;
+    if (block->succ_count != expected)
+      errors += verify_error(function, b, "sucessores desatualizados");
+
+    for (int s = 0; s < block->succ_count; s++)
+      if (ir_pred_index(&function->blocks[block->succs[s]], b) < 0)
+        errors += verify_error(function, b, "predecessores desatualizados");
+  }
+
+  return errors;
+}
+
+int ir_verify_module(const ir_module_t *module) {
+  int errors = 0;
+  for (int f = 0; f < module->function_count; f++)
+    errors += ir_verify_function(&module->functions[f]);
+  return errors;
+}
@@ -0,0 +1,246 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+
+struct symbol;
+
+// ----------------------- Operands ----------------------
+
+//! What an operand refers to
+typedef enum {
+  IR_OPD_NONE,
+  IR_OPD_TEMP,   // Virtual register
+  IR_OPD_CONST,  // 32 bits integer
+  IR_OPD_GLOBAL, // Global variable or array, index in the module
+  IR_OPD_FRAME,  // Local array, index in the function's frame
+  IR_OPD_FUNC,   // Function, index in the module
+  IR_OPD_BLOCK,  // Basic block, index in the function
+} ir_operand_kind_t;
+
+typedef struct {
+  ir_operand_kind_t kind;
+  int value;
+} ir_operand_t;
+
+//! Type of a temporary
+typedef enum {
+  IR_TYPE_I32, // C- int, arithmetic wraps around in 32 bits
+  IR_TYPE_PTR, // Address of an array or a global
+} ir_type_t;
+
+// ----------------------- Instructions ----------------------
+
+//! Three-address opcodes, 'dst = a op b' unless noted
+typedef enum {
+  IR_NOP,    // Removed instruction, dropped by ir_compact_function()
+  IR_PARAM,  // dst = parameter number a
+  IR_MOV,    // dst = a
+  IR_ADD,
+  IR_SUB,
+  IR_MUL,
+  IR_DIV,    // Signed, truncates toward zero
+  IR_SHL,    // Shifts by b (0 to 31), introduced by the strength reduction
+  IR_SHR,    // Logical shift right
+  IR_SAR,    // Arithmetic shift right
+  IR_MULHI,  // High 32 bits of the signed 64 bits product
+  IR_LT,     // Relational operators give 0 or 1
+  IR_LE,
+  IR_GT,
+  IR_GE,
+  IR_EQ,
+  IR_NE,
+  IR_ADDR,   // dst = address of a (GLOBAL or FRAME)
+  IR_PTRADD, // dst = a (pointer) + b (signed byte offset)
+  IR_LOAD,   // dst = *a
+  IR_STORE,  // *a = b
+  IR_CHECK,  // Stops the program unless 0 <= a < b, the index of an array
+             // of b ints (safe mode)
+  IR_VADD,   // Four ints at once: *a = b + args[0], b and args[0] each being
+             // a pointer to four ints or an int taken four times (vectorizer)
+  IR_VSUB,   // *a = b - args[0], the same way
+  IR_CALL,   // dst (or NONE) = a (FUNC) (args...)
+  IR_PHI,    // dst = args[2i + 1] when coming from the block args[2i]
+  IR_JMP,    // goto a
+  IR_BR,     // if (a != 0) goto args[0] else goto args[1]
+  IR_RET,    // return a (or NONE)
+  IR_OPCODE_COUNT,
+} ir_opcode_t;
+
+typedef struct {
+  ir_opcode_t op;
+  ir_operand_t dst;
+  ir_operand_t a;
+  ir_operand_t b;
+  ir_operand_t *args; // Call arguments, phi (block, value) pairs or branch
+                      // targets
+  int arg_count;
+} ir_instr_t;
+
+#define IR_IS_TERMINATOR(op) ((op) == IR_JMP || (op) == IR_BR || (op) == IR_RET)
+#define IR_IS_VECTOR(op) ((op) == IR_VADD || (op) == IR_VSUB)
+
+// ----------------------- Functions and Modules ----------------------
+
+//! Basic block: contiguous instructions, the last one is the terminator
+typedef struct {
+  ir_instr_t *instrs;
+  int count;
+  int capacity;
+
+  int succs[2]; // Taken from the terminator, -1 if absent
+  int succ_count;
+  int *preds;   // Filled by ir_compute_cfg()
+  int pred_count;
+  int pred_capacity;
+} ir_block_t;
+
+//! Local array kept in the stack frame
+typedef struct {
+  char *name;
+  int size; // Number of ints
+} ir_frame_slot_t;
+
+typedef struct {
+  char *name;
+  int returns_value;
+  int is_builtin;    // input() and output(), no blocks
+  int param_count;
+  int *param_is_array;
+  int tail_recursive; // Self tail calls jump back to the body, past the
+                      // PARAMs, which only see the other calls
+  struct symbol *symbol; // Declaration it was lowered from, NULL for the
+                         // builtins
+
+  ir_block_t *blocks; // Block 0 is the entry
+  int block_count;
+  int block_capacity;
+
+  ir_type_t *temp_types;
+  char **temp_names; // Source variable of the temporary or NULL
+  int temp_count;
+  int temp_capacity;
+
+  ir_frame_slot_t *frame;
+  int frame_count;
+} ir_function_t;
+
+typedef struct {
+  char *name;
+  int size; // 0 for a scalar, number of ints for an array
+} ir_global_t;
+
+typedef struct {
+  ir_global_t *globals;
+  int global_count;
+  ir_function_t *functions; // 0 is input() and 1 is output()
+  int function_count;
+  int main_function;
+} ir_module_t;
+
+#define IR_FUNCTION_INPUT 0
+#define IR_FUNCTION_OUTPUT 1
+
+// ----------------------- Construction ----------------------
+
+//! Operand constructors
+ir_operand_t ir_none();
+ir_operand_t ir_temp(int temp);
+ir_operand_t ir_const(int value);
+ir_operand_t ir_global(int global);
+ir_operand_t ir_frame(int slot);
+ir_operand_t ir_func(int function);
+ir_operand_t ir_block(int block);
+
+//! Creates an empty module holding the builtins
+ir_module_t *ir_module_create();
+
+//! Frees a module and all its functions
+void ir_module_destroy(ir_module_t *module);
+
+//! Drops the functions flagged in 'dead', except the builtins, renumbering
+//! the remaining ones. Calls to the dropped functions must be gone
+void ir_remove_functions(ir_module_t *module, const char *dead);
+
+//! Adds a global, returns its index
+int ir_add_global(ir_module_t *module, const char *name, int size);
+
+//! Adds a function without blocks, returns its index
+int ir_add_function(ir_module_t *module, const char *name, int returns_value);
+
+//! Adds a temporary of the given type, returns its number
+int ir_new_temp(ir_function_t *function, ir_type_t type, const char *name);
+
+//! Adds a local array to the frame, returns its slot
+int ir_add_frame_slot(ir_function_t *function, const char *name, int size);
+
+//! Adds an empty block, returns its index
+int ir_new_block(ir_function_t *function);
+
+//! Appends an instruction to a block and returns it. Its args are copied
+ir_instr_t *ir_emit(ir_function_t *function, int block, ir_opcode_t op,
+                    ir_operand_t dst, ir_operand_t a, ir_operand_t b);
+
+//! Inserts an instruction at a position of a block and returns it
+ir_instr_t *ir_insert(ir_function_t *function, int block, int position,
+                      ir_opcode_t op, ir_operand_t dst, ir_operand_t a,
+                      ir_operand_t b);
+
+//! Replaces the arguments of an instruction by a copy of 'args'
+void ir_set_args(ir_instr_t *instr, const ir_operand_t *args, int count);
+
+//! Frees the arguments of an instruction and turns it into a NOP
+void ir_remove_instr(ir_instr_t *instr);
+
+// ----------------------- Control Flow Graph ----------------------
+
+//! Returns the terminator of a block or NULL
+ir_instr_t *ir_terminator(ir_block_t *block);
+
+//! Recomputes the successors of every block from its terminator and the
+//! predecessors from the successors (in block order)
+void ir_compute_cfg(ir_function_t *function);
+
+//! Drops the NOPs and the blocks flagged in 'dead' (may be NULL),
+//! renumbering the remaining ones and dropping the phi sources coming from
+//! removed blocks. Recomputes the CFG
+void ir_compact_function(ir_function_t *function, const char *dead);
+
+//! Index of 'pred' among the predecessors of 'block', -1 if absent
+int ir_pred_index(const ir_block_t *block, int pred);
+
+//! Value of a phi for the predecessor 'pred', NULL if it has none
+ir_operand_t *ir_phi_source(ir_instr_t *phi, int pred);
+
+//! Drops the source of a phi coming from 'pred'
+void ir_phi_remove_source(ir_instr_t *phi, int pred);
+
+//! Opcode properties
+const char *ir_opcode_name(ir_opcode_t op);
+int ir_has_side_effects(ir_opcode_t op);
+int ir_is_commutative(ir_opcode_t op);
+
+//! The effects of the opcode, and a division that may stop the program on
+//! a zero divisor, so its result being unused doesn't make it dead
+int ir_instr_has_side_effects(const ir_instr_t *instr);
+
+//! Computes 'a op b' for an arithmetic or relational opcode, wrapping
+//! around in 32 bits. Returns 0 if it cannot be folded (division by zero,
+//! the overflowing division, a shift out of range or another opcode)
+int ir_fold(ir_opcode_t op, int a, int b, int *result);
+
+//! Operands read by an instruction: a, b and then the args of calls, phis
+//! and vector operations. Only those of kind IR_OPD_TEMP are values
+int ir_use_count(const ir_instr_t *instr);
+ir_operand_t *ir_use(ir_instr_t *instr, int index);
+
+// ----------------------- Checks ----------------------
+
+//! Checks the structural invariants of a function. Prints the problems and
+//! returns their number
+int ir_verify_function(const ir_function_t *function);
+
+//! Checks every function of the module
+int ir_verify_module(const ir_module_t *module);
+
+#endif // !IR_H
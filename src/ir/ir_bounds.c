@@ -0,0 +1,866 @@
+#include "ir_bounds.h"
+#include "ir_dominance.h"
+#include "ir_loop.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+#define BOUNDS_DEPTH 6       // Definitions followed to bound an index
+#define BOUNDS_DOMINATORS 64 // Dominators whose branches may bound it
+
+//! Values a temporary may hold, without wrapping around
+typedef struct {
+  long long low;
+  long long high;
+} range_t;
+
+typedef struct {
+  ir_function_t *function;
+  ir_dominance_t *dominance;
+  ir_loops_t *loops;
+  int temp_count; // Temporaries before the pass, the others are its own
+  int *def_block; // -1 for the temporaries without a definition
+  int *def_index;
+} bounds_t;
+
+//! Range check a loop gets in its preheader
+typedef struct {
+  int preheader;
+  ir_opcode_t test;   // 'variable test bound' keeps the loop going
+  ir_operand_t init;  // First value of the induction variable
+  ir_operand_t bound;
+  long long low;      // Values of the variable within the array
+  long long high;
+} hoisted_t;
+
+static void *bounds_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the bounds "
+                    "checks.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+// ----------------------- Relations ----------------------
+
+static int is_relation(ir_opcode_t op) {
+  return op == IR_LT || op == IR_LE || op == IR_GT || op == IR_GE ||
+         op == IR_EQ || op == IR_NE;
+}
+
+//! 'a op b' is 'b swapped a'
+static ir_opcode_t swap_relation(ir_opcode_t op) {
+  switch (op) {
+  case IR_LT:
+    return IR_GT;
+  case IR_LE:
+    return IR_GE;
+  case IR_GT:
+    return IR_LT;
+  case IR_GE:
+    return IR_LE;
+  default:
+    return op;
+  }
+}
+
+static ir_opcode_t negate_relation(ir_opcode_t op) {
+  switch (op) {
+  case IR_LT:
+    return IR_GE;
+  case IR_LE:
+    return IR_GT;
+  case IR_GT:
+    return IR_LE;
+  case IR_GE:
+    return IR_LT;
+  case IR_EQ:
+    return IR_NE;
+  default:
+    return IR_EQ;
+  }
+}
+
+// ----------------------- Ranges ----------------------
+
+static range_t full_range(void) { return (range_t){INT_MIN, INT_MAX}; }
+
+//! The exact range, or every value when the operation may wrap around
+static range_t wrapped(long long low, long long high) {
+  if (low < INT_MIN || high > INT_MAX)
+    return full_range();
+  return (range_t){low, high};
+}
+
+static const ir_instr_t *definition(const bounds_t *bounds,
+                                    ir_operand_t operand) {
+  if (operand.kind != IR_OPD_TEMP || operand.value >= bounds->temp_count ||
+      bounds->def_block[operand.value] < 0)
+    return NULL;
+  return &bounds->function->blocks[bounds->def_block[operand.value]]
+              .instrs[bounds->def_index[operand.value]];
+}
+
+static range_t value_range(const bounds_t *bounds, ir_operand_t operand,
+                           int block, int depth);
+
+//! Step of a header phi whose every latch value adds the same constant to
+//! it, 0 if it is not an induction variable
+static int induction_step(const bounds_t *bounds, const ir_loop_t *loop,
+                          const ir_instr_t *phi, ir_operand_t *init) {
+  int step = 0, found = 0;
+
+  if (loop->preheader < 0)
+    return 0;
+
+  for (int p = 0; p < phi->arg_count; p += 2) {
+    if (phi->args[p].value == loop->preheader) {
+      *init = phi->args[p + 1];
+      found = 1;
+      continue;
+    }
+
+    const ir_instr_t *next = definition(bounds, phi->args[p + 1]);
+    if (!next)
+      return 0;
+    ir_operand_t a = next->a, b = next->b;
+    if (next->op == IR_ADD && a.kind == IR_OPD_CONST) {
+      a = next->b;
+      b = next->a;
+    }
+    if (a.kind != IR_OPD_TEMP || a.value != phi->dst.value ||
+        b.kind != IR_OPD_CONST || b.value == INT_MIN ||
+        (next->op != IR_ADD && next->op != IR_SUB))
+      return 0;
+
+    int value = next->op == IR_ADD ? b.value : -b.value;
+    if (value == 0 || (step && value != step))
+      return 0;
+    step = value;
+  }
+
+  return found ? step : 0;
+}
+
+//! Relation 'phi test bound' that holds on entering the body of the loop
+//! from its header, IR_NOP when the header branches on something else
+static ir_opcode_t header_test(const bounds_t *bounds, int l, int phi,
+                               ir_operand_t *bound, int *body) {
+  const ir_loop_t *loop = &bounds->loops->loops[l];
+  ir_instr_t *branch = ir_terminator(&bounds->function->blocks[loop->header]);
+
+  if (!branch || branch->op != IR_BR ||
+      branch->args[0].value == branch->args[1].value)
+    return IR_NOP;
+
+  int inside = ir_loop_contains(bounds->loops, l, branch->args[0].value);
+  if (inside == ir_loop_contains(bounds->loops, l, branch->args[1].value))
+    return IR_NOP;
+  *body = branch->args[inside ? 0 : 1].value;
+  if (bounds->function->blocks[*body].pred_count != 1)
+    return IR_NOP;
+
+  const ir_instr_t *condition = definition(bounds, branch->a);
+  if (!condition || !is_relation(condition->op))
+    return IR_NOP;
+
+  ir_opcode_t test;
+  if (condition->a.kind == IR_OPD_TEMP && condition->a.value == phi) {
+    test = condition->op;
+    *bound = condition->b;
+  } else if (condition->b.kind == IR_OPD_TEMP && condition->b.value == phi) {
+    test = swap_relation(condition->op);
+    *bound = condition->a;
+  } else {
+    return IR_NOP;
+  }
+  return inside ? test : negate_relation(test);
+}
+
+//! Range of an induction variable in the body of its loop. The header
+//! tests it against a bound before every iteration, so it never wraps
+//! around when the bound leaves room for one more step, and it stays on
+//! the side of its first value. Returns 0 when that is unknown
+static int induction_range(const bounds_t *bounds, const ir_instr_t *phi,
+                           int block, int depth, range_t *range) {
+  int header = bounds->def_block[phi->dst.value];
+  int l = bounds->loops->block_loop[header];
+  ir_operand_t init, bound;
+  int body;
+
+  if (l < 0 || bounds->loops->loops[l].header != header ||
+      !ir_loop_contains(bounds->loops, l, block))
+    return 0;
+
+  int step = induction_step(bounds, &bounds->loops->loops[l], phi, &init);
+  ir_opcode_t test = step ? header_test(bounds, l, phi->dst.value, &bound,
+                                        &body)
+                          : IR_NOP;
+  if (test == IR_NOP || !ir_dominates(bounds->dominance, body, block))
+    return 0;
+
+  range_t limit = value_range(bounds, bound, header, depth - 1);
+  range_t first = value_range(bounds, init,
+                              bounds->loops->loops[l].preheader, depth - 1);
+
+  if (step > 0 && ((test == IR_LT && limit.high - 1 + step <= INT_MAX) ||
+                   (test == IR_LE && limit.high + step <= INT_MAX))) {
+    *range = (range_t){first.low, INT_MAX};
+    return 1;
+  }
+  if (step < 0 && ((test == IR_GT && limit.low + 1 + step >= INT_MIN) ||
+                   (test == IR_GE && limit.low + step >= INT_MIN))) {
+    *range = (range_t){INT_MIN, first.high};
+    return 1;
+  }
+  return 0;
+}
+
+static range_t definition_range(const bounds_t *bounds,
+                                const ir_instr_t *instr, int block,
+                                int depth) {
+  range_t a, b, range;
+
+  switch (instr->op) {
+  case IR_MOV:
+    return value_range(bounds, instr->a, block, depth - 1);
+  case IR_LT:
+  case IR_LE:
+  case IR_GT:
+  case IR_GE:
+  case IR_EQ:
+  case IR_NE:
+    return (range_t){0, 1};
+  case IR_PHI:
+    if (induction_range(bounds, instr, block, depth, &range))
+      return range;
+    range = (range_t){INT_MAX, INT_MIN};
+    for (int p = 0; p < instr->arg_count; p += 2) {
+      a = value_range(bounds, instr->args[p + 1], instr->args[p].value,
+                      depth - 1);
+      range.low = a.low < range.low ? a.low : range.low;
+      range.high = a.high > range.high ? a.high : range.high;
+    }
+    return range;
+  case IR_ADD:
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_SHL:
+  case IR_SAR:
+    break;
+  default:
+    return full_range();
+  }
+
+  a = value_range(bounds, instr->a, block, depth - 1);
+  b = value_range(bounds, instr->b, block, depth - 1);
+
+  switch (instr->op) {
+  case IR_ADD:
+    return wrapped(a.low + b.low, a.high + b.high);
+  case IR_SUB:
+    return wrapped(a.low - b.high, a.high - b.low);
+  case IR_MUL: {
+    long long products[4] = {a.low * b.low, a.low * b.high, a.high * b.low,
+                             a.high * b.high};
+    range = (range_t){products[0], products[0]};
+    for (int p = 1; p < 4; p++) {
+      range.low = products[p] < range.low ? products[p] : range.low;
+      range.high = products[p] > range.high ? products[p] : range.high;
+    }
+    return wrapped(range.low, range.high);
+  }
+  case IR_DIV:
+    // Truncating by a positive constant keeps the order
+    if (b.low == b.high && b.low > 0)
+      return (range_t){a.low / b.low, a.high / b.low};
+    return full_range();
+  case IR_SHL:
+    if (b.low == b.high && b.low >= 0 && b.low < 32)
+      return wrapped(a.low * (1LL << b.low), a.high * (1LL << b.low));
+    return full_range();
+  default: // IR_SAR
+    if (b.low == b.high && b.low >= 0 && b.low < 32)
+      return (range_t){a.low >> b.low, a.high >> b.low};
+    return full_range();
+  }
+}
+
+//! Narrows the range of a temporary by the comparisons of the branches that
+//! lead to 'block': a block with a single predecessor is only entered when
+//! the condition of its branch gave that way
+static range_t constrain(const bounds_t *bounds, int temp, range_t range,
+                         int block, int depth) {
+  ir_function_t *function = bounds->function;
+
+  for (int d = block, steps = 0; d >= 0 && steps < BOUNDS_DOMINATORS;
+       d = bounds->dominance->idom[d], steps++) {
+    if (function->blocks[d].pred_count != 1)
+      continue;
+
+    int pred = function->blocks[d].preds[0];
+    ir_instr_t *branch = ir_terminator(&function->blocks[pred]);
+    if (!branch || branch->op != IR_BR ||
+        branch->args[0].value == branch->args[1].value)
+      continue;
+
+    const ir_instr_t *condition = definition(bounds, branch->a);
+    if (!condition || !is_relation(condition->op))
+      continue;
+
+    ir_opcode_t test;
+    ir_operand_t other;
+    if (condition->a.kind == IR_OPD_TEMP && condition->a.value == temp) {
+      test = condition->op;
+      other = condition->b;
+    } else if (condition->b.kind == IR_OPD_TEMP &&
+               condition->b.value == temp) {
+      test = swap_relation(condition->op);
+      other = condition->a;
+    } else {
+      continue;
+    }
+    if (d == branch->args[1].value)
+      test = negate_relation(test);
+
+    range_t limit = value_range(bounds, other, pred, depth - 1);
+    switch (test) {
+    case IR_LT:
+      range.high = limit.high - 1 < range.high ? limit.high - 1 : range.high;
+      break;
+    case IR_LE:
+      range.high = limit.high < range.high ? limit.high : range.high;
+      break;
+    case IR_GT:
+      range.low = limit.low + 1 > range.low ? limit.low + 1 : range.low;
+      break;
+    case IR_GE:
+      range.low = limit.low > range.low ? limit.low : range.low;
+      break;
+    case IR_EQ:
+      range.low = limit.low > range.low ? limit.low : range.low;
+      range.high = limit.high < range.high ? limit.high : range.high;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return range;
+}
+
+//! Values 'operand' may hold when 'block' runs
+static range_t value_range(const bounds_t *bounds, ir_operand_t operand,
+                           int block, int depth) {
+  if (operand.kind == IR_OPD_CONST)
+    return (range_t){operand.value, operand.value};
+
+  const ir_instr_t *instr = definition(bounds, operand);
+  if (!instr || depth <= 0)
+    return full_range();
+
+  range_t range = definition_range(bounds, instr, block, depth);
+  return constrain(bounds, operand.value, range, block, depth);
+}
+
+// ----------------------- Hoisting ----------------------
+
+//! Plans the range check replacing a check of the loop around 'block', on
+//! an induction variable stepping by one plus a constant. Returns 0 when
+//! the check may not run at every iteration or may not see every value
+static int plan_hoist(const bounds_t *bounds, int block,
+                      const ir_instr_t *check, hoisted_t *hoisted) {
+  ir_function_t *function = bounds->function;
+  int l = bounds->loops->block_loop[block];
+  if (l < 0)
+    return 0;
+  const ir_loop_t *loop = &bounds->loops->loops[l];
+  if (loop->preheader < 0 || block == loop->header)
+    return 0;
+
+  // index = variable + offset
+  ir_operand_t variable = check->a;
+  long long offset = 0;
+  const ir_instr_t *instr = definition(bounds, variable);
+  if (instr && (instr->op == IR_ADD || instr->op == IR_SUB)) {
+    if (instr->a.kind == IR_OPD_TEMP && instr->b.kind == IR_OPD_CONST) {
+      variable = instr->a;
+      offset = instr->op == IR_ADD ? instr->b.value
+                                   : -(long long)instr->b.value;
+    } else if (instr->op == IR_ADD && instr->a.kind == IR_OPD_CONST &&
+               instr->b.kind == IR_OPD_TEMP) {
+      variable = instr->b;
+      offset = instr->a.value;
+    }
+    instr = definition(bounds, variable);
+  }
+  if (!instr || instr->op != IR_PHI ||
+      bounds->def_block[variable.value] != loop->header)
+    return 0;
+
+  // The wrapped around indexes must stay outside the array
+  long long size = check->b.value;
+  if (offset > INT_MAX - size || -offset > INT_MAX - size)
+    return 0;
+
+  int step = induction_step(bounds, loop, instr, &hoisted->init);
+  int body;
+  ir_opcode_t test = header_test(bounds, l, variable.value, &hoisted->bound,
+                                 &body);
+  if (!((step == 1 && (test == IR_LT || test == IR_LE)) ||
+        (step == -1 && (test == IR_GT || test == IR_GE))))
+    return 0;
+
+  const ir_instr_t *bound = definition(bounds, hoisted->bound);
+  if (hoisted->bound.kind != IR_OPD_CONST &&
+      (!bound || ir_loop_contains(bounds->loops, l,
+                                  bounds->def_block[hoisted->bound.value])))
+    return 0;
+
+  // Every iteration runs the check, and only the header leaves the loop
+  for (int t = 0; t < loop->latch_count; t++)
+    if (!ir_dominates(bounds->dominance, block, loop->latches[t]))
+      return 0;
+  for (int b = 0; b < loop->block_count; b++) {
+    const ir_block_t *member = &function->blocks[loop->blocks[b]];
+    if (loop->blocks[b] == loop->header)
+      continue;
+    for (int s = 0; s < member->succ_count; s++)
+      if (!ir_loop_contains(bounds->loops, l, member->succs[s]))
+        return 0;
+  }
+
+  hoisted->preheader = loop->preheader;
+  hoisted->test = test;
+  hoisted->low = -offset;
+  hoisted->high = size - 1 - offset;
+  return 1;
+}
+
+//! Computes 'a op b' before the terminator of a block, folding constants
+static ir_operand_t emit_before_end(ir_function_t *function, int block,
+                                    ir_opcode_t op, ir_operand_t a,
+                                    ir_operand_t b) {
+  int result;
+  if (a.kind == IR_OPD_CONST && b.kind == IR_OPD_CONST &&
+      ir_fold(op, a.value, b.value, &result))
+    return ir_const(result);
+  if (op == IR_ADD && a.kind == IR_OPD_CONST && a.value == 0)
+    return b;
+  if (op == IR_ADD && b.kind == IR_OPD_CONST && b.value == 0)
+    return a;
+  if (op == IR_MUL && ((a.kind == IR_OPD_CONST && a.value == 0) ||
+                       (b.kind == IR_OPD_CONST && b.value == 0)))
+    return ir_const(0);
+
+  ir_operand_t dst = ir_temp(ir_new_temp(function, IR_TYPE_I32, NULL));
+  ir_insert(function, block, function->blocks[block].count - 1, op, dst, a,
+            b);
+  return dst;
+}
+
+//! Nonzero when the loop runs and one of its values is outside [low, high]:
+//! they go from the first value to the bound, excluded by a strict test
+static ir_operand_t emit_range_check(ir_function_t *function,
+                                     const hoisted_t *hoisted) {
+  int block = hoisted->preheader;
+  int up = hoisted->test == IR_LT || hoisted->test == IR_LE;
+  int strict = hoisted->test == IR_LT || hoisted->test == IR_GT;
+  ir_operand_t first = hoisted->init, last = hoisted->bound;
+
+  ir_operand_t runs =
+      emit_before_end(function, block, hoisted->test, first, last);
+  ir_operand_t below, above;
+  if (up) {
+    below = emit_before_end(function, block, IR_LT, first,
+                            ir_const((int)hoisted->low));
+    above = emit_before_end(function, block, IR_GT, last,
+                            ir_const((int)(hoisted->high + strict)));
+  } else {
+    below = emit_before_end(function, block, IR_LT, last,
+                            ir_const((int)(hoisted->low - strict)));
+    above = emit_before_end(function, block, IR_GT, first,
+                            ir_const((int)hoisted->high));
+  }
+  ir_operand_t outside = emit_before_end(function, block, IR_ADD, below,
+                                         above);
+  return emit_before_end(function, block, IR_MUL, runs, outside);
+}
+
+static int same_hoist(const hoisted_t *a, const hoisted_t *b) {
+  return a->preheader == b->preheader && a->test == b->test &&
+         a->init.kind == b->init.kind && a->init.value == b->init.value &&
+         a->bound.kind == b->bound.kind && a->bound.value == b->bound.value &&
+         a->low == b->low && a->high == b->high;
+}
+
+// ----------------------- Versioning ----------------------
+
+//! Whether the block, maybe added since the loops were found, is in one
+static int in_loop(const bounds_t *bounds, int l, int block) {
+  return block < bounds->loops->block_count &&
+         ir_loop_contains(bounds->loops, l, block);
+}
+
+//! Block the header leaves the loop to, -1 unless there is exactly one
+static int loop_exit(const bounds_t *bounds, int l) {
+  const ir_block_t *header =
+      &bounds->function->blocks[bounds->loops->loops[l].header];
+  int exit = -1;
+  for (int s = 0; s < header->succ_count; s++)
+    if (!in_loop(bounds, l, header->succs[s])) {
+      if (exit >= 0)
+        return -1;
+      exit = header->succs[s];
+    }
+  return exit;
+}
+
+//! Whether the temporary, defined by the header, is used out of the loop
+static int is_live_out(const bounds_t *bounds, int l, int temp) {
+  const ir_function_t *function = bounds->function;
+  for (int b = 0; b < function->block_count; b++) {
+    if (in_loop(bounds, l, b))
+      continue;
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        const ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP && use->value == temp)
+          return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+//! Only the header leaves the loop, so only its values reach the rest of
+//! the function. They get phis in the exit, which must then have no other
+//! predecessor
+static int can_version(const bounds_t *bounds, int l) {
+  const ir_loop_t *loop = &bounds->loops->loops[l];
+  const ir_block_t *header = &bounds->function->blocks[loop->header];
+  int exit = loop_exit(bounds, l);
+  if (exit < 0)
+    return 0;
+  if (bounds->function->blocks[exit].pred_count == 1)
+    return 1;
+
+  for (int i = 0; i < header->count; i++)
+    if (header->instrs[i].dst.kind == IR_OPD_TEMP &&
+        is_live_out(bounds, l, header->instrs[i].dst.value))
+      return 0;
+  return 1;
+}
+
+static ir_operand_t remapped(ir_operand_t operand, const int *blocks,
+                             const int *temps) {
+  if (operand.kind == IR_OPD_BLOCK && blocks[operand.value] >= 0)
+    return ir_block(blocks[operand.value]);
+  if (operand.kind == IR_OPD_TEMP && temps[operand.value] >= 0)
+    return ir_temp(temps[operand.value]);
+  return operand;
+}
+
+//! Copies the blocks of the loop with their checks, the copy of the header
+//! still entered from the preheader. Fills the blocks and the temporaries
+//! of the copy, -1 for the ones outside the loop
+static void copy_loop(const bounds_t *bounds, int l, int *blocks,
+                      int *temps) {
+  ir_function_t *function = bounds->function;
+  const ir_loop_t *loop = &bounds->loops->loops[l];
+
+  for (int b = 0; b < loop->block_count; b++)
+    blocks[loop->blocks[b]] = ir_new_block(function);
+  for (int b = 0; b < loop->block_count; b++) {
+    const ir_block_t *block = &function->blocks[loop->blocks[b]];
+    for (int i = 0; i < block->count; i++) {
+      int dst = block->instrs[i].dst.value;
+      if (block->instrs[i].dst.kind == IR_OPD_TEMP)
+        temps[dst] = ir_new_temp(function, function->temp_types[dst],
+                                 function->temp_names[dst]);
+    }
+  }
+
+  for (int b = 0; b < loop->block_count; b++) {
+    int source = loop->blocks[b];
+    for (int i = 0; i < function->blocks[source].count; i++) {
+      ir_instr_t instr = function->blocks[source].instrs[i];
+      if (instr.op == IR_NOP)
+        continue;
+
+      ir_instr_t *copy = ir_emit(function, blocks[source], instr.op,
+                                 remapped(instr.dst, blocks, temps),
+                                 remapped(instr.a, blocks, temps),
+                                 remapped(instr.b, blocks, temps));
+      ir_set_args(copy, instr.args, instr.arg_count);
+      for (int a = 0; a < copy->arg_count; a++)
+        copy->args[a] = remapped(copy->args[a], blocks, temps);
+    }
+  }
+}
+
+static void retarget_phis(ir_function_t *function, int block, int from,
+                          int to) {
+  ir_block_t *target = &function->blocks[block];
+  for (int i = 0; i < target->count; i++) {
+    ir_instr_t *phi = &target->instrs[i];
+    if (phi->op != IR_PHI)
+      continue;
+    for (int a = 0; a < phi->arg_count; a += 2)
+      if (phi->args[a].value == from)
+        phi->args[a] = ir_block(to);
+  }
+}
+
+//! The loop runs without the checks its preheader replaced when their
+//! range check passes, and as a copy keeping every check when it fails,
+//! so a faulty loop still runs up to its faulty iteration. The values of
+//! the header leaving the loop are merged from both versions in the exit
+static void version_loop(bounds_t *bounds, int l, ir_operand_t fails) {
+  ir_function_t *function = bounds->function;
+  const ir_loop_t *loop = &bounds->loops->loops[l];
+  int header = loop->header, preheader = loop->preheader;
+  int exit = loop_exit(bounds, l);
+  int block_count = function->block_count;
+  int temp_count = function->temp_count;
+
+  int *blocks = (int *)bounds_alloc(block_count, sizeof(int));
+  int *temps = (int *)bounds_alloc(temp_count, sizeof(int));
+  for (int b = 0; b < block_count; b++)
+    blocks[b] = -1;
+  for (int t = 0; t < temp_count; t++)
+    temps[t] = -1;
+  copy_loop(bounds, l, blocks, temps);
+  int copy = blocks[header];
+
+  // The preheader branches to a new preheader of each version
+  int fast = ir_new_block(function), slow = ir_new_block(function);
+  ir_emit(function, fast, IR_JMP, ir_none(), ir_block(header), ir_none());
+  ir_emit(function, slow, IR_JMP, ir_none(), ir_block(copy), ir_none());
+  ir_remove_instr(ir_terminator(&function->blocks[preheader]));
+  ir_operand_t targets[2] = {ir_block(slow), ir_block(fast)};
+  ir_instr_t *branch = ir_emit(function, preheader, IR_BR, ir_none(), fails,
+                               ir_none());
+  ir_set_args(branch, targets, 2);
+  retarget_phis(function, header, preheader, fast);
+  retarget_phis(function, copy, preheader, slow);
+
+  // The phis of the exit get the values of the copy
+  ir_block_t *target = &function->blocks[exit];
+  int phi_count = 0;
+  for (int i = 0; i < target->count; i++) {
+    ir_instr_t *phi = &target->instrs[i];
+    if (phi->op != IR_PHI)
+      continue;
+    phi_count = i + 1;
+    ir_operand_t *source = ir_phi_source(phi, header);
+    if (!source)
+      continue;
+    ir_operand_t *sources = (ir_operand_t *)bounds_alloc(
+        phi->arg_count + 2, sizeof(ir_operand_t));
+    for (int a = 0; a < phi->arg_count; a++)
+      sources[a] = phi->args[a];
+    sources[phi->arg_count] = ir_block(copy);
+    sources[phi->arg_count + 1] = remapped(*source, blocks, temps);
+    ir_set_args(phi, sources, phi->arg_count + 2);
+    free(sources);
+  }
+
+  // And the other values of the header leaving the loop get new phis, which
+  // their uses after it read
+  int *merged = (int *)bounds_alloc(temp_count, sizeof(int));
+  for (int t = 0; t < temp_count; t++)
+    merged[t] = -1;
+  for (int i = 0; i < function->blocks[header].count; i++) {
+    ir_instr_t *instr = &function->blocks[header].instrs[i];
+    if (instr->dst.kind != IR_OPD_TEMP ||
+        !is_live_out(bounds, l, instr->dst.value))
+      continue;
+
+    int temp = instr->dst.value;
+    merged[temp] = ir_new_temp(function, function->temp_types[temp],
+                               function->temp_names[temp]);
+    ir_operand_t sources[4] = {ir_block(header), ir_temp(temp),
+                               ir_block(copy), ir_temp(temps[temp])};
+    ir_instr_t *phi = ir_insert(function, exit, phi_count++, IR_PHI,
+                                ir_temp(merged[temp]), ir_none(), ir_none());
+    ir_set_args(phi, sources, 4);
+  }
+
+  for (int b = 0; b < block_count; b++) {
+    if (in_loop(bounds, l, b))
+      continue;
+    for (int i = b == exit ? phi_count : 0; i < function->blocks[b].count;
+         i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP && use->value < temp_count &&
+            merged[use->value] >= 0)
+          *use = ir_temp(merged[use->value]);
+      }
+    }
+  }
+
+  free(merged);
+  free(blocks);
+  free(temps);
+}
+
+// ----------------------- Pass ----------------------
+
+//! Whether a check kept earlier on the same index and a smaller array runs
+//! before this one on every path
+static int is_repeated(const bounds_t *bounds, const ir_instr_t *check,
+                       int block, const int *kept, int kept_count) {
+  for (int k = 0; k < kept_count; k++) {
+    const ir_instr_t *earlier =
+        &bounds->function->blocks[kept[2 * k]].instrs[kept[2 * k + 1]];
+    if (earlier->a.kind == check->a.kind &&
+        earlier->a.value == check->a.value &&
+        earlier->b.value <= check->b.value &&
+        ir_dominates(bounds->dominance, kept[2 * k], block))
+      return 1;
+  }
+  return 0;
+}
+
+//! Replaces the checks planned for the loop by their range checks, on a
+//! copy of the loop keeping them, unless that copy has nothing to do
+static void hoist_loop(bounds_t *bounds, int l, const hoisted_t *plans,
+                       const int *moved, int count,
+                       ir_bounds_stats_t *stats) {
+  ir_function_t *function = bounds->function;
+  ir_operand_t fails = ir_const(0);
+  int range_checks = 0;
+
+  for (int m = 0; m < count; m++) {
+    int known = 0;
+    for (int p = 0; p < m && !known; p++)
+      known = same_hoist(&plans[p], &plans[m]);
+    if (known)
+      continue;
+    fails = emit_before_end(function, bounds->loops->loops[l].preheader,
+                            IR_ADD, fails,
+                            emit_range_check(function, &plans[m]));
+    range_checks++;
+  }
+
+  // A loop known to fail keeps its checks, and one known to pass loses them
+  if (fails.kind == IR_OPD_CONST && fails.value != 0)
+    return;
+  if (fails.kind != IR_OPD_CONST)
+    version_loop(bounds, l, fails);
+  for (int m = 0; m < count; m++)
+    ir_remove_instr(&function->blocks[moved[2 * m]].instrs[moved[2 * m + 1]]);
+  stats->hoisted += count;
+  stats->range_checks += range_checks;
+}
+
+void ir_bounds_function(ir_function_t *function, ir_bounds_stats_t *stats) {
+  int checks = 0;
+
+  if (function->is_builtin || !function->block_count)
+    return;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      checks += function->blocks[b].instrs[i].op == IR_CHECK;
+  if (!checks)
+    return;
+  stats->checks += checks;
+
+  bounds_t bounds = {.function = function, .temp_count = function->temp_count};
+  bounds.dominance = ir_dominance_compute(function);
+  bounds.loops = ir_loops_find(function, bounds.dominance);
+  bounds.def_block = (int *)bounds_alloc(function->temp_count, sizeof(int));
+  bounds.def_index = (int *)bounds_alloc(function->temp_count, sizeof(int));
+  for (int t = 0; t < function->temp_count; t++)
+    bounds.def_block[t] = -1;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      const ir_instr_t *instr = &function->blocks[b].instrs[i];
+      if (instr->dst.kind == IR_OPD_TEMP) {
+        bounds.def_block[instr->dst.value] = b;
+        bounds.def_index[instr->dst.value] = i;
+      }
+    }
+
+  int *kept = (int *)bounds_alloc(2 * checks, sizeof(int)); // (block, index)
+  int *moved = (int *)bounds_alloc(2 * checks, sizeof(int));
+  hoisted_t *plans = (hoisted_t *)bounds_alloc(checks, sizeof(hoisted_t));
+  int *loops = (int *)bounds_alloc(checks, sizeof(int)); // Of the plans
+  int kept_count = 0, moved_count = 0;
+
+  // Dominators first, so the earlier checks are known
+  for (int r = 0; r < bounds.dominance->rpo_count; r++) {
+    int b = bounds.dominance->rpo[r];
+
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *check = &function->blocks[b].instrs[i];
+      if (check->op != IR_CHECK)
+        continue;
+
+      range_t range = value_range(&bounds, check->a, b, BOUNDS_DEPTH);
+      if ((range.low >= 0 && range.high < check->b.value) ||
+          is_repeated(&bounds, check, b, kept, kept_count)) {
+        ir_remove_instr(check);
+        stats->removed++;
+        continue;
+      }
+
+      // Left in place until the loop is copied
+      if (plan_hoist(&bounds, b, check, &plans[moved_count])) {
+        loops[moved_count] = bounds.loops->block_loop[b];
+        moved[2 * moved_count] = b;
+        moved[2 * moved_count + 1] = i;
+        moved_count++;
+        continue;
+      }
+
+      kept[2 * kept_count] = b;
+      kept[2 * kept_count + 1] = i;
+      kept_count++;
+    }
+  }
+
+  // The checks of a loop holding another one with planned checks stay,
+  // the copies of the loops would nest
+  hoisted_t *group = (hoisted_t *)bounds_alloc(checks, sizeof(hoisted_t));
+  int *positions = (int *)bounds_alloc(2 * checks, sizeof(int));
+  for (int m = 0; m < moved_count; m++) {
+    int l = loops[m], nests = 0, seen = 0, count = 0;
+    for (int o = 0; o < moved_count; o++) {
+      seen |= o < m && loops[o] == l;
+      nests |= loops[o] != l &&
+               ir_loop_contains(bounds.loops, l,
+                                bounds.loops->loops[loops[o]].header);
+    }
+    if (seen || nests || !can_version(&bounds, l))
+      continue;
+
+    for (int o = m; o < moved_count; o++)
+      if (loops[o] == l) {
+        group[count] = plans[o];
+        positions[2 * count] = moved[2 * o];
+        positions[2 * count + 1] = moved[2 * o + 1];
+        count++;
+      }
+    hoist_loop(&bounds, l, group, positions, count, stats);
+  }
+
+  free(group);
+  free(positions);
+  free(kept);
+  free(moved);
+  free(plans);
+  free(loops);
+  free(bounds.def_block);
+  free(bounds.def_index);
+  ir_loops_destroy(bounds.loops);
+  ir_dominance_destroy(bounds.dominance);
+  ir_compact_function(function, NULL);
+}
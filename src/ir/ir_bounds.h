@@ -0,0 +1,30 @@
+#ifndef IR_BOUNDS_H
+#define IR_BOUNDS_H
+
+#include "ir.h"
+
+typedef struct {
+  long checks;       // Found by the pass, as the lowering and inliner left them
+  long removed;      // Proven within their array, or repeating a dominator
+  long hoisted;      // Replaced by a range check before their loop
+  long range_checks; // Added to the preheaders
+} ir_bounds_stats_t;
+
+//! Range analysis of the array indexes of the safe mode, over a function in
+//! SSA form whose loops have their preheaders.
+//!
+//! The range of an index follows its definitions: constants, arithmetic
+//! with constants, the induction variables of the loops, and the branches
+//! on comparisons that dominate the check. A check whose index always lies
+//! within the array is removed, as is one repeating a dominating check.
+//!
+//! A check left in a loop, on an induction variable stepping by one plus a
+//! constant, runs at every iteration when its block dominates the latches
+//! and the loop only exits from its header. It then becomes a single range
+//! check in the preheader, over the values the loop gives the variable.
+//! When it fails, a copy of the loop keeping every check runs instead and
+//! stops at the faulty iteration. A loop holding another one with such
+//! checks keeps its own, so the copies never nest
+void ir_bounds_function(ir_function_t *function, ir_bounds_stats_t *stats);
+
+#endif // !IR_BOUNDS_H
@@ -0,0 +1,176 @@
+#include "ir_callgraph.h"
+
+#include <stdlib.h>
+
+static void *callgraph_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the call graph.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+//! Adds the callees of every function, each once, in the order of their
+//! first call
+static void add_edges(ir_callgraph_t *graph, const ir_module_t *module) {
+  int functions = module->function_count;
+  int *seen = (int *)callgraph_alloc(functions, sizeof(int));
+  int capacity = 16, count = 0;
+
+  graph->callees = (int *)callgraph_alloc(capacity, sizeof(int));
+  for (int f = 0; f < functions; f++)
+    seen[f] = -1;
+
+  for (int f = 0; f < functions; f++) {
+    const ir_function_t *function = &module->functions[f];
+    graph->callee_start[f] = count;
+
+    for (int b = 0; b < function->block_count; b++)
+      for (int i = 0; i < function->blocks[b].count; i++) {
+        const ir_instr_t *instr = &function->blocks[b].instrs[i];
+        if (instr->op != IR_CALL ||
+            module->functions[instr->a.value].is_builtin)
+          continue;
+
+        int callee = instr->a.value;
+        graph->call_sites[callee]++;
+        if (seen[callee] == f)
+          continue;
+        seen[callee] = f;
+
+        if (count == capacity) {
+          capacity *= 2;
+          int *grown = (int *)realloc(graph->callees, capacity * sizeof(int));
+          if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for the call "
+                            "graph.\n");
+            exit(EXIT_FAILURE);
+          }
+          graph->callees = grown;
+        }
+        graph->callees[count++] = callee;
+      }
+  }
+  graph->callee_start[functions] = count;
+
+  free(seen);
+}
+
+//! Tarjan's algorithm with an explicit stack, the call chains of a program
+//! may be as deep as its number of functions
+static void find_sccs(ir_callgraph_t *graph, const ir_module_t *module) {
+  int functions = graph->function_count;
+  int *index = (int *)callgraph_alloc(functions, sizeof(int));
+  int *low = (int *)callgraph_alloc(functions, sizeof(int));
+  char *on_stack = (char *)callgraph_alloc(functions, sizeof(char));
+  int *stack = (int *)callgraph_alloc(functions, sizeof(int));
+  int *visit = (int *)callgraph_alloc(functions, sizeof(int)); // Functions
+  int *edge = (int *)callgraph_alloc(functions, sizeof(int));  // Next callee
+  int next_index = 0, stack_count = 0;
+
+  for (int f = 0; f < functions; f++)
+    index[f] = -1;
+
+  for (int root = 0; root < functions; root++) {
+    if (module->functions[root].is_builtin || index[root] >= 0)
+      continue;
+
+    int depth = 0;
+    visit[0] = root;
+    edge[0] = graph->callee_start[root];
+    index[root] = low[root] = next_index++;
+    stack[stack_count++] = root;
+    on_stack[root] = 1;
+
+    while (depth >= 0) {
+      int v = visit[depth];
+
+      if (edge[depth] < graph->callee_start[v + 1]) {
+        int w = graph->callees[edge[depth]++];
+
+        if (index[w] < 0) {
+          index[w] = low[w] = next_index++;
+          stack[stack_count++] = w;
+          on_stack[w] = 1;
+          visit[++depth] = w;
+          edge[depth] = graph->callee_start[w];
+        } else if (on_stack[w] && index[w] < low[v]) {
+          low[v] = index[w];
+        }
+        continue;
+      }
+
+      // Every callee done, v may close its component
+      if (low[v] == index[v]) {
+        int size = 0, w;
+        do {
+          w = stack[--stack_count];
+          on_stack[w] = 0;
+          graph->scc[w] = graph->scc_count;
+          graph->order[graph->order_count++] = w;
+          size++;
+        } while (w != v);
+
+        for (int s = 0; s < size; s++)
+          graph->recursive[graph->order[graph->order_count - 1 - s]] =
+              size > 1;
+        graph->scc_count++;
+      }
+
+      if (--depth >= 0 && low[v] < low[visit[depth]])
+        low[visit[depth]] = low[v];
+    }
+  }
+
+  // A single function is recursive when it calls itself
+  for (int f = 0; f < functions; f++)
+    for (int c = graph->callee_start[f]; c < graph->callee_start[f + 1]; c++)
+      if (graph->callees[c] == f)
+        graph->recursive[f] = 1;
+
+  free(index);
+  free(low);
+  free(on_stack);
+  free(stack);
+  free(visit);
+  free(edge);
+}
+
+ir_callgraph_t *ir_callgraph_build(const ir_module_t *module) {
+  ir_callgraph_t *graph =
+      (ir_callgraph_t *)callgraph_alloc(1, sizeof(ir_callgraph_t));
+  int functions = module->function_count;
+
+  graph->function_count = functions;
+  graph->callee_start = (int *)callgraph_alloc(functions + 1, sizeof(int));
+  graph->call_sites = (int *)callgraph_alloc(functions, sizeof(int));
+  graph->scc = (int *)callgraph_alloc(functions, sizeof(int));
+  graph->recursive = (char *)callgraph_alloc(functions, sizeof(char));
+  graph->order = (int *)callgraph_alloc(functions, sizeof(int));
+
+  for (int f = 0; f < functions; f++)
+    graph->scc[f] = -1;
+
+  add_edges(graph, module);
+  find_sccs(graph, module);
+
+  return graph;
+}
+
+void ir_callgraph_destroy(ir_callgraph_t *graph) {
+  if (!graph)
+    return;
+  free(graph->callees);
+  free(graph->callee_start);
+  free(graph->call_sites);
+  free(graph->scc);
+  free(graph->recursive);
+  free(graph->order);
+  free(graph);
+}
+
+int ir_callgraph_same_scc(const ir_callgraph_t *graph, int caller,
+                          int callee) {
+  return graph->scc[caller] == graph->scc[callee];
+}
@@ -0,0 +1,37 @@
+#ifndef IR_CALLGRAPH_H
+#define IR_CALLGRAPH_H
+
+#include "ir.h"
+
+//! Call graph of a module, every array is indexed by function. Each call
+//! of the IR is an activation of the source, so the edges are those of the
+//! AST. Callees of f are callees[callee_start[f]..callee_start[f + 1]),
+//! without repetition nor builtins
+typedef struct {
+  int function_count;
+
+  int *callees;
+  int *callee_start;
+  int *call_sites; // Calls reaching each function, over the whole module
+
+  int *scc;       // Strongly connected component of each function
+  int scc_count;
+  char *recursive; // In a cycle: a component of several or a self call
+
+  int *order; // Bottom-up: the callees before their callers, except inside
+              // a cycle. Builtins are left out
+  int order_count;
+} ir_callgraph_t;
+
+//! Builds the graph and finds its components with Tarjan's algorithm, which
+//! completes the callees first and so gives the bottom-up order
+ir_callgraph_t *ir_callgraph_build(const ir_module_t *module);
+
+void ir_callgraph_destroy(ir_callgraph_t *graph);
+
+//! Whether a call from 'caller' to 'callee' may recurse, in which case
+//! inlining it would never end
+int ir_callgraph_same_scc(const ir_callgraph_t *graph, int caller,
+                          int callee);
+
+#endif // !IR_CALLGRAPH_H
@@ -0,0 +1,484 @@
+#include "ir_dce.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void *dce_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the dead code "
+                    "elimination.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *dce_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the dead code "
+                    "elimination.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static long count_instructions(const ir_function_t *function) {
+  long count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      count += function->blocks[b].instrs[i].op != IR_NOP;
+  return count;
+}
+
+// ----------------------- Local Arrays ----------------------
+
+//! Finds the local arrays whose stores are dead: their address (or one
+//! computed from it) is only used to load, store or compute other addresses,
+//! and nothing loads from them
+static char *find_dead_slots(const ir_function_t *function,
+                             const int *def_block, const int *def_index) {
+  int temps = function->temp_count;
+  int *slot_of = (int *)dce_alloc(temps, sizeof(int));
+  char *read = (char *)dce_alloc(function->frame_count, sizeof(char));
+  char *dead = (char *)dce_alloc(function->frame_count, sizeof(char));
+
+  // Follows the chain of ptradds back to the addr giving each pointer
+  for (int t = 0; t < temps; t++) {
+    int current = t;
+    slot_of[t] = -1;
+
+    while (current >= 0 && def_block[current] >= 0) {
+      const ir_instr_t *def =
+          &function->blocks[def_block[current]].instrs[def_index[current]];
+
+      if (def->op == IR_ADDR && def->a.kind == IR_OPD_FRAME) {
+        slot_of[t] = def->a.value;
+        break;
+      }
+      if (def->op != IR_PTRADD || def->a.kind != IR_OPD_TEMP)
+        break;
+      current = def->a.value;
+      if (current < t) { // Already resolved
+        slot_of[t] = slot_of[current];
+        break;
+      }
+    }
+  }
+
+  for (int s = 0; s < function->frame_count; s++)
+    dead[s] = 1;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind != IR_OPD_TEMP || slot_of[use->value] < 0)
+          continue;
+
+        int slot = slot_of[use->value];
+        if (instr->op == IR_LOAD)
+          read[slot] = 1;
+        else if (u != 0 || (instr->op != IR_STORE && instr->op != IR_PTRADD))
+          dead[slot] = 0; // Escapes
+      }
+    }
+
+  for (int s = 0; s < function->frame_count; s++)
+    dead[s] = dead[s] && !read[s];
+
+  free(slot_of);
+  free(read);
+
+  return dead;
+}
+
+//! Whether a store writes to one of the dead arrays
+static int stores_to_dead_slot(const ir_function_t *function,
+                               const ir_instr_t *store, const char *dead_slots,
+                               const int *def_block, const int *def_index) {
+  ir_operand_t pointer = store->a;
+
+  while (pointer.kind == IR_OPD_TEMP && def_block[pointer.value] >= 0) {
+    int t = pointer.value;
+    const ir_instr_t *def = &function->blocks[def_block[t]].instrs[def_index[t]];
+
+    if (def->op == IR_ADDR)
+      return def->a.kind == IR_OPD_FRAME && dead_slots[def->a.value];
+    if (def->op != IR_PTRADD)
+      return 0;
+    pointer = def->a;
+  }
+
+  return 0;
+}
+
+//! Drops the local arrays no instruction refers to, renumbering the others
+static void compact_frame(ir_function_t *function, ir_dce_stats_t *stats) {
+  int *remap = (int *)dce_alloc(function->frame_count, sizeof(int));
+  int kept = 0;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      if (function->blocks[b].instrs[i].a.kind == IR_OPD_FRAME)
+        remap[function->blocks[b].instrs[i].a.value] = 1;
+
+  for (int s = 0; s < function->frame_count; s++) {
+    if (!remap[s]) {
+      free(function->frame[s].name);
+      remap[s] = -1;
+      continue;
+    }
+    remap[s] = kept;
+    function->frame[kept++] = function->frame[s];
+  }
+
+  stats->slots_removed += function->frame_count - kept;
+  function->frame_count = kept;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_operand_t *operand = &function->blocks[b].instrs[i].a;
+      if (operand->kind == IR_OPD_FRAME)
+        operand->value = remap[operand->value];
+    }
+
+  free(remap);
+}
+
+// ----------------------- Mark and Sweep ----------------------
+
+void ir_dce_function(ir_function_t *function, ir_dce_stats_t *stats) {
+  int temps = function->temp_count;
+
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  long instructions = count_instructions(function);
+
+  // Position of the single definition of each temporary, and a flat index
+  // of every instruction for the marks
+  int *def_block = (int *)dce_alloc(temps, sizeof(int));
+  int *def_index = (int *)dce_alloc(temps, sizeof(int));
+  int *base = (int *)dce_alloc(function->block_count + 1, sizeof(int));
+
+  for (int t = 0; t < temps; t++)
+    def_block[t] = -1;
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+    base[b + 1] = base[b] + block->count;
+
+    for (int i = 0; i < block->count; i++)
+      if (block->instrs[i].dst.kind == IR_OPD_TEMP) {
+        def_block[block->instrs[i].dst.value] = b;
+        def_index[block->instrs[i].dst.value] = i;
+      }
+  }
+
+  char *dead_slots = find_dead_slots(function, def_block, def_index);
+  int total = base[function->block_count];
+  char *live = (char *)dce_alloc(total, sizeof(char));
+  int *work_block = (int *)dce_alloc(total, sizeof(int)); // Marked, with
+  int *work = (int *)dce_alloc(total, sizeof(int));       // uses to visit
+  int top = 0;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+
+      if (!ir_instr_has_side_effects(instr))
+        continue;
+      if (instr->op == IR_STORE &&
+          stores_to_dead_slot(function, instr, dead_slots, def_block,
+                              def_index)) {
+        stats->stores_removed++;
+        continue;
+      }
+
+      live[base[b] + i] = 1;
+      work_block[top] = b;
+      work[top++] = i;
+    }
+
+  while (top) {
+    top--;
+    ir_instr_t *instr = &function->blocks[work_block[top]].instrs[work[top]];
+
+    for (int u = 0; u < ir_use_count(instr); u++) {
+      ir_operand_t *use = ir_use(instr, u);
+      if (use->kind != IR_OPD_TEMP || def_block[use->value] < 0)
+        continue;
+
+      int b = def_block[use->value], i = def_index[use->value];
+      if (live[base[b] + i])
+        continue;
+
+      live[base[b] + i] = 1;
+      work_block[top] = b;
+      work[top++] = i;
+    }
+  }
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      if (!live[base[b] + i] && function->blocks[b].instrs[i].op != IR_NOP)
+        ir_remove_instr(&function->blocks[b].instrs[i]);
+
+  free(def_block);
+  free(def_index);
+  free(base);
+  free(dead_slots);
+  free(live);
+  free(work);
+  free(work_block);
+
+  ir_compact_function(function, NULL);
+  compact_frame(function, stats);
+
+  stats->instructions_removed += instructions - count_instructions(function);
+}
+
+// ----------------------- CFG Cleanup ----------------------
+
+static int has_phis(const ir_block_t *block) {
+  for (int i = 0; i < block->count; i++) {
+    if (block->instrs[i].op == IR_PHI)
+      return 1;
+    if (block->instrs[i].op != IR_NOP)
+      return 0;
+  }
+  return 0;
+}
+
+//! Makes 'pred' the predecessor of 'block' in place of 'old', in the
+//! predecessor list and in the phis
+static void replace_pred(ir_block_t *block, int old, int pred) {
+  for (int p = 0; p < block->pred_count; p++)
+    if (block->preds[p] == old)
+      block->preds[p] = pred;
+
+  for (int i = 0; i < block->count; i++) {
+    ir_instr_t *phi = &block->instrs[i];
+    if (phi->op != IR_PHI)
+      continue;
+    for (int a = 0; a < phi->arg_count; a += 2)
+      if (phi->args[a].value == old)
+        phi->args[a].value = pred;
+  }
+}
+
+static void remove_pred(ir_block_t *block, int pred) {
+  int index = ir_pred_index(block, pred);
+  if (index < 0)
+    return;
+  memmove(&block->preds[index], &block->preds[index + 1],
+          (block->pred_count - index - 1) * sizeof(int));
+  block->pred_count--;
+}
+
+static void append_pred(ir_block_t *block, int pred) {
+  if (ir_pred_index(block, pred) >= 0)
+    return;
+  if (block->pred_count == block->pred_capacity) {
+    block->pred_capacity = block->pred_capacity ? block->pred_capacity * 2 : 4;
+    block->preds =
+        (int *)dce_realloc(block->preds, block->pred_capacity * sizeof(int));
+  }
+  block->preds[block->pred_count++] = pred;
+}
+
+static void append_instr(ir_block_t *block, const ir_instr_t *instr) {
+  if (block->count == block->capacity) {
+    block->capacity = block->capacity ? block->capacity * 2 : 8;
+    block->instrs = (ir_instr_t *)dce_realloc(
+        block->instrs, block->capacity * sizeof(ir_instr_t));
+  }
+  block->instrs[block->count++] = *instr;
+}
+
+//! Empties a block that no longer takes part in the CFG
+static void clear_block(ir_block_t *block) {
+  for (int i = 0; i < block->count; i++)
+    free(block->instrs[i].args);
+  block->count = 0;
+  block->pred_count = 0;
+  block->succ_count = 0;
+}
+
+//! Whether the block holds nothing but a jump
+static int only_jumps(ir_block_t *block) {
+  ir_instr_t *terminator = ir_terminator(block);
+  if (!terminator || terminator->op != IR_JMP)
+    return 0;
+  for (int i = 0; i < block->count; i++)
+    if (block->instrs[i].op != IR_NOP && &block->instrs[i] != terminator)
+      return 0;
+  return 1;
+}
+
+//! Moves the instructions of 'next', whose only predecessor is 'block', to
+//! the end of 'block'. Its phis have a single source and become copies
+static void merge_blocks(ir_function_t *function, int block, int next) {
+  ir_block_t *first = &function->blocks[block];
+  ir_block_t *second = &function->blocks[next];
+
+  ir_remove_instr(ir_terminator(first));
+
+  for (int i = 0; i < second->count; i++) {
+    ir_instr_t *instr = &second->instrs[i];
+    if (instr->op == IR_NOP)
+      continue;
+
+    if (instr->op == IR_PHI) {
+      ir_operand_t source = instr->args[1];
+      ir_set_args(instr, NULL, 0);
+      instr->op = IR_MOV;
+      instr->a = source;
+    }
+    append_instr(first, instr);
+    instr->args = NULL; // Owned by the first block now
+  }
+
+  first->succ_count = second->succ_count;
+  for (int s = 0; s < second->succ_count; s++) {
+    first->succs[s] = second->succs[s];
+    replace_pred(&function->blocks[second->succs[s]], next, block);
+  }
+
+  clear_block(second);
+}
+
+//! Sends the predecessors of a block holding only 'jmp target' straight to
+//! the target. Returns 0 if the phis of the target do not allow it
+static int bypass_block(ir_function_t *function, int block, int target) {
+  ir_block_t *empty = &function->blocks[block];
+  ir_block_t *next = &function->blocks[target];
+  int phis = has_phis(next);
+
+  if (phis && (empty->pred_count != 1 ||
+               ir_pred_index(next, empty->preds[0]) >= 0))
+    return 0;
+
+  for (int p = 0; p < empty->pred_count; p++) {
+    int pred = empty->preds[p];
+    ir_block_t *from = &function->blocks[pred];
+    ir_instr_t *terminator = ir_terminator(from);
+
+    if (terminator->op == IR_JMP) {
+      terminator->a.value = target;
+    } else {
+      for (int t = 0; t < 2; t++)
+        if (terminator->args[t].value == block)
+          terminator->args[t].value = target;
+      if (terminator->args[0].value == terminator->args[1].value) {
+        ir_set_args(terminator, NULL, 0);
+        terminator->op = IR_JMP;
+        terminator->a = ir_block(target);
+      }
+    }
+
+    int count = 0;
+    for (int s = 0; s < from->succ_count; s++) {
+      int succ = from->succs[s] == block ? target : from->succs[s];
+      if (count == 0 || from->succs[0] != succ)
+        from->succs[count++] = succ;
+    }
+    from->succ_count = count;
+
+    if (phis)
+      replace_pred(next, block, pred);
+    else
+      append_pred(next, pred);
+  }
+
+  remove_pred(next, block);
+  clear_block(empty);
+
+  return 1;
+}
+
+//! Marks the blocks that cannot be reached from the entry
+static char *unreachable_blocks(const ir_function_t *function) {
+  int count = function->block_count;
+  char *dead = (char *)dce_alloc(count, sizeof(char));
+  int *stack = (int *)dce_alloc(count, sizeof(int));
+  int top = 0;
+
+  for (int b = 0; b < count; b++)
+    dead[b] = 1;
+
+  dead[0] = 0;
+  stack[top++] = 0;
+  while (top) {
+    const ir_block_t *block = &function->blocks[stack[--top]];
+    for (int s = 0; s < block->succ_count; s++)
+      if (dead[block->succs[s]]) {
+        dead[block->succs[s]] = 0;
+        stack[top++] = block->succs[s];
+      }
+  }
+
+  free(stack);
+  return dead;
+}
+
+void ir_clean_cfg(ir_function_t *function, ir_dce_stats_t *stats) {
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  int blocks = function->block_count;
+  char *dead = unreachable_blocks(function);
+  ir_compact_function(function, dead);
+  free(dead);
+
+  dead = (char *)dce_alloc(function->block_count, sizeof(char));
+
+  int changed = 1;
+  while (changed) {
+    changed = 0;
+
+    for (int b = 0; b < function->block_count; b++) {
+      if (dead[b])
+        continue;
+
+      ir_instr_t *terminator = ir_terminator(&function->blocks[b]);
+
+      if (terminator->op == IR_BR &&
+          terminator->args[0].value == terminator->args[1].value) {
+        int target = terminator->args[0].value;
+        ir_set_args(terminator, NULL, 0);
+        terminator->op = IR_JMP;
+        terminator->a = ir_block(target);
+        changed = 1;
+      }
+
+      // Straight-line chains collapse into their first block
+      while ((terminator = ir_terminator(&function->blocks[b]))->op ==
+             IR_JMP) {
+        int next = terminator->a.value;
+        if (next == b || next == 0 ||
+            function->blocks[next].pred_count != 1)
+          break;
+        merge_blocks(function, b, next);
+        dead[next] = 1;
+        changed = 1;
+      }
+
+      terminator = ir_terminator(&function->blocks[b]);
+      if (b != 0 && terminator->op == IR_JMP &&
+          terminator->a.value != b && only_jumps(&function->blocks[b]) &&
+          bypass_block(function, b, terminator->a.value)) {
+        dead[b] = 1;
+        changed = 1;
+      }
+    }
+  }
+
+  ir_compact_function(function, dead);
+  free(dead);
+
+  stats->blocks_removed += blocks - function->block_count;
+}
@@ -0,0 +1,25 @@
+#ifndef IR_DCE_H
+#define IR_DCE_H
+
+#include "ir.h"
+
+typedef struct {
+  long instructions_removed;
+  long stores_removed; // Stores to local arrays that are never read
+  long blocks_removed; // Unreachable, merged into their predecessor or empty
+  long slots_removed;  // Local arrays no longer referenced
+} ir_dce_stats_t;
+
+//! Dead code elimination over a function in SSA form. Marks the
+//! instructions with effects (calls, branches, returns and stores to memory
+//! that may be read) and everything they use, then sweeps the rest. Stores
+//! to a local array whose address never escapes and that is never loaded
+//! are dead too
+void ir_dce_function(ir_function_t *function, ir_dce_stats_t *stats);
+
+//! Simplifies the CFG: drops unreachable blocks, turns branches with a
+//! single target into jumps, merges a block into its only predecessor when
+//! that one jumps to it and bypasses blocks holding only a jump
+void ir_clean_cfg(ir_function_t *function, ir_dce_stats_t *stats);
+
+#endif // !IR_DCE_H
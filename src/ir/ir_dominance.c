@@ -0,0 +1,267 @@
+#include "ir_dominance.h"
+
+#include <stdlib.h>
+
+static void *dominance_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the dominators.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+//! Reverse postorder of the blocks reachable from the entry, with an explicit
+//! stack so deep CFGs do not overflow the native one
+static void compute_rpo(const ir_function_t *function,
+                        ir_dominance_t *dominance) {
+  int count = function->block_count;
+  int *stack = (int *)dominance_alloc(count, sizeof(int));
+  int *next_succ = (int *)dominance_alloc(count, sizeof(int));
+  int *postorder = (int *)dominance_alloc(count, sizeof(int));
+  int top = 0, visited = 0;
+
+  for (int b = 0; b < count; b++)
+    dominance->rpo_index[b] = -1;
+
+  if (count) {
+    stack[top++] = 0;
+    dominance->rpo_index[0] = 0; // Marks as seen, numbered below
+  }
+
+  while (top) {
+    int block = stack[top - 1];
+    const ir_block_t *current = &function->blocks[block];
+
+    if (next_succ[block] < current->succ_count) {
+      int succ = current->succs[next_succ[block]++];
+      if (dominance->rpo_index[succ] < 0) {
+        dominance->rpo_index[succ] = 0;
+        stack[top++] = succ;
+      }
+      continue;
+    }
+
+    postorder[visited++] = block;
+    top--;
+  }
+
+  dominance->rpo_count = visited;
+  for (int i = 0; i < visited; i++) {
+    dominance->rpo[i] = postorder[visited - 1 - i];
+    dominance->rpo_index[dominance->rpo[i]] = i;
+  }
+
+  free(stack);
+  free(next_succ);
+  free(postorder);
+}
+
+//! Walks up from both blocks until they meet, comparing rpo positions
+static int intersect(const int *idom, const int *rpo_index, int a, int b) {
+  while (a != b) {
+    while (rpo_index[a] > rpo_index[b])
+      a = idom[a];
+    while (rpo_index[b] > rpo_index[a])
+      b = idom[b];
+  }
+  return a;
+}
+
+//! Builds the children lists and numbers the tree in preorder
+static void build_tree(ir_dominance_t *dominance) {
+  int count = dominance->block_count;
+  int *fill = (int *)dominance_alloc(count + 1, sizeof(int));
+  int *stack = (int *)dominance_alloc(count, sizeof(int));
+  int *next_child = (int *)dominance_alloc(count, sizeof(int));
+
+  for (int i = 1; i < dominance->rpo_count; i++)
+    dominance->child_start[dominance->idom[dominance->rpo[i]] + 1]++;
+  for (int b = 0; b < count; b++)
+    dominance->child_start[b + 1] += dominance->child_start[b];
+
+  for (int b = 0; b <= count; b++)
+    fill[b] = dominance->child_start[b];
+  for (int i = 1; i < dominance->rpo_count; i++) {
+    int block = dominance->rpo[i];
+    dominance->children[fill[dominance->idom[block]]++] = block;
+  }
+
+  int top = 0, clock = 0;
+  if (dominance->rpo_count) {
+    stack[top++] = 0;
+    dominance->tree_in[0] = clock++;
+    dominance->depth[0] = 0;
+  }
+
+  while (top) {
+    int block = stack[top - 1];
+    int child = dominance->child_start[block] + next_child[block];
+
+    if (child < dominance->child_start[block + 1]) {
+      int next = dominance->children[child];
+      next_child[block]++;
+      dominance->tree_in[next] = clock++;
+      dominance->depth[next] = dominance->depth[block] + 1;
+      stack[top++] = next;
+      continue;
+    }
+
+    dominance->tree_out[block] = clock++;
+    top--;
+  }
+
+  free(fill);
+  free(stack);
+  free(next_child);
+}
+
+ir_dominance_t *ir_dominance_compute(const ir_function_t *function) {
+  ir_dominance_t *dominance =
+      (ir_dominance_t *)dominance_alloc(1, sizeof(ir_dominance_t));
+  int count = function->block_count;
+
+  dominance->block_count = count;
+  dominance->rpo = (int *)dominance_alloc(count, sizeof(int));
+  dominance->rpo_index = (int *)dominance_alloc(count, sizeof(int));
+  dominance->idom = (int *)dominance_alloc(count, sizeof(int));
+  dominance->children = (int *)dominance_alloc(count, sizeof(int));
+  dominance->child_start = (int *)dominance_alloc(count + 1, sizeof(int));
+  dominance->depth = (int *)dominance_alloc(count, sizeof(int));
+  dominance->tree_in = (int *)dominance_alloc(count, sizeof(int));
+  dominance->tree_out = (int *)dominance_alloc(count, sizeof(int));
+
+  compute_rpo(function, dominance);
+
+  int *idom = dominance->idom;
+  for (int b = 0; b < count; b++)
+    idom[b] = -1;
+  if (!dominance->rpo_count)
+    return dominance;
+
+  // The entry stands as its own dominator while iterating
+  idom[0] = 0;
+
+  int changed = 1;
+  while (changed) {
+    changed = 0;
+
+    for (int i = 1; i < dominance->rpo_count; i++) {
+      int block = dominance->rpo[i];
+      const ir_block_t *current = &function->blocks[block];
+      int new_idom = -1;
+
+      for (int p = 0; p < current->pred_count; p++) {
+        int pred = current->preds[p];
+        if (idom[pred] < 0)
+          continue; // Not processed yet, or unreachable
+        new_idom = new_idom < 0 ? pred
+                                : intersect(idom, dominance->rpo_index, pred,
+                                            new_idom);
+      }
+
+      if (idom[block] != new_idom) {
+        idom[block] = new_idom;
+        changed = 1;
+      }
+    }
+  }
+
+  idom[0] = -1;
+  build_tree(dominance);
+
+  return dominance;
+}
+
+void ir_dominance_destroy(ir_dominance_t *dominance) {
+  if (!dominance)
+    return;
+
+  free(dominance->rpo);
+  free(dominance->rpo_index);
+  free(dominance->idom);
+  free(dominance->children);
+  free(dominance->child_start);
+  free(dominance->depth);
+  free(dominance->tree_in);
+  free(dominance->tree_out);
+  free(dominance);
+}
+
+int ir_dominates(const ir_dominance_t *dominance, int a, int b) {
+  if (dominance->rpo_index[a] < 0 || dominance->rpo_index[b] < 0)
+    return 0;
+  return dominance->tree_in[a] <= dominance->tree_in[b] &&
+         dominance->tree_out[b] <= dominance->tree_out[a];
+}
+
+// ----------------------- Dominance Frontiers ----------------------
+
+//! Walks from every predecessor of a join block up to its immediate
+//! dominator; 'mark' keeps a block from being added twice for the same join.
+//! With 'frontiers' NULL it only counts
+static void walk_frontiers(const ir_function_t *function,
+                           const ir_dominance_t *dominance, int *mark,
+                           int *fill, int *frontier) {
+  for (int b = 0; b < function->block_count; b++)
+    mark[b] = -1;
+
+  for (int i = 0; i < dominance->rpo_count; i++) {
+    int block = dominance->rpo[i];
+    const ir_block_t *current = &function->blocks[block];
+
+    if (current->pred_count < 2)
+      continue;
+
+    for (int p = 0; p < current->pred_count; p++) {
+      int runner = current->preds[p];
+      if (dominance->rpo_index[runner] < 0)
+        continue;
+
+      while (runner != dominance->idom[block] && mark[runner] != block) {
+        mark[runner] = block;
+        if (frontier)
+          frontier[fill[runner]] = block;
+        fill[runner]++;
+        runner = dominance->idom[runner];
+        if (runner < 0)
+          break;
+      }
+    }
+  }
+}
+
+ir_frontiers_t *ir_frontiers_compute(const ir_function_t *function,
+                                     const ir_dominance_t *dominance) {
+  int count = function->block_count;
+  ir_frontiers_t *frontiers =
+      (ir_frontiers_t *)dominance_alloc(1, sizeof(ir_frontiers_t));
+  int *mark = (int *)dominance_alloc(count, sizeof(int));
+  int *fill = (int *)dominance_alloc(count + 1, sizeof(int));
+
+  frontiers->start = (int *)dominance_alloc(count + 1, sizeof(int));
+
+  walk_frontiers(function, dominance, mark, fill, NULL);
+  for (int b = 0; b < count; b++)
+    frontiers->start[b + 1] = frontiers->start[b] + fill[b];
+
+  frontiers->frontier =
+      (int *)dominance_alloc(frontiers->start[count], sizeof(int));
+  for (int b = 0; b < count; b++)
+    fill[b] = frontiers->start[b];
+  walk_frontiers(function, dominance, mark, fill, frontiers->frontier);
+
+  free(mark);
+  free(fill);
+
+  return frontiers;
+}
+
+void ir_frontiers_destroy(ir_frontiers_t *frontiers) {
+  if (!frontiers)
+    return;
+
+  free(frontiers->frontier);
+  free(frontiers->start);
+  free(frontiers);
+}
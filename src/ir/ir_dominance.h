@@ -0,0 +1,44 @@
+#ifndef IR_DOMINANCE_H
+#define IR_DOMINANCE_H
+
+#include "ir.h"
+
+//! Dominator tree of a function, every array is indexed by block
+typedef struct {
+  int block_count;
+
+  int *rpo;       // Reachable blocks in reverse postorder, rpo[0] is the entry
+  int rpo_count;
+  int *rpo_index; // Position of a block in rpo, -1 if unreachable
+
+  int *idom;        // Immediate dominator, -1 for the entry and unreachable
+  int *children;    // Children of b are children[child_start[b]..
+  int *child_start; // child_start[b + 1]), in reverse postorder
+  int *depth;       // Depth in the dominator tree, the entry is 0
+
+  int *tree_in; // Preorder interval of the subtree, for O(1) queries
+  int *tree_out;
+} ir_dominance_t;
+
+//! Dominance frontiers, DF(b) is frontier[start[b]..start[b + 1])
+typedef struct {
+  int *frontier;
+  int *start;
+} ir_frontiers_t;
+
+//! Computes the dominators with the iterative algorithm of Cooper, Harvey and
+//! Kennedy over the reverse postorder. Needs an up to date CFG
+ir_dominance_t *ir_dominance_compute(const ir_function_t *function);
+
+void ir_dominance_destroy(ir_dominance_t *dominance);
+
+//! Whether 'a' dominates 'b' (every block dominates itself)
+int ir_dominates(const ir_dominance_t *dominance, int a, int b);
+
+//! Computes the dominance frontier of every reachable block
+ir_frontiers_t *ir_frontiers_compute(const ir_function_t *function,
+                                     const ir_dominance_t *dominance);
+
+void ir_frontiers_destroy(ir_frontiers_t *frontiers);
+
+#endif // !IR_DOMINANCE_H
@@ -0,0 +1,391 @@
+#include "ir_gvn.h"
+#include "ir_dominance.h"
+
+#include <stdlib.h>
+
+//! Expression of the scoped table. Entries are pushed on a stack and popped
+//! when the walk leaves the block that added them, so each bucket is a
+//! linked list whose head is always the most recent entry
+typedef struct {
+  ir_opcode_t op;
+  ir_operand_t a;
+  ir_operand_t b;
+  int version;        // Memory version for loads, 0 otherwise
+  ir_operand_t value; // Operand holding the result
+  int bucket;
+  int next;           // Next entry of the bucket, -1 at the end
+} gvn_entry_t;
+
+typedef struct {
+  ir_function_t *function;
+  ir_gvn_stats_t *stats;
+  ir_operand_t *leaders; // Value of a removed temporary, NONE if kept
+
+  int *buckets;
+  int bucket_mask;
+  gvn_entry_t *entries;
+  int entry_count;
+  int entry_capacity;
+
+  int versions;     // Last memory version handed out
+  int *end_version; // Memory version at the end of each block
+} gvn_t;
+
+static void *gvn_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the value "
+                    "numbering.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static int same_operand(ir_operand_t a, ir_operand_t b) {
+  return a.kind == b.kind && a.value == b.value;
+}
+
+//! Follows the leaders of removed temporaries
+static ir_operand_t resolve(const gvn_t *gvn, ir_operand_t operand) {
+  while (operand.kind == IR_OPD_TEMP &&
+         gvn->leaders[operand.value].kind != IR_OPD_NONE)
+    operand = gvn->leaders[operand.value];
+  return operand;
+}
+
+// ----------------------- Scoped Table ----------------------
+
+static unsigned int hash_key(ir_opcode_t op, ir_operand_t a, ir_operand_t b,
+                             int version) {
+  unsigned int hash = (unsigned int)op * 0x9E3779B1u;
+  hash = (hash ^ (unsigned int)a.kind) * 0x85EBCA77u;
+  hash = (hash ^ (unsigned int)a.value) * 0xC2B2AE3Du;
+  hash = (hash ^ (unsigned int)b.kind) * 0x27D4EB2Fu;
+  hash = (hash ^ (unsigned int)b.value) * 0x165667B1u;
+  hash = (hash ^ (unsigned int)version) * 0x9E3779B1u;
+  return hash ^ (hash >> 15);
+}
+
+static const ir_operand_t *lookup(const gvn_t *gvn, ir_opcode_t op,
+                                  ir_operand_t a, ir_operand_t b,
+                                  int version) {
+  int bucket = hash_key(op, a, b, version) & gvn->bucket_mask;
+
+  for (int e = gvn->buckets[bucket]; e >= 0; e = gvn->entries[e].next) {
+    const gvn_entry_t *entry = &gvn->entries[e];
+    if (entry->op == op && entry->version == version &&
+        same_operand(entry->a, a) && same_operand(entry->b, b))
+      return &entry->value;
+  }
+  return NULL;
+}
+
+static void insert(gvn_t *gvn, ir_opcode_t op, ir_operand_t a, ir_operand_t b,
+                   int version, ir_operand_t value) {
+  if (gvn->entry_count == gvn->entry_capacity) {
+    gvn->entry_capacity = gvn->entry_capacity ? gvn->entry_capacity * 2 : 256;
+    gvn->entries = (gvn_entry_t *)realloc(
+        gvn->entries, gvn->entry_capacity * sizeof(gvn_entry_t));
+    if (!gvn->entries) {
+      fprintf(stderr, "Error: Memory allocation failed for the value "
+                      "numbering.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  int bucket = hash_key(op, a, b, version) & gvn->bucket_mask;
+  gvn->entries[gvn->entry_count] = (gvn_entry_t){
+      .op = op,
+      .a = a,
+      .b = b,
+      .version = version,
+      .value = value,
+      .bucket = bucket,
+      .next = gvn->buckets[bucket],
+  };
+  gvn->buckets[bucket] = gvn->entry_count++;
+}
+
+//! Drops the entries added after 'mark'
+static void pop_scope(gvn_t *gvn, int mark) {
+  while (gvn->entry_count > mark) {
+    gvn_entry_t *entry = &gvn->entries[--gvn->entry_count];
+    gvn->buckets[entry->bucket] = entry->next;
+  }
+}
+
+// ----------------------- Value Numbering ----------------------
+
+//! Algebraic identities, NONE if the expression does not simplify
+static ir_operand_t simplify(const ir_instr_t *instr) {
+  ir_operand_t a = instr->a, b = instr->b;
+  int a_const = a.kind == IR_OPD_CONST, b_const = b.kind == IR_OPD_CONST;
+  int result;
+
+  if (a_const && b_const && ir_fold(instr->op, a.value, b.value, &result))
+    return ir_const(result);
+
+  switch (instr->op) {
+  case IR_ADD:
+    if (b_const && b.value == 0)
+      return a;
+    if (a_const && a.value == 0)
+      return b;
+    break;
+  case IR_SUB:
+    if (b_const && b.value == 0)
+      return a;
+    if (same_operand(a, b))
+      return ir_const(0);
+    break;
+  case IR_MUL:
+    if ((a_const && a.value == 0) || (b_const && b.value == 0))
+      return ir_const(0);
+    if (b_const && b.value == 1)
+      return a;
+    if (a_const && a.value == 1)
+      return b;
+    break;
+  case IR_DIV:
+    if (b_const && b.value == 1)
+      return a;
+    break;
+  case IR_PTRADD:
+    if (b_const && b.value == 0)
+      return a;
+    break;
+  case IR_LT:
+  case IR_GT:
+  case IR_NE:
+    if (same_operand(a, b))
+      return ir_const(0);
+    break;
+  case IR_LE:
+  case IR_GE:
+  case IR_EQ:
+    if (same_operand(a, b))
+      return ir_const(1);
+    break;
+  default:
+    break;
+  }
+
+  return ir_none();
+}
+
+static int is_pure(ir_opcode_t op) {
+  switch (op) {
+  case IR_ADD:
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_SHL:
+  case IR_SHR:
+  case IR_SAR:
+  case IR_MULHI:
+  case IR_LT:
+  case IR_LE:
+  case IR_GT:
+  case IR_GE:
+  case IR_EQ:
+  case IR_NE:
+  case IR_ADDR:
+  case IR_PTRADD:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+//! Orders the operands of commutative opcodes, constants last
+static void canonicalize(ir_instr_t *instr) {
+  if (!ir_is_commutative(instr->op))
+    return;
+
+  ir_operand_t a = instr->a, b = instr->b;
+  if (a.kind > b.kind || (a.kind == b.kind && a.value > b.value)) {
+    instr->a = b;
+    instr->b = a;
+  }
+}
+
+//! Replaces the result of an instruction by 'value' and removes it
+static void replace(gvn_t *gvn, ir_instr_t *instr, ir_operand_t value,
+                    long *counter) {
+  gvn->leaders[instr->dst.value] = value;
+  ir_remove_instr(instr);
+  (*counter)++;
+}
+
+//! A phi whose sources are all the same value (or the phi itself)
+static void visit_phi(gvn_t *gvn, ir_instr_t *phi) {
+  ir_operand_t value = ir_none();
+
+  for (int p = 1; p < phi->arg_count; p += 2) {
+    ir_operand_t source = resolve(gvn, phi->args[p]);
+    phi->args[p] = source;
+
+    if (same_operand(source, phi->dst) || same_operand(source, value))
+      continue;
+    if (value.kind != IR_OPD_NONE)
+      return;
+    value = source;
+  }
+
+  if (value.kind != IR_OPD_NONE)
+    replace(gvn, phi, value, &gvn->stats->copies);
+}
+
+static void visit_instr(gvn_t *gvn, ir_instr_t *instr, int *version) {
+  if (instr->op == IR_PHI) {
+    visit_phi(gvn, instr);
+    return;
+  }
+
+  for (int u = 0; u < ir_use_count(instr); u++) {
+    ir_operand_t *use = ir_use(instr, u);
+    if (use->kind == IR_OPD_TEMP)
+      *use = resolve(gvn, *use);
+  }
+
+  switch (instr->op) {
+  case IR_MOV:
+    replace(gvn, instr, instr->a, &gvn->stats->copies);
+    return;
+  case IR_STORE:
+    *version = ++gvn->versions;
+    insert(gvn, IR_LOAD, instr->a, ir_none(), *version, instr->b);
+    return;
+  case IR_CALL:
+  case IR_VADD:
+  case IR_VSUB:
+    *version = ++gvn->versions;
+    return;
+  case IR_LOAD: {
+    const ir_operand_t *known =
+        lookup(gvn, IR_LOAD, instr->a, ir_none(), *version);
+    if (known)
+      replace(gvn, instr, *known, &gvn->stats->loads);
+    else
+      insert(gvn, IR_LOAD, instr->a, ir_none(), *version, instr->dst);
+    return;
+  }
+  default:
+    break;
+  }
+
+  if (!is_pure(instr->op))
+    return;
+
+  ir_operand_t simple = simplify(instr);
+  if (simple.kind != IR_OPD_NONE) {
+    replace(gvn, instr, simple, &gvn->stats->simplified);
+    return;
+  }
+
+  canonicalize(instr);
+  const ir_operand_t *known = lookup(gvn, instr->op, instr->a, instr->b, 0);
+  if (known)
+    replace(gvn, instr, *known, &gvn->stats->redundant);
+  else
+    insert(gvn, instr->op, instr->a, instr->b, 0, instr->dst);
+}
+
+//! Walks the dominator tree with an explicit stack of (block, mark) pairs,
+//! the mark being -1 when entering and the table size when leaving
+static void walk(gvn_t *gvn, const ir_dominance_t *dominance) {
+  ir_function_t *function = gvn->function;
+  int *stack = (int *)gvn_alloc(2 * function->block_count, sizeof(int));
+  int top = 0;
+
+  if (dominance->rpo_count) {
+    stack[top++] = 0;
+    stack[top++] = -1;
+  }
+
+  while (top) {
+    int mark = stack[--top];
+    int b = stack[--top];
+
+    if (mark >= 0) {
+      pop_scope(gvn, mark);
+      continue;
+    }
+
+    ir_block_t *block = &function->blocks[b];
+    int idom = dominance->idom[b];
+    int version;
+
+    // Memory is unchanged only when coming straight from the dominator
+    if (idom >= 0 && block->pred_count == 1 && block->preds[0] == idom)
+      version = gvn->end_version[idom];
+    else
+      version = ++gvn->versions;
+
+    stack[top++] = b;
+    stack[top++] = gvn->entry_count;
+
+    for (int i = 0; i < block->count; i++)
+      if (block->instrs[i].op != IR_NOP)
+        visit_instr(gvn, &block->instrs[i], &version);
+
+    gvn->end_version[b] = version;
+
+    for (int c = dominance->child_start[b + 1] - 1;
+         c >= dominance->child_start[b]; c--) {
+      stack[top++] = dominance->children[c];
+      stack[top++] = -1;
+    }
+  }
+
+  free(stack);
+}
+
+void ir_gvn_function(ir_function_t *function, ir_gvn_stats_t *stats) {
+  gvn_t gvn = {.function = function, .stats = stats};
+  long instructions = 0;
+
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      instructions += function->blocks[b].instrs[i].op != IR_NOP;
+
+  int buckets = 64;
+  while (buckets < 2 * instructions)
+    buckets *= 2;
+
+  gvn.leaders = (ir_operand_t *)gvn_alloc(function->temp_count,
+                                          sizeof(ir_operand_t));
+  gvn.buckets = (int *)gvn_alloc(buckets, sizeof(int));
+  gvn.bucket_mask = buckets - 1;
+  gvn.end_version = (int *)gvn_alloc(function->block_count, sizeof(int));
+  for (int i = 0; i < buckets; i++)
+    gvn.buckets[i] = -1;
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  walk(&gvn, dominance);
+  ir_dominance_destroy(dominance);
+
+  // Phi sources on back edges were visited before their definitions
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP)
+          *use = resolve(&gvn, *use);
+      }
+    }
+
+  ir_compact_function(function, NULL);
+  for (int b = 0; b < function->block_count; b++)
+    instructions -= function->blocks[b].count;
+  stats->instructions_removed += instructions;
+
+  free(gvn.leaders);
+  free(gvn.buckets);
+  free(gvn.entries);
+  free(gvn.end_version);
+}
@@ -0,0 +1,23 @@
+#ifndef IR_GVN_H
+#define IR_GVN_H
+
+#include "ir.h"
+
+typedef struct {
+  long redundant;  // Expressions already computed by a dominator
+  long loads;      // Loads of a value already loaded or just stored
+  long copies;     // Copies and single-valued phis propagated
+  long simplified; // Algebraic identities such as x + 0 and x * 1
+  long instructions_removed;
+} ir_gvn_stats_t;
+
+//! Dominator-based global value numbering over a function in SSA form.
+//! Walks the dominator tree with a scoped hash table keyed on the opcode and
+//! the value numbers of the operands (ordered for commutative opcodes), so
+//! an expression computed by a dominator is reused. Loads also carry a
+//! memory version, bumped by every store and call and renewed at blocks
+//! reached from elsewhere than their immediate dominator; a store makes its
+//! value available to the next load of the same address
+void ir_gvn_function(ir_function_t *function, ir_gvn_stats_t *stats);
+
+#endif // !IR_GVN_H
@@ -0,0 +1,258 @@
+#include "ir_inline.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void *inline_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the inliner.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static int instruction_count(const ir_function_t *function) {
+  int count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      count += function->blocks[b].instrs[i].op != IR_NOP;
+  return count;
+}
+
+//! Operand of the callee as seen in the caller
+static ir_operand_t relocate(ir_operand_t operand, int temp_offset,
+                             int block_offset) {
+  if (operand.kind == IR_OPD_TEMP)
+    operand.value += temp_offset;
+  else if (operand.kind == IR_OPD_BLOCK)
+    operand.value += block_offset;
+  return operand;
+}
+
+//! Moves the instructions after 'position' to a new block, which takes the
+//! place of the block in the phis of its successors. Returns the new block
+static int split_after(ir_function_t *function, int block, int position) {
+  int rest = ir_new_block(function);
+  ir_block_t *from = &function->blocks[block];
+  ir_block_t *to = &function->blocks[rest];
+  int count = from->count - position - 1;
+
+  to->instrs = (ir_instr_t *)inline_alloc(count, sizeof(ir_instr_t));
+  memcpy(to->instrs, &from->instrs[position + 1], count * sizeof(ir_instr_t));
+  to->count = to->capacity = count;
+  from->count = position + 1;
+
+  ir_instr_t *terminator = ir_terminator(to);
+  int targets[2] = {-1, -1};
+  if (terminator && terminator->op == IR_JMP)
+    targets[0] = terminator->a.value;
+  else if (terminator && terminator->op == IR_BR) {
+    targets[0] = terminator->args[0].value;
+    targets[1] = terminator->args[1].value != targets[0]
+                     ? terminator->args[1].value
+                     : -1;
+  }
+
+  for (int t = 0; t < 2; t++) {
+    if (targets[t] < 0)
+      continue;
+    ir_block_t *successor = &function->blocks[targets[t]];
+    for (int i = 0; i < successor->count && successor->instrs[i].op == IR_PHI;
+         i++)
+      for (int a = 0; a < successor->instrs[i].arg_count; a += 2)
+        if (successor->instrs[i].args[a].value == block)
+          successor->instrs[i].args[a].value = rest;
+  }
+
+  return rest;
+}
+
+//! Replaces the call at 'position' of 'block' by the body of its callee.
+//! Returns the block holding what followed the call
+static int inline_call(ir_function_t *caller, int block, int position,
+                       const ir_function_t *callee, ir_inline_stats_t *stats) {
+  ir_instr_t call = caller->blocks[block].instrs[position];
+  int rest = split_after(caller, block, position);
+  int temp_offset = caller->temp_count;
+  int block_offset = caller->block_count;
+  int return_count = 0;
+  ir_operand_t *returns = (ir_operand_t *)inline_alloc(
+      2 * callee->block_count, sizeof(ir_operand_t)); // (block, value) pairs
+
+  caller->blocks[block].count--; // The call, whose args are freed below
+
+  for (int t = 0; t < callee->temp_count; t++)
+    ir_new_temp(caller, callee->temp_types[t], callee->temp_names[t]);
+  for (int b = 0; b < callee->block_count; b++)
+    ir_new_block(caller);
+
+  for (int b = 0; b < callee->block_count; b++) {
+    const ir_block_t *source = &callee->blocks[b];
+    int copy = block_offset + b;
+
+    for (int i = 0; i < source->count; i++) {
+      const ir_instr_t *instr = &source->instrs[i];
+      ir_operand_t dst = relocate(instr->dst, temp_offset, block_offset);
+      ir_operand_t a = relocate(instr->a, temp_offset, block_offset);
+      ir_operand_t b_operand = relocate(instr->b, temp_offset, block_offset);
+
+      if (instr->op == IR_NOP)
+        continue;
+      stats->instructions++;
+
+      if (instr->op == IR_PARAM) {
+        ir_emit(caller, copy, IR_MOV, dst,
+                instr->a.value < call.arg_count ? call.args[instr->a.value]
+                                                : ir_const(0),
+                ir_none());
+        continue;
+      }
+
+      if (instr->op == IR_RET) {
+        returns[2 * return_count] = ir_block(copy);
+        returns[2 * return_count + 1] = a;
+        return_count++;
+        ir_emit(caller, copy, IR_JMP, ir_none(), ir_block(rest), ir_none());
+        continue;
+      }
+
+      ir_instr_t *added = ir_emit(caller, copy, instr->op, dst, a, b_operand);
+      if (instr->arg_count) {
+        ir_set_args(added, instr->args, instr->arg_count);
+        for (int g = 0; g < added->arg_count; g++)
+          added->args[g] =
+              relocate(added->args[g], temp_offset, block_offset);
+      }
+    }
+  }
+
+  ir_emit(caller, block, IR_JMP, ir_none(), ir_block(block_offset), ir_none());
+
+  // The value of the call, unreachable when the callee never returns
+  if (call.dst.kind == IR_OPD_TEMP) {
+    if (return_count == 1)
+      ir_insert(caller, rest, 0, IR_MOV, call.dst, returns[1], ir_none());
+    else if (return_count == 0)
+      ir_insert(caller, rest, 0, IR_MOV, call.dst, ir_const(0), ir_none());
+    else
+      ir_set_args(ir_insert(caller, rest, 0, IR_PHI, call.dst, ir_none(),
+                            ir_none()),
+                  returns, 2 * return_count);
+  }
+
+  free(call.args);
+  free(returns);
+  stats->inlined++;
+
+  return rest;
+}
+
+//! Whether the call should be inlined, counting the ones kept
+static int should_inline(const ir_module_t *module, int caller,
+                         const ir_instr_t *call, const ir_callgraph_t *graph,
+                         int caller_size, ir_inline_stats_t *stats) {
+  const ir_function_t *callee = &module->functions[call->a.value];
+
+  if (callee->is_builtin)
+    return 0;
+  if (ir_callgraph_same_scc(graph, caller, call->a.value)) {
+    stats->recursive++;
+    return 0;
+  }
+  // Local arrays start cleared at every call, and a loop back to the entry
+  // would have phis without the value of the call
+  if (callee->frame_count || callee->blocks[0].pred_count)
+    return 0;
+
+  int size = instruction_count(callee);
+  int limit = graph->call_sites[call->a.value] == 1 ? IR_INLINE_ONCE_SIZE
+                                                    : IR_INLINE_SIZE;
+  if (size > limit || caller_size + size > IR_INLINE_GROWTH) {
+    stats->too_large++;
+    return 0;
+  }
+  return 1;
+}
+
+//! Puts the blocks in the order of the 'next' links from the entry, so the
+//! inlined code sits where the call was instead of after the caller. The
+//! linear scan then sees it between its neighbors
+static void reorder_blocks(ir_function_t *function, const int *next) {
+  int count = function->block_count;
+  int *remap = (int *)inline_alloc(count, sizeof(int));
+  ir_block_t *blocks = (ir_block_t *)inline_alloc(count, sizeof(ir_block_t));
+  int placed = 0;
+
+  for (int b = 0; b >= 0; b = next[b]) {
+    remap[b] = placed;
+    blocks[placed++] = function->blocks[b];
+  }
+
+  for (int b = 0; b < count; b++) {
+    ir_block_t *block = &blocks[b];
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+      if (instr->a.kind == IR_OPD_BLOCK)
+        instr->a.value = remap[instr->a.value];
+      for (int a = 0; a < instr->arg_count; a++)
+        if (instr->args[a].kind == IR_OPD_BLOCK)
+          instr->args[a].value = remap[instr->args[a].value];
+    }
+  }
+
+  memcpy(function->blocks, blocks, count * sizeof(ir_block_t));
+  free(blocks);
+  free(remap);
+}
+
+void ir_inline_function(ir_module_t *module, int caller,
+                        const ir_callgraph_t *graph,
+                        ir_inline_stats_t *stats) {
+  ir_function_t *function = &module->functions[caller];
+  int blocks = function->block_count;
+  int size = instruction_count(function);
+  int *next = NULL; // Block placed after each one, -1 for the last
+
+  for (int b = 0; b < blocks; b++) {
+    int current = b;
+
+    for (int i = 0; i < function->blocks[current].count; i++) {
+      ir_instr_t *instr = &function->blocks[current].instrs[i];
+      if (instr->op != IR_CALL ||
+          !should_inline(module, caller, instr, graph, size, stats))
+        continue;
+
+      if (!next) {
+        next = (int *)inline_alloc(blocks, sizeof(int));
+        for (int n = 0; n < blocks; n++)
+          next[n] = n + 1 < blocks ? n + 1 : -1;
+      }
+
+      const ir_function_t *callee = &module->functions[instr->a.value];
+      size += instruction_count(callee);
+      int rest = inline_call(function, current, i, callee, stats);
+
+      // The copies, then the rest, come after the block of the call
+      int *grown = (int *)realloc(next, function->block_count * sizeof(int));
+      if (!grown) {
+        fprintf(stderr, "Error: Memory allocation failed for the inliner.\n");
+        exit(EXIT_FAILURE);
+      }
+      next = grown;
+      next[rest] = next[current];
+      next[current] = rest + 1;
+      for (int n = rest + 1; n < function->block_count; n++)
+        next[n] = n + 1 < function->block_count ? n + 1 : rest;
+
+      current = rest;
+      i = -1;
+    }
+  }
+
+  if (next) {
+    reorder_blocks(function, next);
+    ir_compute_cfg(function);
+    free(next);
+  }
+}
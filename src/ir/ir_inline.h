@@ -0,0 +1,30 @@
+#ifndef IR_INLINE_H
+#define IR_INLINE_H
+
+#include "ir.h"
+#include "ir_callgraph.h"
+
+#define IR_INLINE_SIZE 40       // Largest callee inlined at any call
+#define IR_INLINE_ONCE_SIZE 400 // Largest callee inlined at its only call
+#define IR_INLINE_GROWTH 4000   // Size of the caller past which it stops
+
+typedef struct {
+  long inlined;      // Calls replaced by the body of their callee
+  long instructions; // Copied into the callers
+  long recursive;    // Calls kept because they may recurse
+  long too_large;    // Calls kept by the size limits
+} ir_inline_stats_t;
+
+//! Replaces the calls of a function in SSA form by copies of their callees,
+//! which should already have been optimized: run over the functions in the
+//! bottom-up order of the call graph, the constants and the loop invariants
+//! of the arguments reach the inlined code. The parameters become copies of
+//! the arguments and the returns jump to the rest of the caller, where a
+//! phi merges their values. Calls inside a cycle of the graph are kept, as
+//! are the callees with local arrays, which would need clearing at every
+//! call. Only the calls the function had before are considered, those of
+//! the inlined code were kept by the callee for a reason
+void ir_inline_function(ir_module_t *module, int caller,
+                        const ir_callgraph_t *graph, ir_inline_stats_t *stats);
+
+#endif // !IR_INLINE_H
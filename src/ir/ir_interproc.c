@@ -0,0 +1,144 @@
+#include "ir_interproc.h"
+
+#include <stdlib.h>
+
+static void *interproc_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the "
+                    "interprocedural analysis.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+// ----------------------- Dead Functions ----------------------
+
+void ir_remove_dead_functions(ir_module_t *module,
+                              ir_interproc_stats_t *stats) {
+  if (module->main_function < 0)
+    return;
+
+  ir_callgraph_t *graph = ir_callgraph_build(module);
+  int functions = module->function_count;
+  char *dead = (char *)interproc_alloc(functions, sizeof(char));
+  int *stack = (int *)interproc_alloc(functions, sizeof(int));
+  int count = 0;
+
+  for (int f = 0; f < functions; f++)
+    dead[f] = 1;
+  dead[module->main_function] = 0;
+  stack[count++] = module->main_function;
+
+  while (count) {
+    int f = stack[--count];
+    for (int c = graph->callee_start[f]; c < graph->callee_start[f + 1]; c++)
+      if (dead[graph->callees[c]]) {
+        dead[graph->callees[c]] = 0;
+        stack[count++] = graph->callees[c];
+      }
+  }
+
+  int removed = 0;
+  for (int f = 0; f < functions; f++)
+    removed += dead[f] && !module->functions[f].is_builtin;
+  if (removed) {
+    ir_remove_functions(module, dead);
+    stats->functions_removed += removed;
+  }
+
+  free(stack);
+  free(dead);
+  ir_callgraph_destroy(graph);
+}
+
+// ----------------------- Constant Arguments ----------------------
+
+//! What the calls pass to a parameter, from the top of the lattice
+typedef enum {
+  ARGUMENT_NONE,     // No call seen yet
+  ARGUMENT_CONSTANT, // The same constant at every call
+  ARGUMENT_VARYING,
+} argument_state_t;
+
+typedef struct {
+  argument_state_t state;
+  int value;
+} argument_t;
+
+//! Meets the arguments of the calls of a function into its callees
+static void meet_calls(const ir_module_t *module, const ir_function_t *caller,
+                       argument_t **arguments) {
+  for (int b = 0; b < caller->block_count; b++)
+    for (int i = 0; i < caller->blocks[b].count; i++) {
+      const ir_instr_t *instr = &caller->blocks[b].instrs[i];
+      if (instr->op != IR_CALL || module->functions[instr->a.value].is_builtin)
+        continue;
+
+      argument_t *callee = arguments[instr->a.value];
+      for (int p = 0; p < instr->arg_count; p++) {
+        ir_operand_t value = instr->args[p];
+        if (value.kind != IR_OPD_CONST)
+          callee[p].state = ARGUMENT_VARYING;
+        else if (callee[p].state == ARGUMENT_NONE)
+          callee[p] = (argument_t){ARGUMENT_CONSTANT, value.value};
+        else if (callee[p].state == ARGUMENT_CONSTANT &&
+                 callee[p].value != value.value)
+          callee[p].state = ARGUMENT_VARYING;
+      }
+    }
+}
+
+//! Turns the parameters given a single constant into copies of it. Returns
+//! their number
+static int specialize(ir_function_t *function, const argument_t *arguments) {
+  ir_block_t *entry = &function->blocks[0];
+  int count = 0;
+
+  for (int i = 0; i < entry->count; i++) {
+    ir_instr_t *instr = &entry->instrs[i];
+    if (instr->op != IR_PARAM ||
+        arguments[instr->a.value].state != ARGUMENT_CONSTANT)
+      continue;
+    instr->op = IR_MOV;
+    instr->a = ir_const(arguments[instr->a.value].value);
+    count++;
+  }
+  return count;
+}
+
+void ir_propagate_arguments(ir_module_t *module, const ir_callgraph_t *graph,
+                            ir_interproc_stats_t *stats,
+                            ir_sccp_stats_t *sccp) {
+  argument_t **arguments =
+      (argument_t **)interproc_alloc(module->function_count,
+                                     sizeof(argument_t *));
+  for (int f = 0; f < module->function_count; f++)
+    arguments[f] = (argument_t *)interproc_alloc(
+        module->functions[f].param_count, sizeof(argument_t));
+
+  for (int o = graph->order_count - 1; o >= 0; o--) {
+    int f = graph->order[o];
+    ir_function_t *function = &module->functions[f];
+
+    // Main is entered by the runtime, and a parameter no call reaches stays
+    int count = 0;
+    if (f != module->main_function && !graph->recursive[f] &&
+        !function->tail_recursive)
+      count = specialize(function, arguments[f]);
+    if (count) {
+      stats->specialized++;
+      stats->parameters += count;
+    }
+
+    // Folds the arguments of its calls, computed or copied from constants
+    if (count || graph->callee_start[f + 1] > graph->callee_start[f])
+      ir_sccp_function(function, sccp);
+
+    meet_calls(module, function, arguments);
+  }
+
+  for (int f = 0; f < module->function_count; f++)
+    free(arguments[f]);
+  free(arguments);
+}
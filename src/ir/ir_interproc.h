@@ -0,0 +1,30 @@
+#ifndef IR_INTERPROC_H
+#define IR_INTERPROC_H
+
+#include "ir.h"
+#include "ir_callgraph.h"
+#include "ir_sccp.h"
+
+typedef struct {
+  long functions_removed; // Never reached from main
+  long specialized;       // Functions with a constant parameter
+  long parameters;        // Given the same constant by every call
+} ir_interproc_stats_t;
+
+//! Drops the functions main never calls, directly or through other
+//! functions. Their declarations are only reached from dead code
+void ir_remove_dead_functions(ir_module_t *module,
+                              ir_interproc_stats_t *stats);
+
+//! Interprocedural constant propagation over a module in SSA form. Runs
+//! over the callers before their callees: each function gets the constants
+//! every one of its calls passes, which SCCP spreads to the arguments of
+//! the calls it makes in turn. A parameter becomes its constant in place,
+//! the signature does not change, so the code still serves any entry from
+//! the same calls. Recursive functions keep their parameters, part of their
+//! calls are seen only after them
+void ir_propagate_arguments(ir_module_t *module, const ir_callgraph_t *graph,
+                            ir_interproc_stats_t *stats,
+                            ir_sccp_stats_t *sccp);
+
+#endif // !IR_INTERPROC_H
@@ -0,0 +1,148 @@
+#include "ir_licm.h"
+#include "ir_dominance.h"
+#include "ir_loop.h"
+
+#include <stdlib.h>
+
+static void *licm_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the loop-invariant "
+                    "code motion.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+//! Instructions that can run in the preheader even if the loop body would
+//! not have: no effects and no trap
+static int can_hoist(const ir_instr_t *instr) {
+  switch (instr->op) {
+  case IR_ADD:
+  case IR_SUB:
+  case IR_MUL:
+  case IR_SHL:
+  case IR_SHR:
+  case IR_SAR:
+  case IR_MULHI:
+  case IR_LT:
+  case IR_LE:
+  case IR_GT:
+  case IR_GE:
+  case IR_EQ:
+  case IR_NE:
+  case IR_ADDR:
+  case IR_PTRADD:
+    return 1;
+  case IR_DIV:
+    return instr->b.kind == IR_OPD_CONST && instr->b.value != 0 &&
+           instr->b.value != -1;
+  default:
+    return 0;
+  }
+}
+
+//! (RPO index, block) pairs, so the blocks of a loop are visited with the
+//! definitions before their uses
+typedef struct {
+  int order;
+  int block;
+} licm_block_t;
+
+static int compare_order(const void *a, const void *b) {
+  return ((const licm_block_t *)a)->order - ((const licm_block_t *)b)->order;
+}
+
+static void hoist_loop(ir_function_t *function,
+                       const ir_dominance_t *dominance,
+                       const ir_loops_t *loops, int l, int *def_block,
+                       int *in_loop, ir_licm_stats_t *stats) {
+  const ir_loop_t *loop = &loops->loops[l];
+  int preheader = loop->preheader;
+  if (preheader < 0)
+    return;
+
+  licm_block_t *order = (licm_block_t *)licm_alloc(loop->block_count,
+                                                   sizeof(licm_block_t));
+  for (int b = 0; b < loop->block_count; b++) {
+    in_loop[loop->blocks[b]] = l;
+    order[b] = (licm_block_t){dominance->rpo_index[loop->blocks[b]],
+                              loop->blocks[b]};
+  }
+  qsort(order, loop->block_count, sizeof(licm_block_t), compare_order);
+
+  for (int o = 0; o < loop->block_count; o++) {
+    int b = order[o].block;
+
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      if (!can_hoist(instr))
+        continue;
+
+      int invariant = 1;
+      for (int u = 0; u < ir_use_count(instr) && invariant; u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        invariant = use->kind != IR_OPD_TEMP ||
+                    in_loop[def_block[use->value]] != l;
+      }
+      if (!invariant)
+        continue;
+
+      ir_instr_t moved = *instr;
+      ir_block_t *target = &function->blocks[preheader];
+      ir_insert(function, preheader, target->count - 1, moved.op, moved.dst,
+                moved.a, moved.b);
+      ir_remove_instr(&function->blocks[b].instrs[i]);
+
+      def_block[moved.dst.value] = preheader;
+      stats->hoisted++;
+    }
+  }
+
+  free(order);
+}
+
+void ir_licm_function(ir_function_t *function, ir_licm_stats_t *stats) {
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  ir_loops_t *loops = ir_loops_find(function, dominance);
+
+  if (!loops->loop_count) {
+    ir_loops_destroy(loops);
+    ir_dominance_destroy(dominance);
+    return;
+  }
+
+  int added = ir_loops_insert_preheaders(function, loops);
+  if (added) {
+    ir_loops_destroy(loops);
+    ir_dominance_destroy(dominance);
+    dominance = ir_dominance_compute(function);
+    loops = ir_loops_find(function, dominance);
+  }
+  stats->loops += loops->loop_count;
+  stats->preheaders += added;
+
+  int *def_block = (int *)licm_alloc(function->temp_count, sizeof(int));
+  int *in_loop = (int *)licm_alloc(function->block_count, sizeof(int));
+  for (int b = 0; b < function->block_count; b++) {
+    in_loop[b] = -1;
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      const ir_instr_t *instr = &function->blocks[b].instrs[i];
+      if (instr->dst.kind == IR_OPD_TEMP)
+        def_block[instr->dst.value] = b;
+    }
+  }
+
+  // Inner loops first, what they hoist may then leave the enclosing ones
+  for (int l = loops->loop_count - 1; l >= 0; l--)
+    hoist_loop(function, dominance, loops, l, def_block, in_loop, stats);
+
+  free(def_block);
+  free(in_loop);
+  ir_loops_destroy(loops);
+  ir_dominance_destroy(dominance);
+  ir_compact_function(function, NULL);
+}
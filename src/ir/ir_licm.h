@@ -0,0 +1,19 @@
+#ifndef IR_LICM_H
+#define IR_LICM_H
+
+#include "ir.h"
+
+typedef struct {
+  long loops;
+  long preheaders; // Added to loops entered from several edges or a branch
+  long hoisted;    // Instructions moved to a preheader
+} ir_licm_stats_t;
+
+//! Loop-invariant code motion over a function in SSA form. Gives every
+//! natural loop a preheader, then, from the innermost loops out, moves to it
+//! the pure instructions whose operands are all defined outside the loop:
+//! arithmetic, comparisons and array addresses. Divisions are only moved
+//! when their divisor is a constant that cannot trap, loads never are
+void ir_licm_function(ir_function_t *function, ir_licm_stats_t *stats);
+
+#endif // !IR_LICM_H
@@ -0,0 +1,264 @@
+#include "ir_loop.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void *loop_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the loops.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *loop_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the loops.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void add_block(ir_loop_t *loop, int block, int *capacity) {
+  if (loop->block_count == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 8;
+    loop->blocks = (int *)loop_realloc(loop->blocks, *capacity * sizeof(int));
+  }
+  loop->blocks[loop->block_count++] = block;
+}
+
+//! Sorts the loops by decreasing size, so enclosing loops come first
+static int compare_size(const void *a, const void *b) {
+  const ir_loop_t *first = (const ir_loop_t *)a;
+  const ir_loop_t *second = (const ir_loop_t *)b;
+  if (first->block_count != second->block_count)
+    return second->block_count - first->block_count;
+  return first->header - second->header;
+}
+
+ir_loops_t *ir_loops_find(const ir_function_t *function,
+                          const ir_dominance_t *dominance) {
+  int count = function->block_count;
+  ir_loops_t *loops = (ir_loops_t *)loop_alloc(1, sizeof(ir_loops_t));
+  int *header_loop = (int *)loop_alloc(count, sizeof(int));
+  int capacity = 0;
+
+  loops->block_count = count;
+  loops->block_loop = (int *)loop_alloc(count, sizeof(int));
+  for (int b = 0; b < count; b++)
+    header_loop[b] = loops->block_loop[b] = -1;
+
+  // Back edges, grouped by header
+  for (int i = 0; i < dominance->rpo_count; i++) {
+    int latch = dominance->rpo[i];
+    const ir_block_t *block = &function->blocks[latch];
+
+    for (int s = 0; s < block->succ_count; s++) {
+      int header = block->succs[s];
+      if (!ir_dominates(dominance, header, latch))
+        continue;
+
+      if (header_loop[header] < 0) {
+        if (loops->loop_count == capacity) {
+          capacity = capacity ? capacity * 2 : 8;
+          loops->loops = (ir_loop_t *)loop_realloc(
+              loops->loops, capacity * sizeof(ir_loop_t));
+        }
+        header_loop[header] = loops->loop_count;
+        loops->loops[loops->loop_count++] = (ir_loop_t){
+            .header = header, .preheader = -1, .parent = -1};
+      }
+
+      ir_loop_t *loop = &loops->loops[header_loop[header]];
+      loop->latches = (int *)loop_realloc(
+          loop->latches, (loop->latch_count + 1) * sizeof(int));
+      loop->latches[loop->latch_count++] = latch;
+    }
+  }
+  free(header_loop);
+
+  // Bodies: the blocks reaching a latch backwards without the header
+  int *stamp = (int *)loop_alloc(count, sizeof(int));
+  int *work = (int *)loop_alloc(count, sizeof(int));
+  for (int b = 0; b < count; b++)
+    stamp[b] = -1;
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    ir_loop_t *loop = &loops->loops[l];
+    int block_capacity = 0, top = 0;
+
+    stamp[loop->header] = l;
+    add_block(loop, loop->header, &block_capacity);
+
+    for (int i = 0; i < loop->latch_count; i++)
+      if (stamp[loop->latches[i]] != l) {
+        stamp[loop->latches[i]] = l;
+        work[top++] = loop->latches[i];
+      }
+
+    while (top) {
+      int block = work[--top];
+      const ir_block_t *current = &function->blocks[block];
+
+      add_block(loop, block, &block_capacity);
+      for (int p = 0; p < current->pred_count; p++) {
+        int pred = current->preds[p];
+        if (stamp[pred] != l && dominance->rpo_index[pred] >= 0) {
+          stamp[pred] = l;
+          work[top++] = pred;
+        }
+      }
+    }
+  }
+  free(stamp);
+  free(work);
+
+  // Nesting: going from the largest loops down, each block ends up in the
+  // innermost loop holding it
+  if (loops->loop_count)
+    qsort(loops->loops, loops->loop_count, sizeof(ir_loop_t), compare_size);
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    ir_loop_t *loop = &loops->loops[l];
+
+    loop->parent = loops->block_loop[loop->header];
+    loop->depth = loop->parent < 0 ? 1 : loops->loops[loop->parent].depth + 1;
+    for (int b = 0; b < loop->block_count; b++)
+      loops->block_loop[loop->blocks[b]] = l;
+  }
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    ir_loop_t *loop = &loops->loops[l];
+    const ir_block_t *header = &function->blocks[loop->header];
+    int outside = 0, entry = -1;
+
+    for (int p = 0; p < header->pred_count; p++)
+      if (!ir_loop_contains(loops, l, header->preds[p])) {
+        outside++;
+        entry = header->preds[p];
+      }
+
+    if (outside == 1 && function->blocks[entry].succ_count == 1)
+      loop->preheader = entry;
+  }
+
+  return loops;
+}
+
+void ir_loops_destroy(ir_loops_t *loops) {
+  if (!loops)
+    return;
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    free(loops->loops[l].blocks);
+    free(loops->loops[l].latches);
+  }
+  free(loops->loops);
+  free(loops->block_loop);
+  free(loops);
+}
+
+int ir_loop_contains(const ir_loops_t *loops, int loop, int block) {
+  for (int l = loops->block_loop[block]; l >= 0; l = loops->loops[l].parent)
+    if (l == loop)
+      return 1;
+  return 0;
+}
+
+int ir_loop_depth(const ir_loops_t *loops, int block) {
+  int loop = loops->block_loop[block];
+  return loop < 0 ? 0 : loops->loops[loop].depth;
+}
+
+// ----------------------- Preheaders ----------------------
+
+//! Moves the edges from 'from' to 'target' over to 'middle'
+static void retarget(ir_function_t *function, int from, int target,
+                     int middle) {
+  ir_instr_t *terminator = ir_terminator(&function->blocks[from]);
+
+  if (terminator->op == IR_JMP) {
+    terminator->a.value = middle;
+    return;
+  }
+  for (int t = 0; t < terminator->arg_count; t++)
+    if (terminator->args[t].value == target)
+      terminator->args[t].value = middle;
+}
+
+int ir_loops_insert_preheaders(ir_function_t *function,
+                               const ir_loops_t *loops) {
+  int inserted = 0;
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    const ir_loop_t *loop = &loops->loops[l];
+    if (loop->preheader >= 0)
+      continue;
+
+    int header = loop->header;
+    int pred_count = function->blocks[header].pred_count;
+    int *outside = (int *)loop_alloc(pred_count, sizeof(int));
+    int outside_count = 0;
+
+    for (int p = 0; p < pred_count; p++) {
+      int pred = function->blocks[header].preds[p];
+      if (!ir_loop_contains(loops, l, pred))
+        outside[outside_count++] = pred;
+    }
+
+    int middle = ir_new_block(function);
+    ir_block_t *target = &function->blocks[header];
+
+    // Values entering the header now come from the preheader, merged there
+    // if several edges entered the loop
+    for (int i = 0; i < target->count && target->instrs[i].op == IR_PHI;
+         i++) {
+      ir_instr_t *phi = &target->instrs[i];
+
+      if (outside_count == 1) {
+        for (int a = 0; a < phi->arg_count; a += 2)
+          if (phi->args[a].value == outside[0])
+            phi->args[a].value = middle;
+        continue;
+      }
+
+      ir_operand_t *sources = (ir_operand_t *)loop_alloc(
+          2 * outside_count, sizeof(ir_operand_t));
+      for (int o = 0; o < outside_count; o++) {
+        sources[2 * o] = ir_block(outside[o]);
+        sources[2 * o + 1] = *ir_phi_source(phi, outside[o]);
+        ir_phi_remove_source(phi, outside[o]);
+      }
+
+      ir_operand_t merged = ir_temp(ir_new_temp(
+          function, function->temp_types[phi->dst.value],
+          function->temp_names[phi->dst.value]));
+      ir_instr_t *entry = ir_emit(function, middle, IR_PHI, merged, ir_none(),
+                                  ir_none());
+      ir_set_args(entry, sources, 2 * outside_count);
+      free(sources);
+
+      ir_operand_t added[2] = {ir_block(middle), merged};
+      ir_operand_t *args = (ir_operand_t *)loop_alloc(phi->arg_count + 2,
+                                                      sizeof(ir_operand_t));
+      memcpy(args, phi->args, phi->arg_count * sizeof(ir_operand_t));
+      memcpy(&args[phi->arg_count], added, sizeof(added));
+      ir_set_args(phi, args, phi->arg_count + 2);
+      free(args);
+    }
+
+    ir_emit(function, middle, IR_JMP, ir_none(), ir_block(header), ir_none());
+    for (int o = 0; o < outside_count; o++)
+      retarget(function, outside[o], header, middle);
+
+    free(outside);
+    inserted++;
+  }
+
+  if (inserted)
+    ir_compute_cfg(function);
+
+  return inserted;
+}
@@ -0,0 +1,49 @@
+#ifndef IR_LOOP_H
+#define IR_LOOP_H
+
+#include "ir.h"
+#include "ir_dominance.h"
+
+//! Natural loop: the header and every block that reaches one of its latches
+//! without going through the header. Loops sharing a header are merged
+typedef struct {
+  int header;
+  int preheader; // Only predecessor of the header outside the loop, ending
+                 // in a jump to it, -1 if there is none
+  int parent;    // Innermost enclosing loop, -1 for outermost loops
+  int depth;     // 1 for outermost loops
+
+  int *blocks; // The header comes first
+  int block_count;
+  int *latches; // Sources of the back edges
+  int latch_count;
+} ir_loop_t;
+
+//! Loop forest of a function, outer loops come before the loops they hold
+typedef struct {
+  ir_loop_t *loops;
+  int loop_count;
+  int *block_loop; // Innermost loop of each block, -1 outside loops
+  int block_count;
+} ir_loops_t;
+
+//! Finds the natural loops from the back edges, edges whose target dominates
+//! their source
+ir_loops_t *ir_loops_find(const ir_function_t *function,
+                          const ir_dominance_t *dominance);
+
+void ir_loops_destroy(ir_loops_t *loops);
+
+//! Whether 'block' belongs to the loop (or to one nested in it)
+int ir_loop_contains(const ir_loops_t *loops, int loop, int block);
+
+//! Loop depth of a block, 0 outside loops
+int ir_loop_depth(const ir_loops_t *loops, int block);
+
+//! Gives every loop without one a preheader: a new block the entering edges
+//! are moved to, with phis merging the values entering the header. Returns
+//! how many were added; the dominators and loops must then be recomputed
+int ir_loops_insert_preheaders(ir_function_t *function,
+                               const ir_loops_t *loops);
+
+#endif // !IR_LOOP_H
@@ -0,0 +1,560 @@
+#include "ir_lower.h"
+#include "../semantic/symtab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INT_SIZE 4 // Bytes of a C- int
+
+int BOUNDS_CHECKS = 0;
+
+//! State of the translation of a function
+typedef struct {
+  ir_module_t *module;
+  ir_function_t *function;
+  const symbol_t *symbol; // Of the function
+  int block;              // Block receiving the instructions
+  int body; // Start of the body, where the self tail calls loop back to
+} lower_t;
+
+static ir_operand_t lower_expression(lower_t *lower, ast_node_t *node);
+static void lower_statement(lower_t *lower, ast_node_t *node);
+
+static int is_global(const symbol_t *symbol) {
+  return symbol->scope_depth == 0;
+}
+
+//! Appends 'dst = a op b' to the current block, with a new dst
+static ir_operand_t emit_value(lower_t *lower, ir_opcode_t op, ir_type_t type,
+                               ir_operand_t a, ir_operand_t b) {
+  ir_operand_t dst = ir_temp(ir_new_temp(lower->function, type, NULL));
+  ir_emit(lower->function, lower->block, op, dst, a, b);
+  return dst;
+}
+
+//! Ends the current block with a jump, unless it already ended
+static void emit_jump(lower_t *lower, int target) {
+  if (!ir_terminator(&lower->function->blocks[lower->block]))
+    ir_emit(lower->function, lower->block, IR_JMP, ir_none(), ir_block(target),
+            ir_none());
+}
+
+static void emit_branch(lower_t *lower, ir_operand_t condition, int on_true,
+                        int on_false) {
+  ir_operand_t targets[2] = {ir_block(on_true), ir_block(on_false)};
+  ir_instr_t *branch = ir_emit(lower->function, lower->block, IR_BR, ir_none(),
+                               condition, ir_none());
+  ir_set_args(branch, targets, 2);
+}
+
+// ----------------------- Variables ----------------------
+
+//! Address of the first element of an array (or of a global scalar)
+static ir_operand_t lower_base(lower_t *lower, const symbol_t *symbol) {
+  if (is_global(symbol))
+    return emit_value(lower, IR_ADDR, IR_TYPE_PTR, ir_global(symbol->location),
+                      ir_none());
+  if (symbol->is_param) // Array parameters hold the address
+    return ir_temp(symbol->location);
+  return emit_value(lower, IR_ADDR, IR_TYPE_PTR, ir_frame(symbol->location),
+                    ir_none());
+}
+
+//! Address of an array element: base + index * 4
+static ir_operand_t lower_element(lower_t *lower, const symbol_t *symbol,
+                                  ast_node_t *index) {
+  ir_operand_t position = lower_expression(lower, index);
+  if (BOUNDS_CHECKS && symbol->size > 0)
+    ir_emit(lower->function, lower->block, IR_CHECK, ir_none(), position,
+            ir_const(symbol->size));
+  ir_operand_t base = lower_base(lower, symbol);
+  ir_operand_t offset = emit_value(lower, IR_MUL, IR_TYPE_I32, position,
+                                   ir_const(INT_SIZE));
+  return emit_value(lower, IR_PTRADD, IR_TYPE_PTR, base, offset);
+}
+
+static ir_operand_t lower_variable(lower_t *lower, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+
+  if (node->data.variable.index)
+    return emit_value(lower, IR_LOAD, IR_TYPE_I32,
+                      lower_element(lower, symbol, node->data.variable.index),
+                      ir_none());
+
+  if (symbol->kind == SYM_ARRAY) // Only as an argument
+    return lower_base(lower, symbol);
+
+  if (is_global(symbol))
+    return emit_value(lower, IR_LOAD, IR_TYPE_I32, lower_base(lower, symbol),
+                      ir_none());
+
+  return ir_temp(symbol->location);
+}
+
+static ir_operand_t lower_assignment(lower_t *lower, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *index = node->data.assignment_expression.var_index;
+
+  if (index) {
+    ir_operand_t address = lower_element(lower, symbol, index);
+    ir_operand_t value =
+        lower_expression(lower, node->data.assignment_expression.expression);
+    ir_emit(lower->function, lower->block, IR_STORE, ir_none(), address,
+            value);
+    return value;
+  }
+
+  ir_operand_t value =
+      lower_expression(lower, node->data.assignment_expression.expression);
+
+  if (is_global(symbol)) {
+    ir_emit(lower->function, lower->block, IR_STORE, ir_none(),
+            lower_base(lower, symbol), value);
+    return value;
+  }
+
+  ir_operand_t variable = ir_temp(symbol->location);
+  ir_emit(lower->function, lower->block, IR_MOV, variable, value, ir_none());
+  return variable;
+}
+
+// ----------------------- Expressions ----------------------
+
+static ir_operand_t lower_activation(lower_t *lower, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+  int callee = symbol->location;
+  ir_operand_t *args = NULL;
+  int count = 0;
+
+  if (symbol->is_builtin)
+    callee = !strcmp(symbol->name, "input") ? IR_FUNCTION_INPUT
+                                            : IR_FUNCTION_OUTPUT;
+
+  for (ast_node_t *list = node->data.activation.args; list;
+       list = list->data.argument_list.arg_list)
+    count++;
+
+  if (count) {
+    args = (ir_operand_t *)malloc(count * sizeof(ir_operand_t));
+    if (!args) {
+      fprintf(stderr, "Error: Memory allocation failed for the IR.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  count = 0;
+  for (ast_node_t *list = node->data.activation.args; list;
+       list = list->data.argument_list.arg_list)
+    args[count++] = lower_expression(lower, list->data.argument_list.expression);
+
+  ir_operand_t result = ir_none();
+  if (symbol->type == TOKEN_INT)
+    result = ir_temp(ir_new_temp(lower->function, IR_TYPE_I32, NULL));
+
+  ir_instr_t *call = ir_emit(lower->function, lower->block, IR_CALL, result,
+                             ir_func(callee), ir_none());
+  ir_set_args(call, args, count);
+  free(args);
+
+  return result;
+}
+
+static ir_opcode_t relational_opcode(token_types_t relop) {
+  switch (relop) {
+  case TOKEN_LT:
+    return IR_LT;
+  case TOKEN_LE:
+    return IR_LE;
+  case TOKEN_GT:
+    return IR_GT;
+  case TOKEN_GE:
+    return IR_GE;
+  case TOKEN_EQ:
+    return IR_EQ;
+  default:
+    return IR_NE;
+  }
+}
+
+static ir_operand_t lower_binary(lower_t *lower, ir_opcode_t op,
+                                 ast_node_t *left, ast_node_t *right) {
+  ir_operand_t a = lower_expression(lower, left);
+  ir_operand_t b = lower_expression(lower, right);
+  return emit_value(lower, op, IR_TYPE_I32, a, b);
+}
+
+static ir_operand_t lower_expression(lower_t *lower, ast_node_t *node) {
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    return lower_assignment(lower, node);
+
+  case AST_SIMPLE_EXPRESSION:
+    if (!node->data.simple_expression.relational_op)
+      return lower_expression(lower, node->data.simple_expression.left);
+    return lower_binary(
+        lower,
+        relational_opcode(node->data.simple_expression.relational_op->data
+                              .relational_operator.relop),
+        node->data.simple_expression.left, node->data.simple_expression.right);
+
+  case AST_ADDITIVE_EXPRESSION:
+    if (!node->data.additive_expression.add_op)
+      return lower_expression(lower, node->data.additive_expression.left);
+    return lower_binary(lower,
+                        node->data.additive_expression.add_op->data
+                                    .additive_operator.add_operator == '+'
+                            ? IR_ADD
+                            : IR_SUB,
+                        node->data.additive_expression.left,
+                        node->data.additive_expression.right);
+
+  case AST_TERM:
+    if (!node->data.term.mult_op)
+      return lower_expression(lower, node->data.term.left);
+    return lower_binary(lower,
+                        node->data.term.mult_op->data.multiplicative_operator
+                                    .mult_operator == '*'
+                            ? IR_MUL
+                            : IR_DIV,
+                        node->data.term.left, node->data.term.right);
+
+  case AST_FACTOR:
+    if (node->data.factor.expression)
+      return lower_expression(lower, node->data.factor.expression);
+    if (node->data.factor.variable)
+      return lower_variable(lower, node->data.factor.variable);
+    if (node->data.factor.activation)
+      return lower_activation(lower, node->data.factor.activation);
+    return ir_const(node->data.factor.number);
+
+  default:
+    return ir_const(0);
+  }
+}
+
+// ----------------------- Statements ----------------------
+
+static void lower_local(lower_t *lower, ast_node_t *node) {
+  symbol_t *symbol = node->symbol;
+  const char *id = node->data.var_declaration.id;
+
+  if (node->data.var_declaration.dimension) {
+    symbol->location =
+        ir_add_frame_slot(lower->function, id, symbol->size);
+    return;
+  }
+
+  // Locals start at zero, so every use has a definition
+  symbol->location = ir_new_temp(lower->function, IR_TYPE_I32, id);
+  ir_emit(lower->function, lower->block, IR_MOV, ir_temp(symbol->location),
+          ir_const(0), ir_none());
+}
+
+static void lower_compound(lower_t *lower, ast_node_t *node) {
+  for (ast_node_t *list = node->data.compound_decl.local_declarations;
+       list && list->data.local_declarations.var_declaration;
+       list = list->data.local_declarations.local_declarations)
+    lower_local(lower, list->data.local_declarations.var_declaration);
+
+  for (ast_node_t *list = node->data.compound_decl.statement_list;
+       list && list->data.statement_list.statement;
+       list = list->data.statement_list.statement_list)
+    lower_statement(lower, list->data.statement_list.statement);
+}
+
+static void lower_selection(lower_t *lower, ast_node_t *node) {
+  ir_operand_t condition =
+      lower_expression(lower, node->data.selection_statement.expression);
+  int then_block = ir_new_block(lower->function);
+  int else_block = node->data.selection_statement.else_statement
+                       ? ir_new_block(lower->function)
+                       : -1;
+  int join = ir_new_block(lower->function);
+
+  emit_branch(lower, condition, then_block, else_block < 0 ? join : else_block);
+
+  lower->block = then_block;
+  lower_statement(lower, node->data.selection_statement.then_statement);
+  emit_jump(lower, join);
+
+  if (else_block >= 0) {
+    lower->block = else_block;
+    lower_statement(lower, node->data.selection_statement.else_statement);
+    emit_jump(lower, join);
+  }
+
+  lower->block = join;
+}
+
+static void lower_iteration(lower_t *lower, ast_node_t *node) {
+  int header = ir_new_block(lower->function);
+  int body = ir_new_block(lower->function);
+  int exit = ir_new_block(lower->function);
+
+  emit_jump(lower, header);
+
+  lower->block = header;
+  ir_operand_t condition =
+      lower_expression(lower, node->data.iteration_statement.expression);
+  emit_branch(lower, condition, body, exit);
+
+  lower->block = body;
+  lower_statement(lower, node->data.iteration_statement.body);
+  emit_jump(lower, header);
+
+  lower->block = exit;
+}
+
+// ----------------------- Tail Calls ----------------------
+
+//! The expression itself, without the levels of the grammar it went through
+static ast_node_t *unwrap(ast_node_t *node) {
+  for (;;) {
+    if (node->type == AST_FACTOR && node->data.factor.expression)
+      node = node->data.factor.expression;
+    else if (node->type == AST_SIMPLE_EXPRESSION &&
+             !node->data.simple_expression.relational_op)
+      node = node->data.simple_expression.left;
+    else if (node->type == AST_ADDITIVE_EXPRESSION &&
+             !node->data.additive_expression.add_op)
+      node = node->data.additive_expression.left;
+    else if (node->type == AST_TERM && !node->data.term.mult_op)
+      node = node->data.term.left;
+    else
+      return node;
+  }
+}
+
+//! Call of the function to itself whose value is returned at once, which
+//! can assign the parameters and loop back instead. Not when it passes a
+//! local array: the parameter would point to the array the next iteration
+//! starts over with
+static ast_node_t *self_tail_call(const lower_t *lower, ast_node_t *node) {
+  if (!node || node->type != AST_RETURN_STATEMENT ||
+      !node->data.return_statement.expression)
+    return NULL;
+
+  ast_node_t *expression = unwrap(node->data.return_statement.expression);
+  if (expression->type != AST_FACTOR || !expression->data.factor.activation ||
+      expression->data.factor.activation->symbol != lower->symbol)
+    return NULL;
+
+  ast_node_t *call = expression->data.factor.activation;
+  for (ast_node_t *list = call->data.activation.args; list;
+       list = list->data.argument_list.arg_list) {
+    ast_node_t *argument = unwrap(list->data.argument_list.expression);
+    const symbol_t *symbol = argument->type == AST_FACTOR &&
+                                     argument->data.factor.variable
+                                 ? argument->data.factor.variable->symbol
+                                 : NULL;
+    if (symbol && symbol->kind == SYM_ARRAY && !symbol->is_param &&
+        !is_global(symbol))
+      return NULL;
+  }
+  return call;
+}
+
+static int has_self_tail_call(const lower_t *lower, ast_node_t *node) {
+  if (!node)
+    return 0;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    return has_self_tail_call(lower, node->data.statement.statement);
+  case AST_COMPOUND_DECL:
+    for (ast_node_t *list = node->data.compound_decl.statement_list;
+         list && list->data.statement_list.statement;
+         list = list->data.statement_list.statement_list)
+      if (has_self_tail_call(lower, list->data.statement_list.statement))
+        return 1;
+    return 0;
+  case AST_SELECTION_STATEMENT:
+    return has_self_tail_call(lower,
+                              node->data.selection_statement.then_statement) ||
+           has_self_tail_call(lower,
+                              node->data.selection_statement.else_statement);
+  case AST_ITERATION_STATEMENT:
+    return has_self_tail_call(lower, node->data.iteration_statement.body);
+  case AST_RETURN_STATEMENT:
+    return self_tail_call(lower, node) != NULL;
+  default:
+    return 0;
+  }
+}
+
+static int is_parameter(const ir_function_t *function, int temp) {
+  const ir_block_t *entry = &function->blocks[0];
+  for (int i = 0; i < entry->count; i++)
+    if (entry->instrs[i].op == IR_PARAM && entry->instrs[i].dst.value == temp)
+      return 1;
+  return 0;
+}
+
+//! Every argument is evaluated before any parameter changes, the later ones
+//! may read the earlier parameters. Then the body starts over
+static void lower_tail_call(lower_t *lower, ast_node_t *node) {
+  ir_function_t *function = lower->function;
+  ir_operand_t *values = (ir_operand_t *)calloc(
+      function->param_count ? function->param_count : 1, sizeof(ir_operand_t));
+  int count = 0;
+
+  if (!values) {
+    fprintf(stderr, "Error: Memory allocation failed for the IR.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (ast_node_t *list = node->data.activation.args; list;
+       list = list->data.argument_list.arg_list, count++) {
+    ir_operand_t value =
+        lower_expression(lower, list->data.argument_list.expression);
+    // A parameter read as is must be copied before it is assigned
+    if (value.kind == IR_OPD_TEMP && is_parameter(function, value.value))
+      value = emit_value(lower, IR_MOV, function->temp_types[value.value],
+                         value, ir_none());
+    values[count] = value;
+  }
+
+  ir_block_t *entry = &function->blocks[0];
+  for (int i = 0; i < entry->count; i++)
+    if (entry->instrs[i].op == IR_PARAM)
+      ir_emit(function, lower->block, IR_MOV, entry->instrs[i].dst,
+              values[entry->instrs[i].a.value], ir_none());
+  emit_jump(lower, lower->body);
+
+  free(values);
+}
+
+static void lower_return(lower_t *lower, ast_node_t *node) {
+  ir_operand_t value = ir_none();
+  ast_node_t *call = self_tail_call(lower, node);
+
+  if (call)
+    lower_tail_call(lower, call);
+  else if (node->data.return_statement.expression)
+    value = lower_expression(lower, node->data.return_statement.expression);
+
+  if (!call)
+    ir_emit(lower->function, lower->block, IR_RET, ir_none(), value,
+            ir_none());
+
+  // Whatever follows is unreachable, but still needs a block
+  lower->block = ir_new_block(lower->function);
+}
+
+static void lower_statement(lower_t *lower, ast_node_t *node) {
+  if (!node)
+    return;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    lower_statement(lower, node->data.statement.statement);
+    break;
+  case AST_COMPOUND_DECL:
+    lower_compound(lower, node);
+    break;
+  case AST_EXPRESSION_STATEMENT:
+    if (node->data.expression_statement.expression)
+      lower_expression(lower, node->data.expression_statement.expression);
+    break;
+  case AST_SELECTION_STATEMENT:
+    lower_selection(lower, node);
+    break;
+  case AST_ITERATION_STATEMENT:
+    lower_iteration(lower, node);
+    break;
+  case AST_RETURN_STATEMENT:
+    lower_return(lower, node);
+    break;
+  default:
+    break;
+  }
+}
+
+// ----------------------- Program ----------------------
+
+static void lower_function(lower_t *lower, ast_node_t *node) {
+  ir_function_t *function = lower->function;
+  int index = 0;
+
+  lower->block = ir_new_block(function);
+
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->data.param_list.param;
+       list = list->data.param_list.param_list, index++) {
+    ast_node_t *param = list->data.param_list.param;
+    symbol_t *symbol = param->symbol;
+    int is_array = param->data.param.dimension != NULL;
+
+    symbol->location = ir_new_temp(
+        function, is_array ? IR_TYPE_PTR : IR_TYPE_I32, param->data.param.id);
+    ir_emit(function, lower->block, IR_PARAM, ir_temp(symbol->location),
+            ir_const(index), ir_none());
+  }
+
+  // The parameters stay out of the loop of the self tail calls
+  lower->body = -1;
+  if (has_self_tail_call(lower, node->data.fun_declaration.compound_decl)) {
+    lower->body = ir_new_block(function);
+    function->tail_recursive = 1;
+    emit_jump(lower, lower->body);
+    lower->block = lower->body;
+  }
+
+  lower_compound(lower, node->data.fun_declaration.compound_decl);
+
+  // Falling off the end returns, int functions give 0
+  if (!ir_terminator(&function->blocks[lower->block]))
+    ir_emit(function, lower->block, IR_RET, ir_none(),
+            function->returns_value ? ir_const(0) : ir_none(), ir_none());
+
+  ir_compute_cfg(function);
+}
+
+ir_module_t *ir_lower_program(ast_node_t *program) {
+  ir_module_t *module = ir_module_create();
+  lower_t lower = {.module = module};
+
+  // Every global and signature first, so the functions never move again
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    symbol_t *symbol = node->symbol;
+
+    if (node->type == AST_VAR_DECLARATION) {
+      symbol->location =
+          ir_add_global(module, node->data.var_declaration.id, symbol->size);
+      continue;
+    }
+
+    symbol->location = ir_add_function(module, node->data.fun_declaration.id,
+                                       symbol->type == TOKEN_INT);
+    ir_function_t *function = &module->functions[symbol->location];
+    function->symbol = symbol;
+    function->param_count = symbol->param_count;
+    function->param_is_array =
+        (int *)calloc(symbol->param_count ? symbol->param_count : 1,
+                      sizeof(int));
+    for (int p = 0; p < symbol->param_count; p++)
+      function->param_is_array[p] = symbol->param_kinds[p] == SYM_ARRAY;
+
+    if (!strcmp(symbol->name, "main"))
+      module->main_function = symbol->location;
+  }
+
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+
+    if (node->type == AST_FUN_DECLARATION) {
+      lower.function = &module->functions[node->symbol->location];
+      lower.symbol = node->symbol;
+      lower_function(&lower, node);
+    }
+  }
+
+  return module;
+}
@@ -0,0 +1,19 @@
+#ifndef IR_LOWER_H
+#define IR_LOWER_H
+
+#include "../parser/parser.h"
+#include "ir.h"
+
+//! Global controller to check every index of a declared array against its
+//! dimension, stopping the program outside of it. Array parameters have no
+//! known dimension and stay unchecked
+extern int BOUNDS_CHECKS;
+
+//! Translates a checked program into three-address code. It relies on the
+//! symbols annotated by the semantic analysis, which must have no errors.
+//! Scalar locals and parameters become temporaries that may be assigned many
+//! times; globals and arrays live in memory and are reached through explicit
+//! address arithmetic, loads and stores
+ir_module_t *ir_lower_program(ast_node_t *program);
+
+#endif // !IR_LOWER_H
@@ -0,0 +1,74 @@
+#include "ir_optimize.h"
+
+void ir_optimize_module(ir_module_t *module, ir_optimize_stats_t *stats) {
+  ir_remove_dead_functions(module, &stats->interproc);
+
+  ir_callgraph_t *graph = ir_callgraph_build(module);
+  ir_propagate_arguments(module, graph, &stats->interproc, &stats->sccp);
+
+  for (int o = 0; o < graph->order_count; o++) {
+    int f = graph->order[o];
+    ir_function_t *function = &module->functions[f];
+
+    ir_inline_function(module, f, graph, &stats->inliner);
+    ir_sccp_function(function, &stats->sccp);
+    ir_clean_cfg(function, &stats->dce);
+    ir_gvn_function(function, &stats->gvn);
+    ir_licm_function(function, &stats->licm);
+    ir_bounds_function(function, &stats->bounds);
+    ir_unroll_function(function, &stats->unroll);
+    ir_strength_function(function, &stats->strength);
+    ir_dce_function(function, &stats->dce);
+  }
+
+  ir_callgraph_destroy(graph);
+}
+
+void ir_optimize_print_stats(const ir_optimize_stats_t *stats, FILE *output) {
+  fprintf(output,
+          "interproc: %ld unreachable functions removed, %ld parameters of "
+          "%ld functions constant\n",
+          stats->interproc.functions_removed, stats->interproc.parameters,
+          stats->interproc.specialized);
+  fprintf(output,
+          "inline: %ld calls inlined (%ld instructions), %ld recursive and "
+          "%ld too large kept\n",
+          stats->inliner.inlined, stats->inliner.instructions,
+          stats->inliner.recursive, stats->inliner.too_large);
+  fprintf(output,
+          "sccp: %ld constants, %ld branches folded, %ld instructions and %ld "
+          "blocks removed\n",
+          stats->sccp.constants, stats->sccp.branches,
+          stats->sccp.instructions_removed, stats->sccp.blocks_removed);
+  fprintf(output,
+          "gvn: %ld redundant expressions, %ld loads, %ld copies, %ld "
+          "simplified, %ld instructions removed\n",
+          stats->gvn.redundant, stats->gvn.loads, stats->gvn.copies,
+          stats->gvn.simplified, stats->gvn.instructions_removed);
+  fprintf(output, "licm: %ld loops, %ld preheaders added, %ld hoisted\n",
+          stats->licm.loops, stats->licm.preheaders, stats->licm.hoisted);
+  if (stats->bounds.checks) {
+    long narrowed = stats->bounds.removed + stats->bounds.hoisted;
+    fprintf(output,
+            "bounds: %ld checks, %ld removed and %ld hoisted into %ld range "
+            "checks (%.1f%% out of the loops)\n",
+            stats->bounds.checks, stats->bounds.removed, stats->bounds.hoisted,
+            stats->bounds.range_checks,
+            100.0 * (double)narrowed / (double)stats->bounds.checks);
+  }
+  fprintf(output,
+          "unroll: %ld loops unrolled, %ld vectorized with %ld alias checks\n",
+          stats->unroll.unrolled, stats->unroll.vectorized,
+          stats->unroll.alias_checks);
+  fprintf(output,
+          "strength: %ld induction variables, %ld recurrences, %ld pointer "
+          "increments, %ld shifts, %ld divisions\n",
+          stats->strength.induction_variables, stats->strength.recurrences,
+          stats->strength.pointers, stats->strength.shifts,
+          stats->strength.divisions);
+  fprintf(output,
+          "dce: %ld instructions, %ld dead stores, %ld blocks and %ld local "
+          "arrays removed\n",
+          stats->dce.instructions_removed, stats->dce.stores_removed,
+          stats->dce.blocks_removed, stats->dce.slots_removed);
+}
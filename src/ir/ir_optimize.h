@@ -0,0 +1,39 @@
+#ifndef IR_OPTIMIZE_H
+#define IR_OPTIMIZE_H
+
+#include "ir.h"
+#include "ir_bounds.h"
+#include "ir_dce.h"
+#include "ir_gvn.h"
+#include "ir_inline.h"
+#include "ir_interproc.h"
+#include "ir_licm.h"
+#include "ir_sccp.h"
+#include "ir_strength.h"
+#include "ir_unroll.h"
+
+//! Counters of every optimization pass, accumulated over the functions
+typedef struct {
+  ir_interproc_stats_t interproc;
+  ir_inline_stats_t inliner;
+  ir_sccp_stats_t sccp;
+  ir_dce_stats_t dce;
+  ir_gvn_stats_t gvn;
+  ir_licm_stats_t licm;
+  ir_bounds_stats_t bounds;
+  ir_unroll_stats_t unroll;
+  ir_strength_stats_t strength;
+} ir_optimize_stats_t;
+
+//! Runs the optimization passes over a module in SSA form. The functions
+//! main never reaches are dropped and the constant arguments propagated
+//! from the callers down, then the callees are optimized before their
+//! callers so that each function inlines optimized code. The array checks
+//! of the safe mode are narrowed once the loops have their preheaders, and
+//! the innermost loops unrolled or vectorized before the strength reduction
+void ir_optimize_module(ir_module_t *module, ir_optimize_stats_t *stats);
+
+//! Prints what each pass did
+void ir_optimize_print_stats(const ir_optimize_stats_t *stats, FILE *output);
+
+#endif // !IR_OPTIMIZE_H
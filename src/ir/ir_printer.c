@@ -0,0 +1,144 @@
+#include "ir_printer.h"
+
+static void print_operand(ir_operand_t operand, const ir_function_t *function,
+                          const ir_module_t *module, FILE *output) {
+  switch (operand.kind) {
+  case IR_OPD_NONE:
+    fprintf(output, "_");
+    break;
+  case IR_OPD_TEMP:
+    if (function->temp_names[operand.value])
+      fprintf(output, "%%%s.%d", function->temp_names[operand.value],
+              operand.value);
+    else
+      fprintf(output, "%%%d", operand.value);
+    break;
+  case IR_OPD_CONST:
+    fprintf(output, "%d", operand.value);
+    break;
+  case IR_OPD_GLOBAL:
+    fprintf(output, "@%s", module->globals[operand.value].name);
+    break;
+  case IR_OPD_FRAME:
+    fprintf(output, "$%s.%d", function->frame[operand.value].name,
+            operand.value);
+    break;
+  case IR_OPD_FUNC:
+    fprintf(output, "%s", module->functions[operand.value].name);
+    break;
+  case IR_OPD_BLOCK:
+    fprintf(output, "b%d", operand.value);
+    break;
+  }
+}
+
+void ir_print_instr(const ir_instr_t *instr, const ir_function_t *function,
+                    const ir_module_t *module, FILE *output) {
+  if (instr->dst.kind != IR_OPD_NONE) {
+    print_operand(instr->dst, function, module, output);
+    fprintf(output, " = ");
+  }
+
+  fprintf(output, "%s", ir_opcode_name(instr->op));
+
+  switch (instr->op) {
+  case IR_PHI:
+    for (int i = 0; i < instr->arg_count; i += 2) {
+      fprintf(output, "%s[", i ? ", " : " ");
+      print_operand(instr->args[i], function, module, output);
+      fprintf(output, ": ");
+      print_operand(instr->args[i + 1], function, module, output);
+      fprintf(output, "]");
+    }
+    return;
+  case IR_CALL:
+    fprintf(output, " ");
+    print_operand(instr->a, function, module, output);
+    fprintf(output, "(");
+    for (int i = 0; i < instr->arg_count; i++) {
+      if (i)
+        fprintf(output, ", ");
+      print_operand(instr->args[i], function, module, output);
+    }
+    fprintf(output, ")");
+    return;
+  case IR_BR:
+    fprintf(output, " ");
+    print_operand(instr->a, function, module, output);
+    fprintf(output, ", b%d, b%d", instr->args[0].value, instr->args[1].value);
+    return;
+  case IR_VADD:
+  case IR_VSUB:
+    fprintf(output, " ");
+    print_operand(instr->a, function, module, output);
+    fprintf(output, ", ");
+    print_operand(instr->b, function, module, output);
+    fprintf(output, ", ");
+    print_operand(instr->args[0], function, module, output);
+    return;
+  default:
+    break;
+  }
+
+  if (instr->a.kind != IR_OPD_NONE) {
+    fprintf(output, " ");
+    print_operand(instr->a, function, module, output);
+  }
+  if (instr->b.kind != IR_OPD_NONE) {
+    fprintf(output, ", ");
+    print_operand(instr->b, function, module, output);
+  }
+}
+
+void ir_print_function(const ir_function_t *function,
+                       const ir_module_t *module, FILE *output) {
+  fprintf(output, "function %s %s(", function->returns_value ? "int" : "void",
+          function->name);
+  for (int p = 0; p < function->param_count; p++)
+    fprintf(output, "%s%s", p ? ", " : "",
+            function->param_is_array[p] ? "int[]" : "int");
+  fprintf(output, ")\n");
+
+  for (int f = 0; f < function->frame_count; f++)
+    fprintf(output, "  frame $%s.%d[%d]\n", function->frame[f].name, f,
+            function->frame[f].size);
+
+  for (int b = 0; b < function->block_count; b++) {
+    const ir_block_t *block = &function->blocks[b];
+
+    fprintf(output, "b%d:", b);
+    if (block->pred_count) {
+      fprintf(output, "%*s; preds:", 6 - (b > 9) - (b > 99), "");
+      for (int p = 0; p < block->pred_count; p++)
+        fprintf(output, " b%d", block->preds[p]);
+    }
+    fprintf(output, "\n");
+
+    for (int i = 0; i < block->count; i++) {
+      if (block->instrs[i].op == IR_NOP)
+        continue;
+      fprintf(output, "    ");
+      ir_print_instr(&block->instrs[i], function, module, output);
+      fprintf(output, "\n");
+    }
+  }
+}
+
+void ir_print_module(const ir_module_t *module, FILE *output) {
+  for (int g = 0; g < module->global_count; g++) {
+    if (module->globals[g].size)
+      fprintf(output, "global @%s[%d]\n", module->globals[g].name,
+              module->globals[g].size);
+    else
+      fprintf(output, "global @%s\n", module->globals[g].name);
+  }
+  if (module->global_count)
+    fprintf(output, "\n");
+
+  for (int f = 0; f < module->function_count; f++) {
+    if (module->functions[f].is_builtin)
+      continue;
+    ir_print_function(&module->functions[f], module, output);
+    fprintf(output, "\n");
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef IR_PRINTER_H
+#define IR_PRINTER_H
+
+#include "ir.h"
+
+//! Prints the whole module
+void ir_print_module(const ir_module_t *module, FILE *output);
+
+//! Prints a function, its frame and its blocks
+void ir_print_function(const ir_function_t *function,
+                       const ir_module_t *module, FILE *output);
+
+//! Prints a single instruction, without indentation or line break
+void ir_print_instr(const ir_instr_t *instr, const ir_function_t *function,
+                    const ir_module_t *module, FILE *output);
+
+#endif // !IR_PRINTER_H
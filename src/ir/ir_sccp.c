@@ -0,0 +1,366 @@
+#include "ir_sccp.h"
+
+#include <stdlib.h>
+
+//! Lattice of a temporary: undefined yet, a known constant or overdefined
+typedef enum {
+  LATTICE_TOP,
+  LATTICE_CONST,
+  LATTICE_BOTTOM,
+} lattice_kind_t;
+
+typedef struct {
+  lattice_kind_t kind;
+  int value;
+} lattice_t;
+
+typedef struct {
+  ir_function_t *function;
+  lattice_t *values;     // By temporary
+  char *reached;         // Blocks known to execute
+  char *visited;         // Blocks whose instructions were evaluated once
+  char *edges;           // Executable edges, two per block by successor
+
+  int *use_start;        // Uses of temporary t are the instructions
+  int *use_block;        // (use_block[u], use_index[u]) for u in
+  int *use_index;        // use_start[t]..use_start[t + 1]
+
+  int *blocks;           // Blocks to evaluate
+  int block_count;
+  int *temps;            // Temporaries whose value changed
+  int temp_count;
+} sccp_t;
+
+static void *sccp_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the constant "
+                    "propagation.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+//! Def-use chains, in flat arrays indexed by temporary
+static void build_uses(sccp_t *sccp) {
+  ir_function_t *function = sccp->function;
+  int temps = function->temp_count;
+
+  sccp->use_start = (int *)sccp_alloc(temps + 1, sizeof(int));
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP)
+          sccp->use_start[use->value + 1]++;
+      }
+    }
+
+  for (int t = 0; t < temps; t++)
+    sccp->use_start[t + 1] += sccp->use_start[t];
+
+  int total = sccp->use_start[temps];
+  int *fill = (int *)sccp_alloc(temps, sizeof(int));
+  sccp->use_block = (int *)sccp_alloc(total, sizeof(int));
+  sccp->use_index = (int *)sccp_alloc(total, sizeof(int));
+
+  for (int t = 0; t < temps; t++)
+    fill[t] = sccp->use_start[t];
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind != IR_OPD_TEMP)
+          continue;
+        sccp->use_block[fill[use->value]] = b;
+        sccp->use_index[fill[use->value]++] = i;
+      }
+    }
+
+  free(fill);
+}
+
+// ----------------------- Lattice ----------------------
+
+static lattice_t lattice_of(const sccp_t *sccp, ir_operand_t operand) {
+  if (operand.kind == IR_OPD_CONST)
+    return (lattice_t){LATTICE_CONST, operand.value};
+  if (operand.kind == IR_OPD_TEMP)
+    return sccp->values[operand.value];
+  return (lattice_t){LATTICE_BOTTOM, 0};
+}
+
+static lattice_t meet(lattice_t a, lattice_t b) {
+  if (a.kind == LATTICE_TOP)
+    return b;
+  if (b.kind == LATTICE_TOP)
+    return a;
+  if (a.kind == LATTICE_CONST && b.kind == LATTICE_CONST && a.value == b.value)
+    return a;
+  return (lattice_t){LATTICE_BOTTOM, 0};
+}
+
+//! Lowers the value of a temporary, queueing its uses if it changed
+static void set_value(sccp_t *sccp, ir_operand_t dst, lattice_t value) {
+  lattice_t *current = &sccp->values[dst.value];
+
+  if (current->kind == value.kind &&
+      (value.kind != LATTICE_CONST || current->value == value.value))
+    return;
+
+  *current = value;
+  sccp->temps[sccp->temp_count++] = dst.value;
+}
+
+static void mark_edge(sccp_t *sccp, int block, int succ) {
+  int edge = 2 * block + succ;
+
+  if (sccp->edges[edge])
+    return;
+
+  sccp->edges[edge] = 1;
+  int target = sccp->function->blocks[block].succs[succ];
+  sccp->reached[target] = 1;
+  sccp->blocks[sccp->block_count++] = target;
+}
+
+static int edge_reached(const sccp_t *sccp, int from, int to) {
+  const ir_block_t *block = &sccp->function->blocks[from];
+  for (int s = 0; s < block->succ_count; s++)
+    if (block->succs[s] == to)
+      return sccp->edges[2 * from + s];
+  return 0;
+}
+
+// ----------------------- Evaluation ----------------------
+
+static lattice_t evaluate_binary(const sccp_t *sccp, const ir_instr_t *instr) {
+  lattice_t a = lattice_of(sccp, instr->a);
+  lattice_t b = lattice_of(sccp, instr->b);
+
+  // x * 0 is 0 whatever x is
+  if (instr->op == IR_MUL && ((a.kind == LATTICE_CONST && a.value == 0) ||
+                              (b.kind == LATTICE_CONST && b.value == 0)))
+    return (lattice_t){LATTICE_CONST, 0};
+
+  if (a.kind == LATTICE_BOTTOM || b.kind == LATTICE_BOTTOM)
+    return (lattice_t){LATTICE_BOTTOM, 0};
+  if (a.kind == LATTICE_TOP || b.kind == LATTICE_TOP)
+    return (lattice_t){LATTICE_TOP, 0};
+
+  int result;
+  if (!ir_fold(instr->op, a.value, b.value, &result))
+    return (lattice_t){LATTICE_BOTTOM, 0};
+  return (lattice_t){LATTICE_CONST, result};
+}
+
+static void visit_branch(sccp_t *sccp, int block, const ir_instr_t *instr) {
+  lattice_t condition = lattice_of(sccp, instr->a);
+  const ir_block_t *current = &sccp->function->blocks[block];
+
+  if (condition.kind == LATTICE_TOP)
+    return;
+
+  for (int s = 0; s < current->succ_count; s++) {
+    int target = condition.value ? instr->args[0].value : instr->args[1].value;
+    if (condition.kind == LATTICE_BOTTOM || current->succs[s] == target)
+      mark_edge(sccp, block, s);
+  }
+}
+
+static void visit_instr(sccp_t *sccp, int block, const ir_instr_t *instr) {
+  lattice_t value = {LATTICE_BOTTOM, 0};
+
+  switch (instr->op) {
+  case IR_NOP:
+    return;
+  case IR_JMP:
+    mark_edge(sccp, block, 0);
+    return;
+  case IR_BR:
+    visit_branch(sccp, block, instr);
+    return;
+  case IR_PHI:
+    value = (lattice_t){LATTICE_TOP, 0};
+    for (int p = 0; p < instr->arg_count; p += 2)
+      if (edge_reached(sccp, instr->args[p].value, block))
+        value = meet(value, lattice_of(sccp, instr->args[p + 1]));
+    break;
+  case IR_MOV:
+    value = lattice_of(sccp, instr->a);
+    break;
+  case IR_ADD:
+  case IR_SUB:
+  case IR_MUL:
+  case IR_DIV:
+  case IR_SHL:
+  case IR_SHR:
+  case IR_SAR:
+  case IR_MULHI:
+  case IR_LT:
+  case IR_LE:
+  case IR_GT:
+  case IR_GE:
+  case IR_EQ:
+  case IR_NE:
+    value = evaluate_binary(sccp, instr);
+    break;
+  default: // Parameters, memory and calls are unknown
+    break;
+  }
+
+  if (instr->dst.kind == IR_OPD_TEMP)
+    set_value(sccp, instr->dst, meet(sccp->values[instr->dst.value], value));
+}
+
+//! Runs both worklists until neither the values nor the edges change
+static void propagate(sccp_t *sccp) {
+  ir_function_t *function = sccp->function;
+
+  sccp->reached[0] = 1;
+  sccp->blocks[sccp->block_count++] = 0;
+
+  while (sccp->block_count || sccp->temp_count) {
+    while (sccp->block_count) {
+      int b = sccp->blocks[--sccp->block_count];
+      ir_block_t *block = &function->blocks[b];
+
+      // A new edge only changes the phis once the block was evaluated
+      for (int i = 0; i < block->count; i++) {
+        if (sccp->visited[b] && block->instrs[i].op != IR_PHI)
+          break;
+        visit_instr(sccp, b, &block->instrs[i]);
+      }
+      sccp->visited[b] = 1;
+    }
+
+    while (sccp->temp_count) {
+      int t = sccp->temps[--sccp->temp_count];
+      for (int u = sccp->use_start[t]; u < sccp->use_start[t + 1]; u++) {
+        int b = sccp->use_block[u];
+        if (sccp->visited[b])
+          visit_instr(sccp, b, &function->blocks[b].instrs[sccp->use_index[u]]);
+      }
+    }
+  }
+}
+
+// ----------------------- Rewriting ----------------------
+
+static long count_instructions(const ir_function_t *function) {
+  long count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++)
+      count += function->blocks[b].instrs[i].op != IR_NOP;
+  return count;
+}
+
+//! Turns a branch on a constant into a jump, dropping the phi sources of the
+//! target not taken
+static void fold_branch(ir_function_t *function, int block, ir_instr_t *branch) {
+  int taken = branch->a.value ? branch->args[0].value : branch->args[1].value;
+  int dropped = branch->a.value ? branch->args[1].value : branch->args[0].value;
+
+  if (dropped != taken) {
+    ir_block_t *target = &function->blocks[dropped];
+    for (int i = 0; i < target->count && target->instrs[i].op == IR_PHI; i++)
+      ir_phi_remove_source(&target->instrs[i], block);
+  }
+
+  ir_set_args(branch, NULL, 0);
+  branch->op = IR_JMP;
+  branch->a = ir_block(taken);
+}
+
+static void rewrite(sccp_t *sccp, ir_sccp_stats_t *stats) {
+  ir_function_t *function = sccp->function;
+  char *dead = (char *)sccp_alloc(function->block_count, sizeof(char));
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+
+    dead[b] = !sccp->reached[b];
+    if (dead[b])
+      continue;
+
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+
+      if (instr->dst.kind == IR_OPD_TEMP &&
+          sccp->values[instr->dst.value].kind == LATTICE_CONST &&
+          !ir_has_side_effects(instr->op)) {
+        ir_remove_instr(instr);
+        stats->constants++;
+        continue;
+      }
+
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP &&
+            sccp->values[use->value].kind == LATTICE_CONST)
+          *use = ir_const(sccp->values[use->value].value);
+      }
+
+      if (instr->op == IR_BR && instr->a.kind == IR_OPD_CONST) {
+        fold_branch(function, b, instr);
+        stats->branches++;
+      }
+    }
+  }
+
+  int blocks = function->block_count;
+  ir_compact_function(function, dead);
+  stats->blocks_removed += blocks - function->block_count;
+  free(dead);
+
+  // The phis of blocks left with a single predecessor are plain copies
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+    if (block->pred_count != 1)
+      continue;
+
+    for (int i = 0; i < block->count && block->instrs[i].op == IR_PHI; i++) {
+      ir_operand_t source = block->instrs[i].args[1];
+      ir_set_args(&block->instrs[i], NULL, 0);
+      block->instrs[i].op = IR_MOV;
+      block->instrs[i].a = source;
+    }
+  }
+}
+
+void ir_sccp_function(ir_function_t *function, ir_sccp_stats_t *stats) {
+  sccp_t sccp = {.function = function};
+  int blocks = function->block_count, temps = function->temp_count;
+
+  if (function->is_builtin || !blocks)
+    return;
+
+  long instructions = count_instructions(function);
+
+  sccp.values = (lattice_t *)sccp_alloc(temps, sizeof(lattice_t));
+  sccp.reached = (char *)sccp_alloc(blocks, sizeof(char));
+  sccp.visited = (char *)sccp_alloc(blocks, sizeof(char));
+  sccp.edges = (char *)sccp_alloc(2 * blocks, sizeof(char));
+  sccp.blocks = (int *)sccp_alloc(2 * blocks + 1, sizeof(int));
+  sccp.temps = (int *)sccp_alloc(2 * temps + 1, sizeof(int));
+  build_uses(&sccp);
+
+  propagate(&sccp);
+  rewrite(&sccp, stats);
+
+  stats->instructions_removed += instructions - count_instructions(function);
+
+  free(sccp.values);
+  free(sccp.reached);
+  free(sccp.visited);
+  free(sccp.edges);
+  free(sccp.blocks);
+  free(sccp.temps);
+  free(sccp.use_start);
+  free(sccp.use_block);
+  free(sccp.use_index);
+}
@@ -0,0 +1,20 @@
+#ifndef IR_SCCP_H
+#define IR_SCCP_H
+
+#include "ir.h"
+
+typedef struct {
+  long constants;            // Temporaries found to be constant
+  long branches;             // Conditional branches turned into jumps
+  long instructions_removed;
+  long blocks_removed;
+} ir_sccp_stats_t;
+
+//! Sparse conditional constant propagation (Wegman and Zadeck) over a
+//! function in SSA form. Arithmetic is folded with the 32 bits wraparound of
+//! C- ints; divisions by zero are left for run time. Uses of constant
+//! temporaries are replaced, branches on constants become jumps and the
+//! blocks never reached are dropped
+void ir_sccp_function(ir_function_t *function, ir_sccp_stats_t *stats);
+
+#endif // !IR_SCCP_H
@@ -0,0 +1,707 @@
+#include "ir_ssa.h"
+#include "ir_dominance.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void *ssa_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the SSA form.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *ssa_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the SSA form.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e3 +
+         (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static long count_instructions(const ir_function_t *function) {
+  long count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    count += function->blocks[b].count;
+  return count;
+}
+
+// ----------------------- Phi Placement ----------------------
+
+//! Phis placed by the construction, grouped by block: the phis of block b
+//! are its first 'start[b + 1] - start[b]' instructions, and 'vars' holds the
+//! original temporary each one stands for
+typedef struct {
+  int *start;
+  int *vars;
+} phi_table_t;
+
+//! Temporaries assigned more than once, which need renaming: 1 if every read
+//! follows an assignment in the same block, 2 if they also need phis
+static char *find_variables(const ir_function_t *function) {
+  int temps = function->temp_count;
+  int *defs = (int *)ssa_alloc(temps, sizeof(int));
+  int *defined_in = (int *)ssa_alloc(temps, sizeof(int));
+  char *live_across = (char *)ssa_alloc(temps, sizeof(char));
+  char *variables = (char *)ssa_alloc(temps, sizeof(char));
+
+  for (int t = 0; t < temps; t++)
+    defined_in[t] = -1;
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP && defined_in[use->value] != b)
+          live_across[use->value] = 1;
+      }
+
+      if (instr->dst.kind == IR_OPD_TEMP) {
+        defs[instr->dst.value]++;
+        defined_in[instr->dst.value] = b;
+      }
+    }
+  }
+
+  for (int t = 0; t < temps; t++)
+    variables[t] = defs[t] > 1 ? 1 + live_across[t] : 0;
+
+  free(defs);
+  free(defined_in);
+  free(live_across);
+
+  return variables;
+}
+
+//! Places the phis of every variable in the iterated dominance frontier of
+//! the blocks that assign it
+static phi_table_t place_phis(ir_function_t *function, const char *variables,
+                              const ir_frontiers_t *frontiers, long *placed) {
+  int blocks = function->block_count;
+  int temps = function->temp_count;
+
+  // Blocks assigning each variable, grouped by variable
+  int *def_start = (int *)ssa_alloc(temps + 1, sizeof(int));
+  for (int b = 0; b < blocks; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_operand_t dst = function->blocks[b].instrs[i].dst;
+      if (dst.kind == IR_OPD_TEMP && variables[dst.value] == 2)
+        def_start[dst.value + 1]++;
+    }
+  for (int t = 0; t < temps; t++)
+    def_start[t + 1] += def_start[t];
+
+  int *def_blocks = (int *)ssa_alloc(def_start[temps], sizeof(int));
+  int *fill = (int *)ssa_alloc(temps, sizeof(int));
+  memcpy(fill, def_start, temps * sizeof(int));
+  for (int b = 0; b < blocks; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_operand_t dst = function->blocks[b].instrs[i].dst;
+      if (dst.kind == IR_OPD_TEMP && variables[dst.value] == 2)
+        def_blocks[fill[dst.value]++] = b;
+    }
+  free(fill);
+
+  // Iterated frontiers, the stamps avoid clearing the arrays per variable
+  int *has_phi = (int *)ssa_alloc(blocks, sizeof(int));
+  int *in_work = (int *)ssa_alloc(blocks, sizeof(int));
+  int *work = (int *)ssa_alloc(blocks, sizeof(int));
+  int *phi_blocks = NULL, *phi_vars = NULL;
+  int phi_count = 0, phi_capacity = 0;
+
+  for (int b = 0; b < blocks; b++)
+    has_phi[b] = in_work[b] = -1;
+
+  for (int v = 0; v < temps; v++) {
+    if (variables[v] != 2)
+      continue;
+
+    int top = 0;
+    for (int d = def_start[v]; d < def_start[v + 1]; d++) {
+      if (in_work[def_blocks[d]] == v)
+        continue;
+      in_work[def_blocks[d]] = v;
+      work[top++] = def_blocks[d];
+    }
+
+    while (top) {
+      int block = work[--top];
+
+      for (int f = frontiers->start[block]; f < frontiers->start[block + 1];
+           f++) {
+        int join = frontiers->frontier[f];
+        if (has_phi[join] == v)
+          continue;
+
+        has_phi[join] = v;
+        if (phi_count == phi_capacity) {
+          phi_capacity = phi_capacity ? phi_capacity * 2 : 64;
+          phi_blocks =
+              (int *)ssa_realloc(phi_blocks, phi_capacity * sizeof(int));
+          phi_vars = (int *)ssa_realloc(phi_vars, phi_capacity * sizeof(int));
+        }
+        phi_blocks[phi_count] = join;
+        phi_vars[phi_count++] = v;
+
+        if (in_work[join] != v) {
+          in_work[join] = v;
+          work[top++] = join;
+        }
+      }
+    }
+  }
+
+  free(def_start);
+  free(def_blocks);
+  free(has_phi);
+  free(in_work);
+  free(work);
+
+  // Groups the phis by block and puts them in front of each block
+  phi_table_t table;
+  table.start = (int *)ssa_alloc(blocks + 1, sizeof(int));
+  table.vars = (int *)ssa_alloc(phi_count, sizeof(int));
+
+  for (int p = 0; p < phi_count; p++)
+    table.start[phi_blocks[p] + 1]++;
+  for (int b = 0; b < blocks; b++)
+    table.start[b + 1] += table.start[b];
+
+  int *next = (int *)ssa_alloc(blocks, sizeof(int));
+  memcpy(next, table.start, blocks * sizeof(int));
+  for (int p = 0; p < phi_count; p++)
+    table.vars[next[phi_blocks[p]]++] = phi_vars[p];
+  free(next);
+  free(phi_blocks);
+  free(phi_vars);
+
+  for (int b = 0; b < blocks; b++) {
+    ir_block_t *block = &function->blocks[b];
+    int count = table.start[b + 1] - table.start[b];
+    if (!count)
+      continue;
+
+    ir_instr_t *instrs = (ir_instr_t *)ssa_alloc(block->count + count,
+                                                 sizeof(ir_instr_t));
+    for (int p = 0; p < count; p++) {
+      int v = table.vars[table.start[b] + p];
+      ir_instr_t *phi = &instrs[p];
+
+      phi->op = IR_PHI;
+      phi->dst = ir_temp(v);
+      phi->arg_count = 2 * block->pred_count;
+      phi->args = (ir_operand_t *)ssa_alloc(phi->arg_count,
+                                            sizeof(ir_operand_t));
+      for (int s = 0; s < block->pred_count; s++) {
+        phi->args[2 * s] = ir_block(block->preds[s]);
+        phi->args[2 * s + 1] = ir_temp(v); // Renamed from the predecessor
+      }
+    }
+
+    memcpy(&instrs[count], block->instrs, block->count * sizeof(ir_instr_t));
+    free(block->instrs);
+    block->instrs = instrs;
+    block->count += count;
+    block->capacity = block->count;
+  }
+
+  *placed = phi_count;
+  return table;
+}
+
+// ----------------------- Renaming ----------------------
+
+//! Value of a variable in the block being renamed. Every local starts
+//! assigned in the entry block, so the constant only covers dead paths
+static ir_operand_t current_value(const int *current, int variable) {
+  return current[variable] >= 0 ? ir_temp(current[variable]) : ir_const(0);
+}
+
+//! Gives every definition of a variable its own temporary, walking the
+//! dominator tree with an explicit stack. 'log' remembers the values
+//! replaced in each block so they are restored when leaving its subtree
+static void rename_variables(ir_function_t *function, const char *variables,
+                             const phi_table_t *phis,
+                             const ir_dominance_t *dominance) {
+  int temps = function->temp_count; // The variables are among the first ones
+  int *current = (int *)ssa_alloc(temps, sizeof(int));
+  char *reused = (char *)ssa_alloc(temps, sizeof(char));
+  int *log_vars = NULL, *log_values = NULL;
+  int log_count = 0, log_capacity = 0;
+
+  int blocks = function->block_count;
+  int *stack = (int *)ssa_alloc(2 * blocks, sizeof(int)); // (block, mark)
+  int top = 0;
+
+  for (int t = 0; t < temps; t++)
+    current[t] = -1;
+
+  if (dominance->rpo_count) {
+    stack[top++] = 0;
+    stack[top++] = -1;
+  }
+
+  while (top) {
+    int mark = stack[--top];
+    int b = stack[--top];
+
+    if (mark >= 0) { // Leaving the subtree of b
+      while (log_count > mark) {
+        log_count--;
+        current[log_vars[log_count]] = log_values[log_count];
+      }
+      continue;
+    }
+
+    ir_block_t *block = &function->blocks[b];
+    stack[top++] = b;
+    stack[top++] = log_count;
+
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+
+      if (instr->op != IR_PHI) {
+        for (int u = 0; u < ir_use_count(instr); u++) {
+          ir_operand_t *use = ir_use(instr, u);
+          if (use->kind == IR_OPD_TEMP && use->value < temps &&
+              variables[use->value])
+            *use = current_value(current, use->value);
+        }
+      }
+
+      if (instr->dst.kind != IR_OPD_TEMP || instr->dst.value >= temps ||
+          !variables[instr->dst.value])
+        continue;
+
+      // The first definition keeps the original number
+      int v = instr->dst.value, renamed = v;
+      if (reused[v])
+        renamed = ir_new_temp(function, function->temp_types[v],
+                              function->temp_names[v]);
+      reused[v] = 1;
+
+      if (log_count == log_capacity) {
+        log_capacity = log_capacity ? log_capacity * 2 : 64;
+        log_vars = (int *)ssa_realloc(log_vars, log_capacity * sizeof(int));
+        log_values = (int *)ssa_realloc(log_values, log_capacity * sizeof(int));
+      }
+      log_vars[log_count] = v;
+      log_values[log_count++] = current[v];
+
+      current[v] = renamed;
+      instr->dst.value = renamed;
+    }
+
+    for (int s = 0; s < block->succ_count; s++) {
+      int succ = block->succs[s];
+      ir_block_t *target = &function->blocks[succ];
+
+      for (int p = phis->start[succ]; p < phis->start[succ + 1]; p++) {
+        ir_operand_t *source =
+            ir_phi_source(&target->instrs[p - phis->start[succ]], b);
+        *source = current_value(current, phis->vars[p]);
+      }
+    }
+
+    for (int c = dominance->child_start[b + 1] - 1;
+         c >= dominance->child_start[b]; c--) {
+      stack[top++] = dominance->children[c];
+      stack[top++] = -1;
+    }
+  }
+
+  free(current);
+  free(reused);
+  free(log_vars);
+  free(log_values);
+  free(stack);
+}
+
+void ir_ssa_construct(ir_function_t *function, ir_ssa_stats_t *stats) {
+  struct timespec start;
+  double dominance_ms, placement_ms, renaming_ms;
+  long instructions = count_instructions(function), placed = 0;
+
+  if (function->is_builtin)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  if (dominance->rpo_count < function->block_count) {
+    char *dead = (char *)ssa_alloc(function->block_count, sizeof(char));
+    for (int b = 0; b < function->block_count; b++)
+      dead[b] = dominance->rpo_index[b] < 0;
+    ir_compact_function(function, dead);
+    free(dead);
+
+    ir_dominance_destroy(dominance);
+    dominance = ir_dominance_compute(function);
+  }
+  ir_frontiers_t *frontiers = ir_frontiers_compute(function, dominance);
+  dominance_ms = elapsed_ms(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  char *variables = find_variables(function);
+  phi_table_t phis = place_phis(function, variables, frontiers, &placed);
+  placement_ms = elapsed_ms(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  rename_variables(function, variables, &phis, dominance);
+  renaming_ms = elapsed_ms(&start);
+
+  free(variables);
+  free(phis.start);
+  free(phis.vars);
+  ir_frontiers_destroy(frontiers);
+  ir_dominance_destroy(dominance);
+
+  if (!stats)
+    return;
+
+  double total = dominance_ms + placement_ms + renaming_ms;
+  stats->functions++;
+  stats->blocks += function->block_count;
+  stats->instructions += instructions;
+  stats->phis += placed;
+  stats->dominance_ms += dominance_ms;
+  stats->placement_ms += placement_ms;
+  stats->renaming_ms += renaming_ms;
+
+  if (instructions > stats->largest_instructions) {
+    stats->largest_name = function->name;
+    stats->largest_instructions = instructions;
+    stats->largest_ms = total;
+  }
+}
+
+// ----------------------- Destruction ----------------------
+
+static int has_phis(const ir_block_t *block) {
+  return block->count && block->instrs[0].op == IR_PHI;
+}
+
+//! Puts an empty block on every edge from a branch to a block with phis, so
+//! the copies of that edge have a place of their own
+static void split_edges(ir_function_t *function) {
+  int blocks = function->block_count;
+
+  for (int b = 0; b < blocks; b++) {
+    if (function->blocks[b].succ_count < 2)
+      continue;
+
+    for (int s = 0; s < 2; s++) {
+      int succ = function->blocks[b].succs[s];
+      if (!has_phis(&function->blocks[succ]))
+        continue;
+
+      int middle = ir_new_block(function);
+      ir_emit(function, middle, IR_JMP, ir_none(), ir_block(succ), ir_none());
+
+      ir_instr_t *branch = ir_terminator(&function->blocks[b]);
+      for (int t = 0; t < branch->arg_count; t++)
+        if (branch->args[t].value == succ)
+          branch->args[t].value = middle;
+
+      ir_block_t *target = &function->blocks[succ];
+      for (int i = 0; i < target->count && target->instrs[i].op == IR_PHI; i++)
+        for (int a = 0; a < target->instrs[i].arg_count; a += 2)
+          if (target->instrs[i].args[a].value == b)
+            target->instrs[i].args[a].value = middle;
+    }
+  }
+
+  ir_compute_cfg(function);
+}
+
+//! Scratch state to sequentialize the copies of an edge. 'pending' counts
+//! the copies not emitted yet that read each temporary, 'writer' is the copy
+//! assigning it. Both are indexed by temporary and cleared after each edge
+typedef struct {
+  ir_operand_t *dsts;
+  ir_operand_t *srcs;
+  char *done;
+  int *ready;
+  int count;
+  int capacity;
+
+  int *pending;
+  int *writer;
+  int limit; // Temporaries covered by 'pending' and 'writer'
+} copy_set_t;
+
+static void add_copy(copy_set_t *set, ir_operand_t dst, ir_operand_t src) {
+  if (src.kind == IR_OPD_TEMP && src.value == dst.value)
+    return;
+
+  if (set->count == set->capacity) {
+    set->capacity = set->capacity ? set->capacity * 2 : 16;
+    set->dsts = (ir_operand_t *)ssa_realloc(
+        set->dsts, set->capacity * sizeof(ir_operand_t));
+    set->srcs = (ir_operand_t *)ssa_realloc(
+        set->srcs, set->capacity * sizeof(ir_operand_t));
+    set->done = (char *)ssa_realloc(set->done, set->capacity);
+    set->ready = (int *)ssa_realloc(set->ready, set->capacity * sizeof(int));
+  }
+
+  set->dsts[set->count] = dst;
+  set->srcs[set->count] = src;
+  set->done[set->count] = 0;
+  set->count++;
+}
+
+static int tracked(const copy_set_t *set, ir_operand_t operand) {
+  return operand.kind == IR_OPD_TEMP && operand.value < set->limit;
+}
+
+//! Emits the copies of the set in an order that reads every source before
+//! it is overwritten, starting at 'position'. Returns the number emitted
+static int emit_copies(ir_function_t *function, int block, int position,
+                       copy_set_t *set) {
+  int emitted = 0, top = 0, left = set->count, cursor = 0;
+
+  for (int k = 0; k < set->count; k++) {
+    set->writer[set->dsts[k].value] = k;
+    if (tracked(set, set->srcs[k]))
+      set->pending[set->srcs[k].value]++;
+  }
+  for (int k = 0; k < set->count; k++)
+    if (!set->pending[set->dsts[k].value])
+      set->ready[top++] = k;
+
+  while (left) {
+    while (top) {
+      int k = set->ready[--top];
+      ir_operand_t src = set->srcs[k];
+
+      ir_insert(function, block, position + emitted++, IR_MOV, set->dsts[k],
+                src, ir_none());
+      set->done[k] = 1;
+      left--;
+
+      if (tracked(set, src) && !--set->pending[src.value]) {
+        int writer = set->writer[src.value];
+        if (writer >= 0 && !set->done[writer])
+          set->ready[top++] = writer;
+      }
+    }
+
+    if (!left)
+      break;
+
+    // Only cycles are left: saves one of their values and breaks it
+    while (set->done[cursor])
+      cursor++;
+
+    ir_operand_t saved = set->dsts[cursor];
+    ir_operand_t temp = ir_temp(ir_new_temp(
+        function, function->temp_types[saved.value], NULL));
+    ir_insert(function, block, position + emitted++, IR_MOV, temp, saved,
+              ir_none());
+
+    for (int k = 0; k < set->count; k++)
+      if (!set->done[k] && set->srcs[k].kind == IR_OPD_TEMP &&
+          set->srcs[k].value == saved.value)
+        set->srcs[k] = temp;
+    set->pending[saved.value] = 0;
+    set->ready[top++] = cursor;
+  }
+
+  for (int k = 0; k < set->count; k++)
+    set->writer[set->dsts[k].value] = -1;
+  set->count = 0;
+
+  return emitted;
+}
+
+void ir_ssa_destruct(ir_function_t *function, ir_ssa_stats_t *stats) {
+  struct timespec start;
+  int any = 0;
+  long copies = 0;
+
+  if (function->is_builtin)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (int b = 0; b < function->block_count && !any; b++)
+    any = has_phis(&function->blocks[b]);
+
+  if (any) {
+    split_edges(function);
+
+    copy_set_t set = {0};
+    set.limit = function->temp_count;
+    set.pending = (int *)ssa_alloc(set.limit, sizeof(int));
+    set.writer = (int *)ssa_alloc(set.limit, sizeof(int));
+    for (int t = 0; t < set.limit; t++)
+      set.writer[t] = -1;
+
+    for (int b = 0; b < function->block_count; b++) {
+      if (!has_phis(&function->blocks[b]))
+        continue;
+
+      for (int p = 0; p < function->blocks[b].pred_count; p++) {
+        int pred = function->blocks[b].preds[p];
+        ir_block_t *target = &function->blocks[b];
+
+        for (int i = 0; i < target->count && target->instrs[i].op == IR_PHI;
+             i++) {
+          ir_operand_t *source = ir_phi_source(&target->instrs[i], pred);
+          if (source)
+            add_copy(&set, target->instrs[i].dst, *source);
+        }
+
+        // The copies go right before the terminator of the predecessor
+        ir_block_t *from = &function->blocks[pred];
+        int position = (int)(ir_terminator(from) - from->instrs);
+        copies += emit_copies(function, pred, position, &set);
+      }
+    }
+
+    for (int b = 0; b < function->block_count; b++) {
+      ir_block_t *block = &function->blocks[b];
+      for (int i = 0; i < block->count && block->instrs[i].op == IR_PHI; i++)
+        ir_remove_instr(&block->instrs[i]);
+    }
+    ir_compact_function(function, NULL);
+
+    free(set.dsts);
+    free(set.srcs);
+    free(set.done);
+    free(set.ready);
+    free(set.pending);
+    free(set.writer);
+  }
+
+  if (!stats)
+    return;
+
+  double ms = elapsed_ms(&start);
+  stats->copies += copies;
+  stats->destruction_ms += ms;
+  if (stats->largest_name == function->name)
+    stats->largest_ms += ms;
+}
+
+void ir_module_to_ssa(ir_module_t *module, ir_ssa_stats_t *stats) {
+  for (int f = 0; f < module->function_count; f++)
+    ir_ssa_construct(&module->functions[f], stats);
+}
+
+void ir_module_from_ssa(ir_module_t *module, ir_ssa_stats_t *stats) {
+  for (int f = 0; f < module->function_count; f++)
+    ir_ssa_destruct(&module->functions[f], stats);
+}
+
+// ----------------------- Checks ----------------------
+
+static int ssa_error(const ir_function_t *function, int block,
+                     const char *message) {
+  fprintf(stderr, "SSA invalido em %s, bloco b%d: %s\n", function->name, block,
+          message);
+  return 1;
+}
+
+int ir_verify_ssa(const ir_function_t *function) {
+  int errors = 0;
+
+  if (function->is_builtin)
+    return 0;
+
+  int *def_block = (int *)ssa_alloc(function->temp_count, sizeof(int));
+  int *def_position = (int *)ssa_alloc(function->temp_count, sizeof(int));
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+
+  for (int t = 0; t < function->temp_count; t++)
+    def_block[t] = -1;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_operand_t dst = function->blocks[b].instrs[i].dst;
+      if (dst.kind != IR_OPD_TEMP)
+        continue;
+      if (def_block[dst.value] >= 0)
+        errors += ssa_error(function, b, "temporario definido mais de uma vez");
+      def_block[dst.value] = b;
+      def_position[dst.value] = i;
+    }
+
+  for (int b = 0; b < function->block_count; b++) {
+    ir_block_t *block = &function->blocks[b];
+    if (dominance->rpo_index[b] < 0)
+      continue;
+
+    for (int i = 0; i < block->count; i++) {
+      ir_instr_t *instr = &block->instrs[i];
+
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind != IR_OPD_TEMP)
+          continue;
+
+        int def = def_block[use->value];
+        int from = b, dominated;
+
+        if (instr->op == IR_PHI) // Read at the end of the predecessor
+          from = instr->args[u - 3].value;
+
+        if (def < 0)
+          dominated = 0;
+        else if (def == from)
+          dominated = instr->op == IR_PHI || def_position[use->value] < i;
+        else
+          dominated = ir_dominates(dominance, def, from);
+
+        if (!dominated)
+          errors += ssa_error(function, b, "uso nao dominado pela definicao");
+      }
+    }
+  }
+
+  free(def_block);
+  free(def_position);
+  ir_dominance_destroy(dominance);
+
+  return errors;
+}
+
+void ir_ssa_print_stats(const ir_ssa_stats_t *stats, FILE *output) {
+  double total = stats->dominance_ms + stats->placement_ms +
+                 stats->renaming_ms + stats->destruction_ms;
+  long instructions = stats->instructions ? stats->instructions : 1;
+  long largest = stats->largest_instructions ? stats->largest_instructions : 1;
+
+  fprintf(output,
+          "ssa: %d functions, %ld blocks, %ld instructions, %ld phis, %ld "
+          "copies\n",
+          stats->functions, stats->blocks, stats->instructions, stats->phis,
+          stats->copies);
+  fprintf(output, "  dominators     %9.3f ms\n", stats->dominance_ms);
+  fprintf(output, "  phi placement  %9.3f ms\n", stats->placement_ms);
+  fprintf(output, "  renaming       %9.3f ms\n", stats->renaming_ms);
+  fprintf(output, "  out of ssa     %9.3f ms\n", stats->destruction_ms);
+  fprintf(output, "  total          %9.3f ms   %7.1f ns/instruction\n", total,
+          total * 1e6 / instructions);
+  if (stats->largest_name)
+    fprintf(output,
+            "  largest: %s, %ld instructions, %.3f ms   %7.1f "
+            "ns/instruction\n",
+            stats->largest_name, stats->largest_instructions, stats->largest_ms,
+            stats->largest_ms * 1e6 / largest);
+}
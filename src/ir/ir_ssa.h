@@ -0,0 +1,47 @@
+#ifndef IR_SSA_H
+#define IR_SSA_H
+
+#include "ir.h"
+
+//! Timing counters of the SSA conversions, accumulated over the functions
+typedef struct {
+  int functions;
+  long blocks;
+  long instructions; // Before the construction
+  long phis;         // Placed by the construction
+  long copies;       // Inserted by the destruction
+
+  double dominance_ms;
+  double placement_ms;
+  double renaming_ms;
+  double destruction_ms;
+
+  // Function with most instructions, to check the time grows linearly
+  const char *largest_name;
+  long largest_instructions;
+  double largest_ms;
+} ir_ssa_stats_t;
+
+//! Puts a function in SSA form: computes the dominators, places the phis in
+//! the iterated dominance frontiers of the temporaries assigned more than once
+//! (only those live across blocks) and renames every definition. Unreachable
+//! blocks are dropped first. 'stats' may be NULL
+void ir_ssa_construct(ir_function_t *function, ir_ssa_stats_t *stats);
+
+//! Takes a function out of SSA form: splits the edges that leave a branch
+//! into a block with phis and replaces the phis by parallel copies at the end
+//! of the predecessors, sequentialized with a temporary for cycles
+void ir_ssa_destruct(ir_function_t *function, ir_ssa_stats_t *stats);
+
+//! Applies the conversions to every function of the module
+void ir_module_to_ssa(ir_module_t *module, ir_ssa_stats_t *stats);
+void ir_module_from_ssa(ir_module_t *module, ir_ssa_stats_t *stats);
+
+//! Checks that every temporary has a single definition that dominates its
+//! uses. Prints the problems and returns their number
+int ir_verify_ssa(const ir_function_t *function);
+
+//! Prints the counters, with the cost per instruction
+void ir_ssa_print_stats(const ir_ssa_stats_t *stats, FILE *output);
+
+#endif // !IR_SSA_H
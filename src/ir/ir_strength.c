@@ -0,0 +1,481 @@
+#include "ir_strength.h"
+#include "ir_dominance.h"
+#include "ir_loop.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+typedef struct {
+  ir_function_t *function;
+  ir_strength_stats_t *stats;
+  int capacity; // Size of the arrays indexed by temporary
+
+  ir_operand_t *leaders; // Value of a removed temporary, NONE if kept
+  int *def_block;        // -1 if the temporary has no definition yet
+  int *def_index;
+  int *iv_loop;          // Loop whose induction variable it is, or -1
+  int *iv_step;
+  ir_operand_t *iv_init; // Value coming from the preheader
+} strength_t;
+
+static void *strength_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the strength "
+                    "reduction.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void *strength_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size ? size : 1);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the strength "
+                    "reduction.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+//! Adds a temporary, growing the arrays indexed by temporary
+static ir_operand_t new_temp(strength_t *strength, ir_type_t type) {
+  int temp = ir_new_temp(strength->function, type, NULL);
+
+  if (temp >= strength->capacity) {
+    int capacity = 2 * strength->capacity > temp + 1 ? 2 * strength->capacity
+                                                     : temp + 1;
+    strength->leaders = (ir_operand_t *)strength_realloc(
+        strength->leaders, capacity * sizeof(ir_operand_t));
+    strength->def_block = (int *)strength_realloc(strength->def_block,
+                                                  capacity * sizeof(int));
+    strength->def_index = (int *)strength_realloc(strength->def_index,
+                                                  capacity * sizeof(int));
+    strength->iv_loop = (int *)strength_realloc(strength->iv_loop,
+                                                capacity * sizeof(int));
+    strength->iv_step = (int *)strength_realloc(strength->iv_step,
+                                                capacity * sizeof(int));
+    strength->iv_init = (ir_operand_t *)strength_realloc(
+        strength->iv_init, capacity * sizeof(ir_operand_t));
+    strength->capacity = capacity;
+  }
+
+  strength->leaders[temp] = ir_none();
+  strength->def_block[temp] = -1;
+  strength->iv_loop[temp] = -1;
+  return ir_temp(temp);
+}
+
+static ir_operand_t resolve(const strength_t *strength, ir_operand_t operand) {
+  while (operand.kind == IR_OPD_TEMP &&
+         strength->leaders[operand.value].kind != IR_OPD_NONE)
+    operand = strength->leaders[operand.value];
+  return operand;
+}
+
+//! Inserts an instruction, keeping the definition positions up to date
+static void insert(strength_t *strength, int block, int position,
+                   ir_opcode_t op, ir_operand_t dst, ir_operand_t a,
+                   ir_operand_t b) {
+  ir_block_t *target = &strength->function->blocks[block];
+
+  ir_insert(strength->function, block, position, op, dst, a, b);
+  for (int i = position; i < target->count; i++)
+    if (target->instrs[i].dst.kind == IR_OPD_TEMP) {
+      strength->def_block[target->instrs[i].dst.value] = block;
+      strength->def_index[target->instrs[i].dst.value] = i;
+    }
+}
+
+//! Computes 'a op b' at the end of a block, folding constants
+static ir_operand_t emit_at_end(strength_t *strength, int block,
+                                ir_opcode_t op, ir_type_t type, ir_operand_t a,
+                                ir_operand_t b) {
+  int result;
+  if (a.kind == IR_OPD_CONST && b.kind == IR_OPD_CONST &&
+      ir_fold(op, a.value, b.value, &result))
+    return ir_const(result);
+  if (op == IR_PTRADD && b.kind == IR_OPD_CONST && b.value == 0)
+    return a;
+
+  ir_operand_t dst = new_temp(strength, type);
+  insert(strength, block, strength->function->blocks[block].count - 1, op,
+         dst, a, b);
+  return dst;
+}
+
+// ----------------------- Induction Variables ----------------------
+
+static int in_loop(const strength_t *strength, const int *stamp, int loop,
+                   ir_operand_t operand) {
+  return operand.kind == IR_OPD_TEMP &&
+         strength->def_block[operand.value] >= 0 &&
+         stamp[strength->def_block[operand.value]] == loop;
+}
+
+//! Header phis taking 'phi + constant' from the latch
+static void find_basic(strength_t *strength, const ir_loop_t *loop, int l,
+                       const int *stamp) {
+  ir_function_t *function = strength->function;
+  ir_block_t *header = &function->blocks[loop->header];
+
+  for (int i = 0; i < header->count && header->instrs[i].op == IR_PHI; i++) {
+    ir_instr_t *phi = &header->instrs[i];
+    if (phi->arg_count != 4 ||
+        function->temp_types[phi->dst.value] != IR_TYPE_I32)
+      continue;
+
+    ir_operand_t init = *ir_phi_source(phi, loop->preheader);
+    ir_operand_t next = *ir_phi_source(phi, loop->latches[0]);
+    if (!in_loop(strength, stamp, l, next))
+      continue;
+
+    const ir_instr_t *step = &function->blocks[strength->def_block[next.value]]
+                                  .instrs[strength->def_index[next.value]];
+    ir_operand_t a = step->a, b = step->b;
+    int value;
+
+    if (step->op == IR_ADD && a.kind == IR_OPD_CONST)
+      a = step->b, b = step->a;
+    if (a.kind != IR_OPD_TEMP || a.value != phi->dst.value ||
+        b.kind != IR_OPD_CONST)
+      continue;
+    if (step->op == IR_ADD)
+      value = b.value;
+    else if (step->op == IR_SUB)
+      value = (int)(0u - (unsigned int)b.value);
+    else
+      continue;
+
+    strength->iv_loop[phi->dst.value] = l;
+    strength->iv_step[phi->dst.value] = value;
+    strength->iv_init[phi->dst.value] = init;
+    strength->stats->induction_variables++;
+  }
+}
+
+//! Replaces 'temp' by a new induction variable starting at 'init' and
+//! stepping by 'step' (a byte offset for pointers)
+static void add_recurrence(strength_t *strength, const ir_loop_t *loop, int l,
+                           int temp, ir_type_t type, ir_operand_t init,
+                           int step) {
+  ir_operand_t value = new_temp(strength, type);
+  ir_operand_t next = new_temp(strength, type);
+  ir_block_t *latch = &strength->function->blocks[loop->latches[0]];
+
+  insert(strength, loop->latches[0], latch->count - 1,
+         type == IR_TYPE_PTR ? IR_PTRADD : IR_ADD, next, value,
+         ir_const(step));
+
+  insert(strength, loop->header, 0, IR_PHI, value, ir_none(), ir_none());
+  ir_operand_t args[4] = {ir_block(loop->preheader), init,
+                          ir_block(loop->latches[0]), next};
+  ir_set_args(&strength->function->blocks[loop->header].instrs[0], args, 4);
+
+  strength->iv_loop[value.value] = l;
+  strength->iv_step[value.value] = step;
+  strength->iv_init[value.value] = init;
+
+  int block = strength->def_block[temp], index = strength->def_index[temp];
+  ir_remove_instr(&strength->function->blocks[block].instrs[index]);
+  strength->leaders[temp] = value;
+  strength->def_block[temp] = -1;
+}
+
+//! Multiplications of an induction variable by a constant and array
+//! addresses indexed by one, in the order of the loop's blocks
+static void reduce_loop(strength_t *strength, const ir_loops_t *loops, int l,
+                        int *stamp) {
+  ir_function_t *function = strength->function;
+  const ir_loop_t *loop = &loops->loops[l];
+  int *candidates = NULL;
+  int count = 0, capacity = 0;
+
+  if (loop->preheader < 0 || loop->latch_count != 1)
+    return;
+
+  for (int b = 0; b < loop->block_count; b++)
+    stamp[loop->blocks[b]] = l;
+
+  find_basic(strength, loop, l, stamp);
+
+  for (int b = 0; b < loop->block_count; b++) {
+    const ir_block_t *block = &function->blocks[loop->blocks[b]];
+    for (int i = 0; i < block->count; i++) {
+      const ir_instr_t *instr = &block->instrs[i];
+      if (instr->op != IR_MUL && instr->op != IR_PTRADD)
+        continue;
+      if (count == capacity) {
+        capacity = capacity ? capacity * 2 : 16;
+        candidates =
+            (int *)strength_realloc(candidates, capacity * sizeof(int));
+      }
+      candidates[count++] = instr->dst.value;
+    }
+  }
+
+  // An address may be listed before the product it adds, so the candidates
+  // are retried until nothing changes
+  for (int changed = 1; changed;) {
+    changed = 0;
+
+    for (int c = 0; c < count; c++) {
+      int temp = candidates[c];
+      if (strength->def_block[temp] < 0)
+        continue;
+
+      ir_instr_t *instr = &function->blocks[strength->def_block[temp]]
+                               .instrs[strength->def_index[temp]];
+      ir_operand_t a = resolve(strength, instr->a);
+      ir_operand_t b = resolve(strength, instr->b);
+      ir_opcode_t op = instr->op;
+
+      if (op == IR_MUL) {
+        if (a.kind == IR_OPD_CONST) {
+          ir_operand_t swap = a;
+          a = b;
+          b = swap;
+        }
+        if (a.kind != IR_OPD_TEMP || strength->iv_loop[a.value] != l ||
+            b.kind != IR_OPD_CONST)
+          continue;
+
+        ir_operand_t init =
+            emit_at_end(strength, loop->preheader, IR_MUL, IR_TYPE_I32,
+                        strength->iv_init[a.value], b);
+        int step = (int)((unsigned int)strength->iv_step[a.value] *
+                         (unsigned int)b.value);
+        add_recurrence(strength, loop, l, temp, IR_TYPE_I32, init, step);
+        strength->stats->recurrences++;
+      } else {
+        if (b.kind != IR_OPD_TEMP || strength->iv_loop[b.value] != l ||
+            in_loop(strength, stamp, l, a))
+          continue;
+
+        ir_operand_t init =
+            emit_at_end(strength, loop->preheader, IR_PTRADD, IR_TYPE_PTR, a,
+                        strength->iv_init[b.value]);
+        add_recurrence(strength, loop, l, temp, IR_TYPE_PTR, init,
+                       strength->iv_step[b.value]);
+        strength->stats->pointers++;
+      }
+      changed = 1;
+    }
+  }
+
+  free(candidates);
+}
+
+// ----------------------- Shifts and Divisions ----------------------
+
+//! Exponent of a power of two, -1 for other values
+static int power_of_two(int value) {
+  unsigned int bits = (unsigned int)value;
+  if (bits < 2 || (bits & (bits - 1)))
+    return -1;
+
+  int exponent = 0;
+  while (bits > 1) {
+    bits >>= 1;
+    exponent++;
+  }
+  return exponent;
+}
+
+//! Magic number and shift for a signed division by 'divisor' (Hacker's
+//! Delight, 10-1). The divisor must not be -1, 0 or 1
+static void magic_number(int divisor, int *magic, int *shift) {
+  const unsigned int two31 = 0x80000000u;
+  unsigned int absolute = divisor < 0 ? 0u - (unsigned int)divisor
+                                      : (unsigned int)divisor;
+  unsigned int t = two31 + ((unsigned int)divisor >> 31);
+  unsigned int anc = t - 1 - t % absolute;
+  unsigned int q1 = two31 / anc, r1 = two31 - q1 * anc;
+  unsigned int q2 = two31 / absolute, r2 = two31 - q2 * absolute;
+  unsigned int delta;
+  int p = 31;
+
+  do {
+    p++;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      q1++;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= absolute) {
+      q2++;
+      r2 -= absolute;
+    }
+    delta = absolute - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+
+  *magic = (int)(q2 + 1);
+  if (divisor < 0)
+    *magic = (int)(0u - (unsigned int)*magic);
+  *shift = p - 32;
+}
+
+//! Emits 'op' before the instruction at 'position', returns the result
+static ir_operand_t emit_before(strength_t *strength, int block,
+                                int *position, ir_opcode_t op, ir_operand_t a,
+                                ir_operand_t b) {
+  ir_operand_t dst = new_temp(strength, IR_TYPE_I32);
+  ir_insert(strength->function, block, (*position)++, op, dst, a, b);
+  return dst;
+}
+
+//! Rewrites 'dst = x / divisor' at 'position' into shifts, or a
+//! multiply-high and shifts, advancing 'position' to it
+static void expand_division(strength_t *strength, int block, int *position) {
+  ir_instr_t *instr = &strength->function->blocks[block].instrs[*position];
+  ir_operand_t x = instr->a;
+  int divisor = instr->b.value;
+
+  if (divisor == INT_MIN) { // Only INT_MIN itself gives a non-zero quotient
+    instr->op = IR_EQ;
+    return;
+  }
+
+  int exponent = power_of_two(divisor < 0 ? -divisor : divisor);
+
+  ir_opcode_t last_op;
+  ir_operand_t last_a, last_b;
+
+  if (exponent > 0) {
+    // Negative dividends are biased by 2^k - 1 to truncate toward zero
+    ir_operand_t sign = x;
+    if (exponent > 1)
+      sign = emit_before(strength, block, position, IR_SAR, x, ir_const(31));
+    ir_operand_t bias = emit_before(strength, block, position, IR_SHR, sign,
+                                    ir_const(32 - exponent));
+    ir_operand_t biased =
+        emit_before(strength, block, position, IR_ADD, x, bias);
+
+    if (divisor > 0) {
+      last_op = IR_SAR, last_a = biased, last_b = ir_const(exponent);
+    } else {
+      ir_operand_t quotient = emit_before(strength, block, position, IR_SAR,
+                                          biased, ir_const(exponent));
+      last_op = IR_SUB, last_a = ir_const(0), last_b = quotient;
+    }
+  } else {
+    int magic, shift;
+    magic_number(divisor, &magic, &shift);
+
+    ir_operand_t quotient = emit_before(strength, block, position, IR_MULHI,
+                                        x, ir_const(magic));
+    if (divisor > 0 && magic < 0)
+      quotient = emit_before(strength, block, position, IR_ADD, quotient, x);
+    else if (divisor < 0 && magic > 0)
+      quotient = emit_before(strength, block, position, IR_SUB, quotient, x);
+    if (shift > 0)
+      quotient = emit_before(strength, block, position, IR_SAR, quotient,
+                             ir_const(shift));
+
+    // Adds one to negative quotients, which were rounded down
+    ir_operand_t sign = emit_before(strength, block, position, IR_SHR,
+                                    quotient, ir_const(31));
+    last_op = IR_ADD, last_a = quotient, last_b = sign;
+  }
+
+  instr = &strength->function->blocks[block].instrs[*position];
+  instr->op = last_op;
+  instr->a = last_a;
+  instr->b = last_b;
+}
+
+static void reduce_operations(strength_t *strength) {
+  ir_function_t *function = strength->function;
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+
+      if (instr->op == IR_MUL) {
+        if (instr->a.kind == IR_OPD_CONST) {
+          ir_operand_t swap = instr->a;
+          instr->a = instr->b;
+          instr->b = swap;
+        }
+        int exponent = instr->b.kind == IR_OPD_CONST
+                           ? power_of_two(instr->b.value)
+                           : -1;
+        if (exponent > 0) {
+          instr->op = IR_SHL;
+          instr->b = ir_const(exponent);
+          strength->stats->shifts++;
+        }
+      } else if (instr->op == IR_DIV && instr->b.kind == IR_OPD_CONST &&
+                 instr->b.value != 0 && instr->b.value != 1 &&
+                 instr->b.value != -1) {
+        expand_division(strength, b, &i);
+        strength->stats->divisions++;
+      }
+    }
+}
+
+void ir_strength_function(ir_function_t *function,
+                          ir_strength_stats_t *stats) {
+  strength_t strength = {.function = function, .stats = stats};
+
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  int temps = function->temp_count;
+  strength.capacity = temps;
+  strength.leaders =
+      (ir_operand_t *)strength_alloc(temps, sizeof(ir_operand_t));
+  strength.def_block = (int *)strength_alloc(temps, sizeof(int));
+  strength.def_index = (int *)strength_alloc(temps, sizeof(int));
+  strength.iv_loop = (int *)strength_alloc(temps, sizeof(int));
+  strength.iv_step = (int *)strength_alloc(temps, sizeof(int));
+  strength.iv_init =
+      (ir_operand_t *)strength_alloc(temps, sizeof(ir_operand_t));
+
+  for (int t = 0; t < temps; t++)
+    strength.def_block[t] = strength.iv_loop[t] = -1;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_operand_t dst = function->blocks[b].instrs[i].dst;
+      if (dst.kind == IR_OPD_TEMP) {
+        strength.def_block[dst.value] = b;
+        strength.def_index[dst.value] = i;
+      }
+    }
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  ir_loops_t *loops = ir_loops_find(function, dominance);
+  int *stamp = (int *)strength_alloc(function->block_count, sizeof(int));
+  for (int b = 0; b < function->block_count; b++)
+    stamp[b] = -1;
+
+  for (int l = 0; l < loops->loop_count; l++)
+    reduce_loop(&strength, loops, l, stamp);
+
+  free(stamp);
+  ir_loops_destroy(loops);
+  ir_dominance_destroy(dominance);
+
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++) {
+        ir_operand_t *use = ir_use(instr, u);
+        if (use->kind == IR_OPD_TEMP)
+          *use = resolve(&strength, *use);
+      }
+    }
+
+  reduce_operations(&strength);
+  ir_compact_function(function, NULL);
+
+  free(strength.leaders);
+  free(strength.def_block);
+  free(strength.def_index);
+  free(strength.iv_loop);
+  free(strength.iv_step);
+  free(strength.iv_init);
+}
@@ -0,0 +1,28 @@
+#ifndef IR_STRENGTH_H
+#define IR_STRENGTH_H
+
+#include "ir.h"
+
+typedef struct {
+  long induction_variables; // Header phis stepping by a constant
+  long recurrences;         // Multiplications turned into additions
+  long pointers;            // Array addresses turned into pointer increments
+  long shifts;              // Multiplications by a power of two
+  long divisions;           // Divisions by a constant
+} ir_strength_stats_t;
+
+//! Strength reduction over a function in SSA form, after the loop-invariant
+//! code motion gave the loops their preheaders.
+//!
+//! In loops with a single latch, the basic induction variables are the
+//! header phis whose latch value adds a constant to them. A multiplication
+//! of one by a constant, and an array address indexed by one, becomes a new
+//! induction variable of its own, started in the preheader and stepped at
+//! the end of the latch.
+//!
+//! Then, in every block, multiplications by a power of two become shifts and
+//! divisions by a constant become a multiply-high by a magic number with the
+//! corrections giving the same truncated quotient as the division
+void ir_strength_function(ir_function_t *function, ir_strength_stats_t *stats);
+
+#endif // !IR_STRENGTH_H
@@ -0,0 +1,624 @@
+#include "ir_unroll.h"
+#include "ir_dominance.h"
+#include "ir_loop.h"
+
+#include <stdlib.h>
+
+#define INT_SIZE 4          // Bytes of a C- int
+#define UNROLL_OFFSET 65536 // Farthest element from i a vector may access
+
+//! Loop of a header testing its induction variable and of a single body
+typedef struct {
+  int preheader;
+  int header;
+  int body;
+  int iv;             // Header phi the body adds 1 to
+  int step;           // 'iv + 1', taken by the phi from the body
+  ir_operand_t limit; // Invariant, the loop runs while iv < limit
+} simple_loop_t;
+
+//! Elements 'base[i + offset]' of an array
+typedef struct {
+  ir_operand_t base;
+  int offset;
+} stream_t;
+
+//! Operand of a vector operation: four elements or an invariant int
+typedef struct {
+  int loaded;
+  stream_t stream;
+  ir_operand_t value;
+} vector_operand_t;
+
+//! Four iterations of a body storing 'a op b' into an array
+typedef struct {
+  ir_opcode_t op; // IR_VADD or IR_VSUB
+  stream_t target;
+  vector_operand_t operands[2];
+  ir_operand_t checks[4]; // Pairs of arrays that must differ
+  int check_count;
+} vector_t;
+
+typedef struct {
+  ir_function_t *function;
+  ir_unroll_stats_t *stats;
+  simple_loop_t loop;
+  int temp_count; // Temporaries when the loop was found
+  int *def_block; // -1 for the temporaries without a definition
+  int *def_index;
+  int *first;  // Phi of the new header for each phi of the header
+  int *clones; // Copies of the body temporaries, temp_count per copy
+} unroll_t;
+
+static void *unroll_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the loop "
+                    "unrolling.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static void find_definitions(unroll_t *unroll) {
+  ir_function_t *function = unroll->function;
+
+  free(unroll->def_block);
+  free(unroll->def_index);
+  unroll->temp_count = function->temp_count;
+  unroll->def_block = (int *)unroll_alloc(function->temp_count, sizeof(int));
+  unroll->def_index = (int *)unroll_alloc(function->temp_count, sizeof(int));
+
+  for (int t = 0; t < function->temp_count; t++)
+    unroll->def_block[t] = -1;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      const ir_instr_t *instr = &function->blocks[b].instrs[i];
+      if (instr->dst.kind == IR_OPD_TEMP) {
+        unroll->def_block[instr->dst.value] = b;
+        unroll->def_index[instr->dst.value] = i;
+      }
+    }
+}
+
+//! Instruction of the block defining a temporary, NULL for another operand
+static ir_instr_t *defined_in(const unroll_t *unroll, int block,
+                              ir_operand_t operand) {
+  if (operand.kind != IR_OPD_TEMP || operand.value >= unroll->temp_count ||
+      unroll->def_block[operand.value] != block)
+    return NULL;
+  return &unroll->function->blocks[block]
+              .instrs[unroll->def_index[operand.value]];
+}
+
+static int in_loop(const unroll_t *unroll, ir_operand_t operand) {
+  return defined_in(unroll, unroll->loop.header, operand) ||
+         defined_in(unroll, unroll->loop.body, operand);
+}
+
+static int is_temp(ir_operand_t operand, int temp) {
+  return operand.kind == IR_OPD_TEMP && operand.value == temp;
+}
+
+//! Whether an instruction computes 'temp + offset'
+static int offset_of(const ir_instr_t *instr, int temp, int *offset) {
+  ir_operand_t a = instr->a, b = instr->b;
+
+  if (instr->op == IR_ADD && a.kind == IR_OPD_CONST) {
+    a = instr->b;
+    b = instr->a;
+  }
+  if ((instr->op != IR_ADD && instr->op != IR_SUB) || !is_temp(a, temp) ||
+      b.kind != IR_OPD_CONST)
+    return 0;
+
+  *offset = instr->op == IR_ADD ? b.value
+                                : (int)(0u - (unsigned int)b.value);
+  return 1;
+}
+
+static int count_uses(ir_function_t *function, int temp) {
+  int count = 0;
+  for (int b = 0; b < function->block_count; b++)
+    for (int i = 0; i < function->blocks[b].count; i++) {
+      ir_instr_t *instr = &function->blocks[b].instrs[i];
+      for (int u = 0; u < ir_use_count(instr); u++)
+        count += is_temp(*ir_use(instr, u), temp);
+    }
+  return count;
+}
+
+// ----------------------- Loops ----------------------
+
+//! Fills unroll->loop when the loop has the expected shape
+static int find_loop(unroll_t *unroll, const ir_loop_t *loop) {
+  ir_function_t *function = unroll->function;
+  simple_loop_t *found = &unroll->loop;
+
+  if (loop->block_count != 2 || loop->latch_count != 1 ||
+      loop->preheader < 0)
+    return 0;
+
+  found->preheader = loop->preheader;
+  found->header = loop->header;
+  found->body = loop->latches[0];
+
+  ir_block_t *header = &function->blocks[found->header];
+  ir_instr_t *branch = ir_terminator(header);
+  ir_instr_t *jump = ir_terminator(&function->blocks[found->body]);
+  if (!branch || branch->op != IR_BR ||
+      branch->args[0].value != found->body ||
+      branch->args[1].value == found->body || !jump || jump->op != IR_JMP)
+    return 0;
+
+  // Phis, the test and the branch
+  ir_instr_t *test = NULL;
+  for (int i = 0; i < header->count - 1; i++) {
+    ir_instr_t *instr = &header->instrs[i];
+    if (instr->op == IR_PHI || instr->op == IR_NOP)
+      continue;
+    if (test)
+      return 0;
+    test = instr;
+  }
+  if (!test || test->dst.kind != IR_OPD_TEMP ||
+      !is_temp(branch->a, test->dst.value))
+    return 0;
+
+  ir_operand_t iv = test->op == IR_LT ? test->a : test->b;
+  found->limit = test->op == IR_LT ? test->b : test->a;
+  if ((test->op != IR_LT && test->op != IR_GT) ||
+      in_loop(unroll, found->limit) || iv.kind != IR_OPD_TEMP)
+    return 0;
+
+  ir_instr_t *phi = defined_in(unroll, found->header, iv);
+  if (!phi || phi->op != IR_PHI)
+    return 0;
+  ir_operand_t next = *ir_phi_source(phi, found->body);
+  ir_instr_t *step = defined_in(unroll, found->body, next);
+  int offset;
+  if (!step || !offset_of(step, iv.value, &offset) || offset != 1)
+    return 0;
+  found->iv = iv.value;
+  found->step = next.value;
+
+  for (int i = 0; i < function->blocks[found->body].count; i++)
+    if (function->blocks[found->body].instrs[i].op == IR_PHI)
+      return 0;
+
+  return count_uses(function, test->dst.value) == 1;
+}
+
+// ----------------------- Vectors ----------------------
+
+//! Whether an address is 'base + INT_SIZE * (i + offset)', base invariant
+static int find_stream(const unroll_t *unroll, ir_operand_t address,
+                       stream_t *stream) {
+  int body = unroll->loop.body, iv = unroll->loop.iv;
+  const ir_instr_t *add = defined_in(unroll, body, address);
+  if (!add || add->op != IR_PTRADD || in_loop(unroll, add->a))
+    return 0;
+
+  const ir_instr_t *scale = defined_in(unroll, body, add->b);
+  if (!scale || scale->op != IR_MUL)
+    return 0;
+  ir_operand_t index = scale->a, size = scale->b;
+  if (index.kind == IR_OPD_CONST) {
+    index = scale->b;
+    size = scale->a;
+  }
+  if (size.kind != IR_OPD_CONST || size.value != INT_SIZE)
+    return 0;
+
+  int offset = 0;
+  if (!is_temp(index, iv)) {
+    const ir_instr_t *shift = defined_in(unroll, body, index);
+    if (!shift || !offset_of(shift, iv, &offset) ||
+        offset < -UNROLL_OFFSET || offset > UNROLL_OFFSET)
+      return 0;
+  }
+
+  *stream = (stream_t){add->a, offset};
+  return 1;
+}
+
+static int find_operand(const unroll_t *unroll, ir_operand_t value,
+                        vector_operand_t *operand) {
+  if (value.kind == IR_OPD_CONST ||
+      (value.kind == IR_OPD_TEMP && !in_loop(unroll, value) &&
+       unroll->function->temp_types[value.value] == IR_TYPE_I32)) {
+    *operand = (vector_operand_t){.loaded = 0, .value = value};
+    return 1;
+  }
+
+  const ir_instr_t *load = defined_in(unroll, unroll->loop.body, value);
+  operand->loaded = 1;
+  return load && load->op == IR_LOAD &&
+         find_stream(unroll, load->a, &operand->stream);
+}
+
+//! Instruction defining a temporary, NULL for another operand
+static ir_instr_t *definition(const unroll_t *unroll, ir_operand_t operand) {
+  if (operand.kind != IR_OPD_TEMP || operand.value >= unroll->temp_count ||
+      unroll->def_block[operand.value] < 0)
+    return NULL;
+  return defined_in(unroll, unroll->def_block[operand.value], operand);
+}
+
+//! 1 for the same array, 0 for disjoint ones, -1 when only known at run
+//! time. Every array value is the start of an array
+static int same_array(const unroll_t *unroll, ir_operand_t a, ir_operand_t b) {
+  if (a.kind == b.kind && a.value == b.value)
+    return 1;
+
+  const ir_instr_t *first = definition(unroll, a);
+  const ir_instr_t *second = definition(unroll, b);
+  if (!first || !second || first->op != IR_ADDR || second->op != IR_ADDR)
+    return -1;
+  return first->a.kind == second->a.kind && first->a.value == second->a.value;
+}
+
+//! The vector operation the body amounts to, if any
+static int plan_vector(const unroll_t *unroll, vector_t *vector) {
+  ir_function_t *function = unroll->function;
+  const ir_block_t *header = &function->blocks[unroll->loop.header];
+  const ir_block_t *body = &function->blocks[unroll->loop.body];
+  const ir_instr_t *store = NULL;
+
+  for (int i = 0; i < header->count; i++)
+    if (header->instrs[i].op == IR_PHI &&
+        !is_temp(header->instrs[i].dst, unroll->loop.iv))
+      return 0;
+
+  for (int i = 0; i < body->count; i++) {
+    const ir_instr_t *instr = &body->instrs[i];
+    if (instr->op == IR_STORE && !store)
+      store = instr;
+    else if (ir_instr_has_side_effects(instr) &&
+             !IR_IS_TERMINATOR(instr->op))
+      return 0;
+  }
+  if (!store || !find_stream(unroll, store->a, &vector->target))
+    return 0;
+
+  const ir_instr_t *value = defined_in(unroll, unroll->loop.body, store->b);
+  if (value && (value->op == IR_ADD || value->op == IR_SUB)) {
+    vector->op = value->op == IR_ADD ? IR_VADD : IR_VSUB;
+    if (!find_operand(unroll, value->a, &vector->operands[0]) ||
+        !find_operand(unroll, value->b, &vector->operands[1]))
+      return 0;
+  } else {
+    vector->op = IR_VADD;
+    vector->operands[1] = (vector_operand_t){.loaded = 0, .value = ir_const(0)};
+    if (!find_operand(unroll, store->b, &vector->operands[0]))
+      return 0;
+  }
+
+  // A read up to three elements behind the write would see a value four
+  // iterations at once have not stored yet
+  vector->check_count = 0;
+  for (int o = 0; o < 2; o++) {
+    const vector_operand_t *operand = &vector->operands[o];
+    int distance = operand->loaded ? operand->stream.offset -
+                                         vector->target.offset
+                                   : 0;
+    if (distance >= 0 || distance <= -IR_UNROLL_FACTOR)
+      continue;
+
+    int same = same_array(unroll, vector->target.base, operand->stream.base);
+    if (same > 0)
+      return 0;
+    if (same < 0 && !(vector->check_count == 2 &&
+                      is_temp(vector->checks[1], operand->stream.base.value))) {
+      vector->checks[vector->check_count++] = vector->target.base;
+      vector->checks[vector->check_count++] = operand->stream.base;
+    }
+  }
+  return 1;
+}
+
+//! Address of the stream in an iteration of the vector loop, where
+//! 'scaled' is INT_SIZE * i. Each array is only indexed once
+static ir_operand_t emit_stream(unroll_t *unroll, int block,
+                                const stream_t *stream, ir_operand_t scaled,
+                                ir_operand_t *starts, int *start_count) {
+  ir_function_t *function = unroll->function;
+  ir_operand_t start = ir_none();
+
+  for (int s = 0; s < *start_count; s += 2)
+    if (is_temp(starts[s], stream->base.value))
+      start = starts[s + 1];
+  if (start.kind == IR_OPD_NONE) {
+    start = ir_temp(ir_new_temp(function, IR_TYPE_PTR, NULL));
+    ir_emit(function, block, IR_PTRADD, start, stream->base, scaled);
+    starts[(*start_count)++] = stream->base;
+    starts[(*start_count)++] = start;
+  }
+  if (!stream->offset)
+    return start;
+
+  ir_operand_t address = ir_temp(ir_new_temp(function, IR_TYPE_PTR, NULL));
+  ir_emit(function, block, IR_PTRADD, address, start,
+          ir_const(INT_SIZE * stream->offset));
+  return address;
+}
+
+//! Four iterations with one vector operation. Returns the next value of i
+static ir_operand_t emit_vector(unroll_t *unroll, int block,
+                                const vector_t *vector) {
+  ir_function_t *function = unroll->function;
+  ir_operand_t iv = ir_temp(unroll->first[unroll->loop.iv]);
+  ir_operand_t starts[6], values[2];
+  int start_count = 0;
+
+  ir_operand_t scaled = ir_temp(ir_new_temp(function, IR_TYPE_I32, NULL));
+  ir_emit(function, block, IR_MUL, scaled, iv, ir_const(INT_SIZE));
+
+  ir_operand_t target = emit_stream(unroll, block, &vector->target, scaled,
+                                    starts, &start_count);
+  for (int o = 0; o < 2; o++)
+    values[o] = vector->operands[o].loaded
+                    ? emit_stream(unroll, block, &vector->operands[o].stream,
+                                  scaled, starts, &start_count)
+                    : vector->operands[o].value;
+
+  ir_instr_t *operation =
+      ir_emit(function, block, vector->op, ir_none(), target, values[0]);
+  ir_set_args(operation, &values[1], 1);
+
+  ir_operand_t next = ir_temp(ir_new_temp(
+      function, IR_TYPE_I32, function->temp_names[unroll->loop.iv]));
+  ir_emit(function, block, IR_ADD, next, iv, ir_const(IR_UNROLL_FACTOR));
+  return next;
+}
+
+// ----------------------- Copies ----------------------
+
+//! Value of an operand of the body in one of its copies
+static ir_operand_t copied(const unroll_t *unroll, int copy,
+                           ir_operand_t operand) {
+  const simple_loop_t *loop = &unroll->loop;
+
+  if (defined_in(unroll, loop->body, operand))
+    return ir_temp(unroll->clones[copy * unroll->temp_count + operand.value]);
+
+  ir_instr_t *phi = defined_in(unroll, loop->header, operand);
+  if (!phi)
+    return operand;
+  if (!copy)
+    return ir_temp(unroll->first[operand.value]);
+  return copied(unroll, copy - 1, *ir_phi_source(phi, loop->body));
+}
+
+//! 'base + INT_SIZE * i', base invariant: the copies add to the address of
+//! the first one, which the strength reduction turns into a pointer
+static int is_indexed_address(const unroll_t *unroll, const ir_instr_t *instr) {
+  if (instr->op != IR_PTRADD || in_loop(unroll, instr->a))
+    return 0;
+
+  const ir_instr_t *scale = defined_in(unroll, unroll->loop.body, instr->b);
+  return scale && scale->op == IR_MUL &&
+         ((is_temp(scale->a, unroll->loop.iv) &&
+           scale->b.kind == IR_OPD_CONST && scale->b.value == INT_SIZE) ||
+          (is_temp(scale->b, unroll->loop.iv) &&
+           scale->a.kind == IR_OPD_CONST && scale->a.value == INT_SIZE));
+}
+
+static int body_size(const unroll_t *unroll) {
+  const ir_block_t *body = &unroll->function->blocks[unroll->loop.body];
+  int size = 0;
+
+  for (int i = 0; i < body->count; i++) {
+    if (body->instrs[i].op == IR_CALL)
+      return IR_UNROLL_SIZE + 1;
+    size += body->instrs[i].op != IR_NOP &&
+            !IR_IS_TERMINATOR(body->instrs[i].op);
+  }
+  return size;
+}
+
+//! Appends a copy of the body. The step of i adds to the first value of i,
+//! so that it stays an induction variable of the new loop
+static void emit_copy(unroll_t *unroll, int block, int copy) {
+  ir_function_t *function = unroll->function;
+  const simple_loop_t *loop = &unroll->loop;
+
+  for (int i = 0; i < function->blocks[loop->body].count; i++) {
+    const ir_instr_t *instr = &function->blocks[loop->body].instrs[i];
+    if (instr->op == IR_NOP || IR_IS_TERMINATOR(instr->op))
+      continue;
+
+    ir_opcode_t op = instr->op;
+    ir_operand_t dst = instr->dst, a, b;
+    if (dst.kind == IR_OPD_TEMP) {
+      dst = ir_temp(ir_new_temp(function, function->temp_types[dst.value],
+                                function->temp_names[dst.value]));
+      unroll->clones[copy * unroll->temp_count + instr->dst.value] =
+          dst.value;
+    }
+
+    if (is_temp(instr->dst, loop->step)) {
+      op = IR_ADD;
+      a = ir_temp(unroll->first[loop->iv]);
+      b = ir_const(copy + 1);
+    } else if (copy && is_indexed_address(unroll, instr)) {
+      a = ir_temp(unroll->clones[instr->dst.value]);
+      b = ir_const(INT_SIZE * copy);
+    } else {
+      a = copied(unroll, copy, instr->a);
+      b = copied(unroll, copy, instr->b);
+    }
+
+    ir_instr_t *added = ir_emit(function, block, op, dst, a, b);
+    if (instr->arg_count) {
+      ir_set_args(added, instr->args, instr->arg_count);
+      for (int g = 0; g < added->arg_count; g++)
+        added->args[g] = copied(unroll, copy, added->args[g]);
+    }
+  }
+}
+
+// ----------------------- Rewriting ----------------------
+
+static ir_operand_t emit_value(ir_function_t *function, int block,
+                               ir_opcode_t op, ir_operand_t a,
+                               ir_operand_t b) {
+  ir_operand_t dst = ir_temp(ir_new_temp(function, IR_TYPE_I32, NULL));
+  ir_emit(function, block, op, dst, a, b);
+  return dst;
+}
+
+static void emit_phi(ir_function_t *function, int block, int dst,
+                     ir_operand_t *sources) {
+  ir_instr_t *phi =
+      ir_emit(function, block, IR_PHI, ir_temp(dst), ir_none(), ir_none());
+  ir_set_args(phi, sources, 4);
+}
+
+static void emit_branch(ir_function_t *function, int block,
+                        ir_operand_t condition, int on_true, int on_false) {
+  ir_operand_t targets[2] = {ir_block(on_true), ir_block(on_false)};
+  ir_instr_t *branch = ir_emit(function, block, IR_BR, ir_none(), condition,
+                               ir_none());
+  ir_set_args(branch, targets, 2);
+}
+
+//! Puts the new loop before the original one, which runs the remaining
+//! iterations. With checks, the preheader only enters it when the arrays
+//! of each pair differ
+static void rewrite_loop(unroll_t *unroll, const vector_t *vector) {
+  ir_function_t *function = unroll->function;
+  const simple_loop_t *loop = &unroll->loop;
+  int checks = vector ? vector->check_count : 0;
+  int entry = checks ? ir_new_block(function) : loop->preheader;
+  int header = ir_new_block(function);
+  int body = ir_new_block(function);
+  int join = ir_new_block(function);
+  int phi_count = 0;
+
+  while (function->blocks[loop->header].instrs[phi_count].op == IR_PHI) {
+    int phi = function->blocks[loop->header].instrs[phi_count++].dst.value;
+    unroll->first[phi] = ir_new_temp(function, function->temp_types[phi],
+                                     function->temp_names[phi]);
+  }
+
+  // Four more iterations at least: i < limit and limit - i > 3, which
+  // wraps around to a negative number only when i is far below the limit
+  ir_operand_t iv = ir_temp(unroll->first[loop->iv]);
+  ir_operand_t below = emit_value(function, header, IR_LT, iv, loop->limit);
+  ir_operand_t left = emit_value(function, header, IR_SUB, loop->limit, iv);
+  ir_operand_t enough = emit_value(function, header, IR_GT, left,
+                                   ir_const(IR_UNROLL_FACTOR - 1));
+  emit_branch(function, header,
+              emit_value(function, header, IR_MUL, below, enough), body, join);
+
+  ir_operand_t next = ir_none();
+  if (vector)
+    next = emit_vector(unroll, body, vector);
+  else
+    for (int copy = 0; copy < IR_UNROLL_FACTOR; copy++)
+      emit_copy(unroll, body, copy);
+  ir_emit(function, body, IR_JMP, ir_none(), ir_block(header), ir_none());
+
+  // The phis of the new header, and the values entering the original one
+  for (int p = 0; p < phi_count; p++) {
+    ir_instr_t *phi = &function->blocks[loop->header].instrs[p];
+    int dst = phi->dst.value;
+    ir_operand_t init = *ir_phi_source(phi, loop->preheader);
+    ir_operand_t latch =
+        vector ? next
+               : copied(unroll, IR_UNROLL_FACTOR - 1,
+                        *ir_phi_source(phi, loop->body));
+    ir_operand_t entering = ir_temp(unroll->first[dst]);
+    ir_operand_t sources[4] = {ir_block(entry), init, ir_block(body), latch};
+
+    ir_insert(function, header, p, IR_PHI, entering, ir_none(), ir_none());
+    ir_set_args(&function->blocks[header].instrs[p], sources, 4);
+
+    if (checks) {
+      ir_operand_t merged[4] = {ir_block(loop->preheader), init,
+                                ir_block(header), entering};
+      entering = ir_temp(ir_new_temp(function, function->temp_types[dst],
+                                     function->temp_names[dst]));
+      emit_phi(function, join, entering.value, merged);
+    }
+
+    phi = &function->blocks[loop->header].instrs[p];
+    for (int a = 0; a < phi->arg_count; a += 2)
+      if (phi->args[a].value == loop->preheader) {
+        phi->args[a] = ir_block(join);
+        phi->args[a + 1] = entering;
+      }
+  }
+  ir_emit(function, join, IR_JMP, ir_none(), ir_block(loop->header),
+          ir_none());
+
+  ir_instr_t *jump = ir_terminator(&function->blocks[loop->preheader]);
+  if (!checks) {
+    jump->a = ir_block(header);
+    return;
+  }
+
+  ir_remove_instr(jump);
+  ir_operand_t differ = ir_none();
+  for (int c = 0; c < checks; c += 2) {
+    ir_operand_t pair = emit_value(function, loop->preheader, IR_NE,
+                                   vector->checks[c], vector->checks[c + 1]);
+    differ = differ.kind == IR_OPD_NONE
+                 ? pair
+                 : emit_value(function, loop->preheader, IR_MUL, differ, pair);
+  }
+  emit_branch(function, loop->preheader, differ, entry, join);
+  ir_emit(function, entry, IR_JMP, ir_none(), ir_block(header), ir_none());
+  unroll->stats->alias_checks += checks / 2;
+}
+
+void ir_unroll_function(ir_function_t *function, ir_unroll_stats_t *stats) {
+  if (function->is_builtin || !function->block_count)
+    return;
+
+  ir_dominance_t *dominance = ir_dominance_compute(function);
+  ir_loops_t *loops = ir_loops_find(function, dominance);
+  char *outer = (char *)unroll_alloc(loops->loop_count, sizeof(char));
+  unroll_t unroll = {.function = function, .stats = stats};
+  int changed = 0;
+
+  for (int l = 0; l < loops->loop_count; l++)
+    if (loops->loops[l].parent >= 0)
+      outer[loops->loops[l].parent] = 1;
+
+  for (int l = 0; l < loops->loop_count; l++) {
+    if (outer[l])
+      continue;
+    find_definitions(&unroll);
+    if (!find_loop(&unroll, &loops->loops[l]))
+      continue;
+
+    vector_t vector;
+    int vectorize = plan_vector(&unroll, &vector);
+    if (!vectorize && body_size(&unroll) > IR_UNROLL_SIZE)
+      continue;
+
+    unroll.first = (int *)unroll_alloc(unroll.temp_count, sizeof(int));
+    unroll.clones = (int *)unroll_alloc(
+        (size_t)IR_UNROLL_FACTOR * unroll.temp_count, sizeof(int));
+    rewrite_loop(&unroll, vectorize ? &vector : NULL);
+    free(unroll.first);
+    free(unroll.clones);
+
+    if (vectorize)
+      stats->vectorized++;
+    else
+      stats->unrolled++;
+    changed = 1;
+  }
+
+  if (changed)
+    ir_compact_function(function, NULL);
+
+  free(unroll.def_block);
+  free(unroll.def_index);
+  free(outer);
+  ir_loops_destroy(loops);
+  ir_dominance_destroy(dominance);
+}
@@ -0,0 +1,33 @@
+#ifndef IR_UNROLL_H
+#define IR_UNROLL_H
+
+#include "ir.h"
+
+#define IR_UNROLL_FACTOR 4 // Copies of an unrolled body, ints of a vector
+#define IR_UNROLL_SIZE 16  // Largest body unrolled, in instructions
+
+typedef struct {
+  long unrolled;     // Loops running their body four times per iteration
+  long vectorized;   // Loops running four iterations at once
+  long alias_checks; // Arrays compared before a vectorized loop
+} ir_unroll_stats_t;
+
+//! Unrolls the innermost loops of a function in SSA form, once the loops
+//! have their preheaders and before the strength reduction, which then
+//! steps the addresses of the new loops.
+//!
+//! A loop qualifies when it is a header testing 'i < n', with n invariant,
+//! and a single block adding 1 to i. A new loop runs first while at least
+//! four iterations remain, and the original one runs the rest.
+//!
+//! When the body only stores, at a constant offset from i, the sum or the
+//! difference of ints loaded the same way or invariant, the new loop does
+//! four iterations with one vector operation. Arrays are only ever passed
+//! whole, so two of them are either the same or disjoint: the vector loop
+//! is right unless it reads at most three elements behind the one it
+//! writes, in the same array. When that depends on the arrays a function
+//! was given, they are compared before the loop, which only runs when they
+//! differ. Otherwise the body is copied four times, when small enough
+void ir_unroll_function(ir_function_t *function, ir_unroll_stats_t *stats);
+
+#endif // !IR_UNROLL_H
@@ -7,6 +7,7 @@
 #include <string.h>
 
 int VERBOSE_LEXER = 0;
+int DEFERRED_LEXER = 0;
 FILE *filename = NULL;
 
 int current_line = 1;
@@ -16,17 +17,22 @@ int current_column = 0;
 
 void set_verbose_lexer(int is_verbose) { VERBOSE_LEXER = is_verbose; }
 
+void set_deferred_lexer(int is_deferred) { DEFERRED_LEXER = is_deferred; }
+
 void init_lexer(const char *file) {
   if (filename) {
     fclose(filename);
   }
   filename = fopen(file, "r");
+  current_line = 1;
+  current_column = 0;
 
   lexer_hash_init();
 }
 
 void close_lexer() {
   fclose(filename);
+  filename = NULL;
 
   lexer_hash_delete();
 }
@@ -40,7 +46,7 @@ token_t *get_next_token() {
   while (1) {
     c = get_next_char();
 
-    if (c == EOF) {
+    if (c == EOF && state != 1 && state != 2) {
       return NULL; // End of file
     }
     if (IS_WHITESPACE(c) && state == 0) {
@@ -159,6 +165,7 @@ token_t *get_next_token() {
       break;
     case 7:
       if (c != '*') {
+        unget_char(c);
         return create_token(TOKEN_DIV, "/");
       } else { // c == *
         state = 8;
@@ -171,6 +178,8 @@ token_t *get_next_token() {
     case 9:
       if (c == '/')
         state = 0;
+      else if (c != '*')
+        state = 8;
       break;
     default:
       return create_token(TOKEN_UNKNOWN, (char[]){c, '\0'});
@@ -186,6 +195,10 @@ token_t *create_token(token_types_t type, const char *lexeme) {
   token->line = current_line;
   token->column = current_column - strlen(lexeme);
 
+  // When deferred, the consumer prints the token and reports the error
+  if (DEFERRED_LEXER)
+    return token;
+
   if (VERBOSE_LEXER)
     print_token(token);
 
@@ -263,6 +276,8 @@ char *print_token_classes(token_types_t type) {
     return "LEFT BRACKET";
   case TOKEN_RBRACKET:
     return "RIGHT BRACKET";
+  case TOKEN_EOF:
+    return "END OF FILE";
   case TOKEN_UNKNOWN:
     return "UNKNOWN";
   default:
@@ -4,12 +4,16 @@
 #include <stdio.h>
 
 #define IS_WHITESPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
-#define IS_ID_SEPARATOR(c) (IS_WHITESPACE(c) || (c) == ';' || (c) == '[' || (c) == '(' || (c) == ')' || (c) == '{')
-#define IS_NUM_SEPARATOR(c) (IS_WHITESPACE(c) || (c) == ';')
+#define IS_SYMBOL(c) ((c) == ';' || (c) == ',' || (c) == '[' || (c) == ']' || (c) == '(' || (c) == ')' || \
+                      (c) == '{' || (c) == '}' || (c) == '+' || (c) == '-' || (c) == '*' || (c) == '/' || \
+                      (c) == '<' || (c) == '>' || (c) == '=' || (c) == '!')
+#define IS_ID_SEPARATOR(c) (IS_WHITESPACE(c) || IS_SYMBOL(c) || (c) == EOF)
+#define IS_NUM_SEPARATOR(c) (IS_WHITESPACE(c) || IS_SYMBOL(c) || (c) == EOF)
 
 #define LEXEME_MAX_SIZE 101 // 100 + \0
 
 extern int VERBOSE_LEXER;
+extern int DEFERRED_LEXER;
 extern FILE *filename;
 
 extern int current_line;
@@ -27,6 +31,8 @@ typedef enum {
   // Comments, ;, ,, (), [] and {}
   TOKEN_LCOMM, TOKEN_RCOMM, TOKEN_LPARENT, TOKEN_RPARENT,
   TOKEN_LKEY, TOKEN_RKEY, TOKEN_LBRACKET, TOKEN_RBRACKET,
+  // End of file
+  TOKEN_EOF,
   // Error
   TOKEN_UNKNOWN,
 } token_types_t;
@@ -43,6 +49,10 @@ typedef struct {
 //! Sets the option to print each token after getting it
 void set_verbose_lexer(int is_verbose);
 
+//! Defers token printing and lexical errors to whoever consumes the token
+//! (used when the lexer runs on its own thread)
+void set_deferred_lexer(int is_deferred);
+
 //! Setup the lexer internal state and current file being read
 void init_lexer(const char *filename);
 
@@ -0,0 +1,201 @@
+#include "token_pipeline.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOKEN_PIPELINE_MASK (TOKEN_PIPELINE_CAPACITY - 1)
+#define SPIN_LIMIT 64 // Busy waits before giving the core away
+
+// Single-producer/single-consumer ring buffer. The producer (lexer thread)
+// only writes 'head' and the consumer (parser) only writes 'tail', so no
+// locks are needed: each side publishes its index with release semantics
+// and reads the other one with acquire semantics.
+typedef struct {
+  token_t slots[TOKEN_PIPELINE_CAPACITY];
+
+  _Alignas(64) atomic_size_t head; // Next slot to be published by the lexer
+  _Alignas(64) atomic_size_t tail; // Next slot to be released by the parser
+  _Alignas(64) atomic_int stop;    // Asks the lexer thread to give up
+
+  // Producer private state
+  _Alignas(64) size_t producer_head;
+  size_t producer_cached_tail;
+
+  // Consumer private state
+  _Alignas(64) size_t consumer_tail;
+  size_t consumer_cached_head;
+  size_t consumer_published_tail;
+  token_t *current; // Slot handed to the parser, released on the next pop
+
+  pthread_t thread;
+  int running;
+} token_pipeline_t;
+
+static token_pipeline_t *pipeline = NULL;
+
+// ----------------------- Helpers ----------------------
+
+static void pipeline_wait(int *spins) {
+  if (++(*spins) < SPIN_LIMIT)
+    return;
+
+  *spins = 0;
+  sched_yield();
+}
+
+static void producer_publish() {
+  atomic_store_explicit(&pipeline->head, pipeline->producer_head,
+                        memory_order_release);
+}
+
+static void consumer_publish() {
+  atomic_store_explicit(&pipeline->tail, pipeline->consumer_tail,
+                        memory_order_release);
+  pipeline->consumer_published_tail = pipeline->consumer_tail;
+}
+
+// Waits for a free slot (backpressure), returns 0 if asked to stop
+static int producer_reserve() {
+  int spins = 0;
+
+  while (pipeline->producer_head - pipeline->producer_cached_tail >=
+         TOKEN_PIPELINE_CAPACITY) {
+    pipeline->producer_cached_tail =
+        atomic_load_explicit(&pipeline->tail, memory_order_acquire);
+
+    if (pipeline->producer_head - pipeline->producer_cached_tail <
+        TOKEN_PIPELINE_CAPACITY)
+      break;
+
+    // The buffer is full: everything must be visible to the parser before
+    // sleeping, otherwise both sides would wait for each other
+    producer_publish();
+    if (atomic_load_explicit(&pipeline->stop, memory_order_relaxed))
+      return 0;
+    pipeline_wait(&spins);
+  }
+
+  return 1;
+}
+
+static void *producer_main(void *arg) {
+  (void)arg;
+
+  while (1) {
+    if (!producer_reserve())
+      return NULL;
+
+    token_t *slot = &pipeline->slots[pipeline->producer_head &
+                                     TOKEN_PIPELINE_MASK];
+    token_t *token = get_next_token();
+
+    if (token) {
+      *slot = *token;
+      delete_token(token);
+    } else { // End of file
+      memset(slot, 0, sizeof(*slot));
+      slot->type = TOKEN_EOF;
+      slot->line = current_line;
+      slot->column = current_column;
+    }
+
+    pipeline->producer_head++;
+
+    // EOF and errors end the stream, so they are always published at once
+    if (slot->type == TOKEN_EOF || slot->type == TOKEN_UNKNOWN) {
+      producer_publish();
+      return NULL;
+    }
+
+    if (pipeline->producer_head % TOKEN_PIPELINE_BATCH == 0)
+      producer_publish();
+  }
+}
+
+// ----------------------- Functions ----------------------
+
+void token_pipeline_start() {
+  if (pipeline)
+    token_pipeline_stop();
+
+  pipeline = (token_pipeline_t *)aligned_alloc(64, sizeof(token_pipeline_t));
+  if (!pipeline) {
+    fprintf(stderr, "Error: Memory allocation failed for token pipeline.\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(pipeline, 0, sizeof(*pipeline));
+  atomic_init(&pipeline->head, 0);
+  atomic_init(&pipeline->tail, 0);
+  atomic_init(&pipeline->stop, 0);
+
+  set_deferred_lexer(1);
+
+  if (pthread_create(&pipeline->thread, NULL, producer_main, NULL) != 0) {
+    fprintf(stderr, "Error: Could not start the lexer thread.\n");
+    exit(EXIT_FAILURE);
+  }
+  pipeline->running = 1;
+}
+
+token_t *token_pipeline_pop() {
+  // The end of file is sticky, like get_next_token() returning NULL forever
+  if (pipeline->current && pipeline->current->type == TOKEN_EOF)
+    return pipeline->current;
+
+  if (pipeline->current) {
+    pipeline->consumer_tail++;
+    if (pipeline->consumer_tail - pipeline->consumer_published_tail >=
+        TOKEN_PIPELINE_BATCH)
+      consumer_publish();
+  }
+
+  int spins = 0;
+  while (pipeline->consumer_tail == pipeline->consumer_cached_head) {
+    pipeline->consumer_cached_head =
+        atomic_load_explicit(&pipeline->head, memory_order_acquire);
+
+    if (pipeline->consumer_tail != pipeline->consumer_cached_head)
+      break;
+
+    // Releases the consumed slots before sleeping (see producer_reserve)
+    consumer_publish();
+    pipeline_wait(&spins);
+  }
+
+  token_t *token =
+      &pipeline->slots[pipeline->consumer_tail & TOKEN_PIPELINE_MASK];
+  pipeline->current = token;
+
+  if (token->type == TOKEN_EOF)
+    return token;
+
+  if (VERBOSE_LEXER)
+    print_token(token);
+
+  if (token->type == TOKEN_UNKNOWN) {
+    print_error(token);
+    exit(EXIT_FAILURE);
+  }
+
+  return token;
+}
+
+void token_pipeline_stop() {
+  if (!pipeline)
+    return;
+
+  if (pipeline->running) {
+    atomic_store_explicit(&pipeline->stop, 1, memory_order_relaxed);
+    pthread_join(pipeline->thread, NULL);
+  }
+
+  set_deferred_lexer(0);
+
+  free(pipeline);
+  pipeline = NULL;
+}
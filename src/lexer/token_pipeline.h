@@ -0,0 +1,23 @@
+#ifndef TOKEN_PIPELINE_H
+#define TOKEN_PIPELINE_H
+
+#include "lexer.h"
+
+#define TOKEN_PIPELINE_CAPACITY 1024 // Must be a power of two
+#define TOKEN_PIPELINE_BATCH 64      // Tokens published per index update
+
+// ----------------------- Functions ----------------------
+
+//! Starts the lexer thread, which fills the ring buffer with tokens of the
+//! file opened by init_lexer()
+void token_pipeline_start();
+
+//! Returns the next token produced by the lexer thread. The token stays valid
+//! until the next call. After the end of file it keeps returning TOKEN_EOF,
+//! and a lexical error is reported (and the program ends) when it is reached
+token_t *token_pipeline_pop();
+
+//! Stops the lexer thread (if still running) and waits for it to finish
+void token_pipeline_stop();
+
+#endif // !TOKEN_PIPELINE_H
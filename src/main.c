@@ -1,14 +1,53 @@
+#include "backend/c_emit.h"
+#include "backend/regalloc.h"
+#include "backend/x86_asm.h"
+#include "backend/x86_elf.h"
+#include "backend/x86_encode.h"
+#include "backend/x86_peephole.h"
+#include "backend/x86_select.h"
 #include "lexer/lexer.h"
 #include "parser/parser.h"
+#include "semantic/semantic.h"
+#include "ir/ir.h"
+#include "ir/ir_lower.h"
+#include "ir/ir_optimize.h"
+#include "ir/ir_printer.h"
+#include "ir/ir_ssa.h"
+#include "vm/ast_walk.h"
+#include "vm/bytecode.h"
+#include "vm/jit.h"
+#include "vm/superinstructions.h"
+#include "vm/vm.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Definitions
 
 int LEXER_ONLY = 0;
 int PARSER_ONLY = 0;
+int BENCH_PARSER = 0;
+int EMIT_IR = 0;
+int EMIT_SSA = 0;
+int TIME_SSA = 0;
+int OPTIMIZE = 0;
+int OPTIMIZE_STATS = 0;
+int REGALLOC_STATS = 0;
+int EMIT_ASM = 0;
+int EMIT_C = 0;
+int COMPILE_ONLY = 0;
+const char *OUTPUT_FILE = NULL;
+int RUN_VM = 0;
+int BENCH_VM = 0;
+int EMIT_BYTECODE = 0;
+int BYTECODE_PROFILE = 0;
+int JIT = 0;
+int JIT_FORCE = 0;
+
+#define BENCH_RUNS 20
+#define BENCH_VM_RUNS 5 // Whole program runs, far longer than a parse
 
 // Functions
 
@@ -21,6 +60,40 @@ void lexer_only(int option);
 //! Option to run only the sintatic analysis part
 void parser_only(int option);
 
+//! Parses the file several times with each engine and prints the timings
+int bench_parsers(const char *file);
+
+//! Translates the checked program into the IR
+ir_module_t *build_ir(ast_node_t *ast);
+
+//! Runs the stages that work in SSA form, leaving the module out of it
+void transform_ir(ir_module_t *module);
+
+//! Unlinks the declarations of the functions the optimizer dropped from the
+//! module, found through the symbols of the functions left, so the C and
+//! the bytecode backends leave them out too
+void remove_dead_functions(ast_node_t *ast, const ir_module_t *module);
+
+//! Allocates the registers of every function and prints the spills
+void print_allocation(ir_module_t *module);
+
+//! Selects the instructions of the native outputs, rewritten by the
+//! peephole optimizer under -O
+x86_module_t *select_machine(ir_module_t *module, x86_entry_t entry);
+
+//! Writes the object file or the executable of the program, returns 0 on
+//! failure
+int write_binary(ir_module_t *module, const char *source);
+
+//! Compiles the program into bytecode and runs it, benchmarks it or prints
+//! it. The hot functions get native code from 'module' when it is given.
+//! Returns 0 when the program stops on an error
+int run_bytecode(ast_node_t *ast, ir_module_t *module);
+
+//! Runs the program several times in the VM, with and without the
+//! superinstructions, walking the tree and tiered when 'module' is given,
+//! with the standard input read once for every run, and prints the timings
+int bench_vm(ast_node_t *ast, vm_program_t *program, ir_module_t *module);
 
 
 int main(int argc, char *argv[]) {
@@ -38,6 +111,55 @@ int main(int argc, char *argv[]) {
     } else if (!strcmp("-p", argv[i]) || !strcmp("-P", argv[i]) ||
                !strcmp("--parser", argv[i])) {
       set_verbose_parser(1);
+    } else if (!strcmp("-s", argv[i]) || !strcmp("-S", argv[i]) ||
+               !strcmp("--semantic", argv[i])) {
+      set_verbose_semantic(1);
+    } else if (!strcmp("-f", argv[i]) || !strcmp("--fused-semantic", argv[i])) {
+      set_fused_semantic(1);
+    } else if (!strncmp("-j", argv[i], 2)) {
+      set_parallel_semantic(argv[i][2] ? atoi(argv[i] + 2) : -1);
+    } else if (!strcmp("--parallel-semantic", argv[i])) {
+      set_parallel_semantic(-1);
+    } else if (!strcmp("-t", argv[i]) || !strcmp("--pipeline", argv[i])) {
+      set_pipelined_parser(1);
+    } else if (!strcmp("--ll1", argv[i])) {
+      set_parser_engine(PARSER_ENGINE_LL1);
+    } else if (!strcmp("--emit-ir", argv[i])) {
+      EMIT_IR = 1;
+    } else if (!strcmp("--emit-ssa", argv[i])) {
+      EMIT_SSA = 1;
+    } else if (!strcmp("--time-ssa", argv[i])) {
+      TIME_SSA = 1;
+    } else if (!strcmp("-O", argv[i]) || !strcmp("--optimize", argv[i])) {
+      OPTIMIZE = 1;
+    } else if (!strcmp("--opt-stats", argv[i])) {
+      OPTIMIZE = OPTIMIZE_STATS = 1;
+    } else if (!strcmp("--ra-stats", argv[i])) {
+      REGALLOC_STATS = 1;
+    } else if (!strcmp("--emit-asm", argv[i])) {
+      EMIT_ASM = 1;
+    } else if (!strcmp("--safe", argv[i])) {
+      BOUNDS_CHECKS = 1;
+    } else if (!strcmp("--emit-c", argv[i])) {
+      EMIT_C = 1;
+    } else if (!strcmp("-c", argv[i])) {
+      COMPILE_ONLY = 1;
+    } else if (!strcmp("-o", argv[i]) && i + 1 < argc) {
+      OUTPUT_FILE = argv[++i];
+    } else if (!strcmp("--run", argv[i])) {
+      RUN_VM = 1;
+    } else if (!strcmp("--bench-vm", argv[i])) {
+      BENCH_VM = 1;
+    } else if (!strcmp("--emit-bytecode", argv[i])) {
+      EMIT_BYTECODE = 1;
+    } else if (!strcmp("--bytecode-profile", argv[i])) {
+      BYTECODE_PROFILE = 1;
+    } else if (!strcmp("--jit", argv[i])) {
+      JIT = 1;
+    } else if (!strcmp("--jit-force", argv[i])) {
+      JIT = JIT_FORCE = 1;
+    } else if (!strcmp("--bench-parser", argv[i])) {
+      BENCH_PARSER = 1;
     } else if (!strcmp("-lexer-only", argv[i])) {
       lexer_only(1);
     } else if (!strcmp("-parser-only", argv[i])) {
@@ -47,6 +169,18 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // The checks are in the native code, the virtual machine, the JIT and
+  // the C translation have none
+  if (BOUNDS_CHECKS && (JIT || RUN_VM || BENCH_VM || EMIT_BYTECODE ||
+                        BYTECODE_PROFILE || EMIT_C)) {
+    fprintf(stderr, "Error: --safe only applies to the native code of -o, -c "
+                    "and --emit-asm.\n");
+    return EXIT_FAILURE;
+  }
+
+  if (file_position != -1 && BENCH_PARSER)
+    return bench_parsers(argv[file_position]);
+
   if (file_position != -1)
     init_lexer(argv[file_position]);
   else {
@@ -64,6 +198,7 @@ int main(int argc, char *argv[]) {
 
     return EXIT_SUCCESS;
   } else if (PARSER_ONLY) {
+    set_fused_semantic(0);
     ast_node_t *ast = parse_program();
 
     destroy_ast_root(ast);
@@ -73,11 +208,50 @@ int main(int argc, char *argv[]) {
   }
 
   ast_node_t *ast = parse_program();
+  int semantic_errors = semantic_analysis(ast);
+  ir_module_t *module = NULL;
 
+  if (JIT && !BENCH_VM)
+    RUN_VM = 1;
+
+  if (!semantic_errors &&
+      (EMIT_IR || EMIT_SSA || TIME_SSA || OPTIMIZE || REGALLOC_STATS ||
+       EMIT_ASM || COMPILE_ONLY || OUTPUT_FILE || JIT)) {
+    module = build_ir(ast);
+    transform_ir(module);
+    if (OPTIMIZE)
+      remove_dead_functions(ast, module);
+    if (EMIT_IR)
+      ir_print_module(module, stdout);
+    if (REGALLOC_STATS)
+      print_allocation(module);
+    if (EMIT_ASM) {
+      x86_module_t *machine = select_machine(module, X86_ENTRY_MAIN);
+      x86_print_module(machine, stdout);
+      x86_module_destroy(machine);
+    }
+    if ((COMPILE_ONLY || OUTPUT_FILE) &&
+        !write_binary(module, argv[file_position]))
+      semantic_errors = 1;
+  }
+
+  // The C names are numbered in the locations too, before the bytecode
+  if (!semantic_errors && EMIT_C)
+    c_emit_program(ast, argv[file_position], stdout);
+
+  // After the IR, whose locations the bytecode compiler overwrites
+  if (!semantic_errors &&
+      (RUN_VM || BENCH_VM || EMIT_BYTECODE || BYTECODE_PROFILE) &&
+      !run_bytecode(ast, JIT ? module : NULL))
+    semantic_errors = 1;
+  if (module)
+    ir_module_destroy(module);
+
+  semantic_release();
   destroy_ast_root(ast);
   close_lexer();
 
-  return EXIT_SUCCESS;
+  return semantic_errors ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 // Function implementations
@@ -91,6 +265,52 @@ void show_help() {
        "analysis");
   puts("  -p  -P --parser                    -- prints the ASTree after "
        "completing the sintatic analysis");
+  puts("  -s  -S --semantic                  -- prints the symbols of each "
+       "scope during the semantic analysis");
+  puts("  -f  --fused-semantic               -- runs the semantic checks "
+       "inside the parser, in a single pass");
+  puts("  -j[N] --parallel-semantic          -- checks the function bodies on "
+       "N threads (default: one per core)");
+  puts("  -t  --pipeline                     -- runs the lexer on its own "
+       "thread, overlapping it with the parser");
+  puts("  --ll1                              -- parses with the table-driven "
+       "LL(1) engine");
+  puts("  --emit-ir                          -- prints the intermediate "
+       "code (three-address code)");
+  puts("  --emit-ssa                         -- prints the intermediate "
+       "code in SSA form");
+  puts("  --time-ssa                         -- prints the time spent "
+       "entering and leaving SSA form");
+  puts("  -O  --optimize                     -- optimizes the intermediate "
+       "and the machine code");
+  puts("  --opt-stats                        -- optimizes and prints what "
+       "each pass did");
+  puts("  --ra-stats                         -- allocates the registers and "
+       "prints the spills of each function");
+  puts("  --emit-asm                         -- prints the x86-64 assembly "
+       "of the program, for gcc");
+  puts("  --safe                             -- checks every array index of "
+       "the native code (-o, -c, --emit-asm)");
+  puts("  --emit-c                           -- prints the program as C11, "
+       "for gcc");
+  puts("  -c                                 -- writes an ELF object file, "
+       "to be linked by gcc");
+  puts("  -o <file>                          -- names the output, a static "
+       "executable unless -c is given");
+  puts("  --run                              -- runs the program in the "
+       "bytecode virtual machine");
+  puts("  --bench-vm                         -- compares the speed of the "
+       "virtual machine and of an AST walk");
+  puts("  --jit                              -- runs the hot functions as "
+       "native code, compiled in memory");
+  puts("  --jit-force                        -- runs every function as "
+       "native code from the start");
+  puts("  --emit-bytecode                    -- prints the bytecode of the "
+       "virtual machine");
+  puts("  --bytecode-profile                 -- prints how often each pair "
+       "of opcodes appears in the bytecode");
+  puts("  --bench-parser                     -- compares the speed of the "
+       "parsing engines");
   puts("  --lexer-only                       -- stops the execution of the "
        "program after finishing the lexic analysis");
   puts("  --parser-only                      -- stops the execution of the "
@@ -106,3 +326,303 @@ void lexer_only(int option) {
 void parser_only(int option) {
   PARSER_ONLY = option;
 }
+
+int bench_parsers(const char *file) {
+  const char *names[] = {"recursive descent", "LL(1) table"};
+  parser_engine_t engines[] = {PARSER_ENGINE_DESCENT, PARSER_ENGINE_LL1};
+  int verbose = VERBOSE_PARSER;
+
+  set_verbose_parser(0);
+  set_fused_semantic(0);
+
+  for (int e = 0; e < 2; e++) {
+    double best = 0, total = 0;
+
+    set_parser_engine(engines[e]);
+    for (int run = 0; run < BENCH_RUNS; run++) {
+      struct timespec start, end;
+
+      init_lexer(file);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      ast_node_t *ast = parse_program();
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      destroy_ast_root(ast);
+      close_lexer();
+
+      double ms = (end.tv_sec - start.tv_sec) * 1e3 +
+                  (end.tv_nsec - start.tv_nsec) / 1e6;
+      total += ms;
+      if (run == 0 || ms < best)
+        best = ms;
+    }
+
+    printf("%-18s best %9.3f ms   mean %9.3f ms   (%d runs)\n", names[e], best,
+           total / BENCH_RUNS, BENCH_RUNS);
+  }
+
+  set_verbose_parser(verbose);
+
+  return EXIT_SUCCESS;
+}
+
+ir_module_t *build_ir(ast_node_t *ast) {
+  ir_module_t *module = ir_lower_program(ast);
+
+  if (ir_verify_module(module)) {
+    fprintf(stderr, "Error: Invalid intermediate code.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return module;
+}
+
+void transform_ir(ir_module_t *module) {
+  ir_ssa_stats_t stats = {0};
+  ir_optimize_stats_t optimize_stats = {0};
+  int errors = 0;
+
+  if (!EMIT_SSA && !TIME_SSA && !OPTIMIZE)
+    return;
+
+  ir_module_to_ssa(module, &stats);
+  if (OPTIMIZE)
+    ir_optimize_module(module, &optimize_stats);
+
+  for (int f = 0; f < module->function_count; f++)
+    errors += ir_verify_ssa(&module->functions[f]);
+  if (errors || ir_verify_module(module)) {
+    fprintf(stderr, "Error: Invalid SSA form.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (EMIT_SSA)
+    ir_print_module(module, stdout);
+
+  ir_module_from_ssa(module, &stats);
+  if (ir_verify_module(module)) {
+    fprintf(stderr, "Error: Invalid intermediate code.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (TIME_SSA)
+    ir_ssa_print_stats(&stats, stdout);
+  if (OPTIMIZE_STATS)
+    ir_optimize_print_stats(&optimize_stats, stdout);
+}
+
+void remove_dead_functions(ast_node_t *ast, const ir_module_t *module) {
+  ast_node_t **link = &ast->data.program.decl_list;
+
+  // The functions left in the module point their symbols back at them
+  for (ast_node_t *list = *link; list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    if (node->type == AST_FUN_DECLARATION)
+      node->symbol->location = -1;
+  }
+  for (int f = 0; f < module->function_count; f++)
+    if (module->functions[f].symbol)
+      module->functions[f].symbol->location = f;
+
+  while (*link && (*link)->data.decl_list.declaration) {
+    ast_node_t *list = *link;
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+
+    if (node->type != AST_FUN_DECLARATION || node->symbol->location >= 0) {
+      link = &list->data.decl_list.decl_list;
+      continue;
+    }
+
+    node->symbol->declaration = NULL;
+    *link = list->data.decl_list.decl_list;
+    list->data.decl_list.decl_list = NULL;
+    destroy_ast(list);
+  }
+}
+
+void print_allocation(ir_module_t *module) {
+  for (int f = 0; f < module->function_count; f++) {
+    if (module->functions[f].is_builtin)
+      continue;
+
+    ra_allocation_t *allocation = ra_allocate(&module->functions[f]);
+    ra_print_stats(allocation, stdout);
+    ra_destroy(allocation);
+  }
+}
+
+x86_module_t *select_machine(ir_module_t *module, x86_entry_t entry) {
+  x86_module_t *machine = x86_select_module(module, entry);
+  x86_peephole_stats_t stats = {0};
+
+  if (OPTIMIZE)
+    x86_peephole_module(machine, &stats);
+  if (OPTIMIZE_STATS)
+    x86_peephole_print_stats(&stats, stdout);
+  return machine;
+}
+
+int write_binary(ir_module_t *module, const char *source) {
+  x86_module_t *machine = select_machine(
+      module, COMPILE_ONLY ? X86_ENTRY_MAIN : X86_ENTRY_START);
+  x86_code_t *code = x86_encode_module(machine);
+  int written;
+
+  if (COMPILE_ONLY) {
+    const char *path = OUTPUT_FILE;
+    char *object = NULL;
+
+    // Like gcc, 'dir/file.c' gives 'file.o' in the current directory
+    if (!path) {
+      const char *name = strrchr(source, '/') ? strrchr(source, '/') + 1
+                                              : source;
+      object = (char *)malloc(strlen(name) + 3);
+      if (!object) {
+        fprintf(stderr, "Error: Memory allocation failed for the file "
+                        "name.\n");
+        exit(EXIT_FAILURE);
+      }
+      strcpy(object, name);
+      char *extension = strrchr(object, '.');
+      strcpy(extension ? extension : object + strlen(object), ".o");
+      path = object;
+    }
+
+    written = x86_write_object(machine, code, path);
+    free(object);
+  } else
+    written = x86_write_executable(machine, code, OUTPUT_FILE);
+
+  x86_code_destroy(code);
+  x86_module_destroy(machine);
+  return written;
+}
+
+int run_bytecode(ast_node_t *ast, ir_module_t *module) {
+  vm_program_t *program = vm_compile_program(ast);
+  vm_fuse_stats_t fuse_stats = {0};
+  int ok = 1;
+
+  if (BYTECODE_PROFILE)
+    vm_print_pair_profile(program, stdout);
+  vm_fuse_program(program, &fuse_stats);
+  if (EMIT_BYTECODE)
+    vm_print_program(program, stdout);
+
+  if (BENCH_VM) {
+    vm_fuse_print_stats(&fuse_stats, stdout);
+    ok = bench_vm(ast, program, module);
+  }
+  else if (RUN_VM) {
+    vm_io_t *io = (vm_io_t *)malloc(sizeof(vm_io_t));
+    if (!io) {
+      fprintf(stderr, "Error: Memory allocation failed for the VM.\n");
+      exit(EXIT_FAILURE);
+    }
+    vm_jit_t *jit = module ? vm_jit_create(program, module, JIT_FORCE) : NULL;
+    fflush(stdout);
+    vm_io_init(io);
+    ok = vm_run(program, io, jit);
+    vm_jit_destroy(jit);
+    free(io);
+  }
+
+  vm_program_destroy(program);
+  return ok;
+}
+
+int bench_vm(ast_node_t *ast, vm_program_t *program, ir_module_t *module) {
+  const char *names[] = {"bytecode VM", "without fusion", "AST walk",
+                         JIT_FORCE ? "native (JIT)" : "tiered JIT"};
+  int engines = module ? 4 : 3;
+  unsigned char *input = NULL;
+  size_t length = 0, capacity = 0, count;
+  double best[4] = {0};
+  unsigned long checksums[4] = {0};
+  int ok = 1;
+
+  do {
+    if (length == capacity) {
+      capacity = capacity ? capacity * 2 : 4096;
+      input = (unsigned char *)realloc(input, capacity);
+      if (!input) {
+        fprintf(stderr, "Error: Memory allocation failed for the input.\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    count = fread(input + length, 1, capacity - length, stdin);
+    length += count;
+  } while (count);
+
+  vm_io_t *io = (vm_io_t *)malloc(sizeof(vm_io_t));
+  if (!io) {
+    fprintf(stderr, "Error: Memory allocation failed for the VM.\n");
+    exit(EXIT_FAILURE);
+  }
+  // Compiled again, the same locations are given to the symbols
+  vm_program_t *plain = vm_compile_program(ast);
+
+  for (int e = 0; e < engines && ok; e++) {
+    double total = 0;
+
+    for (int run = 0; run < BENCH_VM_RUNS && ok; run++) {
+      struct timespec start, end;
+      vm_program_t *tiered = NULL;
+      vm_jit_t *jit = NULL;
+
+      // A JIT serves a single run, which starts from the bytecode
+      if (e == 3) {
+        vm_fuse_stats_t fuse_stats = {0};
+        tiered = vm_compile_program(ast);
+        vm_fuse_program(tiered, &fuse_stats);
+        jit = vm_jit_create(tiered, module, JIT_FORCE);
+      }
+
+      vm_io_init_memory(io, input, length);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if (e < 2)
+        ok = vm_run(e == 0 ? program : plain, io, NULL);
+      else if (e == 2)
+        ok = ast_walk_program(ast, plain, io);
+      else
+        ok = vm_run(tiered, io, jit);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      double ms = (end.tv_sec - start.tv_sec) * 1e3 +
+                  (end.tv_nsec - start.tv_nsec) / 1e6;
+      total += ms;
+      if (run == 0 || ms < best[e])
+        best[e] = ms;
+      checksums[e] = io->checksum;
+
+      if (jit && run == BENCH_VM_RUNS - 1 && ok)
+        vm_jit_print_stats(jit, stdout);
+      vm_jit_destroy(jit);
+      vm_program_destroy(tiered);
+    }
+
+    if (ok)
+      printf("%-18s best %9.3f ms   mean %9.3f ms   (%d runs)\n", names[e],
+             best[e], total / BENCH_VM_RUNS, BENCH_VM_RUNS);
+  }
+
+  for (int e = 0; e < engines && ok; e++)
+    if (checksums[e] != checksums[2]) {
+      fprintf(stderr, "Error: The engines gave different outputs.\n");
+      ok = 0;
+    }
+  if (ok && best[0] > 0 && best[1] > 0)
+    printf("%-18s %.2fx faster than the AST walk, %.2fx than without "
+           "fusion\n",
+           names[0], best[2] / best[0], best[1] / best[0]);
+  if (ok && engines == 4 && best[3] > 0)
+    printf("%-18s %.2fx faster than the bytecode VM\n", names[3],
+           best[0] / best[3]);
+
+  vm_program_destroy(plain);
+  free(io);
+  free(input);
+  return ok;
+}
@@ -0,0 +1,516 @@
+#include "ll1_grammar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define T(x) (x)
+#define N(x) (LL1_NONTERMINAL_BASE + (x))
+#define A(x) (LL1_ACTION_BASE + (x))
+#define E LL1_END
+
+// ----------------------- C- Grammar ----------------------
+
+// Left factored version of the C- grammar. The actions placed inside the
+// productions build the AST bottom up over the value stack, so the tree is
+// exactly the one built by the recursive descent parser (including the left
+// associative '+ -' and '* /' chains)
+const ll1_production_t ll1_productions[] = {
+    // program -> declaration-list
+    {NT_PROGRAM, {N(NT_DECL_LIST), A(ACT_PROGRAM), E}, 0},
+
+    // declaration-list -> declaration declaration-list | empty
+    {NT_DECL_LIST,
+     {N(NT_DECLARATION), N(NT_DECL_LIST), A(ACT_DECL_CONS), E},
+     0},
+    {NT_DECL_LIST, {A(ACT_DECL_NIL), E}, 0},
+
+    // declaration -> type-specifier ID ( fun-declaration | var-declaration )
+    {NT_DECLARATION,
+     {N(NT_TYPE_SPEC), T(TOKEN_ID), N(NT_DECL_TAIL), A(ACT_DECLARATION), E},
+     0},
+    {NT_DECL_TAIL,
+     {T(TOKEN_LPARENT), N(NT_PARAMS), T(TOKEN_RPARENT), N(NT_COMPOUND),
+      A(ACT_FUN_DECL), E},
+     0},
+    {NT_DECL_TAIL, {N(NT_DIMENSION), T(TOKEN_DELIM), A(ACT_VAR_DECL), E}, 0},
+
+    // type-specifier -> int | void
+    {NT_TYPE_SPEC, {T(TOKEN_INT), A(ACT_TYPE_SPEC), E}, 0},
+    {NT_TYPE_SPEC, {T(TOKEN_VOID), A(ACT_TYPE_SPEC), E}, 0},
+
+    // dimension -> [ NUM ] | empty
+    {NT_DIMENSION,
+     {T(TOKEN_LBRACKET), T(TOKEN_NUM), T(TOKEN_RBRACKET), A(ACT_DIMENSION), E},
+     0},
+    {NT_DIMENSION, {A(ACT_NULL), E}, 0},
+
+    // params -> void | param param-tail
+    {NT_PARAMS, {T(TOKEN_VOID), A(ACT_PARAMS_VOID), E}, 0},
+    {NT_PARAMS,
+     {T(TOKEN_INT), A(ACT_TYPE_SPEC), T(TOKEN_ID), N(NT_PARAM_DIMENSION),
+      A(ACT_PARAM), N(NT_PARAM_TAIL), A(ACT_PARAM_LIST), E},
+     0},
+    {NT_PARAM_TAIL,
+     {T(TOKEN_COMMA), N(NT_PARAM), N(NT_PARAM_TAIL), A(ACT_PARAM_LIST), E},
+     0},
+    {NT_PARAM_TAIL, {A(ACT_NULL), E}, 0},
+
+    // param -> type-specifier ID | type-specifier ID [ ]
+    {NT_PARAM,
+     {N(NT_TYPE_SPEC), T(TOKEN_ID), N(NT_PARAM_DIMENSION), A(ACT_PARAM), E},
+     0},
+    {NT_PARAM_DIMENSION,
+     {T(TOKEN_LBRACKET), T(TOKEN_RBRACKET), A(ACT_ARRAY_MARK), E},
+     0},
+    {NT_PARAM_DIMENSION, {A(ACT_NULL), E}, 0},
+
+    // compound-decl -> { local-declarations statement-list }
+    {NT_COMPOUND,
+     {T(TOKEN_LKEY), N(NT_LOCAL_DECLS), N(NT_STMT_LIST), T(TOKEN_RKEY),
+      A(ACT_COMPOUND), E},
+     0},
+    {NT_LOCAL_DECLS,
+     {N(NT_VAR_DECL), N(NT_LOCAL_DECLS), A(ACT_LOCALS_CONS), E},
+     0},
+    {NT_LOCAL_DECLS, {A(ACT_LOCALS_NIL), E}, 0},
+    {NT_VAR_DECL,
+     {N(NT_TYPE_SPEC), T(TOKEN_ID), N(NT_DIMENSION), T(TOKEN_DELIM),
+      A(ACT_VAR_DECL), E},
+     0},
+
+    // statement-list -> statement statement-list | empty
+    {NT_STMT_LIST,
+     {N(NT_STATEMENT), N(NT_STMT_LIST), A(ACT_STMTS_CONS), E},
+     0},
+    {NT_STMT_LIST, {A(ACT_STMTS_NIL), E}, 0},
+
+    // statement -> selection | iteration | return | compound | expression
+    {NT_STATEMENT, {N(NT_SELECTION), A(ACT_STATEMENT), E}, 0},
+    {NT_STATEMENT, {N(NT_ITERATION), A(ACT_STATEMENT), E}, 0},
+    {NT_STATEMENT, {N(NT_RETURN), A(ACT_STATEMENT), E}, 0},
+    {NT_STATEMENT, {N(NT_COMPOUND), A(ACT_STATEMENT), E}, 0},
+    {NT_STATEMENT, {N(NT_EXPR_STMT), A(ACT_STATEMENT), E}, 0},
+
+    // selection -> if ( expression ) statement [ else statement ]
+    {NT_SELECTION,
+     {T(TOKEN_IF), T(TOKEN_LPARENT), N(NT_EXPRESSION), T(TOKEN_RPARENT),
+      N(NT_STATEMENT), N(NT_ELSE_PART), A(ACT_SELECTION), E},
+     0},
+    {NT_ELSE_PART, {T(TOKEN_ELSE), N(NT_STATEMENT), E}, 1}, // Dangling else
+    {NT_ELSE_PART, {A(ACT_NULL), E}, 0},
+
+    // iteration -> while ( expression ) statement
+    {NT_ITERATION,
+     {T(TOKEN_WHILE), T(TOKEN_LPARENT), N(NT_EXPRESSION), T(TOKEN_RPARENT),
+      N(NT_STATEMENT), A(ACT_ITERATION), E},
+     0},
+
+    // return -> return ; | return expression ;
+    {NT_RETURN,
+     {T(TOKEN_RETURN), N(NT_RETURN_VALUE), T(TOKEN_DELIM), A(ACT_RETURN), E},
+     0},
+    {NT_RETURN_VALUE, {N(NT_EXPRESSION), E}, 0},
+    {NT_RETURN_VALUE, {A(ACT_NULL), E}, 0},
+
+    // expression-statement -> expression ; | ;
+    {NT_EXPR_STMT,
+     {N(NT_EXPRESSION), T(TOKEN_DELIM), A(ACT_EXPR_STMT), E},
+     0},
+    {NT_EXPR_STMT, {T(TOKEN_DELIM), A(ACT_NULL), A(ACT_EXPR_STMT), E}, 0},
+
+    // expression -> var = expression | simple-expression, factored on ID
+    {NT_EXPRESSION, {T(TOKEN_ID), N(NT_EXPR_ID_TAIL), E}, 0},
+    {NT_EXPRESSION, {N(NT_FACTOR_NO_ID), N(NT_SIMPLE_REST), E}, 0},
+    {NT_EXPR_ID_TAIL,
+     {T(TOKEN_LBRACKET), N(NT_EXPRESSION), T(TOKEN_RBRACKET),
+      A(ACT_VAR_INDEXED), N(NT_VAR_REST), E},
+     0},
+    {NT_EXPR_ID_TAIL,
+     {T(TOKEN_LPARENT), N(NT_ARGS), T(TOKEN_RPARENT), A(ACT_CALL_FACTOR),
+      N(NT_SIMPLE_REST), E},
+     0},
+    {NT_EXPR_ID_TAIL, {A(ACT_VAR), N(NT_VAR_REST), E}, 0},
+    {NT_VAR_REST, {T(TOKEN_ATTR), N(NT_EXPRESSION), A(ACT_ASSIGN), E}, 0},
+    {NT_VAR_REST, {A(ACT_VAR_FACTOR), N(NT_SIMPLE_REST), E}, 0},
+
+    // Rest of a simple-expression whose first factor is on the value stack
+    {NT_SIMPLE_REST,
+     {N(NT_TERM_REST), A(ACT_TERM_END), N(NT_ADD_REST), A(ACT_ADD_END),
+      N(NT_REL_REST), A(ACT_SIMPLE), E},
+     0},
+    {NT_REL_REST, {N(NT_RELOP), N(NT_ADDITIVE), E}, 0},
+    {NT_REL_REST, {A(ACT_NULL), E}, 0}, // No comparison, no right side
+    {NT_RELOP, {T(TOKEN_LE), E}, 0},
+    {NT_RELOP, {T(TOKEN_LT), E}, 0},
+    {NT_RELOP, {T(TOKEN_GT), E}, 0},
+    {NT_RELOP, {T(TOKEN_GE), E}, 0},
+    {NT_RELOP, {T(TOKEN_EQ), E}, 0},
+    {NT_RELOP, {T(TOKEN_DIFF), E}, 0},
+
+    // additive-expression -> term { addop term }
+    {NT_ADDITIVE, {N(NT_TERM), N(NT_ADD_REST), A(ACT_ADD_END), E}, 0},
+    {NT_ADD_REST,
+     {N(NT_ADDOP), N(NT_TERM), A(ACT_ADD_OP), N(NT_ADD_REST), E},
+     0},
+    {NT_ADD_REST, {E}, 0},
+    {NT_ADDOP, {T(TOKEN_PLUS), E}, 0},
+    {NT_ADDOP, {T(TOKEN_MINUS), E}, 0},
+
+    // term -> factor { mulop factor }
+    {NT_TERM, {N(NT_FACTOR), N(NT_TERM_REST), A(ACT_TERM_END), E}, 0},
+    {NT_TERM_REST,
+     {N(NT_MULOP), N(NT_FACTOR), A(ACT_TERM_OP), N(NT_TERM_REST), E},
+     0},
+    {NT_TERM_REST, {E}, 0},
+    {NT_MULOP, {T(TOKEN_MULT), E}, 0},
+    {NT_MULOP, {T(TOKEN_DIV), E}, 0},
+
+    // factor -> ( expression ) | var | activation | NUM
+    {NT_FACTOR, {T(TOKEN_ID), N(NT_FACTOR_ID_TAIL), E}, 0},
+    {NT_FACTOR, {N(NT_FACTOR_NO_ID), E}, 0},
+    {NT_FACTOR_NO_ID,
+     {T(TOKEN_LPARENT), N(NT_EXPRESSION), T(TOKEN_RPARENT),
+      A(ACT_FACTOR_PAREN), E},
+     0},
+    {NT_FACTOR_NO_ID, {T(TOKEN_NUM), A(ACT_FACTOR_NUM), E}, 0},
+    {NT_FACTOR_ID_TAIL,
+     {T(TOKEN_LBRACKET), N(NT_EXPRESSION), T(TOKEN_RBRACKET),
+      A(ACT_VAR_INDEXED), A(ACT_VAR_FACTOR), E},
+     0},
+    {NT_FACTOR_ID_TAIL,
+     {T(TOKEN_LPARENT), N(NT_ARGS), T(TOKEN_RPARENT), A(ACT_CALL_FACTOR), E},
+     0},
+    {NT_FACTOR_ID_TAIL, {A(ACT_VAR), A(ACT_VAR_FACTOR), E}, 0},
+
+    // args -> expression { , expression } | empty
+    {NT_ARGS, {N(NT_EXPRESSION), N(NT_ARG_REST), A(ACT_ARG_LIST), E}, 0},
+    {NT_ARGS, {A(ACT_NULL), E}, 0},
+    {NT_ARG_REST,
+     {T(TOKEN_COMMA), N(NT_EXPRESSION), N(NT_ARG_REST), A(ACT_ARG_LIST), E},
+     0},
+    {NT_ARG_REST, {A(ACT_NULL), E}, 0},
+};
+
+const int ll1_production_count =
+    sizeof(ll1_productions) / sizeof(ll1_productions[0]);
+
+const char *ll1_nonterminal_name(ll1_nonterminal_t nonterminal) {
+  static const char *names[NT_COUNT] = {
+      "program",          "declaration-list", "declaration",
+      "declaration-tail", "type-specifier",   "dimension",
+      "params",           "param-tail",       "param",
+      "param-dimension",  "compound-decl",    "local-declarations",
+      "var-declaration",  "statement-list",   "statement",
+      "selection-stmt",   "else-part",        "iteration-stmt",
+      "return-stmt",      "return-value",     "expression-stmt",
+      "expression",       "expression-id",    "var-rest",
+      "simple-rest",      "relational-rest",  "relop",
+      "additive-expr",    "additive-rest",    "addop",
+      "term",             "term-rest",        "mulop",
+      "factor",           "factor-no-id",     "factor-id",
+      "args",             "arg-rest",
+  };
+
+  return (nonterminal >= 0 && nonterminal < NT_COUNT) ? names[nonterminal]
+                                                      : "unknown";
+}
+
+// ----------------------- Value Stack ----------------------
+
+static void push(ll1_value_stack_t *stack, ll1_value_t value) {
+  if (stack->size == stack->capacity) {
+    stack->capacity = stack->capacity ? stack->capacity * 2 : 64;
+    stack->values = (ll1_value_t *)realloc(
+        stack->values, stack->capacity * sizeof(ll1_value_t));
+    if (!stack->values) {
+      fprintf(stderr, "Error: Memory allocation failed for LL(1) values.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  stack->values[stack->size++] = value;
+}
+
+static void push_node(ll1_value_stack_t *stack, ast_node_t *node) {
+  push(stack, (ll1_value_t){.node = node, .line = node ? node->line : 0});
+}
+
+// Line of the leftmost value popped by the running action (values are
+// popped right to left), used as the line of the node being built
+static int popped_line = 0;
+
+static ll1_value_t pop(ll1_value_stack_t *stack) {
+  ll1_value_t value = stack->values[--stack->size];
+  if (value.line)
+    popped_line = value.line;
+  return value;
+}
+
+static ast_node_t *pop_node(ll1_value_stack_t *stack) {
+  return pop(stack).node;
+}
+
+static ast_node_t *top_node(ll1_value_stack_t *stack) {
+  return stack->values[stack->size - 1].node;
+}
+
+void ll1_push_terminal(ll1_value_stack_t *stack, token_t *token) {
+  switch (token->type) {
+  case TOKEN_ID:
+    push(stack,
+         (ll1_value_t){.id = strdup(token->lexeme), .line = token->line});
+    break;
+  case TOKEN_NUM:
+    push(stack,
+         (ll1_value_t){.number = atoi(token->lexeme), .line = token->line});
+    break;
+  case TOKEN_INT:
+  case TOKEN_VOID:
+  case TOKEN_PLUS:
+  case TOKEN_MINUS:
+  case TOKEN_MULT:
+  case TOKEN_DIV:
+  case TOKEN_LT:
+  case TOKEN_LE:
+  case TOKEN_GT:
+  case TOKEN_GE:
+  case TOKEN_EQ:
+  case TOKEN_DIFF:
+    push(stack, (ll1_value_t){.token = token->type, .line = token->line});
+    break;
+  case TOKEN_RETURN:
+    // Only its line, the statement has none when it returns no value
+    push(stack, (ll1_value_t){.line = token->line});
+    break;
+  default:
+    // Punctuation doesn't carry values
+    break;
+  }
+}
+
+// ----------------------- Semantic Actions ----------------------
+
+void ll1_run_action(ll1_action_t action, ll1_value_stack_t *stack) {
+  ast_node_t *node = NULL;
+  ll1_value_t id = {0}; // Nodes with an identifier take its line
+
+  popped_line = 0;
+
+  switch (action) {
+  case ACT_PROGRAM:
+    node = create_ast_node(AST_PROGRAM);
+    node->data.program.decl_list = pop_node(stack);
+    break;
+  case ACT_DECL_CONS:
+    node = create_ast_node(AST_DECL_LIST);
+    node->data.decl_list.decl_list = pop_node(stack);
+    node->data.decl_list.declaration = pop_node(stack);
+    break;
+  case ACT_DECL_NIL:
+    node = create_ast_node(AST_DECL_LIST);
+    break;
+  case ACT_DECLARATION:
+    node = create_ast_node(AST_DECLARATION);
+    node->data.declaration.declaration = pop_node(stack);
+    break;
+  case ACT_FUN_DECL:
+    node = create_ast_node(AST_FUN_DECLARATION);
+    node->data.fun_declaration.compound_decl = pop_node(stack);
+    node->data.fun_declaration.params = pop_node(stack);
+    id = pop(stack);
+    node->data.fun_declaration.id = id.id;
+    node->data.fun_declaration.type_specifier = pop_node(stack);
+    break;
+  case ACT_VAR_DECL:
+    node = create_ast_node(AST_VAR_DECLARATION);
+    node->data.var_declaration.dimension = pop_node(stack);
+    id = pop(stack);
+    node->data.var_declaration.id = id.id;
+    node->data.var_declaration.type_specifier = pop_node(stack);
+    break;
+  case ACT_TYPE_SPEC:
+    node = create_ast_node(AST_TYPE_SPECIFIER);
+    node->data.type_specifier.type = pop(stack).token;
+    break;
+  case ACT_DIMENSION:
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.number = pop(stack).number;
+    break;
+  case ACT_ARRAY_MARK:
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.number = 0; // Value to indicate an array
+    break;
+  case ACT_NULL:
+    break;
+  case ACT_PARAMS_VOID:
+    pop(stack); // The 'void' token
+    node = create_ast_node(AST_PARAM_LIST);
+    break;
+  case ACT_PARAM:
+    node = create_ast_node(AST_PARAM);
+    node->data.param.dimension = pop_node(stack);
+    id = pop(stack);
+    node->data.param.id = id.id;
+    node->data.param.type_specifier = pop_node(stack);
+    break;
+  case ACT_PARAM_LIST:
+    node = create_ast_node(AST_PARAM_LIST);
+    node->data.param_list.param_list = pop_node(stack);
+    node->data.param_list.param = pop_node(stack);
+    break;
+  case ACT_COMPOUND:
+    node = create_ast_node(AST_COMPOUND_DECL);
+    node->data.compound_decl.statement_list = pop_node(stack);
+    node->data.compound_decl.local_declarations = pop_node(stack);
+    break;
+  case ACT_LOCALS_CONS:
+    node = create_ast_node(AST_LOCAL_DECLARATIONS);
+    node->data.local_declarations.local_declarations = pop_node(stack);
+    node->data.local_declarations.var_declaration = pop_node(stack);
+    break;
+  case ACT_LOCALS_NIL:
+    node = create_ast_node(AST_LOCAL_DECLARATIONS);
+    break;
+  case ACT_STMTS_CONS:
+    node = create_ast_node(AST_STATEMENT_LIST);
+    node->data.statement_list.statement_list = pop_node(stack);
+    node->data.statement_list.statement = pop_node(stack);
+    break;
+  case ACT_STMTS_NIL:
+    node = create_ast_node(AST_STATEMENT_LIST);
+    break;
+  case ACT_STATEMENT:
+    node = create_ast_node(AST_STATEMENT);
+    node->data.statement.statement = pop_node(stack);
+    break;
+  case ACT_SELECTION:
+    node = create_ast_node(AST_SELECTION_STATEMENT);
+    node->data.selection_statement.else_statement = pop_node(stack);
+    node->data.selection_statement.then_statement = pop_node(stack);
+    node->data.selection_statement.expression = pop_node(stack);
+    break;
+  case ACT_ITERATION:
+    node = create_ast_node(AST_ITERATION_STATEMENT);
+    node->data.iteration_statement.body = pop_node(stack);
+    node->data.iteration_statement.expression = pop_node(stack);
+    break;
+  case ACT_RETURN:
+    node = create_ast_node(AST_RETURN_STATEMENT);
+    node->data.return_statement.expression = pop_node(stack);
+    pop(stack); // The 'return' token
+    break;
+  case ACT_EXPR_STMT:
+    node = create_ast_node(AST_EXPRESSION_STATEMENT);
+    node->data.expression_statement.expression = pop_node(stack);
+    break;
+  case ACT_VAR:
+    node = create_ast_node(AST_VARIABLE);
+    id = pop(stack);
+    node->data.variable.id = id.id;
+    break;
+  case ACT_VAR_INDEXED:
+    node = create_ast_node(AST_VARIABLE);
+    node->data.variable.index = pop_node(stack);
+    id = pop(stack);
+    node->data.variable.id = id.id;
+    break;
+  case ACT_VAR_FACTOR:
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.variable = pop_node(stack);
+    break;
+  case ACT_CALL_FACTOR: {
+    ast_node_t *activation = create_ast_node(AST_ACTIVATION);
+    activation->data.activation.args = pop_node(stack);
+    id = pop(stack);
+    activation->data.activation.id = id.id;
+    activation->line = id.line;
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.activation = activation;
+    break;
+  }
+  case ACT_ASSIGN: {
+    ast_node_t *expression = pop_node(stack);
+    ast_node_t *var = pop_node(stack);
+    node = create_ast_node(AST_ASSIGNMENT_EXPRESSION);
+    node->data.assignment_expression.var_id = var->data.variable.id;
+    node->data.assignment_expression.var_index = var->data.variable.index;
+    node->data.assignment_expression.expression = expression;
+    // The id and the index now belong to the assignment
+    var->data.variable.id = NULL;
+    var->data.variable.index = NULL;
+    destroy_ast(var);
+    break;
+  }
+  case ACT_FACTOR_PAREN:
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.expression = pop_node(stack);
+    break;
+  case ACT_FACTOR_NUM:
+    node = create_ast_node(AST_FACTOR);
+    node->data.factor.number = pop(stack).number;
+    break;
+  case ACT_TERM_OP: {
+    ast_node_t *right = pop_node(stack);
+    token_types_t op = pop(stack).token;
+    node = create_ast_node(AST_TERM);
+    node->data.term.left = pop_node(stack);
+    node->data.term.mult_op = create_ast_node(AST_MULTIPLICATIVE_OPERATOR);
+    node->data.term.mult_op->data.multiplicative_operator.mult_operator =
+        (op == TOKEN_MULT) ? '*' : '/';
+    node->data.term.right = right;
+    break;
+  }
+  case ACT_TERM_END:
+    // A lone factor still needs its term node
+    if (top_node(stack)->type == AST_TERM)
+      return;
+    node = create_ast_node(AST_TERM);
+    node->data.term.left = pop_node(stack);
+    break;
+  case ACT_ADD_OP: {
+    ast_node_t *right = pop_node(stack);
+    token_types_t op = pop(stack).token;
+    node = create_ast_node(AST_ADDITIVE_EXPRESSION);
+    node->data.additive_expression.left = pop_node(stack);
+    node->data.additive_expression.add_op =
+        create_ast_node(AST_ADDITIVE_OPERATOR);
+    node->data.additive_expression.add_op->data.additive_operator
+        .add_operator = (op == TOKEN_PLUS) ? '+' : '-';
+    node->data.additive_expression.right = right;
+    break;
+  }
+  case ACT_ADD_END:
+    // A lone term still needs its additive expression node
+    if (top_node(stack)->type == AST_ADDITIVE_EXPRESSION)
+      return;
+    node = create_ast_node(AST_ADDITIVE_EXPRESSION);
+    node->data.additive_expression.left = pop_node(stack);
+    break;
+  case ACT_SIMPLE: {
+    ast_node_t *right = pop_node(stack);
+    node = create_ast_node(AST_SIMPLE_EXPRESSION);
+    if (right) {
+      node->data.simple_expression.right = right;
+      node->data.simple_expression.relational_op =
+          create_ast_node(AST_RELATIONAL_OPERATOR);
+      node->data.simple_expression.relational_op->data.relational_operator
+          .relop = pop(stack).token;
+    }
+    node->data.simple_expression.left = pop_node(stack);
+    break;
+  }
+  case ACT_ARG_LIST:
+    node = create_ast_node(AST_ARGUMENT_LIST);
+    node->data.argument_list.arg_list = pop_node(stack);
+    node->data.argument_list.expression = pop_node(stack);
+    break;
+  default:
+    fprintf(stderr, "Error: Unknown LL(1) action %d.\n", action);
+    exit(EXIT_FAILURE);
+  }
+
+  if (node && (id.line || popped_line))
+    node->line = id.line ? id.line : popped_line;
+
+  push_node(stack, node);
+}
@@ -0,0 +1,148 @@
+#ifndef LL1_GRAMMAR_H
+#define LL1_GRAMMAR_H
+
+#include "parser.h"
+
+// ----------------------- Grammar Symbols ----------------------
+
+//! Terminals are the token types themselves, so they must fit in a bitmask
+#define LL1_TERMINAL_COUNT (TOKEN_UNKNOWN + 1)
+
+//! Symbols are encoded in a single number: [0, 64) terminals,
+//! [64, 128) nonterminals and [128, ...) semantic actions
+#define LL1_NONTERMINAL_BASE 64
+#define LL1_ACTION_BASE 128
+#define LL1_END -1 // Ends the right side of a production
+
+#define LL1_IS_TERMINAL(s) ((s) < LL1_NONTERMINAL_BASE)
+#define LL1_IS_NONTERMINAL(s)                                                  \
+  ((s) >= LL1_NONTERMINAL_BASE && (s) < LL1_ACTION_BASE)
+#define LL1_IS_ACTION(s) ((s) >= LL1_ACTION_BASE)
+
+#define LL1_MAX_RHS 8
+
+//! Nonterminals of the left factored C- grammar
+typedef enum {
+  NT_PROGRAM,
+  NT_DECL_LIST,
+  NT_DECLARATION,
+  NT_DECL_TAIL,
+  NT_TYPE_SPEC,
+  NT_DIMENSION,
+  NT_PARAMS,
+  NT_PARAM_TAIL,
+  NT_PARAM,
+  NT_PARAM_DIMENSION,
+  NT_COMPOUND,
+  NT_LOCAL_DECLS,
+  NT_VAR_DECL,
+  NT_STMT_LIST,
+  NT_STATEMENT,
+  NT_SELECTION,
+  NT_ELSE_PART,
+  NT_ITERATION,
+  NT_RETURN,
+  NT_RETURN_VALUE,
+  NT_EXPR_STMT,
+  NT_EXPRESSION,
+  NT_EXPR_ID_TAIL,
+  NT_VAR_REST,
+  NT_SIMPLE_REST,
+  NT_REL_REST,
+  NT_RELOP,
+  NT_ADDITIVE,
+  NT_ADD_REST,
+  NT_ADDOP,
+  NT_TERM,
+  NT_TERM_REST,
+  NT_MULOP,
+  NT_FACTOR,
+  NT_FACTOR_NO_ID,
+  NT_FACTOR_ID_TAIL,
+  NT_ARGS,
+  NT_ARG_REST,
+  NT_COUNT,
+} ll1_nonterminal_t;
+
+//! Semantic actions, run when popped from the parse stack. They build the
+//! same ast_node_t trees as the recursive descent parser
+typedef enum {
+  ACT_PROGRAM,
+  ACT_DECL_CONS,
+  ACT_DECL_NIL,
+  ACT_DECLARATION,
+  ACT_FUN_DECL,
+  ACT_VAR_DECL,
+  ACT_TYPE_SPEC,
+  ACT_DIMENSION,
+  ACT_ARRAY_MARK,
+  ACT_NULL,
+  ACT_PARAMS_VOID,
+  ACT_PARAM,
+  ACT_PARAM_LIST,
+  ACT_COMPOUND,
+  ACT_LOCALS_CONS,
+  ACT_LOCALS_NIL,
+  ACT_STMTS_CONS,
+  ACT_STMTS_NIL,
+  ACT_STATEMENT,
+  ACT_SELECTION,
+  ACT_ITERATION,
+  ACT_RETURN,
+  ACT_EXPR_STMT,
+  ACT_VAR,
+  ACT_VAR_INDEXED,
+  ACT_VAR_FACTOR,
+  ACT_CALL_FACTOR,
+  ACT_ASSIGN,
+  ACT_FACTOR_PAREN,
+  ACT_FACTOR_NUM,
+  ACT_TERM_OP,
+  ACT_TERM_END,
+  ACT_ADD_OP,
+  ACT_ADD_END,
+  ACT_SIMPLE,
+  ACT_ARG_LIST,
+  ACT_COUNT,
+} ll1_action_t;
+
+//! Grammar production. 'prefer' wins LL(1) conflicts (dangling else)
+typedef struct {
+  ll1_nonterminal_t lhs;
+  short rhs[LL1_MAX_RHS]; // Terminated by LL1_END
+  int prefer;
+} ll1_production_t;
+
+extern const ll1_production_t ll1_productions[];
+extern const int ll1_production_count;
+
+//! Printable name of a nonterminal (used by the table generator errors)
+const char *ll1_nonterminal_name(ll1_nonterminal_t nonterminal);
+
+// ----------------------- Semantic Values ----------------------
+
+//! Entry of the value stack handled by the actions
+typedef struct {
+  union {
+    ast_node_t *node;
+    char *id;
+    int number;
+    token_types_t token;
+  };
+  int line; // Line of the token or node that produced the value
+} ll1_value_t;
+
+typedef struct {
+  ll1_value_t *values;
+  int size;
+  int capacity;
+} ll1_value_stack_t;
+
+//! Pushes the value carried by a matched terminal (identifiers, numbers,
+//! types and operators). Other terminals don't carry values
+void ll1_push_terminal(ll1_value_stack_t *stack, token_t *token);
+
+//! Runs a semantic action over the value stack
+void ll1_run_action(ll1_action_t action, ll1_value_stack_t *stack);
+
+#endif // !LL1_GRAMMAR_H
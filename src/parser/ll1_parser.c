@@ -0,0 +1,226 @@
+#include "ll1_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIT(t) ((ll1_set_t)1 << (t))
+
+ll1_tables_t ll1_tables;
+
+// ----------------------- Table Generator ----------------------
+
+// FIRST set of rhs[start..], tells in 'nullable' if it can derive empty
+static ll1_set_t first_of_sequence(const short *rhs, int *nullable) {
+  ll1_set_t first = 0;
+
+  for (int i = 0; rhs[i] != LL1_END; i++) {
+    short symbol = rhs[i];
+
+    if (LL1_IS_ACTION(symbol))
+      continue; // Actions derive empty
+
+    if (LL1_IS_TERMINAL(symbol)) {
+      *nullable = 0;
+      return first | BIT(symbol);
+    }
+
+    int nt = symbol - LL1_NONTERMINAL_BASE;
+    first |= ll1_tables.first[nt];
+    if (!ll1_tables.nullable[nt]) {
+      *nullable = 0;
+      return first;
+    }
+  }
+
+  *nullable = 1;
+  return first;
+}
+
+static void compute_first() {
+  int changed = 1;
+
+  while (changed) {
+    changed = 0;
+    for (int p = 0; p < ll1_production_count; p++) {
+      const ll1_production_t *prod = &ll1_productions[p];
+      int nullable;
+      ll1_set_t first = first_of_sequence(prod->rhs, &nullable);
+
+      if ((ll1_tables.first[prod->lhs] | first) != ll1_tables.first[prod->lhs]) {
+        ll1_tables.first[prod->lhs] |= first;
+        changed = 1;
+      }
+      if (nullable && !ll1_tables.nullable[prod->lhs]) {
+        ll1_tables.nullable[prod->lhs] = 1;
+        changed = 1;
+      }
+    }
+  }
+}
+
+static void compute_follow() {
+  int changed = 1;
+
+  ll1_tables.follow[NT_PROGRAM] = BIT(TOKEN_EOF);
+
+  while (changed) {
+    changed = 0;
+    for (int p = 0; p < ll1_production_count; p++) {
+      const ll1_production_t *prod = &ll1_productions[p];
+
+      for (int i = 0; prod->rhs[i] != LL1_END; i++) {
+        if (!LL1_IS_NONTERMINAL(prod->rhs[i]))
+          continue;
+
+        int nt = prod->rhs[i] - LL1_NONTERMINAL_BASE;
+        int nullable;
+        ll1_set_t follow = first_of_sequence(&prod->rhs[i + 1], &nullable);
+        if (nullable)
+          follow |= ll1_tables.follow[prod->lhs];
+
+        if ((ll1_tables.follow[nt] | follow) != ll1_tables.follow[nt]) {
+          ll1_tables.follow[nt] |= follow;
+          changed = 1;
+        }
+      }
+    }
+  }
+}
+
+static void compute_table() {
+  ll1_tables.predict =
+      (ll1_set_t *)calloc(ll1_production_count, sizeof(ll1_set_t));
+  ll1_tables.rhs_length = (int *)calloc(ll1_production_count, sizeof(int));
+  if (!ll1_tables.predict || !ll1_tables.rhs_length) {
+    fprintf(stderr, "Error: Memory allocation failed for LL(1) tables.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  memset(ll1_tables.table, -1, sizeof(ll1_tables.table));
+
+  for (int p = 0; p < ll1_production_count; p++) {
+    const ll1_production_t *prod = &ll1_productions[p];
+    int nullable;
+    ll1_set_t predict = first_of_sequence(prod->rhs, &nullable);
+    if (nullable)
+      predict |= ll1_tables.follow[prod->lhs];
+    ll1_tables.predict[p] = predict;
+
+    while (prod->rhs[ll1_tables.rhs_length[p]] != LL1_END)
+      ll1_tables.rhs_length[p]++;
+
+    for (int t = 0; t < LL1_TERMINAL_COUNT; t++) {
+      if (!(predict & BIT(t)))
+        continue;
+
+      short *entry = &ll1_tables.table[prod->lhs][t];
+      if (*entry >= 0 && !prod->prefer) {
+        if (ll1_productions[*entry].prefer)
+          continue;
+        fprintf(stderr,
+                "Error: LL(1) conflict in '%s' on %s between productions %d "
+                "and %d.\n",
+                ll1_nonterminal_name(prod->lhs), print_token_classes(t), *entry,
+                p);
+        exit(EXIT_FAILURE);
+      }
+      *entry = p;
+    }
+  }
+}
+
+void ll1_build_tables() {
+  if (ll1_tables.built)
+    return;
+
+  compute_first();
+  compute_follow();
+  compute_table();
+
+  ll1_tables.built = 1;
+}
+
+static void print_set(ll1_set_t set) {
+  printf("{");
+  for (int t = 0, first = 1; t < LL1_TERMINAL_COUNT; t++) {
+    if (set & BIT(t)) {
+      printf("%s%s", first ? " " : ", ", print_token_classes(t));
+      first = 0;
+    }
+  }
+  printf(" }");
+}
+
+void ll1_print_tables() {
+  ll1_build_tables();
+
+  for (int nt = 0; nt < NT_COUNT; nt++) {
+    printf("%s%s\n  FIRST  ", ll1_nonterminal_name(nt),
+           ll1_tables.nullable[nt] ? " (nullable)" : "");
+    print_set(ll1_tables.first[nt]);
+    printf("\n  FOLLOW ");
+    print_set(ll1_tables.follow[nt]);
+    printf("\n");
+  }
+}
+
+// ----------------------- Parse Engine ----------------------
+
+typedef struct {
+  short *symbols;
+  int size;
+  int capacity;
+} symbol_stack_t;
+
+static void push_symbol(symbol_stack_t *stack, short symbol) {
+  if (stack->size == stack->capacity) {
+    stack->capacity = stack->capacity ? stack->capacity * 2 : 256;
+    stack->symbols =
+        (short *)realloc(stack->symbols, stack->capacity * sizeof(short));
+    if (!stack->symbols) {
+      fprintf(stderr, "Error: Memory allocation failed for LL(1) stack.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  stack->symbols[stack->size++] = symbol;
+}
+
+ast_node_t *ll1_parse_program() {
+  symbol_stack_t stack = {0};
+  ll1_value_stack_t values = {0};
+
+  ll1_build_tables();
+
+  push_symbol(&stack, LL1_NONTERMINAL_BASE + NT_PROGRAM);
+
+  while (stack.size > 0) {
+    short symbol = stack.symbols[--stack.size];
+
+    if (LL1_IS_TERMINAL(symbol)) {
+      if (currentToken->type != (token_types_t)symbol)
+        parser_print_error();
+      ll1_push_terminal(&values, currentToken);
+      advance_token();
+    } else if (LL1_IS_NONTERMINAL(symbol)) {
+      int production =
+          ll1_tables.table[symbol - LL1_NONTERMINAL_BASE][currentToken->type];
+      if (production < 0)
+        parser_print_error();
+
+      // Pushes the right side backwards, so its first symbol is on top
+      const short *rhs = ll1_productions[production].rhs;
+      for (int i = ll1_tables.rhs_length[production] - 1; i >= 0; i--)
+        push_symbol(&stack, rhs[i]);
+    } else {
+      ll1_run_action(symbol - LL1_ACTION_BASE, &values);
+    }
+  }
+
+  ast_node_t *program = values.values[0].node;
+
+  free(stack.symbols);
+  free(values.values);
+
+  return program;
+}
@@ -0,0 +1,35 @@
+#ifndef LL1_PARSER_H
+#define LL1_PARSER_H
+
+#include "ll1_grammar.h"
+
+#include <stdint.h>
+
+//! Set of terminals, one bit per token type
+typedef uint64_t ll1_set_t;
+
+//! Tables generated from the grammar description
+typedef struct {
+  ll1_set_t first[NT_COUNT];
+  ll1_set_t follow[NT_COUNT];
+  int nullable[NT_COUNT];
+  ll1_set_t *predict; // One set per production
+  int *rhs_length;    // Symbols on the right side of each production
+  short table[NT_COUNT][LL1_TERMINAL_COUNT]; // Production index or -1
+  int built;
+} ll1_tables_t;
+
+extern ll1_tables_t ll1_tables;
+
+//! Computes FIRST, FOLLOW and the parse table (only once). Exits if the
+//! grammar has an unresolved LL(1) conflict
+void ll1_build_tables();
+
+//! Parses a program with the table driven engine. The current token must be
+//! the first one of the file; returns the AST_PROGRAM node
+ast_node_t *ll1_parse_program();
+
+//! Prints the generated FIRST/FOLLOW sets (debugging helper)
+void ll1_print_tables();
+
+#endif // !LL1_PARSER_H
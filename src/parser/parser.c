@@ -1,12 +1,21 @@
 #include "parser.h"
 #include "../lexer/lexer.h"
+#include "../lexer/token_pipeline.h"
 #include "ast_printer.h"
+#include "ll1_parser.h"
+#include "../semantic/semantic.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 token_t *currentToken = NULL;
 int VERBOSE_PARSER = 0;
+int PIPELINED_PARSER = 0;
+parser_engine_t PARSER_ENGINE = PARSER_ENGINE_DESCENT;
+int FUSED_SEMANTIC = 0;
+
+//! Token handed to the parser once the lexer reaches the end of file
+static token_t eof_token = {.type = TOKEN_EOF, .lexeme = "EOF"};
 
 ast_node_t *create_ast_node(ast_node_type_t type) {
   ast_node_t *node = (ast_node_t *)malloc(sizeof(ast_node_t));
@@ -15,6 +24,9 @@ ast_node_t *create_ast_node(ast_node_type_t type) {
     exit(EXIT_FAILURE);
   }
   node->type = type;
+  node->line = currentToken ? currentToken->line : 0;
+  node->symbol = NULL;
+  node->sem_type = SEM_TYPE_NONE;
   memset(&node->data, 0, sizeof(node->data)); //! Initializes the union with 0
   return node;
 }
@@ -160,11 +172,22 @@ void destroy_ast_root(ast_node_t *root) { destroy_ast(root); }
 token_t *get_current_token() { return currentToken; }
 
 void advance_token() {
+  if (PIPELINED_PARSER) {
+    // The ring buffer owns the tokens, nothing to free here
+    currentToken = token_pipeline_pop();
+    return;
+  }
+
+  if (currentToken && currentToken != &eof_token)
+    delete_token(currentToken);
+
   currentToken = get_next_token();
 
   if (currentToken == NULL) {
-    fprintf(stderr, "Error: Reached end of file unexpectedly.\n");
-    exit(EXIT_FAILURE);
+    // Unexpected ends of file are reported by the rule expecting a token
+    eof_token.line = current_line;
+    eof_token.column = current_column;
+    currentToken = &eof_token;
   }
 }
 
@@ -180,6 +203,14 @@ void set_verbose_parser(int is_verbose) {
   VERBOSE_PARSER = is_verbose;
 }
 
+void set_pipelined_parser(int is_pipelined) {
+  PIPELINED_PARSER = is_pipelined;
+}
+
+void set_parser_engine(parser_engine_t engine) { PARSER_ENGINE = engine; }
+
+void set_fused_semantic(int is_fused) { FUSED_SEMANTIC = is_fused; }
+
 void parser_print_error() {
   fprintf(
       stderr,
@@ -193,10 +224,34 @@ void parser_print_error() {
 
 ast_node_t *parse_program() {
 
+  if (PIPELINED_PARSER)
+    token_pipeline_start();
+
   advance_token();
 
-  ast_node_t *program = create_ast_node(AST_PROGRAM);
-  program->data.program.decl_list = parse_declaration_list();
+  // The LL(1) engine builds the nodes out of order, so it always leaves the
+  // checks to the separate pass
+  if (FUSED_SEMANTIC && PARSER_ENGINE == PARSER_ENGINE_DESCENT)
+    semantic_fused_begin();
+
+  ast_node_t *program = NULL;
+  if (PARSER_ENGINE == PARSER_ENGINE_LL1) {
+    program = ll1_parse_program();
+  } else {
+    program = create_ast_node(AST_PROGRAM);
+    program->data.program.decl_list = parse_declaration_list();
+  }
+
+  // Everything must have been consumed by the declarations
+  if (currentToken->type != TOKEN_EOF)
+    parser_print_error();
+
+  if (FUSED_CONTEXT)
+    semantic_end_program(FUSED_CONTEXT);
+
+  if (PIPELINED_PARSER)
+    token_pipeline_stop();
+  currentToken = NULL; // The last token was EOF, which is never freed
 
   if (VERBOSE_PARSER)
     print_ast(program);
@@ -233,20 +288,28 @@ ast_node_t *parse_declaration() {
   }
 
   char *id = strdup(currentToken->lexeme);
+  int line = currentToken->line;
   advance_token(); // Eats the identifier
 
   if (currentToken->type == TOKEN_LPARENT) { // Function
     decl = create_ast_node(AST_FUN_DECLARATION);
+    decl->line = line;
     decl->data.fun_declaration.type_specifier = type_spec;
     decl->data.fun_declaration.id = id;
+    if (FUSED_CONTEXT)
+      semantic_begin_function(FUSED_CONTEXT, decl);
 
     match_token(TOKEN_LPARENT);
     decl->data.fun_declaration.params = parse_params();
     match_token(TOKEN_RPARENT);
     decl->data.fun_declaration.compound_decl = parse_compound_decl();
 
+    if (FUSED_CONTEXT)
+      semantic_end_function(FUSED_CONTEXT, decl);
+
   } else { // Variable
     decl = create_ast_node(AST_VAR_DECLARATION);
+    decl->line = line;
     decl->data.var_declaration.type_specifier = type_spec;
     decl->data.var_declaration.id = id;
     decl->data.var_declaration.dimension = NULL;
@@ -266,6 +329,9 @@ ast_node_t *parse_declaration() {
     }
 
     match_token(TOKEN_DELIM);
+
+    if (FUSED_CONTEXT)
+      semantic_check_var_declaration(FUSED_CONTEXT, decl);
   }
 
   declaration_node->data.declaration.declaration = decl;
@@ -320,6 +386,7 @@ ast_node_t *parse_param() {
 
   param->data.param.dimension = NULL;
   param->data.param.id = strdup(currentToken->lexeme);
+  param->line = currentToken->line;
   advance_token(); // Eats the identifier
 
   if (currentToken->type == TOKEN_LBRACKET) { // Array
@@ -332,6 +399,9 @@ ast_node_t *parse_param() {
     param->data.param.dimension = array_node;
   }
 
+  if (FUSED_CONTEXT)
+    semantic_check_param(FUSED_CONTEXT, param);
+
   return param;
 }
 
@@ -339,11 +409,15 @@ ast_node_t *parse_compound_decl() {
   ast_node_t *compound_decl = create_ast_node(AST_COMPOUND_DECL);
 
   match_token(TOKEN_LKEY); // '{'
+  if (FUSED_CONTEXT)
+    semantic_begin_block(FUSED_CONTEXT);
 
   compound_decl->data.compound_decl.local_declarations =
       parse_local_declarations();
   compound_decl->data.compound_decl.statement_list = parse_statement_list();
 
+  if (FUSED_CONTEXT)
+    semantic_end_block(FUSED_CONTEXT);
   match_token(TOKEN_RKEY); // '}'
 
   return compound_decl;
@@ -378,6 +452,7 @@ ast_node_t *parse_var_declaration() {
 
   char *id = strdup(currentToken->lexeme);
   var_decl->data.var_declaration.id = id;
+  var_decl->line = currentToken->line;
   advance_token(); // Eats the identifier
 
   var_decl->data.var_declaration.dimension = NULL;
@@ -397,6 +472,9 @@ ast_node_t *parse_var_declaration() {
 
   match_token(TOKEN_DELIM);
 
+  if (FUSED_CONTEXT)
+    semantic_check_var_declaration(FUSED_CONTEXT, var_decl);
+
   return var_decl;
 }
 
@@ -406,7 +484,7 @@ ast_node_t *parse_statement_list() {
   if (currentToken->type == TOKEN_IF || currentToken->type == TOKEN_WHILE ||
       currentToken->type == TOKEN_RETURN || currentToken->type == TOKEN_LKEY ||
       currentToken->type == TOKEN_ID || currentToken->type == TOKEN_NUM ||
-      currentToken->type == TOKEN_DELIM) {
+      currentToken->type == TOKEN_LPARENT || currentToken->type == TOKEN_DELIM) {
 
     stmt_list->data.statement_list.statement = parse_statement();
     stmt_list->data.statement_list.statement_list = parse_statement_list();
@@ -442,6 +520,9 @@ ast_node_t *parse_selection_statement() {
   match_token(TOKEN_IF);
   match_token(TOKEN_LPARENT);
   sel_stmt->data.selection_statement.expression = parse_expression();
+  if (FUSED_CONTEXT)
+    semantic_check_condition(FUSED_CONTEXT,
+                             sel_stmt->data.selection_statement.expression);
   match_token(TOKEN_RPARENT);
   sel_stmt->data.selection_statement.then_statement = parse_statement();
 
@@ -461,6 +542,9 @@ ast_node_t *parse_iteration_statement() {
   match_token(TOKEN_WHILE);
   match_token(TOKEN_LPARENT);
   iter_stmt->data.iteration_statement.expression = parse_expression();
+  if (FUSED_CONTEXT)
+    semantic_check_condition(FUSED_CONTEXT,
+                             iter_stmt->data.iteration_statement.expression);
   match_token(TOKEN_RPARENT);
   iter_stmt->data.iteration_statement.body = parse_statement();
 
@@ -480,6 +564,9 @@ ast_node_t *parse_return_statement() {
 
   match_token(TOKEN_DELIM);
 
+  if (FUSED_CONTEXT)
+    semantic_check_return(FUSED_CONTEXT, ret_stmt);
+
   return ret_stmt;
 }
 
@@ -536,9 +623,16 @@ ast_node_t *parse_var() {
 }
 
 ast_node_t *parse_simple_expression() {
+  return parse_simple_expression_with(NULL);
+}
+
+ast_node_t *parse_simple_expression_with(ast_node_t *first_factor) {
   ast_node_t *simple_expr = create_ast_node(AST_SIMPLE_EXPRESSION);
+  if (first_factor)
+    simple_expr->line = first_factor->line;
 
-  simple_expr->data.simple_expression.left = parse_additive_expression();
+  simple_expr->data.simple_expression.left =
+      parse_additive_expression_with(first_factor);
 
   // Searches for a relational operator
   if (currentToken->type == TOKEN_LE || currentToken->type == TOKEN_LT ||
@@ -552,6 +646,9 @@ ast_node_t *parse_simple_expression() {
     simple_expr->data.simple_expression.right = NULL;
   }
 
+  if (FUSED_CONTEXT)
+    semantic_check_expression(FUSED_CONTEXT, simple_expr);
+
   return simple_expr;
 }
 
@@ -588,19 +685,36 @@ ast_node_t *parse_relational_op() {
 }
 
 ast_node_t *parse_additive_expression() {
-  ast_node_t *add_expr = create_ast_node(AST_ADDITIVE_EXPRESSION);
-
-  add_expr->data.additive_expression.left = parse_term();
+  return parse_additive_expression_with(NULL);
+}
 
-  // Searches for a '+' or '-'
-  if (currentToken->type == TOKEN_PLUS || currentToken->type == TOKEN_MINUS) {
+ast_node_t *parse_additive_expression_with(ast_node_t *first_factor) {
+  ast_node_t *add_expr = create_ast_node(AST_ADDITIVE_EXPRESSION);
+  if (first_factor)
+    add_expr->line = first_factor->line;
+
+  add_expr->data.additive_expression.left = parse_term_with(first_factor);
+  add_expr->data.additive_expression.add_op = NULL;
+  add_expr->data.additive_expression.right = NULL;
+
+  // Searches for a '+' or '-', the chain is left associative:
+  // a - b - c is ((a - b) - c)
+  while (currentToken->type == TOKEN_PLUS || currentToken->type == TOKEN_MINUS) {
+    if (add_expr->data.additive_expression.add_op) {
+      if (FUSED_CONTEXT)
+        semantic_check_expression(FUSED_CONTEXT, add_expr);
+      ast_node_t *chain = create_ast_node(AST_ADDITIVE_EXPRESSION);
+      chain->line = add_expr->line;
+      chain->data.additive_expression.left = add_expr;
+      add_expr = chain;
+    }
     add_expr->data.additive_expression.add_op = parse_add_op();
     add_expr->data.additive_expression.right = parse_term();
-  } else {
-    add_expr->data.additive_expression.add_op = NULL;
-    add_expr->data.additive_expression.right = NULL;
   }
 
+  if (FUSED_CONTEXT)
+    semantic_check_expression(FUSED_CONTEXT, add_expr);
+
   return add_expr;
 }
 
@@ -619,20 +733,34 @@ ast_node_t *parse_add_op() {
   return add_op;
 }
 
-ast_node_t *parse_term() {
-  ast_node_t *term_node = create_ast_node(AST_TERM);
-
-  term_node->data.term.left = parse_factor();
+ast_node_t *parse_term() { return parse_term_with(NULL); }
 
-  // Searches for a '*' or '/'
-  if (currentToken->type == TOKEN_MULT || currentToken->type == TOKEN_DIV) {
+ast_node_t *parse_term_with(ast_node_t *first_factor) {
+  ast_node_t *term_node = create_ast_node(AST_TERM);
+  if (first_factor)
+    term_node->line = first_factor->line;
+
+  term_node->data.term.left = first_factor ? first_factor : parse_factor();
+  term_node->data.term.mult_op = NULL;
+  term_node->data.term.right = NULL;
+
+  // Searches for a '*' or '/', left associative like the additive chain
+  while (currentToken->type == TOKEN_MULT || currentToken->type == TOKEN_DIV) {
+    if (term_node->data.term.mult_op) {
+      if (FUSED_CONTEXT)
+        semantic_check_expression(FUSED_CONTEXT, term_node);
+      ast_node_t *chain = create_ast_node(AST_TERM);
+      chain->line = term_node->line;
+      chain->data.term.left = term_node;
+      term_node = chain;
+    }
     term_node->data.term.mult_op = parse_mult_op();
     term_node->data.term.right = parse_factor();
-  } else {
-    term_node->data.term.mult_op = NULL;
-    term_node->data.term.right = NULL;
   }
 
+  if (FUSED_CONTEXT)
+    semantic_check_expression(FUSED_CONTEXT, term_node);
+
   return term_node;
 }
 
@@ -652,31 +780,15 @@ ast_node_t *parse_mult_op() {
 }
 
 ast_node_t *parse_factor() {
+  if (currentToken->type == TOKEN_ID) // Could be 'var' or 'activation'
+    return parse_factor_from_var(parse_var());
+
   ast_node_t *factor = create_ast_node(AST_FACTOR);
 
   if (currentToken->type == TOKEN_LPARENT) { // '(' expression ')'
     match_token(TOKEN_LPARENT);
     factor->data.factor.expression = parse_expression();
     match_token(TOKEN_RPARENT);
-  } else if (currentToken->type == TOKEN_ID) { // Could be 'var' or 'activation'
-    // Saves the currentToken to know if it's a function call
-    token_t *token_backup = currentToken;
-
-    ast_node_t *var_node = parse_var();
-
-    if (currentToken->type ==
-        TOKEN_LPARENT) { // It's a activation(function call)
-      ast_node_t *activation = parse_activation_helper(
-          var_node->data.variable.id, var_node->data.variable.index);
-      destroy_ast(
-          var_node); // Deletes var node because we know it's an activation
-      factor->data.factor.activation = activation;
-      factor->data.factor.variable = NULL;
-    } else {
-      // It's a normal variable
-      factor->data.factor.variable = var_node;
-      factor->data.factor.activation = NULL;
-    }
   } else if (currentToken->type == TOKEN_NUM) { // NUM
     factor->data.factor.number = atoi(currentToken->lexeme);
     match_token(TOKEN_NUM);
@@ -688,6 +800,40 @@ ast_node_t *parse_factor() {
     parser_print_error();
   }
 
+  if (FUSED_CONTEXT)
+    semantic_check_expression(FUSED_CONTEXT, factor);
+
+  return factor;
+}
+
+// Aux function to finish a factor whose identifier was already parsed
+ast_node_t *parse_factor_from_var(ast_node_t *var_node) {
+  ast_node_t *factor = create_ast_node(AST_FACTOR);
+  factor->line = var_node->line;
+
+  if (currentToken->type == TOKEN_LPARENT) { // It's a activation(function call)
+    // The helper takes ownership of the index (it shouldn't exist anyway)
+    ast_node_t *activation = parse_activation_helper(
+        var_node->data.variable.id, var_node->data.variable.index);
+    activation->line = var_node->line;
+    if (FUSED_CONTEXT)
+      semantic_check_expression(FUSED_CONTEXT, activation);
+    var_node->data.variable.index = NULL;
+    destroy_ast(
+        var_node); // Deletes var node because we know it's an activation
+    factor->data.factor.activation = activation;
+    factor->data.factor.variable = NULL;
+  } else {
+    // It's a normal variable
+    factor->data.factor.variable = var_node;
+    factor->data.factor.activation = NULL;
+    if (FUSED_CONTEXT)
+      semantic_check_expression(FUSED_CONTEXT, var_node);
+  }
+
+  if (FUSED_CONTEXT)
+    semantic_check_expression(FUSED_CONTEXT, factor);
+
   return factor;
 }
 
@@ -759,8 +905,12 @@ ast_node_t *parse_fun_declaration() {
 
   // Copies the identifier lexeme
   fun_decl->data.fun_declaration.id = strdup(currentToken->lexeme);
+  fun_decl->line = currentToken->line;
   advance_token(); // Eats the identifier
 
+  if (FUSED_CONTEXT)
+    semantic_begin_function(FUSED_CONTEXT, fun_decl);
+
   match_token(TOKEN_LPARENT); // Consumes '('
 
   // Analyzing 'params'
@@ -771,6 +921,9 @@ ast_node_t *parse_fun_declaration() {
   // Analyzing 'compound-decl'
   fun_decl->data.fun_declaration.compound_decl = parse_compound_decl();
 
+  if (FUSED_CONTEXT)
+    semantic_end_function(FUSED_CONTEXT, fun_decl);
+
   return fun_decl;
 }
 
@@ -787,6 +940,7 @@ ast_node_t *parse_expression() {
     if (currentToken->type == TOKEN_ATTR) { // '='
       // It's a atribuition
       expr = create_ast_node(AST_ASSIGNMENT_EXPRESSION);
+      expr->line = var_node->line;
       expr->data.assignment_expression.var_id =
           strdup(var_node->data.variable.id);
       expr->data.assignment_expression.var_index =
@@ -798,14 +952,18 @@ ast_node_t *parse_expression() {
       expr->data.assignment_expression.expression =
           parse_expression(); // Recursive call
 
-      // Free var node because we're creating a new attr node
+      // Free var node because we're creating a new attr node, the index
+      // now belongs to the assignment
+      var_node->data.variable.index = NULL;
       destroy_ast(var_node);
+
+      if (FUSED_CONTEXT)
+        semantic_check_expression(FUSED_CONTEXT, expr);
     } else {
-      // It's not an attr, it's a simple-expression starting with var. So, 
+      // It's not an attr, it's a simple-expression starting with var. So,
       // we need to rebuild the tree to include 'var' in the simple expression.
-      // In this case, 'var_node' already represents a factor inside 'simple-exp'
-
-      expr = parse_simple_expression();
+      // In this case, 'var_node' becomes the first factor inside 'simple-exp'
+      expr = parse_simple_expression_with(parse_factor_from_var(var_node));
     }
   } else {
     // Don't start with a variable, so it's a simple-expression
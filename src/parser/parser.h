@@ -9,6 +9,23 @@ extern token_t *currentToken;
 //! Global controller to print the ASTree after sintatic analysis
 extern int VERBOSE_PARSER;
 
+//! Global controller to run the lexer on its own thread, feeding the parser
+//! through a ring buffer of tokens
+extern int PIPELINED_PARSER;
+
+//! Available parsing engines
+typedef enum {
+  PARSER_ENGINE_DESCENT, // Hand-written recursive descent (default)
+  PARSER_ENGINE_LL1,     // Table-driven LL(1) generated from the grammar
+} parser_engine_t;
+
+//! Global controller of the engine used by parse_program()
+extern parser_engine_t PARSER_ENGINE;
+
+//! Global controller to run the semantic checks while the recursive descent
+//! parser builds the nodes, instead of a second walk over the tree
+extern int FUSED_SEMANTIC;
+
 // ----------------------- Abstract Syntax Tree (AST) Structures ----------------------
 
 //! Enumeration for AST node types
@@ -43,9 +60,25 @@ typedef enum {
   AST_ARGUMENT_LIST,
 } ast_node_type_t;
 
+//! Type of an expression, annotated by the semantic analysis
+typedef enum {
+  SEM_TYPE_NONE,  // Not an expression, or not analyzed
+  SEM_TYPE_ERROR, // Already reported, never reported again
+  SEM_TYPE_INT,
+  SEM_TYPE_VOID,
+  SEM_TYPE_ARRAY, // Array name used without an index
+} sem_type_t;
+
+struct symbol;
+
 //! Structure for an AST node
 typedef struct ast_node {
   ast_node_type_t type;
+  int line; // Source line of the node (of the identifier, when it has one)
+
+  //! Annotations of the semantic analysis
+  struct symbol *symbol; // Declaration of the identifier of the node
+  sem_type_t sem_type;   // Type of the expression
   union {
     //! Program Node
     struct {
@@ -235,6 +268,15 @@ void destroy_ast_root(ast_node_t *root);
 //! Sets the option to print the tree after the sintatic analysis
 void set_verbose_parser(int is_verbose);
 
+//! Sets the option to run the lexer and the parser on separate threads
+void set_pipelined_parser(int is_pipelined);
+
+//! Selects the parsing engine
+void set_parser_engine(parser_engine_t engine);
+
+//! Sets the option to run the semantic checks inside the parser
+void set_fused_semantic(int is_fused);
+
 //! Parser default error
 void parser_print_error();
 
@@ -269,6 +311,13 @@ ast_node_t *parse_mult_op();
 ast_node_t *parse_factor();
 ast_node_t *parse_activation();
 ast_node_t* parse_activation_helper(char *id, ast_node_t *index);
+
+//! Variants continuing an expression whose first factor was already parsed
+//! (NULL parses it as usual)
+ast_node_t *parse_simple_expression_with(ast_node_t *first_factor);
+ast_node_t *parse_additive_expression_with(ast_node_t *first_factor);
+ast_node_t *parse_term_with(ast_node_t *first_factor);
+ast_node_t *parse_factor_from_var(ast_node_t *var_node);
 ast_node_t *parse_args();
 ast_node_t *parse_argument_list();
 
@@ -0,0 +1,713 @@
+#include "semantic.h"
+#include "semantic_parallel.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int VERBOSE_SEMANTIC = 0;
+int PARALLEL_SEMANTIC = 0;
+semantic_context_t *FUSED_CONTEXT = NULL;
+
+void set_verbose_semantic(int is_verbose) { VERBOSE_SEMANTIC = is_verbose; }
+
+void set_parallel_semantic(int threads) { PARALLEL_SEMANTIC = threads; }
+
+// ----------------------- Diagnostics ----------------------
+
+void semantic_error(semantic_context_t *context, int line, const char *format,
+                    ...) {
+  char buffer[256];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+
+  if (context->diagnostic_count == context->diagnostic_capacity) {
+    context->diagnostic_capacity =
+        context->diagnostic_capacity ? context->diagnostic_capacity * 2 : 16;
+    context->diagnostics = (semantic_diagnostic_t *)realloc(
+        context->diagnostics,
+        context->diagnostic_capacity * sizeof(semantic_diagnostic_t));
+    if (!context->diagnostics) {
+      fprintf(stderr, "Error: Memory allocation failed for diagnostics.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  semantic_diagnostic_t *diagnostic =
+      &context->diagnostics[context->diagnostic_count++];
+  diagnostic->line = line;
+  diagnostic->message = strdup(buffer);
+}
+
+void semantic_print_diagnostics(const semantic_context_t *context) {
+  for (int i = 0; i < context->diagnostic_count; i++)
+    fprintf(stderr, "\033[31mERRO SEMANTICO: %s [linha: %d]\033[0m\n",
+            context->diagnostics[i].message, context->diagnostics[i].line);
+}
+
+// ----------------------- Context ----------------------
+
+static symbol_t *declare_builtin(semantic_context_t *context, const char *name,
+                                 token_types_t type, int param_count) {
+  symbol_t *symbol =
+      symtab_declare(&context->table, name, SYM_FUNCTION, type, NULL);
+  symbol->is_builtin = 1;
+  symbol->param_count = param_count;
+  if (param_count) {
+    symbol->param_kinds =
+        (symbol_kind_t *)malloc(param_count * sizeof(symbol_kind_t));
+    for (int i = 0; i < param_count; i++)
+      symbol->param_kinds[i] = SYM_VARIABLE;
+  }
+  return symbol;
+}
+
+void semantic_init(semantic_context_t *context) {
+  memset(context, 0, sizeof(*context));
+  intern_pool_init(&context->pool);
+  symtab_init(&context->table, &context->pool);
+  context->output = stdout;
+
+  symtab_enter_scope(&context->table); // Global scope
+  declare_builtin(context, "input", TOKEN_INT, 0);
+  declare_builtin(context, "output", TOKEN_VOID, 1);
+}
+
+void semantic_destroy(semantic_context_t *context) {
+  for (int i = 0; i < context->diagnostic_count; i++)
+    free(context->diagnostics[i].message);
+  free(context->diagnostics);
+  symtab_destroy(&context->table);
+  intern_pool_destroy(&context->pool);
+}
+
+static const char *kind_name(symbol_kind_t kind) {
+  switch (kind) {
+  case SYM_VARIABLE:
+    return "variavel";
+  case SYM_ARRAY:
+    return "array";
+  case SYM_FUNCTION:
+    return "funcao";
+  }
+  return "?";
+}
+
+//! Prints the symbols declared in the innermost scope
+static void print_scope(const semantic_context_t *context) {
+  const symtab_t *table = &context->table;
+  int depth = table->depth - 1;
+
+  fprintf(context->output, "Escopo %d%s%s:\n", depth, context->function ? " de " : "",
+         context->function ? context->function->name : "");
+  for (int e = table->scope_marks[depth]; e < table->entry_count; e++) {
+    const symbol_t *symbol = table->entries[e].symbol;
+    fprintf(context->output, "  %-16s %-8s %-4s", symbol->name, kind_name(symbol->kind),
+           symbol->type == TOKEN_INT ? "int" : "void");
+    if (symbol->kind == SYM_ARRAY && symbol->size)
+      fprintf(context->output, " [%d]", symbol->size);
+    if (symbol->kind == SYM_FUNCTION)
+      fprintf(context->output, " (%d parametros)", symbol->param_count);
+    if (symbol->is_param)
+      fprintf(context->output, " parametro");
+    if (symbol->declaration)
+      fprintf(context->output, " linha %d", symbol->declaration->line);
+    fputc('\n', context->output);
+  }
+}
+
+static void leave_scope(semantic_context_t *context) {
+  if (VERBOSE_SEMANTIC)
+    print_scope(context);
+  symtab_leave_scope(&context->table);
+}
+
+// ----------------------- Declarations ----------------------
+
+//! Declares a name, reporting a redeclaration in the same scope
+static symbol_t *declare(semantic_context_t *context, ast_node_t *node,
+                         const char *id, symbol_kind_t kind,
+                         token_types_t type) {
+  symbol_t *previous = NULL;
+  symbol_t *symbol = symtab_declare(&context->table, id, kind, type, &previous);
+
+  if (!symbol) {
+    if (previous->is_builtin)
+      semantic_error(context, node->line,
+                     "'%s' redeclara uma funcao pre-definida", id);
+    else
+      semantic_error(context, node->line,
+                     "'%s' ja foi declarado neste escopo (linha %d)", id,
+                     previous->declaration ? previous->declaration->line : 0);
+    return NULL;
+  }
+
+  symbol->declaration = node;
+  node->symbol = symbol;
+  return symbol;
+}
+
+void semantic_check_var_declaration(semantic_context_t *context,
+                                    ast_node_t *node) {
+  const char *id = node->data.var_declaration.id;
+  ast_node_t *dimension = node->data.var_declaration.dimension;
+  token_types_t type =
+      node->data.var_declaration.type_specifier->data.type_specifier.type;
+
+  if (type == TOKEN_VOID)
+    semantic_error(context, node->line,
+                   "variavel '%s' declarada com o tipo void", id);
+
+  symbol_t *symbol =
+      declare(context, node, id, dimension ? SYM_ARRAY : SYM_VARIABLE, type);
+
+  if (dimension) {
+    if (dimension->data.factor.number <= 0)
+      semantic_error(context, node->line,
+                     "array '%s' com tamanho invalido (%d)", id,
+                     dimension->data.factor.number);
+    if (symbol)
+      symbol->size = dimension->data.factor.number;
+  }
+
+  if (context->table.depth == 1)
+    context->last_declaration = node;
+}
+
+void semantic_check_param(semantic_context_t *context, ast_node_t *node) {
+  const char *id = node->data.param.id;
+  ast_node_t *dimension = node->data.param.dimension;
+  token_types_t type =
+      node->data.param.type_specifier->data.type_specifier.type;
+  symbol_kind_t kind = dimension ? SYM_ARRAY : SYM_VARIABLE;
+
+  if (type == TOKEN_VOID)
+    semantic_error(context, node->line,
+                   "parametro '%s' declarado com o tipo void", id);
+
+  symbol_t *symbol = declare(context, node, id, kind, type);
+  if (symbol)
+    symbol->is_param = 1;
+
+  // The signature is known as soon as its parameters are, so the body may
+  // call the function recursively
+  symbol_t *function = context->function;
+  if (function && !context->globals) {
+    function->param_kinds = (symbol_kind_t *)realloc(
+        function->param_kinds,
+        (function->param_count + 1) * sizeof(symbol_kind_t));
+    if (!function->param_kinds) {
+      fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+      exit(EXIT_FAILURE);
+    }
+    function->param_kinds[function->param_count++] = kind;
+  }
+}
+
+void semantic_begin_function(semantic_context_t *context, ast_node_t *node) {
+  const char *id = node->data.fun_declaration.id;
+  token_types_t type =
+      node->data.fun_declaration.type_specifier->data.type_specifier.type;
+
+  // Declared before the body, so it may call itself. Workers of the
+  // parallel analysis reuse the symbol of the global table
+  if (context->globals) {
+    context->function = node->symbol;
+  } else {
+    context->function = declare(context, node, id, SYM_FUNCTION, type);
+    context->last_declaration = node;
+  }
+
+  // The parameters share the scope of the outermost block of the body
+  symtab_enter_scope(&context->table);
+  context->function_depth = context->table.depth;
+  context->body_pending = 1;
+}
+
+void semantic_end_function(semantic_context_t *context, ast_node_t *node) {
+  (void)node;
+  leave_scope(context);
+  context->function = NULL;
+}
+
+void semantic_begin_block(semantic_context_t *context) {
+  if (context->body_pending)
+    context->body_pending = 0;
+  else
+    symtab_enter_scope(&context->table);
+}
+
+void semantic_end_block(semantic_context_t *context) {
+  if (context->table.depth > context->function_depth)
+    leave_scope(context);
+}
+
+// ----------------------- Expressions ----------------------
+
+//! Reports a value that can't be used as an integer. Returns 1 if it's valid
+static int require_int(semantic_context_t *context, ast_node_t *node,
+                       const char *where) {
+  switch (node->sem_type) {
+  case SEM_TYPE_INT:
+  case SEM_TYPE_ERROR:
+  case SEM_TYPE_NONE:
+    return 1;
+  case SEM_TYPE_VOID:
+    semantic_error(context, node->line, "valor void usado %s", where);
+    return 0;
+  case SEM_TYPE_ARRAY:
+    semantic_error(context, node->line, "array sem indice usado %s", where);
+    return 0;
+  }
+  return 0;
+}
+
+//! Resolves a name used by a variable, an assignment or a call
+static symbol_t *resolve(semantic_context_t *context, ast_node_t *node,
+                         const char *id) {
+  symbol_t *symbol = symtab_lookup(&context->table, id);
+
+  // Workers of the parallel analysis fall back to the globals declared
+  // before the end of their function's declaration
+  if (!symbol && context->globals) {
+    symbol = symtab_lookup_interned(context->globals,
+                                    intern_find(context->globals->pool, id));
+    if (symbol && symbol->order >= context->visible_globals)
+      symbol = NULL;
+  }
+
+  if (!symbol)
+    semantic_error(context, node->line, "'%s' nao foi declarado", id);
+  node->symbol = symbol;
+  return symbol;
+}
+
+static sem_type_t check_variable(semantic_context_t *context,
+                                 ast_node_t *node) {
+  const char *id = node->data.variable.id;
+  ast_node_t *index = node->data.variable.index;
+  symbol_t *symbol = resolve(context, node, id);
+
+  if (index)
+    require_int(context, index, "como indice");
+
+  if (!symbol)
+    return SEM_TYPE_ERROR;
+
+  if (symbol->kind == SYM_FUNCTION) {
+    semantic_error(context, node->line, "funcao '%s' usada como variavel", id);
+    return SEM_TYPE_ERROR;
+  }
+
+  if (index) {
+    if (symbol->kind != SYM_ARRAY) {
+      semantic_error(context, node->line, "'%s' nao e um array", id);
+      return SEM_TYPE_ERROR;
+    }
+    return SEM_TYPE_INT;
+  }
+
+  return symbol->kind == SYM_ARRAY ? SEM_TYPE_ARRAY : SEM_TYPE_INT;
+}
+
+static sem_type_t check_activation(semantic_context_t *context,
+                                   ast_node_t *node) {
+  const char *id = node->data.activation.id;
+  symbol_t *symbol = resolve(context, node, id);
+
+  if (symbol && symbol->kind != SYM_FUNCTION) {
+    semantic_error(context, node->line, "'%s' nao e uma funcao", id);
+    symbol = NULL;
+  }
+
+  int count = 0;
+  for (ast_node_t *list = node->data.activation.args; list;
+       list = list->data.argument_list.arg_list, count++) {
+    ast_node_t *argument = list->data.argument_list.expression;
+
+    if (!symbol || count >= symbol->param_count ||
+        argument->sem_type == SEM_TYPE_ERROR)
+      continue;
+
+    if (symbol->param_kinds[count] == SYM_ARRAY) {
+      if (argument->sem_type != SEM_TYPE_ARRAY)
+        semantic_error(context, argument->line,
+                       "argumento %d de '%s' deveria ser um array", count + 1,
+                       id);
+    } else {
+      require_int(context, argument, "como argumento");
+    }
+  }
+
+  if (!symbol)
+    return SEM_TYPE_ERROR;
+
+  if (count != symbol->param_count)
+    semantic_error(context, node->line,
+                   "'%s' espera %d argumento(s), mas recebeu %d", id,
+                   symbol->param_count, count);
+
+  return symbol->type == TOKEN_INT ? SEM_TYPE_INT : SEM_TYPE_VOID;
+}
+
+static sem_type_t check_assignment(semantic_context_t *context,
+                                   ast_node_t *node) {
+  const char *id = node->data.assignment_expression.var_id;
+  ast_node_t *index = node->data.assignment_expression.var_index;
+  symbol_t *symbol = resolve(context, node, id);
+  sem_type_t result = SEM_TYPE_INT;
+
+  if (index)
+    require_int(context, index, "como indice");
+
+  if (!symbol) {
+    result = SEM_TYPE_ERROR;
+  } else if (symbol->kind == SYM_FUNCTION) {
+    semantic_error(context, node->line, "atribuicao a funcao '%s'", id);
+    result = SEM_TYPE_ERROR;
+  } else if (index && symbol->kind != SYM_ARRAY) {
+    semantic_error(context, node->line, "'%s' nao e um array", id);
+    result = SEM_TYPE_ERROR;
+  } else if (!index && symbol->kind == SYM_ARRAY) {
+    semantic_error(context, node->line, "atribuicao ao array '%s' sem indice",
+                   id);
+    result = SEM_TYPE_ERROR;
+  }
+
+  require_int(context, node->data.assignment_expression.expression,
+              "em atribuicao");
+
+  return result;
+}
+
+static sem_type_t check_factor(ast_node_t *node) {
+  if (node->data.factor.expression)
+    return node->data.factor.expression->sem_type;
+  if (node->data.factor.variable)
+    return node->data.factor.variable->sem_type;
+  if (node->data.factor.activation)
+    return node->data.factor.activation->sem_type;
+  return SEM_TYPE_INT; // Number
+}
+
+//! Checks both sides of a binary operator, the result is always int
+static sem_type_t check_operands(semantic_context_t *context, ast_node_t *left,
+                                 ast_node_t *right, const char *where) {
+  int valid = require_int(context, left, where);
+  valid &= require_int(context, right, where);
+  return valid && left->sem_type == SEM_TYPE_INT &&
+                 right->sem_type == SEM_TYPE_INT
+             ? SEM_TYPE_INT
+             : SEM_TYPE_ERROR;
+}
+
+void semantic_check_expression(semantic_context_t *context, ast_node_t *node) {
+  sem_type_t type = SEM_TYPE_ERROR;
+
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    type = check_assignment(context, node);
+    break;
+  case AST_SIMPLE_EXPRESSION:
+    if (node->data.simple_expression.relational_op)
+      type = check_operands(context, node->data.simple_expression.left,
+                            node->data.simple_expression.right,
+                            "em comparacao");
+    else
+      type = node->data.simple_expression.left->sem_type;
+    break;
+  case AST_ADDITIVE_EXPRESSION:
+    if (node->data.additive_expression.add_op)
+      type = check_operands(context, node->data.additive_expression.left,
+                            node->data.additive_expression.right,
+                            "em operacao aritmetica");
+    else
+      type = node->data.additive_expression.left->sem_type;
+    break;
+  case AST_TERM:
+    if (node->data.term.mult_op)
+      type = check_operands(context, node->data.term.left,
+                            node->data.term.right, "em operacao aritmetica");
+    else
+      type = node->data.term.left->sem_type;
+    break;
+  case AST_FACTOR:
+    type = check_factor(node);
+    break;
+  case AST_VARIABLE:
+    type = check_variable(context, node);
+    break;
+  case AST_ACTIVATION:
+    type = check_activation(context, node);
+    break;
+  default:
+    break;
+  }
+
+  node->sem_type = type;
+}
+
+// ----------------------- Statements ----------------------
+
+void semantic_check_return(semantic_context_t *context, ast_node_t *node) {
+  ast_node_t *value = node->data.return_statement.expression;
+  symbol_t *function = context->function;
+
+  if (value) {
+    if (function && function->type == TOKEN_VOID)
+      semantic_error(context, node->line,
+                     "funcao void '%s' retorna um valor", function->name);
+    else
+      require_int(context, value, "como retorno");
+  } else if (function && function->type == TOKEN_INT) {
+    semantic_error(context, node->line,
+                   "funcao '%s' deve retornar um valor int", function->name);
+  }
+}
+
+void semantic_check_condition(semantic_context_t *context, ast_node_t *node) {
+  require_int(context, node, "como condicao");
+}
+
+// ----------------------- Program ----------------------
+
+void semantic_end_program(semantic_context_t *context) {
+  ast_node_t *last = context->last_declaration;
+  symbol_t *main_symbol = symtab_lookup(&context->table, "main");
+
+  // The last declaration must be 'void main(void)'
+  if (!main_symbol || main_symbol->kind != SYM_FUNCTION) {
+    semantic_error(context, last ? last->line : 0,
+                   "funcao 'main' nao foi declarada");
+  } else {
+    ast_node_t *declaration = main_symbol->declaration;
+    if (declaration != last)
+      semantic_error(context, declaration->line,
+                     "'main' deve ser a ultima declaracao do programa");
+    if (main_symbol->type != TOKEN_VOID || main_symbol->param_count != 0)
+      semantic_error(context, declaration->line,
+                     "'main' deve ser declarada como 'void main(void)'");
+  }
+
+  leave_scope(context);
+}
+
+void semantic_declare_function(semantic_context_t *context, ast_node_t *node) {
+  const char *id = node->data.fun_declaration.id;
+  token_types_t type =
+      node->data.fun_declaration.type_specifier->data.type_specifier.type;
+  symbol_t *symbol = declare(context, node, id, SYM_FUNCTION, type);
+
+  context->last_declaration = node;
+  if (!symbol)
+    return;
+
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->data.param_list.param;
+       list = list->data.param_list.param_list)
+    symbol->param_count++;
+
+  if (!symbol->param_count)
+    return;
+
+  symbol->param_kinds =
+      (symbol_kind_t *)malloc(symbol->param_count * sizeof(symbol_kind_t));
+  if (!symbol->param_kinds) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int index = 0;
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->data.param_list.param;
+       list = list->data.param_list.param_list)
+    symbol->param_kinds[index++] =
+        list->data.param_list.param->data.param.dimension ? SYM_ARRAY
+                                                          : SYM_VARIABLE;
+}
+
+void semantic_fused_begin() {
+  FUSED_CONTEXT = (semantic_context_t *)malloc(sizeof(semantic_context_t));
+  if (!FUSED_CONTEXT) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic context.\n");
+    exit(EXIT_FAILURE);
+  }
+  semantic_init(FUSED_CONTEXT);
+}
+
+// ----------------------- Separate Pass ----------------------
+
+static void walk_expression(semantic_context_t *context, ast_node_t *node) {
+  if (!node)
+    return;
+
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    walk_expression(context, node->data.assignment_expression.var_index);
+    walk_expression(context, node->data.assignment_expression.expression);
+    break;
+  case AST_SIMPLE_EXPRESSION:
+    walk_expression(context, node->data.simple_expression.left);
+    walk_expression(context, node->data.simple_expression.right);
+    break;
+  case AST_ADDITIVE_EXPRESSION:
+    walk_expression(context, node->data.additive_expression.left);
+    walk_expression(context, node->data.additive_expression.right);
+    break;
+  case AST_TERM:
+    walk_expression(context, node->data.term.left);
+    walk_expression(context, node->data.term.right);
+    break;
+  case AST_FACTOR:
+    walk_expression(context, node->data.factor.expression);
+    walk_expression(context, node->data.factor.variable);
+    walk_expression(context, node->data.factor.activation);
+    break;
+  case AST_VARIABLE:
+    walk_expression(context, node->data.variable.index);
+    break;
+  case AST_ACTIVATION:
+    for (ast_node_t *list = node->data.activation.args; list;
+         list = list->data.argument_list.arg_list)
+      walk_expression(context, list->data.argument_list.expression);
+    break;
+  default:
+    return;
+  }
+
+  semantic_check_expression(context, node);
+}
+
+static void walk_compound(semantic_context_t *context, ast_node_t *node);
+
+static void walk_statement(semantic_context_t *context, ast_node_t *node) {
+  if (!node)
+    return;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    walk_statement(context, node->data.statement.statement);
+    break;
+  case AST_COMPOUND_DECL:
+    walk_compound(context, node);
+    break;
+  case AST_EXPRESSION_STATEMENT:
+    walk_expression(context, node->data.expression_statement.expression);
+    break;
+  case AST_SELECTION_STATEMENT:
+    walk_expression(context, node->data.selection_statement.expression);
+    semantic_check_condition(context,
+                             node->data.selection_statement.expression);
+    walk_statement(context, node->data.selection_statement.then_statement);
+    walk_statement(context, node->data.selection_statement.else_statement);
+    break;
+  case AST_ITERATION_STATEMENT:
+    walk_expression(context, node->data.iteration_statement.expression);
+    semantic_check_condition(context,
+                             node->data.iteration_statement.expression);
+    walk_statement(context, node->data.iteration_statement.body);
+    break;
+  case AST_RETURN_STATEMENT:
+    walk_expression(context, node->data.return_statement.expression);
+    semantic_check_return(context, node);
+    break;
+  default:
+    break;
+  }
+}
+
+static void walk_compound(semantic_context_t *context, ast_node_t *node) {
+  semantic_begin_block(context);
+
+  for (ast_node_t *list = node->data.compound_decl.local_declarations;
+       list && list->data.local_declarations.var_declaration;
+       list = list->data.local_declarations.local_declarations)
+    semantic_check_var_declaration(
+        context, list->data.local_declarations.var_declaration);
+
+  for (ast_node_t *list = node->data.compound_decl.statement_list;
+       list && list->data.statement_list.statement;
+       list = list->data.statement_list.statement_list)
+    walk_statement(context, list->data.statement_list.statement);
+
+  semantic_end_block(context);
+}
+
+void semantic_walk_function(semantic_context_t *context, ast_node_t *node) {
+  semantic_begin_function(context, node);
+
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->data.param_list.param;
+       list = list->data.param_list.param_list)
+    semantic_check_param(context, list->data.param_list.param);
+
+  walk_compound(context, node->data.fun_declaration.compound_decl);
+
+  semantic_end_function(context, node);
+}
+
+//! Contexts kept after the analysis, so nodes can still point to symbols
+static semantic_context_t **retained = NULL;
+static int retained_count = 0;
+
+void semantic_retain(semantic_context_t *context) {
+  retained = (semantic_context_t **)realloc(
+      retained, (retained_count + 1) * sizeof(semantic_context_t *));
+  if (!retained) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic context.\n");
+    exit(EXIT_FAILURE);
+  }
+  retained[retained_count++] = context;
+}
+
+void semantic_release() {
+  for (int i = 0; i < retained_count; i++) {
+    semantic_destroy(retained[i]);
+    free(retained[i]);
+  }
+  free(retained);
+  retained = NULL;
+  retained_count = 0;
+}
+
+int semantic_analysis(ast_node_t *program) {
+  semantic_context_t *context = FUSED_CONTEXT;
+
+  if (!context && PARALLEL_SEMANTIC)
+    return semantic_parallel_analysis(program, PARALLEL_SEMANTIC);
+
+  // The parser already ran every check and closed the program
+  if (!context) {
+    context = (semantic_context_t *)malloc(sizeof(semantic_context_t));
+    if (!context) {
+      fprintf(stderr, "Error: Memory allocation failed for semantic context.\n");
+      exit(EXIT_FAILURE);
+    }
+    semantic_init(context);
+
+    for (ast_node_t *list = program->data.program.decl_list;
+         list && list->data.decl_list.declaration;
+         list = list->data.decl_list.decl_list) {
+      ast_node_t *declaration =
+          list->data.decl_list.declaration->data.declaration.declaration;
+      if (declaration->type == AST_FUN_DECLARATION)
+        semantic_walk_function(context, declaration);
+      else
+        semantic_check_var_declaration(context, declaration);
+    }
+
+    semantic_end_program(context);
+  }
+
+  semantic_print_diagnostics(context);
+  int errors = context->diagnostic_count;
+
+  semantic_retain(context);
+  FUSED_CONTEXT = NULL;
+
+  return errors;
+}
@@ -0,0 +1,127 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "../parser/parser.h"
+#include "symtab.h"
+
+#include <stdio.h>
+
+//! Global controller to print the symbols of every scope when it closes
+extern int VERBOSE_SEMANTIC;
+
+//! Global controller of the threads checking the function bodies: 0 checks
+//! them sequentially, a negative number uses one thread per core
+extern int PARALLEL_SEMANTIC;
+
+//! Error found by the semantic analysis
+typedef struct {
+  int line;
+  char *message;
+} semantic_diagnostic_t;
+
+//! State of the semantic analysis of a program
+typedef struct {
+  intern_pool_t pool;
+  symtab_t table;
+
+  semantic_diagnostic_t *diagnostics;
+  int diagnostic_count;
+  int diagnostic_capacity;
+
+  symbol_t *function;       // Function whose body is being checked
+  int function_depth;       // Scope depth of its parameters
+  int body_pending;         // Next block is the body, sharing the params scope
+  ast_node_t *last_declaration; // Last top-level declaration seen
+
+  const symtab_t *globals; // Read-only global table (parallel workers only)
+  int visible_globals;     // Globals whose order is lower are visible
+  FILE *output;            // Where the scopes are printed
+} semantic_context_t;
+
+// ----------------------- Semantic Functions ----------------------
+
+//! Sets the option to print the symbols of each scope
+void set_verbose_semantic(int is_verbose);
+
+//! Sets the number of threads checking the function bodies
+void set_parallel_semantic(int threads);
+
+//! Initializes the context with the global scope and the builtins
+//! 'int input(void)' and 'void output(int)'
+void semantic_init(semantic_context_t *context);
+
+//! Frees the context and every symbol
+void semantic_destroy(semantic_context_t *context);
+
+//! Records an error, printf style
+void semantic_error(semantic_context_t *context, int line, const char *format,
+                    ...) __attribute__((format(printf, 3, 4)));
+
+//! Prints every error recorded, in source order
+void semantic_print_diagnostics(const semantic_context_t *context);
+
+//! Checks the whole program. Returns the number of errors found. When the
+//! checks already ran inside the parser, it only finishes them. The symbols
+//! annotated on the nodes stay valid until semantic_release()
+int semantic_analysis(ast_node_t *program);
+
+//! Keeps a context alive until semantic_release()
+void semantic_retain(semantic_context_t *context);
+
+//! Frees the symbols of every analysis
+void semantic_release();
+
+// ----------------------- Semantic Hooks ----------------------
+
+// Each hook checks a single node and annotates it, reading only the
+// annotations of its children. The separate pass calls them from a walk over
+// the tree; with FUSED_SEMANTIC the recursive descent parser calls them as it
+// builds the nodes, in the same order, so both report the same errors
+
+//! Context of the checks fused into the parser, NULL when there's none
+extern semantic_context_t *FUSED_CONTEXT;
+
+//! Starts the fused checks of a program
+void semantic_fused_begin();
+
+//! Declares a function, after its type and identifier, and opens the scope
+//! of its parameters
+void semantic_begin_function(semantic_context_t *context, ast_node_t *node);
+
+//! Declares a function and its signature without checking its parameters
+//! or body (first phase of the parallel analysis)
+void semantic_declare_function(semantic_context_t *context, ast_node_t *node);
+
+//! Checks a whole function declaration: signature and body
+void semantic_walk_function(semantic_context_t *context, ast_node_t *node);
+
+//! Closes the scope of a function after its body
+void semantic_end_function(semantic_context_t *context, ast_node_t *node);
+
+//! Declares a parameter of the current function
+void semantic_check_param(semantic_context_t *context, ast_node_t *node);
+
+//! Declares a global or local variable
+void semantic_check_var_declaration(semantic_context_t *context,
+                                    ast_node_t *node);
+
+//! Opens the scope of a block, at '{'
+void semantic_begin_block(semantic_context_t *context);
+
+//! Closes the scope of a block, at '}'
+void semantic_end_block(semantic_context_t *context);
+
+//! Checks the condition of an 'if' or 'while'
+void semantic_check_condition(semantic_context_t *context, ast_node_t *node);
+
+//! Checks a return against the current function
+void semantic_check_return(semantic_context_t *context, ast_node_t *node);
+
+//! Resolves and types an expression node (assignment, simple, additive, term,
+//! factor, variable or activation)
+void semantic_check_expression(semantic_context_t *context, ast_node_t *node);
+
+//! Checks 'main' and closes the global scope
+void semantic_end_program(semantic_context_t *context);
+
+#endif // !SEMANTIC_H
@@ -0,0 +1,198 @@
+#include "semantic_parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//! Top-level declaration, with the state its function body is checked in
+typedef struct {
+  ast_node_t *declaration;
+  int diagnostic_mark; // Global errors reported before the declaration
+  int visible_globals; // Global symbols declared up to its end
+
+  semantic_context_t *context; // Local scopes of the body (functions only)
+  char *scopes;               // Scopes printed by the worker
+  size_t scopes_size;
+} parallel_item_t;
+
+//! Queue of function bodies shared by the workers
+typedef struct {
+  parallel_item_t *items;
+  int *functions; // Indexes of the items that are functions
+  int function_count;
+  const semantic_context_t *globals;
+  atomic_int next;
+} parallel_work_t;
+
+static void check_body(parallel_item_t *item,
+                       const semantic_context_t *globals) {
+  semantic_context_t *context =
+      (semantic_context_t *)calloc(1, sizeof(semantic_context_t));
+  if (!context) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic context.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  item->context = context;
+  intern_pool_init(&context->pool);
+  symtab_init(&context->table, &context->pool);
+  symtab_enter_scope(&context->table); // Stands for the global scope
+  context->globals = &globals->table;
+  context->visible_globals = item->visible_globals;
+
+  context->output = VERBOSE_SEMANTIC
+                        ? open_memstream(&item->scopes, &item->scopes_size)
+                        : stdout;
+  if (!context->output) {
+    fprintf(stderr, "Error: Memory allocation failed for the scope output.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  semantic_walk_function(context, item->declaration);
+
+  if (VERBOSE_SEMANTIC)
+    fclose(context->output);
+}
+
+static void *semantic_worker(void *argument) {
+  parallel_work_t *work = (parallel_work_t *)argument;
+  int next;
+
+  while ((next = atomic_fetch_add(&work->next, 1)) < work->function_count)
+    check_body(&work->items[work->functions[next]], work->globals);
+
+  return NULL;
+}
+
+//! Moves the errors of a worker to the end of the global list
+static void take_diagnostics(semantic_context_t *globals,
+                             semantic_context_t *worker) {
+  for (int i = 0; i < worker->diagnostic_count; i++) {
+    semantic_error(globals, worker->diagnostics[i].line, "%s",
+                   worker->diagnostics[i].message);
+    free(worker->diagnostics[i].message);
+  }
+  worker->diagnostic_count = 0;
+}
+
+int semantic_parallel_analysis(ast_node_t *program, int threads) {
+  semantic_context_t *globals =
+      (semantic_context_t *)malloc(sizeof(semantic_context_t));
+  parallel_work_t work = {0};
+  int count = 0;
+
+  if (!globals) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic context.\n");
+    exit(EXIT_FAILURE);
+  }
+  semantic_init(globals);
+
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list)
+    count++;
+
+  work.items = (parallel_item_t *)calloc(count ? count : 1,
+                                         sizeof(parallel_item_t));
+  work.functions = (int *)malloc((count ? count : 1) * sizeof(int));
+  if (!work.items || !work.functions) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic work.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // First phase: the global table, in source order
+  int index = 0;
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list, index++) {
+    parallel_item_t *item = &work.items[index];
+
+    item->declaration =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    item->diagnostic_mark = globals->diagnostic_count;
+
+    if (item->declaration->type == AST_FUN_DECLARATION) {
+      semantic_declare_function(globals, item->declaration);
+      work.functions[work.function_count++] = index;
+    } else {
+      semantic_check_var_declaration(globals, item->declaration);
+    }
+
+    item->visible_globals = globals->table.symbol_count;
+  }
+
+  // Second phase: the function bodies, the global table is read-only now
+  if (threads <= 0)
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads > work.function_count)
+    threads = work.function_count;
+
+  work.globals = globals;
+  atomic_init(&work.next, 0);
+
+  pthread_t *pool = (pthread_t *)malloc((threads ? threads : 1) *
+                                        sizeof(pthread_t));
+  if (!pool) {
+    fprintf(stderr, "Error: Memory allocation failed for semantic threads.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int started = 0;
+  for (; started < threads; started++)
+    if (pthread_create(&pool[started], NULL, semantic_worker, &work))
+      break;
+
+  semantic_worker(&work); // Also helps, and finishes the work if no thread started
+
+  for (int t = 0; t < started; t++)
+    pthread_join(pool[t], NULL);
+  free(pool);
+
+  // Merges the errors in source order: those of the declaration itself, then
+  // those of its body
+  semantic_diagnostic_t *global_errors = globals->diagnostics;
+  int global_count = globals->diagnostic_count;
+
+  globals->diagnostics = NULL;
+  globals->diagnostic_count = 0;
+  globals->diagnostic_capacity = 0;
+
+  for (int i = 0; i < count; i++) {
+    parallel_item_t *item = &work.items[i];
+    int end = i + 1 < count ? work.items[i + 1].diagnostic_mark : global_count;
+
+    for (int d = item->diagnostic_mark; d < end; d++)
+      semantic_error(globals, global_errors[d].line, "%s",
+                     global_errors[d].message);
+
+    if (item->declaration->type == AST_FUN_DECLARATION) {
+      take_diagnostics(globals, item->context);
+      if (item->scopes) {
+        fwrite(item->scopes, 1, item->scopes_size, stdout);
+        free(item->scopes);
+      }
+    }
+  }
+
+  for (int d = 0; d < global_count; d++)
+    free(global_errors[d].message);
+  free(global_errors);
+
+  semantic_end_program(globals);
+
+  semantic_print_diagnostics(globals);
+  int errors = globals->diagnostic_count;
+
+  // The symbols stay alive for the stages after the analysis
+  for (int i = 0; i < count; i++)
+    if (work.items[i].declaration->type == AST_FUN_DECLARATION)
+      semantic_retain(work.items[i].context);
+  semantic_retain(globals);
+  free(work.items);
+  free(work.functions);
+
+  return errors;
+}
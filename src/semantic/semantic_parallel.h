@@ -0,0 +1,14 @@
+#ifndef SEMANTIC_PARALLEL_H
+#define SEMANTIC_PARALLEL_H
+
+#include "semantic.h"
+
+//! Checks the program in two phases. The first one declares every global
+//! variable and function signature sequentially; the second checks the
+//! function bodies on a pool of threads, each one with its own local table
+//! and a read-only view of the globals visible at its declaration. Errors
+//! are merged in source order, so the result matches the sequential pass.
+//! Returns the number of errors found
+int semantic_parallel_analysis(ast_node_t *program, int threads);
+
+#endif // !SEMANTIC_PARALLEL_H
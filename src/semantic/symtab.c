@@ -0,0 +1,300 @@
+#include "symtab.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_INITIAL_CAPACITY 256
+#define INTERN_BLOCK_SIZE 4096
+
+static void *checked_realloc(void *pointer, size_t size) {
+  void *result = realloc(pointer, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+// ----------------------- Interned Strings ----------------------
+
+static unsigned int string_hash(const char *string) {
+  unsigned int hash = 2166136261u; // FNV-1a
+  while (*string) {
+    hash ^= (unsigned char)*string++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void intern_pool_init(intern_pool_t *pool) {
+  memset(pool, 0, sizeof(*pool));
+  pool->capacity = INTERN_INITIAL_CAPACITY;
+  pool->keys = (const char **)calloc(pool->capacity, sizeof(char *));
+  pool->hashes = (unsigned int *)calloc(pool->capacity, sizeof(unsigned int));
+  if (!pool->keys || !pool->hashes) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void intern_pool_destroy(intern_pool_t *pool) {
+  for (int i = 0; i < pool->block_count; i++)
+    free(pool->blocks[i]);
+  free(pool->blocks);
+  free(pool->keys);
+  free(pool->hashes);
+  memset(pool, 0, sizeof(*pool));
+}
+
+static int intern_probe(const intern_pool_t *pool, const char *string,
+                        unsigned int hash) {
+  unsigned int mask = pool->capacity - 1;
+  unsigned int index = hash & mask;
+
+  while (pool->keys[index] && (pool->hashes[index] != hash ||
+                               strcmp(pool->keys[index], string) != 0))
+    index = (index + 1) & mask;
+
+  return index;
+}
+
+static void intern_grow(intern_pool_t *pool) {
+  const char **old_keys = pool->keys;
+  unsigned int *old_hashes = pool->hashes;
+  int old_capacity = pool->capacity;
+
+  pool->capacity *= 2;
+  pool->keys = (const char **)calloc(pool->capacity, sizeof(char *));
+  pool->hashes = (unsigned int *)calloc(pool->capacity, sizeof(unsigned int));
+  if (!pool->keys || !pool->hashes) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = 0; i < old_capacity; i++) {
+    if (!old_keys[i])
+      continue;
+    int index = intern_probe(pool, old_keys[i], old_hashes[i]);
+    pool->keys[index] = old_keys[i];
+    pool->hashes[index] = old_hashes[i];
+  }
+
+  free(old_keys);
+  free(old_hashes);
+}
+
+static char *intern_copy(intern_pool_t *pool, const char *string) {
+  size_t length = strlen(string) + 1;
+
+  if (pool->block_count == 0 ||
+      pool->block_used + length > INTERN_BLOCK_SIZE) {
+    pool->blocks = (char **)checked_realloc(
+        pool->blocks, (pool->block_count + 1) * sizeof(char *));
+    pool->blocks[pool->block_count++] =
+        (char *)checked_realloc(NULL, INTERN_BLOCK_SIZE);
+    pool->block_used = 0;
+  }
+
+  char *copy = pool->blocks[pool->block_count - 1] + pool->block_used;
+  memcpy(copy, string, length);
+  pool->block_used += length;
+
+  return copy;
+}
+
+const char *intern(intern_pool_t *pool, const char *string) {
+  unsigned int hash = string_hash(string);
+  int index = intern_probe(pool, string, hash);
+
+  if (pool->keys[index])
+    return pool->keys[index];
+
+  // Keeps the load factor under 1/2
+  if ((pool->count + 1) * 2 > pool->capacity) {
+    intern_grow(pool);
+    index = intern_probe(pool, string, hash);
+  }
+
+  pool->keys[index] = intern_copy(pool, string);
+  pool->hashes[index] = hash;
+  pool->count++;
+
+  return pool->keys[index];
+}
+
+const char *intern_find(const intern_pool_t *pool, const char *string) {
+  return pool->keys[intern_probe(pool, string, string_hash(string))];
+}
+
+// ----------------------- Scoped Symbol Table ----------------------
+
+// Interned keys are unique, so their address is a perfect identity
+static unsigned int key_hash(const char *key) {
+  uint64_t value = (uint64_t)(uintptr_t)key;
+  return (unsigned int)((value * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static int slot_probe(const symtab_t *table, const char *key) {
+  unsigned int mask = table->capacity - 1;
+  unsigned int index = key_hash(key) & mask;
+
+  while (table->slots[index].key && table->slots[index].key != key)
+    index = (index + 1) & mask;
+
+  return index;
+}
+
+// Doubles the map, re-adding the names in the order their slots were
+// created so the LIFO property of the slots still holds
+static void symtab_grow(symtab_t *table) {
+  free(table->slots);
+
+  table->capacity *= 2;
+  table->used = 0;
+  table->slots =
+      (symtab_slot_t *)calloc(table->capacity, sizeof(symtab_slot_t));
+  if (!table->slots) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (int e = 0; e < table->entry_count; e++) {
+    const char *key = table->entries[e].symbol->name;
+    int slot = slot_probe(table, key);
+
+    if (!table->slots[slot].key) {
+      table->slots[slot].key = key;
+      table->used++;
+    }
+    table->slots[slot].entry = e; // Later entries shadow earlier ones
+    table->entries[e].slot = slot;
+  }
+}
+
+static symbol_t *symtab_new_symbol(symtab_t *table) {
+  if (table->chunk_count == 0 || table->chunk_used == SYMBOL_CHUNK_SIZE) {
+    table->chunks = (symbol_t **)checked_realloc(
+        table->chunks, (table->chunk_count + 1) * sizeof(symbol_t *));
+    table->chunks[table->chunk_count++] = (symbol_t *)checked_realloc(
+        NULL, SYMBOL_CHUNK_SIZE * sizeof(symbol_t));
+    table->chunk_used = 0;
+  }
+
+  symbol_t *symbol = &table->chunks[table->chunk_count - 1][table->chunk_used++];
+  memset(symbol, 0, sizeof(*symbol));
+  symbol->order = table->symbol_count++;
+
+  return symbol;
+}
+
+void symtab_init(symtab_t *table, intern_pool_t *pool) {
+  memset(table, 0, sizeof(*table));
+  table->pool = pool;
+  table->capacity = SYMTAB_INITIAL_CAPACITY;
+  table->slots =
+      (symtab_slot_t *)calloc(table->capacity, sizeof(symtab_slot_t));
+  if (!table->slots) {
+    fprintf(stderr, "Error: Memory allocation failed for the symbol table.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void symtab_destroy(symtab_t *table) {
+  for (int c = 0; c < table->chunk_count; c++) {
+    int used = (c == table->chunk_count - 1) ? table->chunk_used
+                                              : SYMBOL_CHUNK_SIZE;
+    for (int s = 0; s < used; s++)
+      free(table->chunks[c][s].param_kinds);
+    free(table->chunks[c]);
+  }
+  free(table->chunks);
+  free(table->slots);
+  free(table->entries);
+  free(table->scope_marks);
+  memset(table, 0, sizeof(*table));
+}
+
+void symtab_enter_scope(symtab_t *table) {
+  if (table->depth == table->scope_capacity) {
+    table->scope_capacity = table->scope_capacity ? table->scope_capacity * 2 : 16;
+    table->scope_marks = (int *)checked_realloc(
+        table->scope_marks, table->scope_capacity * sizeof(int));
+  }
+  table->scope_marks[table->depth++] = table->entry_count;
+}
+
+void symtab_leave_scope(symtab_t *table) {
+  int mark = table->scope_marks[--table->depth];
+
+  while (table->entry_count > mark) {
+    symtab_entry_t *entry = &table->entries[--table->entry_count];
+    symtab_slot_t *slot = &table->slots[entry->slot];
+
+    if (entry->shadowed >= 0) {
+      slot->entry = entry->shadowed;
+    } else {
+      slot->key = NULL;
+      table->used--;
+    }
+  }
+}
+
+symbol_t *symtab_declare(symtab_t *table, const char *name,
+                         symbol_kind_t kind, token_types_t type,
+                         symbol_t **previous) {
+  const char *key = intern(table->pool, name);
+
+  if ((table->used + 1) * 2 > table->capacity)
+    symtab_grow(table);
+
+  int slot = slot_probe(table, key);
+  int shadowed = -1;
+
+  if (table->slots[slot].key) {
+    symbol_t *existing = table->entries[table->slots[slot].entry].symbol;
+    if (existing->scope_depth == table->depth - 1) {
+      if (previous)
+        *previous = existing;
+      return NULL;
+    }
+    shadowed = table->slots[slot].entry;
+  } else {
+    table->slots[slot].key = key;
+    table->used++;
+  }
+
+  if (table->entry_count == table->entry_capacity) {
+    table->entry_capacity = table->entry_capacity ? table->entry_capacity * 2 : 64;
+    table->entries = (symtab_entry_t *)checked_realloc(
+        table->entries, table->entry_capacity * sizeof(symtab_entry_t));
+  }
+
+  symbol_t *symbol = symtab_new_symbol(table);
+  symbol->name = key;
+  symbol->kind = kind;
+  symbol->type = type;
+  symbol->scope_depth = table->depth - 1;
+
+  table->entries[table->entry_count] =
+      (symtab_entry_t){.symbol = symbol, .shadowed = shadowed, .slot = slot};
+  table->slots[slot].entry = table->entry_count++;
+
+  return symbol;
+}
+
+symbol_t *symtab_lookup_interned(const symtab_t *table, const char *key) {
+  if (!key)
+    return NULL;
+
+  int slot = slot_probe(table, key);
+  if (!table->slots[slot].key)
+    return NULL;
+
+  return table->entries[table->slots[slot].entry].symbol;
+}
+
+symbol_t *symtab_lookup(const symtab_t *table, const char *name) {
+  return symtab_lookup_interned(table, intern_find(table->pool, name));
+}
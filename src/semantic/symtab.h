@@ -0,0 +1,126 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include "../parser/parser.h"
+
+#define SYMTAB_INITIAL_CAPACITY 64 // Slots of the hash map, power of two
+#define SYMBOL_CHUNK_SIZE 256      // Symbols allocated at once
+
+// ----------------------- Interned Strings ----------------------
+
+//! Set of unique strings. Interned keys are compared by pointer and carry
+//! their hash, so the scoped table never touches the characters again
+typedef struct {
+  const char **keys;     // Open addressing, NULL is an empty slot
+  unsigned int *hashes;  // String hash of each slot
+  int capacity;          // Power of two
+  int count;
+  char **blocks;         // Storage of the strings, freed all at once
+  int block_count;
+  int block_used;        // Bytes used in the last block
+} intern_pool_t;
+
+//! Initializes an empty pool
+void intern_pool_init(intern_pool_t *pool);
+
+//! Frees the pool and every string interned in it
+void intern_pool_destroy(intern_pool_t *pool);
+
+//! Returns the unique copy of the string, adding it if necessary
+const char *intern(intern_pool_t *pool, const char *string);
+
+//! Returns the unique copy of the string or NULL if it was never interned.
+//! It doesn't modify the pool, so it may run on a shared read-only pool
+const char *intern_find(const intern_pool_t *pool, const char *string);
+
+// ----------------------- Symbols ----------------------
+
+typedef enum {
+  SYM_VARIABLE,
+  SYM_ARRAY,
+  SYM_FUNCTION,
+} symbol_kind_t;
+
+typedef struct symbol {
+  const char *name;          // Interned
+  symbol_kind_t kind;
+  token_types_t type;        // TOKEN_INT or TOKEN_VOID (return type)
+  int is_param;
+  int size;                  // Array dimension, 0 for array parameters
+  int scope_depth;           // 0 for globals
+  int order;                 // Declaration order inside its table
+  int param_count;           // Functions only
+  symbol_kind_t *param_kinds; // Functions only, SYM_VARIABLE or SYM_ARRAY
+  int is_builtin;            // input() and output()
+  ast_node_t *declaration;   // NULL for builtins
+  int location;              // Temporary, frame slot, global or function
+                             // given by the IR lowering or the bytecode
+                             // compiler, or number of the C name
+} symbol_t;
+
+// ----------------------- Scoped Symbol Table ----------------------
+
+//! Declaration inside the scope stack
+typedef struct {
+  symbol_t *symbol;
+  int shadowed; // Entry hidden by this one (same name, outer scope) or -1
+  int slot;     // Slot of the hash map holding the name
+} symtab_entry_t;
+
+//! Slot of the hash map: the innermost visible entry of a name
+typedef struct {
+  const char *key; // Interned name, NULL when empty
+  int entry;
+} symtab_slot_t;
+
+//! Flat open addressing map over a stack of declarations. Entering a scope
+//! pushes a marker; leaving it pops its entries, restoring shadowed names
+//! or emptying their slots. Slots are created and emptied in LIFO order, so
+//! emptying never breaks a probe sequence and no tombstones or rehashing
+//! are needed
+typedef struct {
+  intern_pool_t *pool;
+
+  symtab_slot_t *slots;
+  int capacity; // Power of two
+  int used;
+
+  symtab_entry_t *entries;
+  int entry_count;
+  int entry_capacity;
+
+  int *scope_marks; // Entry count when each open scope started
+  int depth;
+  int scope_capacity;
+
+  symbol_t **chunks; // Symbols are never moved, so nodes can point to them
+  int chunk_count;
+  int chunk_used;
+  int symbol_count;
+} symtab_t;
+
+//! Initializes an empty table (no scope open) using the given pool
+void symtab_init(symtab_t *table, intern_pool_t *pool);
+
+//! Frees the table and all its symbols
+void symtab_destroy(symtab_t *table);
+
+//! Opens a new scope
+void symtab_enter_scope(symtab_t *table);
+
+//! Closes the innermost scope, in O(number of its declarations)
+void symtab_leave_scope(symtab_t *table);
+
+//! Declares a name in the innermost scope. Returns the new symbol, or NULL
+//! if the name already exists in that scope (*previous receives it)
+symbol_t *symtab_declare(symtab_t *table, const char *name,
+                         symbol_kind_t kind, token_types_t type,
+                         symbol_t **previous);
+
+//! Finds the innermost visible declaration of a name, NULL if there's none
+symbol_t *symtab_lookup(const symtab_t *table, const char *name);
+
+//! Same as symtab_lookup(), but for an already interned name
+symbol_t *symtab_lookup_interned(const symtab_t *table, const char *key);
+
+#endif // !SYMTAB_H
@@ -0,0 +1,307 @@
+#include "ast_walk.h"
+#include "../semantic/symtab.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! State of the walk
+typedef struct {
+  const vm_program_t *program;
+  vm_io_t *io;
+  vm_memory_t memory;
+  const vm_function_t *function; // Running
+  int *fp;
+  int depth;
+  int returning; // A return statement is unwinding its function
+  int value;     // Returned
+  jmp_buf error;
+} walker_t;
+
+static int evaluate(walker_t *walker, ast_node_t *node);
+static void execute(walker_t *walker, ast_node_t *node);
+
+static void fail(walker_t *walker, const char *message) {
+  fprintf(stderr, "Error: %s\n", message);
+  longjmp(walker->error, 1);
+}
+
+// ----------------------- Variables ----------------------
+
+//! Address of the first element of an array
+static unsigned base_of(walker_t *walker, const symbol_t *symbol) {
+  if (symbol->scope_depth == 0)
+    return symbol->location;
+  if (symbol->is_param)
+    return walker->fp[symbol->location];
+  return (walker->fp - walker->memory.cells) +
+         walker->function->register_count + symbol->location;
+}
+
+static int *element(walker_t *walker, const symbol_t *symbol,
+                    ast_node_t *index) {
+  unsigned position = evaluate(walker, index);
+  unsigned address = base_of(walker, symbol) + position;
+
+  if (address >= (unsigned)walker->memory.size)
+    fail(walker, "Array access outside the memory of the program.");
+  return &walker->memory.cells[address];
+}
+
+static int *scalar(walker_t *walker, const symbol_t *symbol) {
+  if (symbol->scope_depth == 0)
+    return &walker->memory.cells[symbol->location];
+  return &walker->fp[symbol->location];
+}
+
+// ----------------------- Expressions ----------------------
+
+static int call(walker_t *walker, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *args = node->data.activation.args;
+
+  if (symbol->is_builtin) {
+    if (!strcmp(symbol->name, "input"))
+      return vm_io_input(walker->io);
+    int value = evaluate(walker, args->data.argument_list.expression);
+    vm_io_output(walker->io, value);
+    return value;
+  }
+
+  const vm_function_t *callee = &walker->program->functions[symbol->location];
+  int values[callee->param_count + 1];
+  int count = 0;
+  for (ast_node_t *list = args; list; list = list->data.argument_list.arg_list)
+    values[count++] = evaluate(walker, list->data.argument_list.expression);
+
+  const vm_function_t *caller = walker->function;
+  int *caller_fp = walker->fp;
+  int *fp = caller_fp + caller->frame_size;
+  if (walker->depth == AST_WALK_MAX_DEPTH ||
+      (fp - walker->memory.cells) + callee->frame_size > walker->memory.size)
+    fail(walker, "Stack overflow.");
+
+  memcpy(fp, values, count * sizeof(int));
+  walker->function = callee;
+  walker->fp = fp;
+  walker->depth++;
+
+  ast_node_t *declaration = symbol->declaration;
+  execute(walker, declaration->data.fun_declaration.compound_decl);
+  int value = walker->returning ? walker->value : 0;
+
+  walker->returning = 0;
+  walker->depth--;
+  walker->fp = caller_fp;
+  walker->function = caller;
+  return value;
+}
+
+static int assign(walker_t *walker, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *index = node->data.assignment_expression.var_index;
+
+  if (index) {
+    int *cell = element(walker, symbol, index);
+    int value = evaluate(walker, node->data.assignment_expression.expression);
+    // The memory never moves, the cell is still valid
+    *cell = value;
+    return value;
+  }
+
+  int value = evaluate(walker, node->data.assignment_expression.expression);
+  *scalar(walker, symbol) = value;
+  return value;
+}
+
+static int variable(walker_t *walker, ast_node_t *node) {
+  const symbol_t *symbol = node->symbol;
+
+  if (node->data.variable.index)
+    return *element(walker, symbol, node->data.variable.index);
+  if (symbol->kind == SYM_ARRAY) // Only as an argument
+    return base_of(walker, symbol);
+  return *scalar(walker, symbol);
+}
+
+static int binary(walker_t *walker, int op, ast_node_t *left,
+                  ast_node_t *right) {
+  int x = evaluate(walker, left);
+  int y = evaluate(walker, right);
+
+  switch (op) {
+  case '+':
+    return (int)((unsigned)x + (unsigned)y);
+  case '-':
+    return (int)((unsigned)x - (unsigned)y);
+  case '*':
+    return (int)((unsigned)x * (unsigned)y);
+  case '/':
+    if (!y)
+      fail(walker, "Division by zero.");
+    return y == -1 ? (int)-(unsigned)x : x / y;
+  case TOKEN_LT:
+    return x < y;
+  case TOKEN_LE:
+    return x <= y;
+  case TOKEN_GT:
+    return x > y;
+  case TOKEN_GE:
+    return x >= y;
+  case TOKEN_EQ:
+    return x == y;
+  default:
+    return x != y;
+  }
+}
+
+static int evaluate(walker_t *walker, ast_node_t *node) {
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    return assign(walker, node);
+
+  case AST_SIMPLE_EXPRESSION:
+    if (!node->data.simple_expression.relational_op)
+      return evaluate(walker, node->data.simple_expression.left);
+    return binary(walker,
+                  node->data.simple_expression.relational_op->data
+                      .relational_operator.relop,
+                  node->data.simple_expression.left,
+                  node->data.simple_expression.right);
+
+  case AST_ADDITIVE_EXPRESSION:
+    if (!node->data.additive_expression.add_op)
+      return evaluate(walker, node->data.additive_expression.left);
+    return binary(walker,
+                  node->data.additive_expression.add_op->data
+                      .additive_operator.add_operator,
+                  node->data.additive_expression.left,
+                  node->data.additive_expression.right);
+
+  case AST_TERM:
+    if (!node->data.term.mult_op)
+      return evaluate(walker, node->data.term.left);
+    return binary(walker,
+                  node->data.term.mult_op->data.multiplicative_operator
+                      .mult_operator,
+                  node->data.term.left, node->data.term.right);
+
+  case AST_FACTOR:
+    if (node->data.factor.expression)
+      return evaluate(walker, node->data.factor.expression);
+    if (node->data.factor.variable)
+      return variable(walker, node->data.factor.variable);
+    if (node->data.factor.activation)
+      return call(walker, node->data.factor.activation);
+    return node->data.factor.number;
+
+  default:
+    return 0;
+  }
+}
+
+// ----------------------- Statements ----------------------
+
+static void execute_compound(walker_t *walker, ast_node_t *node) {
+  for (ast_node_t *list = node->data.compound_decl.local_declarations;
+       list && list->data.local_declarations.var_declaration;
+       list = list->data.local_declarations.local_declarations) {
+    ast_node_t *local = list->data.local_declarations.var_declaration;
+    if (!local->data.var_declaration.dimension)
+      walker->fp[local->symbol->location] = 0;
+  }
+
+  for (ast_node_t *list = node->data.compound_decl.statement_list;
+       list && list->data.statement_list.statement && !walker->returning;
+       list = list->data.statement_list.statement_list)
+    execute(walker, list->data.statement_list.statement);
+}
+
+static void execute(walker_t *walker, ast_node_t *node) {
+  if (!node)
+    return;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    execute(walker, node->data.statement.statement);
+    break;
+  case AST_COMPOUND_DECL:
+    execute_compound(walker, node);
+    break;
+  case AST_EXPRESSION_STATEMENT:
+    if (node->data.expression_statement.expression)
+      evaluate(walker, node->data.expression_statement.expression);
+    break;
+  case AST_SELECTION_STATEMENT:
+    if (evaluate(walker, node->data.selection_statement.expression))
+      execute(walker, node->data.selection_statement.then_statement);
+    else
+      execute(walker, node->data.selection_statement.else_statement);
+    break;
+  case AST_ITERATION_STATEMENT:
+    while (!walker->returning &&
+           evaluate(walker, node->data.iteration_statement.expression))
+      execute(walker, node->data.iteration_statement.body);
+    break;
+  case AST_RETURN_STATEMENT:
+    walker->value = node->data.return_statement.expression
+                        ? evaluate(walker,
+                                   node->data.return_statement.expression)
+                        : 0;
+    walker->returning = 1;
+    break;
+  default:
+    break;
+  }
+}
+
+// ----------------------- Program ----------------------
+
+//! Runs the body of main, coming back here on errors
+static int walk_main(walker_t *walker, ast_node_t *body) {
+  if (setjmp(walker->error))
+    return 0;
+  if (walker->program->global_size + walker->function->frame_size >
+      walker->memory.size)
+    fail(walker, "Stack overflow.");
+  execute(walker, body);
+  return 1;
+}
+
+int ast_walk_program(ast_node_t *program, const vm_program_t *bytecode,
+                     vm_io_t *io) {
+  ast_node_t *main_declaration = NULL;
+
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    if (node->type == AST_FUN_DECLARATION &&
+        node->symbol->location == bytecode->main_function)
+      main_declaration = node;
+  }
+  if (!main_declaration) {
+    fprintf(stderr, "Error: The program has no main function.\n");
+    return 0;
+  }
+
+  walker_t *walker = (walker_t *)calloc(1, sizeof(walker_t));
+  if (!walker) {
+    fprintf(stderr, "Error: Memory allocation failed for the AST walk.\n");
+    exit(EXIT_FAILURE);
+  }
+  walker->program = bytecode;
+  walker->io = io;
+  walker->memory = vm_memory_create(bytecode);
+  walker->function = &bytecode->functions[bytecode->main_function];
+  walker->fp = walker->memory.cells + bytecode->global_size;
+
+  int ok =
+      walk_main(walker, main_declaration->data.fun_declaration.compound_decl);
+
+  vm_io_flush(io);
+  vm_memory_destroy(&walker->memory);
+  free(walker);
+  return ok;
+}
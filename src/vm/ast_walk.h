@@ -0,0 +1,15 @@
+#ifndef AST_WALK_H
+#define AST_WALK_H
+
+#include "vm.h"
+
+#define AST_WALK_MAX_DEPTH 10000 // Nested calls, each one recursing in C
+
+//! Runs main by walking the tree, the baseline of the bytecode. It takes
+//! the frames and the memory of the compiled program, so the symbols must
+//! still hold their bytecode locations. Returns 0 when the program stops on
+//! an error, which is already reported
+int ast_walk_program(ast_node_t *program, const vm_program_t *bytecode,
+                     vm_io_t *io);
+
+#endif // !AST_WALK_H
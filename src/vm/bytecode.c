@@ -0,0 +1,595 @@
+#include "bytecode.h"
+#include "../semantic/symtab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//! State of the compilation of a function
+typedef struct {
+  vm_program_t *program;
+  vm_function_t *function;
+  int next_register; // Registers below it hold variables or live values
+  int array_size;    // Ints of the local arrays in scope
+} compiler_t;
+
+static int compile_expression(compiler_t *compiler, ast_node_t *node,
+                              int dst);
+static void compile_statement(compiler_t *compiler, ast_node_t *node);
+
+static int is_global(const symbol_t *symbol) {
+  return symbol->scope_depth == 0;
+}
+
+static int emit(compiler_t *compiler, vm_opcode_t op, int a, int b, int c) {
+  vm_program_t *program = compiler->program;
+
+  if (program->count == program->capacity) {
+    program->capacity = program->capacity ? program->capacity * 2 : 256;
+    program->code = (vm_instr_t *)realloc(
+        program->code, program->capacity * sizeof(vm_instr_t));
+    if (!program->code) {
+      fprintf(stderr, "Error: Memory allocation failed for the bytecode.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  program->code[program->count] = (vm_instr_t){
+      .handler = NULL, .op = op, .a = a, .b = b, .c = c, .d = 0};
+  return program->count++;
+}
+
+//! Access site of an element of the array
+static int new_site(compiler_t *compiler, const symbol_t *symbol) {
+  vm_program_t *program = compiler->program;
+  vm_site_t site = {VM_ARRAY_FRAME, symbol->location, symbol->size};
+
+  if (is_global(symbol))
+    site.kind = VM_ARRAY_GLOBAL;
+  else if (symbol->is_param)
+    site = (vm_site_t){VM_ARRAY_PARAM, symbol->location, 0};
+
+  if (program->site_count == program->site_capacity) {
+    program->site_capacity =
+        program->site_capacity ? program->site_capacity * 2 : 64;
+    program->sites = (vm_site_t *)realloc(
+        program->sites, program->site_capacity * sizeof(vm_site_t));
+    if (!program->sites) {
+      fprintf(stderr, "Error: Memory allocation failed for the bytecode.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  program->sites[program->site_count] = site;
+  return program->site_count++;
+}
+
+static int new_register(compiler_t *compiler) {
+  int reg = compiler->next_register++;
+  if (compiler->next_register > compiler->function->register_count)
+    compiler->function->register_count = compiler->next_register;
+  return reg;
+}
+
+//! The register asked for, or a new one when any will do
+static int target(compiler_t *compiler, int dst) {
+  return dst >= 0 ? dst : new_register(compiler);
+}
+
+//! Copies a value already in a register where it was asked for
+static int place(compiler_t *compiler, int reg, int dst) {
+  if (dst < 0 || dst == reg)
+    return reg;
+  emit(compiler, VM_MOVE, dst, reg, 0);
+  return dst;
+}
+
+// ----------------------- Variables ----------------------
+
+//! Address of the first element of an array, passed as an argument
+static int compile_base(compiler_t *compiler, const symbol_t *symbol,
+                        int dst) {
+  if (is_global(symbol)) {
+    int reg = target(compiler, dst);
+    emit(compiler, VM_LOADK, reg, symbol->location, 0);
+    return reg;
+  }
+  if (symbol->is_param) // Array parameters hold the address
+    return place(compiler, symbol->location, dst);
+
+  int reg = target(compiler, dst);
+  emit(compiler, VM_LEA, reg, symbol->location, 0);
+  return reg;
+}
+
+static int compile_variable(compiler_t *compiler, ast_node_t *node, int dst) {
+  const symbol_t *symbol = node->symbol;
+
+  if (node->data.variable.index) {
+    int index = compile_expression(compiler, node->data.variable.index, -1);
+    int reg = target(compiler, dst);
+    emit(compiler, VM_LOADA, reg, new_site(compiler, symbol), index);
+    return reg;
+  }
+
+  if (symbol->kind == SYM_ARRAY) // Only as an argument
+    return compile_base(compiler, symbol, dst);
+
+  if (is_global(symbol)) {
+    int reg = target(compiler, dst);
+    emit(compiler, VM_LOADG, reg, symbol->location, 0);
+    return reg;
+  }
+
+  return place(compiler, symbol->location, dst);
+}
+
+static int compile_assignment(compiler_t *compiler, ast_node_t *node,
+                              int dst) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *index = node->data.assignment_expression.var_index;
+  ast_node_t *expression = node->data.assignment_expression.expression;
+
+  if (index) {
+    int position = compile_expression(compiler, index, -1);
+    int site = new_site(compiler, symbol);
+    // Not into 'dst' yet, it may be the register of the index
+    int value = compile_expression(compiler, expression, -1);
+    emit(compiler, VM_STOREA, value, site, position);
+    return place(compiler, value, dst);
+  }
+
+  if (is_global(symbol)) {
+    int value = compile_expression(compiler, expression, dst);
+    emit(compiler, VM_STOREG, value, symbol->location, 0);
+    return value;
+  }
+
+  // The value is computed straight into the variable
+  compile_expression(compiler, expression, symbol->location);
+  return place(compiler, symbol->location, dst);
+}
+
+// ----------------------- Expressions ----------------------
+
+static int compile_activation(compiler_t *compiler, ast_node_t *node,
+                              int dst) {
+  const symbol_t *symbol = node->symbol;
+  ast_node_t *args = node->data.activation.args;
+
+  if (symbol->is_builtin) {
+    if (!strcmp(symbol->name, "input")) {
+      int reg = target(compiler, dst);
+      emit(compiler, VM_INPUT, reg, 0, 0);
+      return reg;
+    }
+    int value =
+        compile_expression(compiler, args->data.argument_list.expression, -1);
+    emit(compiler, VM_OUTPUT, value, 0, 0);
+    return place(compiler, value, dst);
+  }
+
+  // The arguments take consecutive registers
+  int first = compiler->next_register;
+  for (int p = 0; p < symbol->param_count; p++)
+    new_register(compiler);
+  int reg = first;
+  for (ast_node_t *list = args; list;
+       list = list->data.argument_list.arg_list)
+    compile_expression(compiler, list->data.argument_list.expression, reg++);
+
+  reg = target(compiler, dst);
+  emit(compiler, VM_CALL, reg, symbol->location, first);
+  return reg;
+}
+
+static vm_opcode_t relational_opcode(token_types_t relop) {
+  switch (relop) {
+  case TOKEN_LT:
+    return VM_LT;
+  case TOKEN_LE:
+    return VM_LE;
+  case TOKEN_GT:
+    return VM_GT;
+  case TOKEN_GE:
+    return VM_GE;
+  case TOKEN_EQ:
+    return VM_EQ;
+  default:
+    return VM_NE;
+  }
+}
+
+static int compile_binary(compiler_t *compiler, vm_opcode_t op,
+                          ast_node_t *left, ast_node_t *right, int dst) {
+  int a = compile_expression(compiler, left, -1);
+  int b = compile_expression(compiler, right, -1);
+  int reg = target(compiler, dst);
+  emit(compiler, op, reg, a, b);
+  return reg;
+}
+
+//! Compiles the expression into 'dst', or into any register when it is
+//! negative, returning the register holding the value. Only the last
+//! instruction writes 'dst'
+static int compile_expression(compiler_t *compiler, ast_node_t *node,
+                              int dst) {
+  switch (node->type) {
+  case AST_ASSIGNMENT_EXPRESSION:
+    return compile_assignment(compiler, node, dst);
+
+  case AST_SIMPLE_EXPRESSION:
+    if (!node->data.simple_expression.relational_op)
+      return compile_expression(compiler, node->data.simple_expression.left,
+                                dst);
+    return compile_binary(
+        compiler,
+        relational_opcode(node->data.simple_expression.relational_op->data
+                              .relational_operator.relop),
+        node->data.simple_expression.left, node->data.simple_expression.right,
+        dst);
+
+  case AST_ADDITIVE_EXPRESSION:
+    if (!node->data.additive_expression.add_op)
+      return compile_expression(compiler,
+                                node->data.additive_expression.left, dst);
+    return compile_binary(compiler,
+                          node->data.additive_expression.add_op->data
+                                      .additive_operator.add_operator == '+'
+                              ? VM_ADD
+                              : VM_SUB,
+                          node->data.additive_expression.left,
+                          node->data.additive_expression.right, dst);
+
+  case AST_TERM:
+    if (!node->data.term.mult_op)
+      return compile_expression(compiler, node->data.term.left, dst);
+    return compile_binary(compiler,
+                          node->data.term.mult_op->data.multiplicative_operator
+                                      .mult_operator == '*'
+                              ? VM_MUL
+                              : VM_DIV,
+                          node->data.term.left, node->data.term.right, dst);
+
+  case AST_FACTOR:
+    if (node->data.factor.expression)
+      return compile_expression(compiler, node->data.factor.expression, dst);
+    if (node->data.factor.variable)
+      return compile_variable(compiler, node->data.factor.variable, dst);
+    if (node->data.factor.activation)
+      return compile_activation(compiler, node->data.factor.activation, dst);
+    break;
+
+  default:
+    break;
+  }
+
+  int reg = target(compiler, dst);
+  emit(compiler, VM_LOADK, reg,
+       node->type == AST_FACTOR ? node->data.factor.number : 0, 0);
+  return reg;
+}
+
+// ----------------------- Statements ----------------------
+
+static void compile_local(compiler_t *compiler, ast_node_t *node) {
+  symbol_t *symbol = node->symbol;
+
+  if (node->data.var_declaration.dimension) {
+    symbol->location = compiler->array_size;
+    compiler->array_size += symbol->size;
+    if (compiler->array_size > compiler->function->frame_size)
+      compiler->function->frame_size = compiler->array_size;
+    return;
+  }
+
+  // Locals start at zero, as in the IR
+  symbol->location = new_register(compiler);
+  emit(compiler, VM_LOADK, symbol->location, 0, 0);
+}
+
+//! The registers and arrays of a block are reused once it ends
+static void compile_compound(compiler_t *compiler, ast_node_t *node) {
+  int registers = compiler->next_register;
+  int arrays = compiler->array_size;
+
+  for (ast_node_t *list = node->data.compound_decl.local_declarations;
+       list && list->data.local_declarations.var_declaration;
+       list = list->data.local_declarations.local_declarations)
+    compile_local(compiler, list->data.local_declarations.var_declaration);
+
+  for (ast_node_t *list = node->data.compound_decl.statement_list;
+       list && list->data.statement_list.statement;
+       list = list->data.statement_list.statement_list)
+    compile_statement(compiler, list->data.statement_list.statement);
+
+  compiler->next_register = registers;
+  compiler->array_size = arrays;
+}
+
+static void compile_selection(compiler_t *compiler, ast_node_t *node) {
+  int condition = compile_expression(
+      compiler, node->data.selection_statement.expression, -1);
+  int branch = emit(compiler, VM_JZ, condition, 0, 0);
+
+  compile_statement(compiler, node->data.selection_statement.then_statement);
+
+  if (node->data.selection_statement.else_statement) {
+    int jump = emit(compiler, VM_JMP, 0, 0, 0);
+    compiler->program->code[branch].b = compiler->program->count;
+    compile_statement(compiler,
+                      node->data.selection_statement.else_statement);
+    compiler->program->code[jump].a = compiler->program->count;
+  } else {
+    compiler->program->code[branch].b = compiler->program->count;
+  }
+}
+
+static void compile_iteration(compiler_t *compiler, ast_node_t *node) {
+  int header = compiler->program->count;
+  int condition = compile_expression(
+      compiler, node->data.iteration_statement.expression, -1);
+  int branch = emit(compiler, VM_JZ, condition, 0, 0);
+
+  compile_statement(compiler, node->data.iteration_statement.body);
+  emit(compiler, VM_JMP, header, 0, 0);
+  compiler->program->code[branch].b = compiler->program->count;
+}
+
+static void compile_return(compiler_t *compiler, ast_node_t *node) {
+  if (!node->data.return_statement.expression) {
+    emit(compiler, VM_RETV, 0, 0, 0);
+    return;
+  }
+  int value =
+      compile_expression(compiler, node->data.return_statement.expression, -1);
+  emit(compiler, VM_RET, value, 0, 0);
+}
+
+//! The temporaries of a statement die with it
+static void compile_statement(compiler_t *compiler, ast_node_t *node) {
+  if (!node)
+    return;
+
+  int registers = compiler->next_register;
+
+  switch (node->type) {
+  case AST_STATEMENT:
+    compile_statement(compiler, node->data.statement.statement);
+    break;
+  case AST_COMPOUND_DECL:
+    compile_compound(compiler, node);
+    break;
+  case AST_EXPRESSION_STATEMENT:
+    if (node->data.expression_statement.expression)
+      compile_expression(compiler,
+                         node->data.expression_statement.expression, -1);
+    break;
+  case AST_SELECTION_STATEMENT:
+    compile_selection(compiler, node);
+    break;
+  case AST_ITERATION_STATEMENT:
+    compile_iteration(compiler, node);
+    break;
+  case AST_RETURN_STATEMENT:
+    compile_return(compiler, node);
+    break;
+  default:
+    break;
+  }
+
+  compiler->next_register = registers;
+}
+
+// ----------------------- Program ----------------------
+
+static void compile_function(compiler_t *compiler, ast_node_t *node) {
+  vm_function_t *function = compiler->function;
+  int start = compiler->program->count;
+  int first_site = compiler->program->site_count;
+
+  function->start = start;
+  compiler->next_register = 0;
+  compiler->array_size = 0;
+
+  for (ast_node_t *list = node->data.fun_declaration.params;
+       list && list->data.param_list.param;
+       list = list->data.param_list.param_list)
+    list->data.param_list.param->symbol->location = new_register(compiler);
+
+  compile_compound(compiler, node->data.fun_declaration.compound_decl);
+
+  // Falling off the end returns, int functions give 0
+  emit(compiler, VM_RETV, 0, 0, 0);
+
+  // The arrays go above the registers, known only now
+  for (int i = start; i < compiler->program->count; i++)
+    if (compiler->program->code[i].op == VM_LEA)
+      compiler->program->code[i].b += function->register_count;
+  for (int i = first_site; i < compiler->program->site_count; i++)
+    if (compiler->program->sites[i].kind == VM_ARRAY_FRAME)
+      compiler->program->sites[i].location += function->register_count;
+  function->frame_size += function->register_count;
+}
+
+vm_program_t *vm_compile_program(ast_node_t *program) {
+  vm_program_t *bytecode = (vm_program_t *)calloc(1, sizeof(vm_program_t));
+  if (!bytecode) {
+    fprintf(stderr, "Error: Memory allocation failed for the bytecode.\n");
+    exit(EXIT_FAILURE);
+  }
+  bytecode->main_function = -1;
+
+  // Every global and function gets its place before any code
+  int capacity = 0;
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list)
+    capacity++;
+  bytecode->functions =
+      (vm_function_t *)calloc(capacity ? capacity : 1, sizeof(vm_function_t));
+  bytecode->globals =
+      (vm_global_t *)calloc(capacity ? capacity : 1, sizeof(vm_global_t));
+  if (!bytecode->functions || !bytecode->globals) {
+    fprintf(stderr, "Error: Memory allocation failed for the bytecode.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+    symbol_t *symbol = node->symbol;
+
+    if (node->type == AST_VAR_DECLARATION) {
+      symbol->location = bytecode->global_size;
+      bytecode->globals[bytecode->global_count++] =
+          (vm_global_t){symbol->name, symbol->location};
+      bytecode->global_size += symbol->kind == SYM_ARRAY ? symbol->size : 1;
+      continue;
+    }
+
+    symbol->location = bytecode->function_count++;
+    vm_function_t *function = &bytecode->functions[symbol->location];
+    function->name = symbol->name;
+    function->param_count = symbol->param_count;
+    if (!strcmp(symbol->name, "main"))
+      bytecode->main_function = symbol->location;
+  }
+
+  compiler_t compiler = {.program = bytecode};
+  for (ast_node_t *list = program->data.program.decl_list;
+       list && list->data.decl_list.declaration;
+       list = list->data.decl_list.decl_list) {
+    ast_node_t *node =
+        list->data.decl_list.declaration->data.declaration.declaration;
+
+    if (node->type == AST_FUN_DECLARATION) {
+      compiler.function = &bytecode->functions[node->symbol->location];
+      compile_function(&compiler, node);
+    }
+  }
+
+  return bytecode;
+}
+
+void vm_program_destroy(vm_program_t *program) {
+  if (!program)
+    return;
+  free(program->code);
+  free(program->sites);
+  free(program->functions);
+  free(program->globals);
+  free(program);
+}
+
+// ----------------------- Printing ----------------------
+
+static const char *OPCODE_NAMES[VM_OPCODE_COUNT] = {
+    "move",   "loadk",   "loadg",  "storeg", "lea",    "loada",   "storea",
+    "add",    "sub",     "mul",    "div",    "lt",     "le",      "gt",
+    "ge",     "eq",      "ne",     "jmp",    "jz",     "call",    "ret",
+    "retv",   "input",   "output", "loadi",  "storei", "loadgi",  "storegi",
+    "loadfi", "storefi", "addk",   "mulk",   "divk",   "ltk",     "lek",
+    "gtk",    "gek",     "eqk",    "nek",    "jlt",    "jle",     "jgt",
+    "jge",    "jeq",     "jne",    "jltk",   "jlek",   "jgtk",    "jgek",
+    "jeqk",   "jnek",    "addk_jmp", "callc",  "calln",
+};
+
+const char *vm_opcode_name(vm_opcode_t op) {
+  return op < VM_OPCODE_COUNT ? OPCODE_NAMES[op] : "?";
+}
+
+int *vm_jump_target(vm_instr_t *instr) {
+  if (instr->op == VM_JMP)
+    return &instr->a;
+  if (instr->op == VM_JZ)
+    return &instr->b;
+  if (instr->op >= VM_JLT && instr->op <= VM_JNEK)
+    return &instr->c;
+  if (instr->op == VM_ADDK_JMP)
+    return &instr->d;
+  return NULL;
+}
+
+int vm_falls_through(vm_opcode_t op) {
+  return op != VM_JMP && op != VM_RET && op != VM_RETV &&
+         op != VM_ADDK_JMP;
+}
+
+//! Last instruction of the function, plus one
+static int function_end(const vm_program_t *program, int f) {
+  return f + 1 < program->function_count ? program->functions[f + 1].start
+                                         : program->count;
+}
+
+void vm_print_program(const vm_program_t *program, FILE *output) {
+  for (int f = 0; f < program->function_count; f++) {
+    const vm_function_t *function = &program->functions[f];
+
+    fprintf(output, "function %s: %d params, %d registers, frame of %d\n",
+            function->name, function->param_count, function->register_count,
+            function->frame_size);
+    for (int i = function->start; i < function_end(program, f); i++) {
+      const vm_instr_t *instr = &program->code[i];
+      fprintf(output, "  %5d  %-8s %d, %d, %d", i, vm_opcode_name(instr->op),
+              instr->a, instr->b, instr->c);
+      if (instr->op == VM_ADDK_JMP)
+        fprintf(output, ", %d", instr->d);
+      if (instr->op == VM_LOADA || instr->op == VM_STOREA) {
+        static const char *kinds[] = {"global", "frame", "param"};
+        const vm_site_t *site = &program->sites[instr->b];
+        fprintf(output, "    ; %s %d", kinds[site->kind], site->location);
+      }
+      fputc('\n', output);
+    }
+  }
+}
+
+//! Pair of opcodes and how many times it appears
+typedef struct {
+  int first;
+  int second;
+  int count;
+} pair_count_t;
+
+static int compare_pairs(const void *a, const void *b) {
+  const pair_count_t *x = (const pair_count_t *)a;
+  const pair_count_t *y = (const pair_count_t *)b;
+  if (x->count != y->count)
+    return y->count - x->count;
+  return x->first != y->first ? x->first - y->first : x->second - y->second;
+}
+
+void vm_print_pair_profile(const vm_program_t *program, FILE *output) {
+  pair_count_t *pairs = (pair_count_t *)calloc(
+      VM_OPCODE_COUNT * VM_OPCODE_COUNT, sizeof(pair_count_t));
+  int total = 0;
+
+  if (!pairs) {
+    fprintf(stderr, "Error: Memory allocation failed for the profile.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < VM_OPCODE_COUNT * VM_OPCODE_COUNT; i++) {
+    pairs[i].first = i / VM_OPCODE_COUNT;
+    pairs[i].second = i % VM_OPCODE_COUNT;
+  }
+
+  // Pairs never cross the end of a function
+  for (int f = 0; f < program->function_count; f++)
+    for (int i = program->functions[f].start + 1; i < function_end(program, f);
+         i++, total++)
+      pairs[program->code[i - 1].op * VM_OPCODE_COUNT + program->code[i].op]
+          .count++;
+
+  qsort(pairs, VM_OPCODE_COUNT * VM_OPCODE_COUNT, sizeof(pair_count_t),
+        compare_pairs);
+
+  fprintf(output, "%d pairs of opcodes\n", total);
+  for (int i = 0; i < VM_OPCODE_COUNT * VM_OPCODE_COUNT && pairs[i].count;
+       i++)
+    fprintf(output, "  %-8s %-8s %8d  %5.1f%%\n",
+            vm_opcode_name(pairs[i].first), vm_opcode_name(pairs[i].second),
+            pairs[i].count, 100.0 * pairs[i].count / total);
+
+  free(pairs);
+}
@@ -0,0 +1,161 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "../parser/parser.h"
+
+#include <stdio.h>
+
+// ----------------------- Instructions ----------------------
+
+//! Register machine opcodes. Registers are the int slots of the frame of
+//! the running function; 'a', 'b', 'c' and 'd' are registers unless noted
+typedef enum {
+  VM_MOVE,   // a = b
+  VM_LOADK,  // a = constant b
+  VM_LOADG,  // a = global scalar at the address b
+  VM_STOREG, // global scalar at the address b = a
+  VM_LEA,    // a = address of the frame slot b
+  VM_LOADA,  // a = element c of the array of the access site b
+  VM_STOREA, // element c of the array of the access site b = a
+  VM_ADD,    // a = b + c, wrapping around
+  VM_SUB,
+  VM_MUL,
+  VM_DIV,    // Truncates toward zero, fails on a zero divisor
+  VM_LT,     // Relational operators give 0 or 1
+  VM_LE,
+  VM_GT,
+  VM_GE,
+  VM_EQ,
+  VM_NE,
+  VM_JMP,    // Goes to the instruction a
+  VM_JZ,     // Goes to the instruction b if a is 0
+  VM_CALL,   // a = function b (registers c, c + 1, ...)
+  VM_RET,    // Returns a
+  VM_RETV,   // Returns 0, for the void functions and their ends
+  VM_INPUT,  // a = input()
+  VM_OUTPUT, // output(a)
+
+  // Array accesses quickened by their first execution
+  VM_LOADI,   // a = memory[b + c], b holding the address of the array
+  VM_STOREI,  // memory[b + c] = a
+  VM_LOADGI,  // a = element c of the global array at the address b, of d
+  VM_STOREGI, // element c of the global array at b, of d elements = a
+  VM_LOADFI,  // a = element c of the local array at the frame slot b, of d
+  VM_STOREFI, // element c of the local array at the slot b, of d elements = a
+
+  // Superinstructions, 'k' being a constant
+  VM_ADDK, // a = b + k c
+  VM_MULK,
+  VM_DIVK, // Divisor other than 0 and -1
+  VM_LTK,  // a = b < k c
+  VM_LEK,
+  VM_GTK,
+  VM_GEK,
+  VM_EQK,
+  VM_NEK,
+  VM_JLT, // Goes to the instruction c if a < b
+  VM_JLE,
+  VM_JGT,
+  VM_JGE,
+  VM_JEQ,
+  VM_JNE,
+  VM_JLTK, // Goes to the instruction c if a < k b
+  VM_JLEK,
+  VM_JGTK,
+  VM_JGEK,
+  VM_JEQK,
+  VM_JNEK,
+  VM_ADDK_JMP, // a = b + k c, then goes to the instruction d
+
+  // Tiered execution, see jit.h
+  VM_CALLC, // CALL counting the calls of b until it runs native code
+  VM_CALLN, // CALL running the native code of b
+
+  VM_OPCODE_COUNT,
+} vm_opcode_t;
+
+typedef struct {
+  const void *handler; // Address of the opcode's code once threaded
+  vm_opcode_t op;
+  int a;
+  int b;
+  int c;
+  int d;
+} vm_instr_t;
+
+typedef enum {
+  VM_ARRAY_GLOBAL, // At a fixed address
+  VM_ARRAY_FRAME,  // At a slot of the frame
+  VM_ARRAY_PARAM,  // Address held by a register
+} vm_array_kind_t;
+
+//! Array named by an access, resolved when it first runs
+typedef struct {
+  vm_array_kind_t kind;
+  int location; // Address, frame slot or register
+  int length;   // Elements, 0 when unknown
+} vm_site_t;
+
+// ----------------------- Programs ----------------------
+
+//! The frame holds the parameters, then the other registers, then the
+//! local arrays
+typedef struct {
+  const char *name;
+  int start; // First instruction
+  int param_count;
+  int register_count;
+  int frame_size; // Registers and local arrays, in ints
+} vm_function_t;
+
+//! Global variable and its address in the memory
+typedef struct {
+  const char *name;
+  int address;
+} vm_global_t;
+
+//! The memory of a program is a single array of ints: the globals at its
+//! start, then the frames, one after the other. Array values are indexes
+//! into it
+typedef struct {
+  vm_instr_t *code;
+  int count;
+  int capacity;
+
+  vm_site_t *sites;
+  int site_count;
+  int site_capacity;
+
+  vm_function_t *functions;
+  int function_count;
+  int main_function;
+  vm_global_t *globals; // In the order of their declarations
+  int global_count;
+  int global_size; // Ints taken by the globals
+
+  int threaded; // The handlers are filled
+} vm_program_t;
+
+//! Compiles a checked program into bytecode. The symbols get their
+//! register, frame slot, global address or function number in 'location',
+//! overwriting the one of the IR lowering
+vm_program_t *vm_compile_program(ast_node_t *program);
+
+void vm_program_destroy(vm_program_t *program);
+
+const char *vm_opcode_name(vm_opcode_t op);
+
+//! Field holding the target of a jump, NULL for the other instructions
+int *vm_jump_target(vm_instr_t *instr);
+
+//! The instruction may go on to the next one
+int vm_falls_through(vm_opcode_t op);
+
+//! Prints the bytecode of every function
+void vm_print_program(const vm_program_t *program, FILE *output);
+
+//! Prints how often each pair of opcodes follows one another in the code,
+//! the most frequent first, which picks the superinstructions
+void vm_print_pair_profile(const vm_program_t *program, FILE *output);
+
+#endif // !BYTECODE_H
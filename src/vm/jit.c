@@ -0,0 +1,290 @@
+#include "jit.h"
+#include "../backend/x86_encode.h"
+#include "../backend/x86_select.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// The machine code only runs on the machine it is made for
+#if defined(__x86_64__) && defined(__linux__)
+#define VM_JIT_NATIVE
+#endif
+
+//! Every native function is called with the most arguments: the extra
+//! registers are ignored and the extra stack slots are popped by the caller
+typedef int (*native_t)(long, long, long, long, long, long, long, long);
+
+static jmp_buf *FAULT_TARGET = NULL; // Set while native code runs
+static char FAULT_STACK[65536];      // The faulting stack may be exhausted
+static const int NO_ARRAYS[VM_JIT_MAX_PARAMS] = {0};
+
+static void *jit_alloc(size_t count, size_t size) {
+  void *result = calloc(count ? count : 1, size);
+  if (!result) {
+    fprintf(stderr, "Error: Memory allocation failed for the JIT.\n");
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+
+static int find_ir_function(const ir_module_t *module, const char *name) {
+  for (int f = 0; f < module->function_count; f++)
+    if (!module->functions[f].is_builtin &&
+        !strcmp(module->functions[f].name, name))
+      return f;
+  return -1;
+}
+
+//! Code symbol of the backend for a C- name, -1 if absent
+static int find_symbol(const x86_module_t *machine, const char *name) {
+  char *symbol = (char *)jit_alloc(strlen(name) + 4, 1);
+  strcpy(symbol, "cm_");
+  strcat(symbol, name);
+  int index = x86_find_symbol(machine, symbol);
+  free(symbol);
+  return index;
+}
+
+// ----------------------- Host ----------------------
+
+static int host_input(void *io) { return vm_io_input((vm_io_t *)io); }
+
+static void host_output(int value, void *io) {
+  vm_io_output((vm_io_t *)io, value);
+}
+
+static void on_fault(int signal) {
+  if (FAULT_TARGET)
+    longjmp(*FAULT_TARGET, signal);
+  raise(signal); // Not in the native code, the default action is back
+}
+
+// ----------------------- Compilation ----------------------
+
+#ifdef VM_JIT_NATIVE
+//! Maps the text and the data of the builtins near the memory of the
+//! program, whose globals the text reaches relative to rip. Returns 0 if
+//! the code cannot be placed
+static int load(vm_jit_t *jit, const x86_module_t *machine,
+                x86_code_t *code) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t text_size = (code->text_size + page - 1) / page * page;
+  size_t data_size = (code->bss_size + page - 1) / page * page;
+  char *end = (char *)(jit->memory->cells + jit->memory->size);
+  void *hint = (void *)(((unsigned long)end + page - 1) / page * page);
+
+  unsigned char *base =
+      (unsigned char *)mmap(hint, text_size + data_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return 0;
+  jit->code = base;
+  jit->code_size = text_size + data_size;
+
+  unsigned long *addresses = (unsigned long *)jit_alloc(
+      machine->symbol_count, sizeof(unsigned long));
+  for (int s = 0; s < machine->symbol_count; s++)
+    addresses[s] = (unsigned long)base + code->symbol_offsets[s] +
+                   (machine->symbols[s].section == X86_SECTION_BSS
+                        ? text_size
+                        : 0);
+  for (int g = 0; g < jit->program->global_count; g++) {
+    const vm_global_t *global = &jit->program->globals[g];
+    int s = find_symbol(machine, global->name);
+    if (s >= 0 && machine->symbols[s].section == X86_SECTION_BSS)
+      addresses[s] = (unsigned long)(jit->memory->cells + global->address);
+  }
+
+  int linked = x86_code_link_at(code, (unsigned long)base, addresses);
+  free(addresses);
+  if (!linked)
+    return 0;
+  memcpy(base, code->text, code->text_size);
+
+  // The hooks, in the data of the builtins
+  struct {
+    const char *symbol;
+    void *value;
+  } hooks[] = {{X86_HOST_CONTEXT, jit->io},
+               {X86_HOST_INPUT, (void *)host_input},
+               {X86_HOST_OUTPUT, (void *)host_output}};
+  for (int h = 0; h < 3; h++) {
+    int s = x86_find_symbol(machine, hooks[h].symbol);
+    memcpy(base + text_size + code->symbol_offsets[s], &hooks[h].value,
+           sizeof(void *));
+  }
+
+  // Written once, never again
+  if (mprotect(base, text_size, PROT_READ | PROT_EXEC))
+    return 0;
+
+  for (int f = 0; f < jit->program->function_count; f++) {
+    int s = find_symbol(machine, jit->program->functions[f].name);
+    if (s >= 0 && machine->symbols[s].section == X86_SECTION_TEXT)
+      jit->entries[f] = base + code->symbol_offsets[s];
+  }
+  jit->text_bytes = code->text_size;
+  return 1;
+}
+#endif
+
+//! Compiles the whole module, leaving every entry NULL on failure
+static void compile(vm_jit_t *jit) {
+  struct timespec start, end;
+
+  jit->compiled = 1;
+#ifdef VM_JIT_NATIVE
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  x86_module_t *machine = x86_select_module(jit->module, X86_ENTRY_HOST);
+  x86_code_t *code = x86_encode_module(machine);
+
+  if (!load(jit, machine, code)) {
+    memset(jit->entries, 0,
+           jit->program->function_count * sizeof(*jit->entries));
+    jit->text_bytes = 0;
+  }
+
+  x86_code_destroy(code);
+  x86_module_destroy(machine);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  jit->compile_ms = (end.tv_sec - start.tv_sec) * 1e3 +
+                    (end.tv_nsec - start.tv_nsec) / 1e6;
+#else
+  (void)start;
+  (void)end;
+#endif
+}
+
+static void tier_up(vm_jit_t *jit, int function) {
+  if (!jit->compiled)
+    compile(jit);
+
+  if (jit->entries[function] && jit->param_is_array[function]) {
+    jit->tiers[function] = VM_TIER_NATIVE;
+    jit->tier_ups++;
+  } else
+    jit->tiers[function] = VM_TIER_INTERPRETED;
+}
+
+// ----------------------- Tiers ----------------------
+
+vm_jit_t *vm_jit_create(vm_program_t *program, ir_module_t *module,
+                        int force) {
+  vm_jit_t *jit = (vm_jit_t *)jit_alloc(1, sizeof(vm_jit_t));
+  int count = program->function_count;
+
+  jit->program = program;
+  jit->module = module;
+  jit->force = force;
+  jit->counters = (int *)jit_alloc(count, sizeof(int));
+  jit->tiers = (vm_tier_t *)jit_alloc(count, sizeof(vm_tier_t));
+  jit->entries = (void **)jit_alloc(count, sizeof(void *));
+  jit->param_is_array = (const int **)jit_alloc(count, sizeof(int *));
+
+  for (int f = 0; f < count; f++) {
+    const vm_function_t *function = &program->functions[f];
+    int ir = find_ir_function(module, function->name);
+
+    // Left without flags, the function is never called natively
+    if (ir >= 0 && function->param_count <= VM_JIT_MAX_PARAMS)
+      jit->param_is_array[f] = module->functions[ir].param_is_array
+                                   ? module->functions[ir].param_is_array
+                                   : NO_ARRAYS;
+  }
+
+  for (int i = 0; i < program->count; i++)
+    if (program->code[i].op == VM_CALL)
+      program->code[i].op = VM_CALLC;
+  program->threaded = 0;
+
+  return jit;
+}
+
+void vm_jit_destroy(vm_jit_t *jit) {
+  if (!jit)
+    return;
+  if (jit->code)
+    munmap(jit->code, jit->code_size);
+  free(jit->counters);
+  free(jit->tiers);
+  free(jit->entries);
+  free(jit->param_is_array);
+  free(jit);
+}
+
+void vm_jit_begin(vm_jit_t *jit, vm_memory_t *memory, vm_io_t *io) {
+  static stack_t stack = {.ss_sp = FAULT_STACK, .ss_size = sizeof(FAULT_STACK)};
+  struct sigaction action;
+
+  jit->memory = memory;
+  jit->io = io;
+
+  // Left by a longjmp, the handler must not keep its signal blocked
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_fault;
+  action.sa_flags = SA_ONSTACK | SA_NODEFER | SA_RESETHAND;
+  sigaltstack(&stack, NULL);
+  sigaction(SIGFPE, &action, NULL);
+  sigaction(SIGSEGV, &action, NULL);
+
+  if (jit->force)
+    for (int f = 0; f < jit->program->function_count; f++)
+      tier_up(jit, f);
+}
+
+void vm_jit_end(vm_jit_t *jit) {
+  (void)jit;
+  signal(SIGFPE, SIG_DFL);
+  signal(SIGSEGV, SIG_DFL);
+}
+
+vm_tier_t vm_jit_count(vm_jit_t *jit, int function) {
+  if (jit->tiers[function] == VM_TIER_COUNTING &&
+      ++jit->counters[function] >= VM_JIT_THRESHOLD)
+    tier_up(jit, function);
+  return jit->tiers[function];
+}
+
+int vm_jit_call(vm_jit_t *jit, int function, const int *args, int *result) {
+  const int *is_array = jit->param_is_array[function];
+  native_t entry = (native_t)jit->entries[function];
+  long values[VM_JIT_MAX_PARAMS] = {0};
+
+  for (int p = 0; p < jit->program->functions[function].param_count; p++)
+    values[p] =
+        is_array[p] ? (long)(jit->memory->cells + args[p]) : (long)args[p];
+
+  // The divisions of the code wrap on -1 and only trap on a zero divisor,
+  // through the runtime, so SIGFPE reads as the error of the interpreter
+  int fault = setjmp(jit->fault);
+  if (fault) {
+    FAULT_TARGET = NULL;
+    fprintf(stderr, "Error: %s\n",
+            fault == SIGFPE
+                ? "Division by zero."
+                : "Stack overflow or invalid memory access in native code.");
+    return 0;
+  }
+
+  FAULT_TARGET = &jit->fault;
+  *result = entry(values[0], values[1], values[2], values[3], values[4],
+                  values[5], values[6], values[7]);
+  FAULT_TARGET = NULL;
+  return 1;
+}
+
+void vm_jit_print_stats(const vm_jit_t *jit, FILE *output) {
+  int native = 0;
+
+  for (int f = 0; f < jit->program->function_count; f++)
+    native += jit->tiers[f] == VM_TIER_NATIVE;
+
+  fprintf(output, "JIT: %d of %d functions native, %d bytes of code compiled in "
+                  "%.3f ms\n",
+          native, jit->program->function_count, jit->text_bytes,
+          jit->compile_ms);
+}
@@ -0,0 +1,75 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "../ir/ir.h"
+#include "vm.h"
+
+#include <setjmp.h>
+
+#define VM_JIT_THRESHOLD 1000 // Calls before the tier-up
+#define VM_JIT_MAX_PARAMS 8   // Functions with more stay interpreted
+
+//! How a function of the bytecode runs
+typedef enum {
+  VM_TIER_COUNTING,    // Interpreted, its calls counted
+  VM_TIER_NATIVE,      // Machine code, from its next call on
+  VM_TIER_INTERPRETED, // For good, no code could be made for it
+} vm_tier_t;
+
+//! Native tier of a program. The machine code comes from the IR module
+//! through the instruction selection, the register allocator and the
+//! encoder of the x86-64 backend, and is loaded into memory mapped by the
+//! process itself. The whole module is compiled when the first function
+//! gets hot, each function switching tier on its own counter. Only calls
+//! count: there is no on-stack replacement, so a function switches at the
+//! start of a call and its running loops finish interpreted, those of main
+//! always
+typedef struct vm_jit {
+  vm_program_t *program;
+  ir_module_t *module;
+  int force; // Every function switches tier before main runs
+
+  int *counters;     // By function of the bytecode
+  vm_tier_t *tiers;
+  void **entries;    // Native code of the functions, NULL if none
+  const int **param_is_array; // NULL for the functions never called natively
+
+  vm_memory_t *memory; // Of the running program, holding the globals
+  vm_io_t *io;
+  unsigned char *code; // Text, then the data of the builtins
+  size_t code_size;    // Bytes mapped
+  int compiled;        // The compilation was tried
+
+  int text_bytes;
+  int tier_ups;
+  double compile_ms;
+  jmp_buf fault; // Where a fault in the native code comes back to
+} vm_jit_t;
+
+//! Prepares the program for a tiered run: its calls become the counting
+//! variants, so the program runs only with this JIT
+//! from then on. The module must be out of SSA form
+vm_jit_t *vm_jit_create(vm_program_t *program, ir_module_t *module,
+                        int force);
+
+void vm_jit_destroy(vm_jit_t *jit);
+
+//! Binds the memory and the input and output of the run, which a JIT
+//! serves only once, and compiles everything when forced. Faults in the
+//! native code are caught until vm_jit_end()
+void vm_jit_begin(vm_jit_t *jit, vm_memory_t *memory, vm_io_t *io);
+
+void vm_jit_end(vm_jit_t *jit);
+
+//! Counts a call of the function, switching its tier when it gets hot.
+//! Returns the tier to run it in
+vm_tier_t vm_jit_count(vm_jit_t *jit, int function);
+
+//! Runs the native code of the function with the registers 'args' as its
+//! arguments, the array ones turning into pointers into the memory. Returns
+//! 0 when the code faults, which is already reported
+int vm_jit_call(vm_jit_t *jit, int function, const int *args, int *result);
+
+void vm_jit_print_stats(const vm_jit_t *jit, FILE *output);
+
+#endif // !JIT_H
@@ -0,0 +1,385 @@
+#include "superinstructions.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! Liveness of the registers of a function, one bit set per instruction
+typedef struct {
+  vm_program_t *program;
+  int start;
+  int end;
+  int words;          // Of a set
+  uint64_t *live_in;  // Before each instruction
+  uint64_t *live_out; // After it
+  char *targets;      // Instructions some jump goes to
+  char *removed;      // Folded into the instruction before them
+  vm_fuse_stats_t *stats;
+} fuser_t;
+
+static void *allocate(size_t count, size_t size) {
+  void *memory = calloc(count ? count : 1, size);
+  if (!memory) {
+    fprintf(stderr, "Error: Memory allocation failed for the bytecode.\n");
+    exit(EXIT_FAILURE);
+  }
+  return memory;
+}
+
+static void add(uint64_t *set, int reg) {
+  set[reg / 64] |= (uint64_t)1 << (reg % 64);
+}
+
+static int contains(const uint64_t *set, int reg) {
+  return (set[reg / 64] >> (reg % 64)) & 1;
+}
+
+// ----------------------- Liveness ----------------------
+
+//! Register written by the instruction, -1 if none
+static int definition(const vm_instr_t *instr) {
+  switch (instr->op) {
+  case VM_STOREG:
+  case VM_STOREA:
+  case VM_STOREI:
+  case VM_STOREGI:
+  case VM_STOREFI:
+  case VM_JMP:
+  case VM_JZ:
+  case VM_RET:
+  case VM_RETV:
+  case VM_OUTPUT:
+    return -1;
+  default:
+    return instr->op >= VM_JLT && instr->op <= VM_JNEK ? -1 : instr->a;
+  }
+}
+
+static void add_uses(const vm_program_t *program, const vm_instr_t *instr,
+                     uint64_t *set) {
+  switch (instr->op) {
+  case VM_LOADK:
+  case VM_LOADG:
+  case VM_LEA:
+  case VM_JMP:
+  case VM_RETV:
+  case VM_INPUT:
+    break;
+  case VM_MOVE:
+  case VM_ADDK:
+  case VM_MULK:
+  case VM_DIVK:
+  case VM_LTK:
+  case VM_LEK:
+  case VM_GTK:
+  case VM_GEK:
+  case VM_EQK:
+  case VM_NEK:
+  case VM_ADDK_JMP:
+    add(set, instr->b);
+    break;
+  case VM_STOREG:
+  case VM_JZ:
+  case VM_RET:
+  case VM_OUTPUT:
+  case VM_JLTK:
+  case VM_JLEK:
+  case VM_JGTK:
+  case VM_JGEK:
+  case VM_JEQK:
+  case VM_JNEK:
+    add(set, instr->a);
+    break;
+  case VM_STOREA:
+  case VM_STOREGI:
+  case VM_STOREFI:
+    add(set, instr->a);
+    // fall through
+  case VM_LOADA:
+  case VM_LOADGI:
+  case VM_LOADFI:
+    add(set, instr->c);
+    if ((instr->op == VM_LOADA || instr->op == VM_STOREA) &&
+        program->sites[instr->b].kind == VM_ARRAY_PARAM)
+      add(set, program->sites[instr->b].location);
+    break;
+  case VM_STOREI:
+    add(set, instr->a);
+    // fall through
+  case VM_LOADI:
+    add(set, instr->b);
+    add(set, instr->c);
+    break;
+  case VM_CALL:
+    for (int p = 0; p < program->functions[instr->b].param_count; p++)
+      add(set, instr->c + p);
+    break;
+  default: // Two registers compared or computed
+    if (instr->op >= VM_JLT && instr->op <= VM_JNE)
+      add(set, instr->a);
+    else
+      add(set, instr->c);
+    add(set, instr->b);
+    break;
+  }
+}
+
+//! Backward dataflow over the instructions of the function until the sets
+//! stop changing
+static void compute_liveness(fuser_t *fuser) {
+  vm_program_t *program = fuser->program;
+  int words = fuser->words;
+  uint64_t *set = (uint64_t *)allocate(words, sizeof(uint64_t));
+  int changed = 1;
+
+  while (changed) {
+    changed = 0;
+    for (int i = fuser->end - 1; i >= fuser->start; i--) {
+      vm_instr_t *instr = &program->code[i];
+      uint64_t *out = &fuser->live_out[(i - fuser->start) * words];
+      int *target = vm_jump_target(instr);
+
+      if (vm_falls_through(instr->op) && i + 1 < fuser->end)
+        for (int w = 0; w < words; w++)
+          out[w] |= fuser->live_in[(i + 1 - fuser->start) * words + w];
+      if (target)
+        for (int w = 0; w < words; w++)
+          out[w] |= fuser->live_in[(*target - fuser->start) * words + w];
+
+      int def = definition(instr);
+      memcpy(set, out, words * sizeof(uint64_t));
+      if (def >= 0)
+        set[def / 64] &= ~((uint64_t)1 << (def % 64));
+      add_uses(program, instr, set);
+
+      uint64_t *in = &fuser->live_in[(i - fuser->start) * words];
+      if (memcmp(in, set, words * sizeof(uint64_t))) {
+        memcpy(in, set, words * sizeof(uint64_t));
+        changed = 1;
+      }
+    }
+  }
+
+  free(set);
+}
+
+//! The register holds nothing needed after the instruction
+static int dead_after(const fuser_t *fuser, int i, int reg) {
+  return !contains(&fuser->live_out[(i - fuser->start) * fuser->words], reg);
+}
+
+// ----------------------- Rules ----------------------
+
+//! Position of the opcode among LT, LE, GT, GE, EQ and NE
+static int relation(vm_opcode_t op, vm_opcode_t first) {
+  return op - first;
+}
+
+//! Relation holding when the given one is false: LT and GE, LE and GT, EQ
+//! and NE
+static const int NEGATED[6] = {3, 2, 1, 0, 5, 4};
+
+//! Relation holding with the operands swapped
+static const int MIRRORED[6] = {2, 3, 0, 1, 4, 5};
+
+//! 'loadk t, k' then an operation reading t once: the constant becomes an
+//! operand of the operation
+static int fuse_constant(fuser_t *fuser, vm_instr_t *first,
+                         vm_instr_t *second, int j) {
+  int t = first->a, k = first->b;
+  vm_instr_t fused = *second;
+
+  if ((second->b == t) == (second->c == t))
+    return 0;
+  if (second->a != t && !dead_after(fuser, j, t))
+    return 0;
+  int other = second->b == t ? second->c : second->b;
+  int constant_right = second->c == t;
+
+  switch (second->op) {
+  case VM_ADD:
+    fused.op = VM_ADDK;
+    break;
+  case VM_MUL:
+    fused.op = VM_MULK;
+    break;
+  case VM_SUB:
+    if (!constant_right)
+      return 0;
+    fused.op = VM_ADDK;
+    k = (int)-(unsigned)k;
+    break;
+  case VM_DIV:
+    if (!constant_right || k == 0 || k == -1)
+      return 0;
+    fused.op = VM_DIVK;
+    break;
+  default: {
+    int r = relation(second->op, VM_LT);
+    fused.op = VM_LTK + (constant_right ? r : MIRRORED[r]);
+    break;
+  }
+  }
+
+  fused.b = other;
+  fused.c = k;
+  *first = fused;
+  fuser->stats->constants++;
+  return 1;
+}
+
+//! A compare then 'jz' on its result: jumps when the relation is false
+static int fuse_branch(fuser_t *fuser, vm_instr_t *first, vm_instr_t *second,
+                       int j) {
+  if (second->a != first->a || !dead_after(fuser, j, first->a))
+    return 0;
+
+  int with_constant = first->op >= VM_LTK;
+  int r = relation(first->op, with_constant ? VM_LTK : VM_LT);
+  vm_instr_t fused = *first;
+
+  fused.op = (with_constant ? VM_JLTK : VM_JLT) + NEGATED[r];
+  fused.a = first->b;
+  fused.b = first->c;
+  fused.c = second->b;
+  *first = fused;
+  fuser->stats->branches++;
+  return 1;
+}
+
+//! An increment then the jump back of its loop
+static int fuse_step(fuser_t *fuser, vm_instr_t *first, vm_instr_t *second,
+                     int j) {
+  (void)j;
+  first->op = VM_ADDK_JMP;
+  first->d = second->a;
+  fuser->stats->steps++;
+  return 1;
+}
+
+typedef int (*fuse_rule_t)(fuser_t *fuser, vm_instr_t *first,
+                           vm_instr_t *second, int j);
+
+//! Pairs fused, picked from the static profile of the benchmark corpus
+//! (--bytecode-profile): 'loadk' before an arithmetic or a compare is a
+//! third of the pairs, a compare before 'jz' and an 'add' before the 'jmp'
+//! of a loop a tenth each
+static const struct {
+  vm_opcode_t first;
+  vm_opcode_t second;
+  fuse_rule_t fuse;
+} RULES[] = {
+    {VM_LOADK, VM_ADD, fuse_constant}, {VM_LOADK, VM_SUB, fuse_constant},
+    {VM_LOADK, VM_MUL, fuse_constant}, {VM_LOADK, VM_DIV, fuse_constant},
+    {VM_LOADK, VM_LT, fuse_constant},  {VM_LOADK, VM_LE, fuse_constant},
+    {VM_LOADK, VM_GT, fuse_constant},  {VM_LOADK, VM_GE, fuse_constant},
+    {VM_LOADK, VM_EQ, fuse_constant},  {VM_LOADK, VM_NE, fuse_constant},
+    {VM_LT, VM_JZ, fuse_branch},       {VM_LE, VM_JZ, fuse_branch},
+    {VM_GT, VM_JZ, fuse_branch},       {VM_GE, VM_JZ, fuse_branch},
+    {VM_EQ, VM_JZ, fuse_branch},       {VM_NE, VM_JZ, fuse_branch},
+    {VM_LTK, VM_JZ, fuse_branch},      {VM_LEK, VM_JZ, fuse_branch},
+    {VM_GTK, VM_JZ, fuse_branch},      {VM_GEK, VM_JZ, fuse_branch},
+    {VM_EQK, VM_JZ, fuse_branch},      {VM_NEK, VM_JZ, fuse_branch},
+    {VM_ADDK, VM_JMP, fuse_step},
+};
+
+// ----------------------- Pass ----------------------
+
+static void fuse_function(fuser_t *fuser) {
+  vm_instr_t *code = fuser->program->code;
+
+  for (int i = fuser->start; i < fuser->end; i++) {
+    int *target = vm_jump_target(&code[i]);
+    if (target)
+      fuser->targets[*target] = 1;
+  }
+
+  compute_liveness(fuser);
+
+  for (int i = fuser->start; i < fuser->end; i++) {
+    if (fuser->removed[i])
+      continue;
+
+    // The fused instruction may start another pair, as 'loadk', 'lt' and
+    // 'jz' becoming 'jgek'
+    int j = i + 1;
+    while (j < fuser->end && !fuser->targets[j]) {
+      int fused = 0;
+      for (size_t r = 0; r < sizeof(RULES) / sizeof(RULES[0]) && !fused; r++)
+        if (RULES[r].first == code[i].op && RULES[r].second == code[j].op)
+          fused = RULES[r].fuse(fuser, &code[i], &code[j], j);
+      if (!fused)
+        break;
+      fuser->removed[j++] = 1;
+    }
+  }
+}
+
+//! Drops the fused instructions, moving the jump targets and the functions
+static void compact(vm_program_t *program, const char *removed) {
+  int *position = (int *)allocate(program->count + 1, sizeof(int));
+  int count = 0;
+
+  for (int i = 0; i < program->count; i++) {
+    position[i] = count;
+    count += !removed[i];
+  }
+  position[program->count] = count;
+
+  count = 0;
+  for (int i = 0; i < program->count; i++) {
+    if (removed[i])
+      continue;
+    vm_instr_t instr = program->code[i];
+    int *target = vm_jump_target(&instr);
+    if (target)
+      *target = position[*target];
+    program->code[count++] = instr;
+  }
+
+  for (int f = 0; f < program->function_count; f++)
+    program->functions[f].start = position[program->functions[f].start];
+  program->count = count;
+  free(position);
+}
+
+void vm_fuse_program(vm_program_t *program, vm_fuse_stats_t *stats) {
+  fuser_t fuser = {.program = program, .stats = stats};
+
+  stats->before += program->count;
+  fuser.targets = (char *)allocate(program->count, 1);
+  fuser.removed = (char *)allocate(program->count, 1);
+
+  for (int f = 0; f < program->function_count; f++) {
+    vm_function_t *function = &program->functions[f];
+    int size;
+
+    fuser.start = function->start;
+    fuser.end = f + 1 < program->function_count
+                    ? program->functions[f + 1].start
+                    : program->count;
+    fuser.words = function->register_count / 64 + 1;
+    size = (fuser.end - fuser.start) * fuser.words;
+    fuser.live_in = (uint64_t *)allocate(size, sizeof(uint64_t));
+    fuser.live_out = (uint64_t *)allocate(size, sizeof(uint64_t));
+
+    fuse_function(&fuser);
+
+    free(fuser.live_in);
+    free(fuser.live_out);
+  }
+
+  compact(program, fuser.removed);
+  stats->after += program->count;
+
+  free(fuser.targets);
+  free(fuser.removed);
+}
+
+void vm_fuse_print_stats(const vm_fuse_stats_t *stats, FILE *output) {
+  fprintf(output,
+          "superinstructions: %ld constants, %ld branches, %ld loop steps, "
+          "%ld instructions down to %ld\n",
+          stats->constants, stats->branches, stats->steps, stats->before,
+          stats->after);
+}
@@ -0,0 +1,23 @@
+#ifndef SUPERINSTRUCTIONS_H
+#define SUPERINSTRUCTIONS_H
+
+#include "bytecode.h"
+
+//! What the fusion of the bytecode did
+typedef struct {
+  long constants; // Constants folded into an arithmetic or a compare
+  long branches;  // Compares folded into the conditional jump after them
+  long steps;     // Increments folded into the jump back of their loop
+  long before;    // Instructions
+  long after;
+} vm_fuse_stats_t;
+
+//! Replaces the most frequent pairs of instructions by a single one, the
+//! second instruction of a pair never being a jump target and the value
+//! passed between them having no other use. Runs before the first
+//! execution, which then quickens the array accesses
+void vm_fuse_program(vm_program_t *program, vm_fuse_stats_t *stats);
+
+void vm_fuse_print_stats(const vm_fuse_stats_t *stats, FILE *output);
+
+#endif // !SUPERINSTRUCTIONS_H
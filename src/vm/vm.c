@@ -0,0 +1,520 @@
+#include "vm.h"
+#include "jit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Labels as values let every handler jump straight to the next one
+#if defined(__GNUC__)
+#define VM_THREADED
+#endif
+
+// ----------------------- Input and Output ----------------------
+
+void vm_io_init(vm_io_t *io) {
+  memset(io, 0, sizeof(*io));
+  io->input_fd = STDIN_FILENO;
+  io->data = io->buffer;
+  io->output_fd = STDOUT_FILENO;
+}
+
+void vm_io_init_memory(vm_io_t *io, const unsigned char *data,
+                       size_t length) {
+  memset(io, 0, sizeof(*io));
+  io->input_fd = -1;
+  io->data = data;
+  io->length = length;
+  io->output_fd = -1;
+}
+
+void vm_io_flush(vm_io_t *io) {
+  int written = 0;
+
+  while (io->output_fd >= 0 && written < io->output_length) {
+    ssize_t count = write(io->output_fd, io->output + written,
+                          io->output_length - written);
+    if (count <= 0)
+      break;
+    written += count;
+  }
+  io->output_length = 0;
+}
+
+//! Next byte of the input, -1 at its end
+static int next_byte(vm_io_t *io) {
+  if (io->position == io->length) {
+    if (io->input_fd < 0)
+      return -1;
+    ssize_t count = read(io->input_fd, io->buffer, VM_IO_BUFFER);
+    if (count <= 0)
+      return -1;
+    io->position = 0;
+    io->length = count;
+  }
+  return io->data[io->position++];
+}
+
+int vm_io_input(vm_io_t *io) {
+  unsigned value = 0;
+  int negative = 0;
+  int byte;
+
+  vm_io_flush(io); // The prompts show before the program waits
+
+  while ((byte = next_byte(io)) >= 0 && byte <= ' ')
+    ;
+  if (byte == '-') {
+    negative = 1;
+    byte = next_byte(io);
+  }
+  for (; byte >= '0' && byte <= '9'; byte = next_byte(io))
+    value = value * 10 + (byte - '0');
+  if (byte >= 0) // Left for the next read
+    io->position--;
+
+  return (int)(negative ? -value : value);
+}
+
+void vm_io_output(vm_io_t *io, int value) {
+  char digits[16];
+  int count = 0;
+  unsigned magnitude = value < 0 ? -(unsigned)value : (unsigned)value;
+
+  digits[count++] = '\n';
+  do {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0)
+    digits[count++] = '-';
+
+  if (io->output_length + count > VM_IO_BUFFER)
+    vm_io_flush(io);
+  while (count) {
+    char byte = digits[--count];
+    io->output[io->output_length++] = byte;
+    io->checksum = io->checksum * 31 + (unsigned char)byte;
+  }
+}
+
+// ----------------------- Memory ----------------------
+
+vm_memory_t vm_memory_create(const vm_program_t *program) {
+  vm_memory_t memory;
+
+  memory.size = program->global_size + VM_STACK_SIZE;
+  memory.cells = (int *)calloc(memory.size, sizeof(int));
+  if (!memory.cells) {
+    fprintf(stderr, "Error: Memory allocation failed for the VM memory.\n");
+    exit(EXIT_FAILURE);
+  }
+  return memory;
+}
+
+void vm_memory_destroy(vm_memory_t *memory) {
+  free(memory->cells);
+  memory->cells = NULL;
+  memory->size = 0;
+}
+
+// ----------------------- Interpreter ----------------------
+
+//! Caller suspended by a call
+typedef struct {
+  vm_instr_t *call; // Receives the returned value in its 'a'
+  int *fp;
+  const vm_function_t *function;
+} vm_frame_t;
+
+#ifdef VM_THREADED
+#define CASE(op) label_##op:
+#define DISPATCH() goto *pc->handler
+#define REWRITE(opcode) (pc->op = (opcode), pc->handler = HANDLERS[opcode])
+#else
+#define CASE(op) case op:
+#define DISPATCH() goto dispatch
+#define REWRITE(opcode) (pc->op = (opcode))
+#endif
+
+#define NEXT()                                                                 \
+  do {                                                                         \
+    pc++;                                                                      \
+    DISPATCH();                                                                \
+  } while (0)
+
+#define BINARY(op, expression)                                                 \
+  CASE(op) {                                                                   \
+    int x = fp[pc->b], y = fp[pc->c];                                          \
+    fp[pc->a] = (expression);                                                  \
+    NEXT();                                                                    \
+  }
+
+#define BINARY_K(op, expression)                                               \
+  CASE(op) {                                                                   \
+    int x = fp[pc->b], k = pc->c;                                              \
+    fp[pc->a] = (expression);                                                  \
+    NEXT();                                                                    \
+  }
+
+//! Compare and jump to 'c'
+#define BRANCH(op, condition)                                                  \
+  CASE(op) {                                                                   \
+    if (condition) {                                                           \
+      pc = code + pc->c;                                                       \
+      DISPATCH();                                                              \
+    }                                                                          \
+    NEXT();                                                                    \
+  }
+
+int vm_run(vm_program_t *program, vm_io_t *io, vm_jit_t *jit) {
+#ifdef VM_THREADED
+  static const void *const HANDLERS[VM_OPCODE_COUNT] = {
+      [VM_MOVE] = &&label_VM_MOVE,
+      [VM_LOADK] = &&label_VM_LOADK,
+      [VM_LOADG] = &&label_VM_LOADG,
+      [VM_STOREG] = &&label_VM_STOREG,
+      [VM_LEA] = &&label_VM_LEA,
+      [VM_LOADA] = &&label_VM_LOADA,
+      [VM_STOREA] = &&label_VM_STOREA,
+      [VM_ADD] = &&label_VM_ADD,
+      [VM_SUB] = &&label_VM_SUB,
+      [VM_MUL] = &&label_VM_MUL,
+      [VM_DIV] = &&label_VM_DIV,
+      [VM_LT] = &&label_VM_LT,
+      [VM_LE] = &&label_VM_LE,
+      [VM_GT] = &&label_VM_GT,
+      [VM_GE] = &&label_VM_GE,
+      [VM_EQ] = &&label_VM_EQ,
+      [VM_NE] = &&label_VM_NE,
+      [VM_JMP] = &&label_VM_JMP,
+      [VM_JZ] = &&label_VM_JZ,
+      [VM_CALL] = &&label_VM_CALL,
+      [VM_RET] = &&label_VM_RET,
+      [VM_RETV] = &&label_VM_RETV,
+      [VM_INPUT] = &&label_VM_INPUT,
+      [VM_OUTPUT] = &&label_VM_OUTPUT,
+      [VM_LOADI] = &&label_VM_LOADI,
+      [VM_STOREI] = &&label_VM_STOREI,
+      [VM_LOADGI] = &&label_VM_LOADGI,
+      [VM_STOREGI] = &&label_VM_STOREGI,
+      [VM_LOADFI] = &&label_VM_LOADFI,
+      [VM_STOREFI] = &&label_VM_STOREFI,
+      [VM_ADDK] = &&label_VM_ADDK,
+      [VM_MULK] = &&label_VM_MULK,
+      [VM_DIVK] = &&label_VM_DIVK,
+      [VM_LTK] = &&label_VM_LTK,
+      [VM_LEK] = &&label_VM_LEK,
+      [VM_GTK] = &&label_VM_GTK,
+      [VM_GEK] = &&label_VM_GEK,
+      [VM_EQK] = &&label_VM_EQK,
+      [VM_NEK] = &&label_VM_NEK,
+      [VM_JLT] = &&label_VM_JLT,
+      [VM_JLE] = &&label_VM_JLE,
+      [VM_JGT] = &&label_VM_JGT,
+      [VM_JGE] = &&label_VM_JGE,
+      [VM_JEQ] = &&label_VM_JEQ,
+      [VM_JNE] = &&label_VM_JNE,
+      [VM_JLTK] = &&label_VM_JLTK,
+      [VM_JLEK] = &&label_VM_JLEK,
+      [VM_JGTK] = &&label_VM_JGTK,
+      [VM_JGEK] = &&label_VM_JGEK,
+      [VM_JEQK] = &&label_VM_JEQK,
+      [VM_JNEK] = &&label_VM_JNEK,
+      [VM_ADDK_JMP] = &&label_VM_ADDK_JMP,
+      [VM_CALLC] = &&label_VM_CALLC,
+      [VM_CALLN] = &&label_VM_CALLN,
+  };
+
+  if (!program->threaded) {
+    for (int i = 0; i < program->count; i++)
+      program->code[i].handler = HANDLERS[program->code[i].op];
+    program->threaded = 1;
+  }
+#endif
+
+  if (program->main_function < 0) {
+    fprintf(stderr, "Error: The program has no main function.\n");
+    return 0;
+  }
+
+  vm_memory_t memory = vm_memory_create(program);
+  int *cells = memory.cells;
+  const unsigned size = memory.size;
+  const vm_function_t *function = &program->functions[program->main_function];
+
+  vm_frame_t *frames = NULL;
+  int depth = 0, capacity = 0;
+
+  vm_instr_t *code = program->code;
+  vm_instr_t *pc = code + function->start;
+  int *fp = cells + program->global_size;
+  int frame_size = function->frame_size;
+  int value, ok = 1;
+
+  if (jit)
+    vm_jit_begin(jit, &memory, io);
+  if (program->global_size + frame_size > memory.size)
+    goto overflow;
+  if (jit && jit->tiers[program->main_function] == VM_TIER_NATIVE) {
+    ok = vm_jit_call(jit, program->main_function, fp, &value);
+    goto done;
+  }
+
+  DISPATCH();
+
+#ifndef VM_THREADED
+dispatch:
+  switch (pc->op) {
+#endif
+
+  CASE(VM_MOVE) {
+    fp[pc->a] = fp[pc->b];
+    NEXT();
+  }
+  CASE(VM_LOADK) {
+    fp[pc->a] = pc->b;
+    NEXT();
+  }
+  CASE(VM_LOADG) {
+    fp[pc->a] = cells[pc->b];
+    NEXT();
+  }
+  CASE(VM_STOREG) {
+    cells[pc->b] = fp[pc->a];
+    NEXT();
+  }
+  CASE(VM_LEA) {
+    fp[pc->a] = (int)(fp - cells) + pc->b;
+    NEXT();
+  }
+  // The first execution resolves the array and rewrites the instruction
+  // into the variant of its kind, which runs from then on
+  CASE(VM_LOADA)
+  CASE(VM_STOREA) {
+    const vm_site_t *site = &program->sites[pc->b];
+    int load = pc->op == VM_LOADA;
+
+    switch (site->kind) {
+    case VM_ARRAY_GLOBAL:
+      REWRITE(load ? VM_LOADGI : VM_STOREGI);
+      break;
+    case VM_ARRAY_FRAME:
+      REWRITE(load ? VM_LOADFI : VM_STOREFI);
+      break;
+    default:
+      REWRITE(load ? VM_LOADI : VM_STOREI);
+      break;
+    }
+    pc->b = site->location;
+    pc->d = site->length;
+    DISPATCH();
+  }
+
+  CASE(VM_LOADI) {
+    unsigned address = (unsigned)fp[pc->b] + (unsigned)fp[pc->c];
+    if (address >= size)
+      goto out_of_bounds;
+    fp[pc->a] = cells[address];
+    NEXT();
+  }
+  CASE(VM_STOREI) {
+    unsigned address = (unsigned)fp[pc->b] + (unsigned)fp[pc->c];
+    if (address >= size)
+      goto out_of_bounds;
+    cells[address] = fp[pc->a];
+    NEXT();
+  }
+
+  // Indexes inside the array need no other check, the ones outside it
+  // still may reach the rest of the memory
+  CASE(VM_LOADGI) {
+    unsigned index = fp[pc->c];
+    if (index >= (unsigned)pc->d && pc->b + index >= size)
+      goto out_of_bounds;
+    fp[pc->a] = cells[pc->b + index];
+    NEXT();
+  }
+  CASE(VM_STOREGI) {
+    unsigned index = fp[pc->c];
+    if (index >= (unsigned)pc->d && pc->b + index >= size)
+      goto out_of_bounds;
+    cells[pc->b + index] = fp[pc->a];
+    NEXT();
+  }
+  CASE(VM_LOADFI) {
+    unsigned index = fp[pc->c];
+    if (index >= (unsigned)pc->d &&
+        (unsigned)(fp - cells) + pc->b + index >= size)
+      goto out_of_bounds;
+    fp[pc->a] = cells[(unsigned)(fp - cells) + pc->b + index];
+    NEXT();
+  }
+  CASE(VM_STOREFI) {
+    unsigned index = fp[pc->c];
+    if (index >= (unsigned)pc->d &&
+        (unsigned)(fp - cells) + pc->b + index >= size)
+      goto out_of_bounds;
+    cells[(unsigned)(fp - cells) + pc->b + index] = fp[pc->a];
+    NEXT();
+  }
+
+  BINARY(VM_ADD, (int)((unsigned)x + (unsigned)y))
+  BINARY(VM_SUB, (int)((unsigned)x - (unsigned)y))
+  BINARY(VM_MUL, (int)((unsigned)x * (unsigned)y))
+  BINARY(VM_LT, x < y)
+  BINARY(VM_LE, x <= y)
+  BINARY(VM_GT, x > y)
+  BINARY(VM_GE, x >= y)
+  BINARY(VM_EQ, x == y)
+  BINARY(VM_NE, x != y)
+
+  CASE(VM_DIV) {
+    int x = fp[pc->b], y = fp[pc->c];
+    if (!y)
+      goto division_by_zero;
+    fp[pc->a] = y == -1 ? (int)-(unsigned)x : x / y;
+    NEXT();
+  }
+
+  BINARY_K(VM_ADDK, (int)((unsigned)x + (unsigned)k))
+  BINARY_K(VM_MULK, (int)((unsigned)x * (unsigned)k))
+  BINARY_K(VM_DIVK, x / k)
+  BINARY_K(VM_LTK, x < k)
+  BINARY_K(VM_LEK, x <= k)
+  BINARY_K(VM_GTK, x > k)
+  BINARY_K(VM_GEK, x >= k)
+  BINARY_K(VM_EQK, x == k)
+  BINARY_K(VM_NEK, x != k)
+
+  BRANCH(VM_JLT, fp[pc->a] < fp[pc->b])
+  BRANCH(VM_JLE, fp[pc->a] <= fp[pc->b])
+  BRANCH(VM_JGT, fp[pc->a] > fp[pc->b])
+  BRANCH(VM_JGE, fp[pc->a] >= fp[pc->b])
+  BRANCH(VM_JEQ, fp[pc->a] == fp[pc->b])
+  BRANCH(VM_JNE, fp[pc->a] != fp[pc->b])
+  BRANCH(VM_JLTK, fp[pc->a] < pc->b)
+  BRANCH(VM_JLEK, fp[pc->a] <= pc->b)
+  BRANCH(VM_JGTK, fp[pc->a] > pc->b)
+  BRANCH(VM_JGEK, fp[pc->a] >= pc->b)
+  BRANCH(VM_JEQK, fp[pc->a] == pc->b)
+  BRANCH(VM_JNEK, fp[pc->a] != pc->b)
+
+  CASE(VM_ADDK_JMP) {
+    fp[pc->a] = (int)((unsigned)fp[pc->b] + (unsigned)pc->c);
+    pc = code + pc->d;
+    DISPATCH();
+  }
+
+  CASE(VM_JMP) {
+    pc = code + pc->a;
+    DISPATCH();
+  }
+  CASE(VM_JZ) {
+    if (!fp[pc->a]) {
+      pc = code + pc->b;
+      DISPATCH();
+    }
+    NEXT();
+  }
+
+  CASE(VM_CALL)
+  call: {
+    const vm_function_t *callee = &program->functions[pc->b];
+    int *callee_fp = fp + frame_size;
+
+    if ((unsigned)(callee_fp - cells) + callee->frame_size > size ||
+        depth == VM_STACK_SIZE)
+      goto overflow;
+    if (depth == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      frames = (vm_frame_t *)realloc(frames, capacity * sizeof(vm_frame_t));
+      if (!frames) {
+        fprintf(stderr,
+                "Error: Memory allocation failed for the VM frames.\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    frames[depth++] = (vm_frame_t){.call = pc, .fp = fp, .function = function};
+
+    for (int p = 0; p < callee->param_count; p++)
+      callee_fp[p] = fp[pc->c + p];
+    fp = callee_fp;
+    function = callee;
+    frame_size = callee->frame_size;
+    pc = code + callee->start;
+    DISPATCH();
+  }
+
+  // The tiered variants turn back into the plain ones once the tier of
+  // their function is settled
+  CASE(VM_CALLC) {
+    vm_tier_t tier = vm_jit_count(jit, pc->b);
+    if (tier == VM_TIER_COUNTING)
+      goto call;
+    REWRITE(tier == VM_TIER_NATIVE ? VM_CALLN : VM_CALL);
+    DISPATCH();
+  }
+  CASE(VM_CALLN) {
+    if (!vm_jit_call(jit, pc->b, fp + pc->c, &value)) {
+      ok = 0;
+      goto done;
+    }
+    fp[pc->a] = value;
+    NEXT();
+  }
+  CASE(VM_RET) {
+    value = fp[pc->a];
+    goto leave;
+  }
+  CASE(VM_RETV) {
+    value = 0;
+    goto leave;
+  }
+
+  CASE(VM_INPUT) {
+    fp[pc->a] = vm_io_input(io);
+    NEXT();
+  }
+  CASE(VM_OUTPUT) {
+    vm_io_output(io, fp[pc->a]);
+    NEXT();
+  }
+
+#ifndef VM_THREADED
+  default:
+    goto done;
+  }
+#endif
+
+leave:
+  if (!depth)
+    goto done;
+  depth--;
+  pc = frames[depth].call;
+  fp = frames[depth].fp;
+  function = frames[depth].function;
+  frame_size = function->frame_size;
+  fp[pc->a] = value;
+  NEXT();
+
+division_by_zero:
+  fprintf(stderr, "Error: Division by zero.\n");
+  ok = 0;
+  goto done;
+out_of_bounds:
+  fprintf(stderr, "Error: Array access outside the memory of the program.\n");
+  ok = 0;
+  goto done;
+overflow:
+  fprintf(stderr, "Error: Stack overflow.\n");
+  ok = 0;
+
+done:
+  if (jit)
+    vm_jit_end(jit);
+  vm_io_flush(io);
+  free(frames);
+  vm_memory_destroy(&memory);
+  return ok;
+}
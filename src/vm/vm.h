@@ -0,0 +1,59 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+
+#define VM_IO_BUFFER 4096     // Bytes read or written at once
+#define VM_STACK_SIZE 8388608 // Ints of the frames, above the globals (32 MB)
+
+//! Buffered input and output of the builtins. Reading stops at the end of
+//! 'data' when there is no descriptor to refill it from
+typedef struct {
+  int input_fd; // -1 when the whole input is in 'data'
+  const unsigned char *data;
+  size_t position;
+  size_t length;
+  unsigned char buffer[VM_IO_BUFFER];
+
+  int output_fd; // -1 discards the output
+  char output[VM_IO_BUFFER];
+  int output_length;
+  unsigned long checksum; // Of everything written, discarded or not
+} vm_io_t;
+
+//! Reads the standard input and writes the standard output
+void vm_io_init(vm_io_t *io);
+
+//! Reads a copy of an input already in memory and discards the output
+void vm_io_init_memory(vm_io_t *io, const unsigned char *data, size_t length);
+
+//! Writes what is left in the buffer
+void vm_io_flush(vm_io_t *io);
+
+//! Next number of the input, as read by the native builtins: blanks are
+//! skipped, a '-' may precede the digits and 0 comes when no number follows
+int vm_io_input(vm_io_t *io);
+
+//! Writes the number and a line break
+void vm_io_output(vm_io_t *io, int value);
+
+//! Memory of a running program: the globals, then the value stack
+typedef struct {
+  int *cells;
+  int size;
+} vm_memory_t;
+
+//! Zeroed memory with room for the globals and the frames
+vm_memory_t vm_memory_create(const vm_program_t *program);
+
+void vm_memory_destroy(vm_memory_t *memory);
+
+struct vm_jit;
+
+//! Runs main. The opcodes are threaded on the first run, dispatching with
+//! computed gotos where the compiler supports them. A program prepared for
+//! tiering runs with its JIT, the others with NULL. Returns 0 when the
+//! program stops on an error, which is already reported
+int vm_run(vm_program_t *program, vm_io_t *io, struct vm_jit *jit);
+
+#endif // !VM_H
@@ -0,0 +1,37 @@
+/* Errors spread over several functions, reported in source order */
+
+int first(int a) {
+  return a + b;
+}
+
+int second(int a[], int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    a[i] = c;
+    i = i + 1;
+  }
+  return n;
+}
+
+void third(void) {
+  int v[3];
+  v = 1;
+  output(v);
+}
+
+int fourth(int x) {
+  int x;
+  return first(x, x);
+}
+
+int fifth(void) {
+  return;
+}
+
+void main(void) {
+  int k;
+  k = second(k, 1);
+  third();
+  output(fourth(d));
+}
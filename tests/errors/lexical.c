@@ -0,0 +1,8 @@
+/* A character no token starts with */
+
+int total;
+
+void main(void) {
+  total = 3 @ 4;
+  output(total);
+}
@@ -0,0 +1,21 @@
+/* Undeclared names, a void variable, misused arrays and returns */
+
+int values[4];
+void nothing;
+
+int count(int a[]) {
+  return a;
+}
+
+void show(void) {
+  return 1;
+}
+
+void main(void) {
+  int x;
+  x = missing + 1;
+  values = 3;
+  x = show();
+  undefined(x);
+  output(count(x));
+}
@@ -0,0 +1,7 @@
+/* A statement missing its semicolon */
+
+int twice(int x) {
+  return x * 2
+}
+
+void main(void) { output(twice(4)); }
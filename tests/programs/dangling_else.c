@@ -0,0 +1,17 @@
+/* An else belongs to the nearest if without one */
+
+int pick(int a, int b) {
+  if (a > 0)
+    if (b > 0)
+      return 1;
+    else
+      return 2;
+  return 3;
+}
+
+void main(void) {
+  output(pick(1, 1));
+  output(pick(1, 0));
+  output(pick(0, 1));
+  output(pick(0, 0));
+}
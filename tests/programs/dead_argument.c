@@ -0,0 +1,11 @@
+/* A division passed to a parameter the callee never reads */
+
+int zero;
+
+int first(int a, int b) { return a; }
+
+void main(void) {
+  output(first(1, 2));
+  output(first(3, zero / zero));
+  output(4);
+}
@@ -0,0 +1,10 @@
+/* A division whose result is unused still fails on a zero divisor */
+
+int zero;
+
+void main(void) {
+  int t;
+  output(1);
+  t = zero / zero;
+  output(2);
+}
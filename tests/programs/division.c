@@ -0,0 +1,23 @@
+/* Division wraps on INT_MIN / -1 and fails on a zero divisor */
+
+int divide(int a, int b) { return a / b; }
+
+void main(void) {
+  int min;
+  int minus;
+  int zero;
+  min = 0 - 2147483647 - 1;
+  minus = 0 - 1;
+  output(min / minus);
+  output(min / (0 - 1));
+  output(divide(min, minus));
+  output(divide(7, minus));
+  output(divide(0 - 7, 2));
+  output(divide(7, 0 - 2));
+  output(divide(100, 7));
+  output(min / 2);
+  output(min / 3);
+  zero = input();
+  output(divide(5, zero));
+  output(1);
+}
@@ -0,0 +1,12 @@
+/* A zero divisor known at compile time */
+
+int divide(int a) { return a / 0; }
+
+void main(void) {
+  int x;
+  x = input();
+  output(x / 1);
+  output(x / (0 - 1));
+  output(divide(x));
+  output(x);
+}
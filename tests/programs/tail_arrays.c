@@ -0,0 +1,57 @@
+/* Tail calls whose arguments point into the frame of the caller */
+
+int get(int a[], int i) {
+  int pad[50];
+  int k;
+  k = 0;
+  while (k < 50) {
+    pad[k] = 0 - 1;
+    k = k + 1;
+  }
+  return a[i] + pad[0] + 1;
+}
+
+int local(void) {
+  int loc[10];
+  int k;
+  k = 0;
+  while (k < 10) {
+    loc[k] = k * 100 + 7;
+    k = k + 1;
+  }
+  return get(loc, 3);
+}
+
+int sum(int a[], int n, int total) {
+  if (n == 0)
+    return total;
+  return sum(a, n - 1, total + a[n - 1]);
+}
+
+int localsum(int n) {
+  int values[20];
+  int k;
+  k = 0;
+  while (k < n) {
+    values[k] = k * k;
+    k = k + 1;
+  }
+  return sum(values, n, 0);
+}
+
+int forward(int a[], int i) { return get(a, i); }
+
+int global[10];
+
+void main(void) {
+  int k;
+  output(local());
+  output(localsum(20));
+  k = 0;
+  while (k < 10) {
+    global[k] = k + 40;
+    k = k + 1;
+  }
+  output(forward(global, 9));
+  output(sum(global, 10, 0));
+}
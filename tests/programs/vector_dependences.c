@@ -0,0 +1,125 @@
+/* Loops the vectorizer must leave alone or split around their
+   dependences, next to plain ones it vectorizes */
+
+int a[103];
+int b[103];
+int c[103];
+
+void reset(void) {
+  int i;
+  i = 0;
+  while (i < 103) {
+    a[i] = i;
+    b[i] = 3 * i + 1;
+    c[i] = 0;
+    i = i + 1;
+  }
+}
+
+int checksum(int v[], int n) {
+  int i;
+  int total;
+  i = 0;
+  total = 0;
+  while (i < n) {
+    total = total * 31 + v[i];
+    i = i + 1;
+  }
+  return total;
+}
+
+/* Both arrays may be the same one */
+void add(int dst[], int x[], int y[], int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    dst[i] = x[i] + y[i];
+    i = i + 1;
+  }
+}
+
+void shift(int dst[], int src[], int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    dst[i] = src[i + 1] - src[i];
+    i = i + 1;
+  }
+}
+
+void main(void) {
+  int i;
+
+  /* Plain, with a trip count that is not a multiple of the width */
+  reset();
+  i = 0;
+  while (i < 103) {
+    c[i] = a[i] + b[i];
+    i = i + 1;
+  }
+  output(checksum(c, 103));
+
+  /* Carried from one iteration to the next */
+  reset();
+  i = 1;
+  while (i < 103) {
+    a[i] = a[i - 1] + b[i];
+    i = i + 1;
+  }
+  output(checksum(a, 103));
+
+  /* Carried over two iterations, less than the width */
+  reset();
+  i = 2;
+  while (i < 103) {
+    a[i] = a[i - 2] - b[i];
+    i = i + 1;
+  }
+  output(checksum(a, 103));
+
+  /* Carried over as many iterations as the width, and over more */
+  reset();
+  i = 4;
+  while (i < 103) {
+    a[i] = a[i - 4] + b[i];
+    i = i + 1;
+  }
+  output(checksum(a, 103));
+  reset();
+  i = 7;
+  while (i < 103) {
+    a[i] = a[i - 7] + 5;
+    i = i + 1;
+  }
+  output(checksum(a, 103));
+
+  /* Reading ahead of the writes */
+  reset();
+  i = 0;
+  while (i < 102) {
+    a[i] = a[i + 1] + b[i];
+    i = i + 1;
+  }
+  output(checksum(a, 103));
+
+  /* Reductions */
+  reset();
+  i = 0;
+  c[0] = 0;
+  while (i < 103) {
+    c[0] = c[0] + a[i] * b[i];
+    i = i + 1;
+  }
+  output(c[0]);
+
+  /* Aliased parameters */
+  reset();
+  add(a, a, a, 103);
+  output(checksum(a, 103));
+  reset();
+  shift(a, a, 102);
+  output(checksum(a, 103));
+  reset();
+  add(b, a, b, 100);
+  output(checksum(b, 103));
+}
@@ -0,0 +1,31 @@
+# Runs cmc twice on one program, with OPTIONS and with OTHER_OPTIONS, and
+# checks both runs print the same and exit the same. Takes CMC, PROGRAM,
+# OPTIONS and OTHER_OPTIONS
+
+execute_process(
+  COMMAND ${CMC} ${OPTIONS} ${PROGRAM}
+  INPUT_FILE /dev/null
+  OUTPUT_VARIABLE output
+  ERROR_VARIABLE error
+  RESULT_VARIABLE status
+)
+execute_process(
+  COMMAND ${CMC} ${OTHER_OPTIONS} ${PROGRAM}
+  INPUT_FILE /dev/null
+  OUTPUT_VARIABLE other_output
+  ERROR_VARIABLE other_error
+  RESULT_VARIABLE other_status
+)
+
+if(NOT output STREQUAL other_output)
+  message(FATAL_ERROR "${PROGRAM} printed with ${OTHER_OPTIONS}:\n"
+                      "${other_output}\ninstead of:\n${output}")
+endif()
+if(NOT error STREQUAL other_error)
+  message(FATAL_ERROR "${PROGRAM} reported with ${OTHER_OPTIONS}:\n"
+                      "${other_error}\ninstead of:\n${error}")
+endif()
+if(NOT status STREQUAL other_status)
+  message(FATAL_ERROR "${PROGRAM} exited with ${other_status} instead of "
+                      "${status} with ${OTHER_OPTIONS}")
+endif()
@@ -0,0 +1,83 @@
+# Runs one sample program through one engine of cmc and checks what it
+# prints against the files next to it, see CMakeLists.txt. Takes CMC, CC,
+# PROGRAM, ENGINE (run, jit, native or c), OPTIONS, the extra options of cmc,
+# and WORK, the path of the files it builds
+
+get_filename_component(directory ${PROGRAM} DIRECTORY)
+get_filename_component(name ${PROGRAM} NAME_WE)
+set(base ${directory}/${name})
+
+set(input /dev/null)
+if(EXISTS ${base}.in)
+  set(input ${base}.in)
+endif()
+
+if(ENGINE STREQUAL "run" OR ENGINE STREQUAL "jit")
+  if(ENGINE STREQUAL "run")
+    set(mode --run)
+  else()
+    set(mode --jit-force)
+  endif()
+  execute_process(
+    COMMAND ${CMC} ${OPTIONS} ${mode} ${PROGRAM}
+    INPUT_FILE ${input}
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error
+    RESULT_VARIABLE status
+  )
+else()
+  if(ENGINE STREQUAL "native")
+    execute_process(
+      COMMAND ${CMC} ${OPTIONS} ${PROGRAM} -o ${WORK}
+      ERROR_VARIABLE build_error
+      RESULT_VARIABLE build_status
+    )
+  else()
+    execute_process(
+      COMMAND ${CMC} ${OPTIONS} --emit-c ${PROGRAM}
+      OUTPUT_FILE ${WORK}.c
+      ERROR_VARIABLE build_error
+      RESULT_VARIABLE build_status
+    )
+    # The translation must build without any warning
+    if(build_status EQUAL 0)
+      execute_process(
+        COMMAND ${CC} -std=c11 -Wall -Wextra -Werror -O2 ${WORK}.c -o ${WORK}
+        ERROR_VARIABLE build_error
+        RESULT_VARIABLE build_status
+      )
+    endif()
+  endif()
+  if(NOT build_status EQUAL 0)
+    message(FATAL_ERROR "Building ${PROGRAM} failed:\n${build_error}")
+  endif()
+
+  execute_process(
+    COMMAND ${WORK}
+    INPUT_FILE ${input}
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error
+    RESULT_VARIABLE status
+  )
+endif()
+
+file(READ ${base}.out expected_output)
+set(expected_error "")
+set(expected_status 0)
+if(EXISTS ${base}.err)
+  file(READ ${base}.err expected_error)
+  set(expected_status 1)
+endif()
+
+if(NOT output STREQUAL expected_output)
+  message(FATAL_ERROR
+          "${PROGRAM} printed:\n${output}\ninstead of:\n${expected_output}")
+endif()
+if(NOT error STREQUAL expected_error)
+  message(FATAL_ERROR
+          "${PROGRAM} reported:\n${error}\ninstead of:\n${expected_error}")
+endif()
+if(NOT status STREQUAL expected_status)
+  message(FATAL_ERROR
+          "${PROGRAM} exited with ${status} instead of ${expected_status}")
+endif()
@@ -0,0 +1,28 @@
+/* Every index is valid: the checks, hoisted or not, never fail */
+
+int grid[100];
+
+int sum(int v[], int first, int last) {
+  int total;
+  total = 0;
+  while (first <= last) {
+    total = total + v[first];
+    first = first + 1;
+  }
+  return total;
+}
+
+void main(void) {
+  int i;
+  int n;
+  i = 0;
+  while (i < 100) {
+    grid[i] = i;
+    i = i + 1;
+  }
+  n = input();
+  output(sum(grid, 0, 99));
+  output(sum(grid, n, 99));
+  output(sum(grid, 0, n));
+  output(grid[n]);
+}
@@ -0,0 +1,14 @@
+/* A negative index fails as one past the end does */
+
+void main(void) {
+  int local[5];
+  int i;
+  i = 0;
+  while (i < 5) {
+    local[i] = i;
+    i = i + 1;
+  }
+  output(local[4]);
+  i = input();
+  output(local[i]);
+}
@@ -0,0 +1,21 @@
+/* A loop writing past the end stops before the output after it */
+
+int values[10];
+
+void main(void) {
+  int i;
+  int n;
+  i = 0;
+  while (i < 10) {
+    values[i] = i * 2;
+    i = i + 1;
+  }
+  output(values[9]);
+  n = input();
+  i = 0;
+  while (i < n) {
+    values[i] = i;
+    i = i + 1;
+  }
+  output(values[0]);
+}
@@ -0,0 +1,19 @@
+/* The iterations before the faulty one still print with -O */
+
+int values[10];
+
+void fill(int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    output(i);
+    values[i] = i;
+    i = i + 1;
+  }
+  output(i);
+}
+
+void main(void) {
+  fill(10);
+  fill(input());
+}